@@ -57,6 +57,8 @@
 #include <soundswallower/bin_mdef.h>
 #include <soundswallower/tmat.h>
 #include <soundswallower/hmm.h>
+#include <soundswallower/workpool.h>
+#include <soundswallower/vad.h>
 
 #ifdef __cplusplus
 extern "C" {
@@ -98,6 +100,7 @@ struct ps_mllr_s {
  * Acoustic model parameter structure. 
  */
 typedef struct ps_mgau_s ps_mgau_t;
+typedef struct acmod_s acmod_t;
 
 typedef struct ps_mgaufuncs_s {
     char const *name;
@@ -112,11 +115,22 @@ typedef struct ps_mgaufuncs_s {
     int (*transform)(ps_mgau_t *mgau,
                      ps_mllr_t *mllr);
     void (*free)(ps_mgau_t *mgau);
+    /* Optional: precompute what can be precomputed for a block of
+     * upcoming frames, returning the number of frames done. */
+    int (*frame_eval_block)(ps_mgau_t *mgau,
+                            mfcc_t ***feats,
+                            int32 frame,
+                            int32 n_frames);
+    /* Create a new scorer for acmod using the same parameters. */
+    ps_mgau_t *(*share)(ps_mgau_t *mgau,
+                        acmod_t *acmod);
 } ps_mgaufuncs_t;    
 
 struct ps_mgau_s {
     ps_mgaufuncs_t *vt;  /**< vtable of mgau functions. */
     int frame_idx;       /**< frame counter. */
+    ps_mgau_t *shared;   /**< Scorer owning the parameters (or NULL if we do). */
+    int block_size;      /**< Frames to score at once if -gmmblock is 0 (or 0). */
 };
 
 #define ps_mgau_base(mg) ((ps_mgau_t *)(mg))
@@ -127,6 +141,10 @@ struct ps_mgau_s {
     (*ps_mgau_base(mg)->vt->transform)(mg, mllr)
 #define ps_mgau_free(mg)                                  \
     (*ps_mgau_base(mg)->vt->free)(mg)
+#define ps_mgau_frame_eval_block(mg,feats,frame,n_frames)        \
+    (*ps_mgau_base(mg)->vt->frame_eval_block)(mg, feats, frame, n_frames)
+#define ps_mgau_share(mg,acmod)                                  \
+    (*ps_mgau_base(mg)->vt->share)(mg, acmod)
 
 /**
  * Acoustic model structure.
@@ -154,10 +172,13 @@ struct acmod_s {
     cmd_ln_t *config;          /**< Configuration. */
     logmath_t *lmath;          /**< Log-math computation. */
     glist_t strings;           /**< Temporary acoustic model filenames. */
+    int refcount;              /**< Reference count. */
+    acmod_t *shared;           /**< Acoustic model whose parameters we use (or NULL). */
 
     /* Feature computation: */
     fe_t *fe;                  /**< Acoustic feature computation. */
     feat_t *fcb;               /**< Dynamic feature computation. */
+    vad_t *vad;                /**< Silence detection for live input (or NULL). */
 
     /* Model parameters: */
     bin_mdef_t *mdef;          /**< Model definition. */
@@ -172,27 +193,34 @@ struct acmod_s {
     int senscr_frame;          /**< Frame index for senone_scores. */
     int n_senone_active;       /**< Number of active GMMs. */
     int log_zero;              /**< Zero log-probability value. */
+    mfcc_t ***block_feat;      /**< Upcoming frames for ps_mgau_frame_eval_block(). */
+    int block_size;            /**< Maximum number of frames in a block (or 0). */
+    int block_end;             /**< Frame after the last block. */
+    workpool_t *pipe;          /**< Thread scoring the next frame ahead of search (or NULL). */
+    int16 *pipe_scores;        /**< Scores computed ahead, swapped with senone_scores. */
+    int pipe_frame;            /**< Frame index for pipe_scores (or -1). */
+    int pipe_feat_idx;         /**< Its position in feat_buf. */
+    uint8 pipe_busy;           /**< Is the thread still working on it? */
 
     /* Utterance processing: */
-    mfcc_t **mfc_buf;   /**< Temporary buffer of acoustic features. */
+    mfcc_t **mfc_buf;   /**< Temporary buffer of acoustic features for whole
+                           utterances (live input goes directly into fcb). */
     mfcc_t ***feat_buf; /**< Temporary buffer of dynamic features. */
-    long *framepos;     /**< File positions of recent frames in senone file. */
+    int16 **senscr_buf; /**< Senone scores for recent frames, if input directly. */
 
     /* A whole bunch of flags and counters: */
     uint8 state;        /**< State of utterance processing. */
     uint8 compallsen;   /**< Compute all senones? */
     uint8 grow_feat;    /**< Whether to grow feat_buf. */
-    uint8 insen_swap;   /**< Whether to swap input senone score. */
+    uint8 insenscr;     /**< Are senone scores input directly? */
+    uint8 full_utt;     /**< Was the whole utterance input at once? */
 
     frame_idx_t output_frame; /**< Index of next frame of dynamic features. */
     frame_idx_t n_mfc_alloc;  /**< Number of frames allocated in mfc_buf */
-    frame_idx_t n_mfc_frame;  /**< Number of frames active in mfc_buf */
-    frame_idx_t mfc_outidx;   /**< Start of active frames in mfc_buf */
     frame_idx_t n_feat_alloc; /**< Number of frames allocated in feat_buf */
     frame_idx_t n_feat_frame; /**< Number of frames active in feat_buf */
     frame_idx_t feat_outidx;  /**< Start of active frames in feat_buf */
 };
-typedef struct acmod_s acmod_t;
 
 /**
  * Initialize an acoustic model.
@@ -223,6 +251,35 @@ acmod_t *acmod_create(cmd_ln_t *config, logmath_t *lmath, fe_t *fe, feat_t *fcb)
  */
 int acmod_load_am(acmod_t *acmod);
 
+/**
+ * Use the parameters of another acoustic model instead of loading files.
+ *
+ * The model definition, transition matrices and Gaussian parameters
+ * are shared with <code>other</code>, which is retained, while the
+ * state needed for scoring is private to <code>acmod</code>.
+ * Neither of them can be adapted with acmod_update_mllr() afterwards.
+ *
+ * @return 0 for success, <0 if other is not loaded or not compatible.
+ */
+int acmod_share_am(acmod_t *acmod, acmod_t *other);
+
+/**
+ * Move the parameters of an acoustic model into a new one, and share
+ * them from there.
+ *
+ * The new acoustic model has none of the feature computation or
+ * scoring state of <code>acmod</code>, so it can be shared with
+ * acmod_share_am() without affecting it.  If <code>acmod</code> is
+ * already sharing parameters, the model it shares them from is
+ * returned instead.
+ *
+ * @param fe Feature extraction for the new acoustic model.
+ * @param fcb Dynamic feature computation for the new acoustic model.
+ * @return New acoustic model, to be released with acmod_free(), or
+ * NULL if it is not loaded or cannot be shared.
+ */
+acmod_t *acmod_split_am(acmod_t *acmod, fe_t *fe, feat_t *fcb);
+
 /**
  * Initialize senone scoring (after loading acoustic model files).
  */
@@ -258,10 +315,17 @@ int acmod_feat_mismatch(acmod_t *acmod, feat_t *fcb);
  */
 ps_mllr_t *acmod_update_mllr(acmod_t *acmod, ps_mllr_t *mllr);
 
+/**
+ * Retain a pointer to an acoustic model.
+ */
+acmod_t *acmod_retain(acmod_t *acmod);
+
 /**
  * Finalize an acoustic model.
+ *
+ * @return new reference count (0 if freed)
  */
-void acmod_free(acmod_t *acmod);
+int acmod_free(acmod_t *acmod);
 
 /**
  * Mark the start of an utterance.
@@ -298,6 +362,17 @@ int acmod_rewind(acmod_t *acmod);
  */
 int acmod_advance(acmod_t *acmod);
 
+/**
+ * Map a frame index to a frame of input in the current utterance.
+ *
+ * These are the same unless silence was dropped from live input by
+ * voice activity detection (the -vad option), in which case frame
+ * indices only count the frames which were kept.
+ *
+ * @return Index of the same frame in the input.
+ */
+int acmod_input_frame(acmod_t *acmod, int frame_idx);
+
 /**
  * Set memory allocation policy for utterance processing.
  *
@@ -381,6 +456,28 @@ int acmod_process_cep(acmod_t *acmod,
 int acmod_process_feat(acmod_t *acmod,
                        mfcc_t **feat);
 
+/**
+ * Feed precomputed senone scores into the acoustic model.
+ *
+ * These take the place of features in the queue of frames, and
+ * acmod_score() will simply return them instead of evaluating the
+ * acoustic model.  They must be in the same units it would use,
+ * i.e. negated log-likelihoods in the base of acmod->lmath, shifted
+ * right by SENSCR_SHIFT bits, so that smaller is better (ideally the
+ * best score in each frame is 0).  Scores and features cannot be
+ * mixed in the same utterance.
+ *
+ * @param inout_senscr In: Pointer to scores for consecutive frames,
+ *                     each bin_mdef_n_sen(acmod->mdef) long
+ *                     Out: Pointer to next frame to be read
+ * @param inout_n_frames In: Number of frames available
+ *                      Out: Number of frames remaining
+ * @return Number of frames of data processed, or -1 on error.
+ */
+int acmod_process_senscr(acmod_t *acmod,
+                         int16 const **inout_senscr,
+                         int *inout_n_frames);
+
 /**
  * Get a frame of dynamic feature data.
  *
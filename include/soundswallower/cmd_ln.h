@@ -227,6 +227,22 @@ cmd_ln_t *cmd_ln_parse_r(cmd_ln_t *inout_cmdln, /**< In/Out: Previous command-li
                                                    arguments, or no arguments? */
     );
 
+/**
+ * Parse arguments from a buffer in the same format as
+ * cmd_ln_parse_file_r(), for instance a section of a precompiled
+ * model.
+ *
+ * @return A cmd_ln_t containing the results of command line parsing, or NULL on failure.
+ */
+cmd_ln_t *cmd_ln_parse_buf_r(cmd_ln_t *inout_cmdln, /**< In/Out: Previous command-line to update,
+                                                     or NULL to create a new one. */
+                             arg_t const *defn,   /**< In: Array of argument name definitions*/
+                             char const *buf,     /**< In: Arguments, not NUL-terminated */
+                             size_t buflen,       /**< In: Length of buf */
+                             int32 strict         /**< In: Fail on duplicate or unknown
+                                                     arguments, or no arguments? */
+    );
+
 #ifndef __EMSCRIPTEN__
 /**
  * Parse an arguments file by deliminating on " \r\t\n" and putting each tokens
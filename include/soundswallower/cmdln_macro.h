@@ -171,7 +171,7 @@
 { "-hmm",                                                                       \
       REQARG_STRING,                                                            \
       NULL,                                                                     \
-      "Directory containing acoustic model files."},                            \
+      "Directory containing acoustic model files, or precompiled model file."}, \
 { "-featparams",                                                                \
       ARG_STRING,                                                               \
       NULL,                                                                     \
@@ -200,6 +200,18 @@
       ARG_STRING,                                                               \
       NULL,                                                                     \
       "Mixture gaussian variances input file" },                                \
+{ "-gauden",                                                                    \
+      ARG_STRING,                                                               \
+      NULL,                                                                     \
+      "Precomputed mixture gaussian parameters input file (used instead of -mean and -var if it was computed from them with the same -logbase and -varfloor)" }, \
+{ "-gausel",                                                                    \
+      ARG_STRING,                                                               \
+      NULL,                                                                     \
+      "Gaussian selection shortlists input file (made with soundswallower_pack -gausel-only)" }, \
+{ "-mlp",                                                                       \
+      ARG_STRING,                                                               \
+      NULL,                                                                     \
+      "Neural network senone scorer input file (used instead of Gaussians)" },  \
 { "-varfloor",                                                                  \
       ARG_FLOATING,                                                              \
       "0.0001",                                                                 \
@@ -228,6 +240,30 @@
       ARG_BOOLEAN,                                                              \
       "yes",                                                                    \
       "Use memory-mapped I/O (if possible) for model files" },                  \
+{ "-nthreads",                                                                  \
+      ARG_INTEGER,                                                              \
+      "1",                                                                      \
+      "Number of threads to use for acoustic scoring (if supported)" },         \
+{ "-gmmblock",                                                                  \
+      ARG_INTEGER,                                                              \
+      "0",                                                                      \
+      "Number of upcoming frames to score at once with full-utterance input (treats all codebooks as active), or 0 for the model's default (32 for neural networks, 1 otherwise)" }, \
+{ "-pipeline",                                                                  \
+      ARG_BOOLEAN,                                                              \
+      "no",                                                                     \
+      "Score the next frame in a background thread while searching the current one (only with -compallsen)" }, \
+{ "-senmajor",                                                                  \
+      ARG_BOOLEAN,                                                              \
+      "no",                                                                     \
+      "Reorder mixture weights by senone for faster scoring (uses more memory)" }, \
+{ "-quantgau",                                                                  \
+      ARG_BOOLEAN,                                                              \
+      "no",                                                                     \
+      "Evaluate continuous density Gaussians in 16-bit fixed point (faster with SIMD, slightly less accurate)" }, \
+{ "-gsfallback",                                                                \
+      ARG_FLOATING,                                                             \
+      "2.0",                                                                    \
+      "Evaluate all Gaussians in frames further than this many times the radius of their Gaussian selection cell from its centre (0 to never do so)" }, \
 { "-ds",                                                                        \
       ARG_INTEGER,                                                                \
       "1",                                                                      \
@@ -247,7 +283,27 @@
 { "-cionly",                                                                      \
       ARG_BOOLEAN,                                                              \
       "no",                                                                    \
-      "Use only context-independent phones (faster, useful for alignment)" }    \
+      "Use only context-independent phones (faster, useful for alignment)" },   \
+{ "-vad",                                                                       \
+      ARG_BOOLEAN,                                                              \
+      "no",                                                                     \
+      "Drop long silences from live input before scoring and search, based on frame energy" }, \
+{ "-vad_threshold",                                                             \
+      ARG_FLOATING,                                                             \
+      "2.0",                                                                    \
+      "Log energy (averaged over mel filters) above the noise floor for a frame to count as speech" }, \
+{ "-vad_prespeech",                                                             \
+      ARG_INTEGER,                                                              \
+      "20",                                                                     \
+      "Frames of silence to keep before speech" },                              \
+{ "-vad_postspeech",                                                            \
+      ARG_INTEGER,                                                              \
+      "50",                                                                     \
+      "Frames of silence to keep after speech" },                               \
+{ "-vad_startspeech",                                                           \
+      ARG_INTEGER,                                                              \
+      "10",                                                                     \
+      "Frames in a row above the threshold needed to start speech" }            \
 
 #define CMDLN_EMPTY_OPTION { NULL, 0, NULL, NULL }
 
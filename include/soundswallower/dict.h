@@ -190,6 +190,14 @@ const char *dict_ciphone_str(dict_t *d,	/**< In: Dictionary to look up */
  */
 int32 dict_word2basestr(char *word);
 
+/**
+ * Make a private copy of a dictionary.
+ *
+ * Used to add words to a dictionary which is shared with other
+ * decoders without affecting them.
+ */
+dict_t *dict_copy(dict_t *d);
+
 /**
  * Retain a pointer to an dict_t.
  */
@@ -132,6 +132,11 @@ extern "C" {
     ARG_STRINGIFY(DEFAULT_SAMPLING_RATE), \
     "Sampling rate" }, \
    \
+  { "-resample", \
+    ARG_FLOATING, \
+    "0", \
+    "Resample input to this rate before computing features (0 for no resampling)" }, \
+   \
   { "-frate", \
     ARG_INTEGER, \
     ARG_STRINGIFY(DEFAULT_FRAME_RATE), \
@@ -318,6 +323,9 @@ int fe_get_output_size(fe_t *fe);
  * frames of output, you must have at least <code>(N-1) *
  * *out_frame_shift + *out_frame_size</code> input samples.
  *
+ * If the input is resampled (the <code>-resample</code> option),
+ * these are in samples at the resampled rate.
+ *
  * @param fe Front-end object
  * @param out_frame_shift Output: Number of samples between each frame start.
  * @param out_frame_size Output: Number of samples in each frame.
@@ -405,11 +413,18 @@ int fe_process_float32(fe_t *fe,
  * cepstral vector, if present.  If there are overflow samples
  * remaining, it will pad with zeros to make a complete frame.
  *
+ * When resampling (the <code>-resample</code> option), the last few
+ * milliseconds of input are only resampled here, so there may be
+ * more than one frame.  Any that don't fit in buf_cep are kept, and
+ * can be had by calling fe_end() again, until it writes fewer frames
+ * than there is room for.  fe_start() discards them.
+ *
  * @param fe Front-end object.
- * @param buf_cep Cepstral buffer as passed to fe_process().
+ * @param buf_cep Cepstral buffer as passed to fe_process(), or NULL
+ *                to get the maximum number of frames left to write.
  * @param nframes Number of frames available in buf_cep.
- * @return number of frames written (always 0 or 1), <0 for error (see
- *         enum fe_error_e)
+ * @return number of frames written (0 or 1 unless resampling), <0
+ *         for error (see enum fe_error_e)
  */
 int fe_end(fe_t *fe, mfcc_t **buf_cep, int nframes);
 
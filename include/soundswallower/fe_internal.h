@@ -41,6 +41,7 @@
 #include <soundswallower/fe.h>
 #include <soundswallower/fe_type.h>
 #include <soundswallower/fe_noise.h>
+#include <soundswallower/fe_resample.h>
 
 #ifdef __cplusplus
 extern "C" {
@@ -107,6 +108,12 @@ struct melfb_s {
 /* sqrt(1/2), also used for unitary DCT-II/DCT-III */
 #define SQRT_HALF FLOAT2MFCC(0.707106781186548)
 
+/* Number of input samples resampled at a time by fe_process_*(). */
+#define FE_RESAMPLE_CHUNK 4096
+
+/* Number of frames transformed together by fe_process_*(). */
+#define FE_MAX_BLOCK 16
+
 /* Scale for float data. */
 #define FLOAT32_SCALE 32768.0F
 /* Dithering constant for float data. */
@@ -138,8 +145,15 @@ struct fe_s {
     float32 pre_emphasis_alpha;
     int32 dither_seed;
 
-    /* Twiddle factors for FFT. */
-    frame_t *ccc, *sss;
+    /* Precomputed plan for the real FFT (see fe_fft.c). */
+    int32 *fft_rev;
+    frame_t *fft_tw, *fft_rtw;
+    /* Complex work buffer for the FFT, and how many frames it holds. */
+    frame_t *fft_work;
+    int32 fft_work_frames;
+    /* Instruction set used for the FFT butterflies. */
+    int32 fft_simd;
+    void (*fft_stage)(frame_t *z, frame_t const *tw, int32 n, int32 len);
     /* Mel filter parameters. */
     melfb_t *mel_fb;
     /* Half of a Hamming Window. */
@@ -151,15 +165,30 @@ struct fe_s {
     float32 *overflow_samps;
     /* How many extra samples there are. */
     int num_overflow_samps;    
-    /* One frame's worth of waveform (FIXME: redundant with spch/overflow). */
-    frame_t *frame;
-    /* Spectrum and mel-spectrum. */
+    /* Windowed waveform for a block of FE_MAX_BLOCK frames, and the
+     * frame currently being read into (FIXME: redundant with
+     * spch/overflow). */
+    frame_t *frames, *frame;
+    /* Spectrum and mel-spectrum, one row per frame in the block. */
     powspec_t *spec, *mfspec;
     /* Carryover value from previous frame for pre-emphasis filter. */
     float32 pre_emphasis_prior;
 
     /* Noise removal parameters and buffers. */
     noise_stats_t *noise_stats;
+
+    /* Resampler from the input sampling rate, if it is not
+     * sampling_rate, and whether it should byteswap the input. */
+    fe_resampler_t *resampler;
+    float32 input_rate;
+    uint8 resample_swap;
+    /* Input samples for the resampler. */
+    float32 *rs_in;
+    /* Resampled samples not yet turned into frames. */
+    float32 *rs_out;
+    size_t n_rs_out;
+    /* Has fe_end() already flushed the resampler? */
+    uint8 rs_flushed;
 };
 
 void fe_init_dither(int32 seed);
@@ -174,12 +203,20 @@ int fe_shift_frame_float32(fe_t *fe, float32 const *in, int32 len);
 
 /* Process a frame of data into features. */
 int fe_write_frame(fe_t *fe, mfcc_t *fea);
+/* Process a block of up to FE_MAX_BLOCK frames, stored contiguously
+ * (fft_size points each) in frames, into features. */
+int fe_write_frames(fe_t *fe, frame_t *frames, mfcc_t **fea, int32 n_frames);
 
 /* Initialization functions. */
 int32 fe_build_melfilters(melfb_t *MEL_FB);
 int32 fe_compute_melcosine(melfb_t *MEL_FB);
 void fe_create_hamming(window_t *in, int32 in_len);
-void fe_create_twiddle(fe_t *fe);
+
+/* Real FFT. */
+void fe_create_fft(fe_t *fe);
+void fe_free_fft(fe_t *fe);
+int fe_fft_set_simd(fe_t *fe, int level);
+void fe_fft_real(fe_t *fe, frame_t *x, int32 n_frames);
 
 /* Miscellaneous processing functions. */
 void fe_spec2cep(fe_t * fe, const powspec_t * mflogspec, mfcc_t * mfcep);
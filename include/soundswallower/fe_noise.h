@@ -54,6 +54,6 @@ void fe_free_noisestats(noise_stats_t * noise_stats);
 /**
  * Process frame, update noise statistics, remove noise components if needed.
  */
-void fe_remove_noise(fe_t *fe);
+void fe_remove_noise(fe_t *fe, powspec_t *mfspec);
 
 #endif                          /* FE_NOISE_H */
@@ -0,0 +1,131 @@
+/* -*- c-basic-offset: 4; indent-tabs-mode: nil -*- */
+/* ====================================================================
+ * Copyright (c) 2022 Carnegie Mellon University.  All rights
+ * reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer. 
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in
+ *    the documentation and/or other materials provided with the
+ *    distribution.
+ *
+ * This work was supported in part by funding from the Defense Advanced 
+ * Research Projects Agency and the National Science Foundation of the 
+ * United States of America, and the CMU Sphinx Speech Consortium.
+ *
+ * THIS SOFTWARE IS PROVIDED BY CARNEGIE MELLON UNIVERSITY ``AS IS'' AND 
+ * ANY EXPRESSED OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, 
+ * THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ * PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL CARNEGIE MELLON UNIVERSITY
+ * NOR ITS EMPLOYEES BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT 
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, 
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY 
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT 
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE 
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ * ====================================================================
+ *
+ */
+/**
+ * @file fe_resample.h
+ * @brief Streaming polyphase resampler for the front end.
+ */
+#ifndef FE_RESAMPLE_H
+#define FE_RESAMPLE_H
+
+#include <stddef.h>
+
+#include <soundswallower/prim_type.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+#if 0
+/* Fool Emacs. */
+}
+#endif
+
+/**
+ * Resampler from one integer sampling rate to another.
+ *
+ * The rates are reduced to a ratio up/down, and each output sample
+ * is the dot product of the input with one of up phases of a
+ * windowed-sinc lowpass filter, with n_taps taps per phase.
+ */
+typedef struct fe_resampler_s fe_resampler_t;
+struct fe_resampler_s {
+    int32 up;           /**< Interpolation factor */
+    int32 down;         /**< Decimation factor */
+    int32 n_taps;       /**< Number of taps in each phase (even) */
+    float32 *taps;      /**< Filter, up phases of n_taps taps */
+    float32 *hist;      /**< Input samples not yet completely used */
+    int32 n_hist;       /**< Number of samples in hist */
+    int32 hist_alloc;   /**< Allocated size of hist */
+    int32 pos;          /**< Index in hist of the next output sample */
+    int32 phase;        /**< Phase of the next output sample */
+    size_t n_in;        /**< Input samples since the last reset */
+    size_t n_out;       /**< Output samples since the last reset */
+};
+
+/**
+ * Create a resampler.
+ * @return NULL if the rates are not supported.
+ */
+fe_resampler_t *fe_resampler_init(int32 in_rate, int32 out_rate);
+
+/**
+ * Free a resampler.
+ */
+void fe_resampler_free(fe_resampler_t *rs);
+
+/**
+ * Start a new stream.
+ */
+void fe_resampler_reset(fe_resampler_t *rs);
+
+/**
+ * Get the largest number of samples that fe_resampler_process()
+ * could produce from n_in input samples.
+ */
+size_t fe_resampler_max_output(fe_resampler_t *rs, size_t n_in);
+
+/**
+ * Get the largest number of samples that fe_resampler_flush() could
+ * produce.
+ */
+size_t fe_resampler_max_flush(fe_resampler_t *rs);
+
+/**
+ * Resample some input.
+ *
+ * Output samples are produced as soon as all of the input needed for
+ * them is available, so there is some delay between input and output.
+ * @param out Output buffer, with room for at least
+ *            fe_resampler_max_output(rs, n_in) samples.
+ * @return Number of samples written to out.
+ */
+size_t fe_resampler_process(fe_resampler_t *rs, float32 const *in,
+                            size_t n_in, float32 *out);
+
+/**
+ * Produce the remaining output at the end of the stream.
+ *
+ * @param out Output buffer, with room for at least
+ *            fe_resampler_max_flush(rs) samples.
+ * @return Number of samples written to out.
+ */
+size_t fe_resampler_flush(fe_resampler_t *rs, float32 *out);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* FE_RESAMPLE_H */
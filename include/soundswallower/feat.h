@@ -136,18 +136,35 @@ typedef struct feat_s {
      * speech input must be feature vector itself.
      **/
     void (*compute_feat)(struct feat_s *fcb, mfcc_t **input, mfcc_t **feat);
+    /**
+     * Vectorized feature computation for frames input[0..nfr-1]
+     * (output in feat[0..nfr-1]), or NULL to use compute_feat.
+     */
+    void (*compute_feat_block)(struct feat_s *fcb, mfcc_t **input,
+                               mfcc_t ***feat, int32 nfr);
+    int simd;           /**< Instruction set used by compute_feat_block */
     cmn_t *cmn_struct;	/**< Structure that stores the temporary variables for cepstral 
                            means normalization*/
     void *agc_struct;	/**< UNUSED*/
 
     mfcc_t **cepbuf;    /**< Circular buffer of MFCC frames for live feature computation. */
-    mfcc_t **tmpcepbuf; /**< Array of pointers into cepbuf to handle border cases. */
-    int32   bufpos;     /**< Write index in cepbuf. */
+    mfcc_t **cepring;   /**< Row pointers into cepbuf, repeated three times and
+                           offset to the middle copy, so that any index in
+                           [-LIVEBUFBLOCKSIZE, 2*LIVEBUFBLOCKSIZE) addresses
+                           the ring without wraparound checks. */
+    int32   wrpos;      /**< Index in cepbuf after the last frame written. */
+    int32   bufpos;     /**< Index in cepbuf after the last frame normalized. */
     int32   curpos;     /**< Read index in cepbuf. */
 
     mfcc_t ***lda; /**< Array of linear transformations (for LDA, MLLT, or whatever) */
     uint32 n_lda;   /**< Number of linear transformations in lda. */
     uint32 out_dim; /**< Output dimensionality */
+    void *lda_buf;      /**< Storage for lda_t and lda_out. */
+    float32 *lda_t;     /**< First transform, transposed (input dimension
+                           by lda_stride), padded and aligned. */
+    float32 *lda_out;   /**< Aligned output block for feat_lda_transform(). */
+    uint32 lda_stride;  /**< Row length of lda_t (out_dim rounded up). */
+    int lda_simd;       /**< Instruction set used by feat_lda_transform(). */
 } feat_t;
 
 /**
@@ -292,8 +309,22 @@ int32 feat_read_lda(feat_t *feat,	 /**< In: Descriptor from feat_init() */
  **/
 int feat_read_lda_s3file(feat_t *feat, s3file_t *s, int32 dim);
 
+/**
+ * Set the instruction set used to apply the LDA transform.
+ *
+ * This is chosen automatically when the transform is read, so it is
+ * only useful for testing.
+ *
+ * @param level One of simd_level_t.
+ * @return The level actually used, which may be lower than requested.
+ */
+int feat_lda_set_simd(feat_t *fcb, int level);
+
 /**
  * Transform a block of features using the feature module's LDA transform.
+ *
+ * Frames are transformed several at a time, so that each block of
+ * the matrix is loaded once for all of them.
  **/
 void feat_lda_transform(feat_t *fcb,		/**< In: Descriptor from feat_init() */
                         mfcc_t ***inout_feat,	/**< Feature block to transform. */
@@ -340,6 +371,11 @@ int feat_set_subvecs(feat_t *fcb, int32 **subvecs);
  * If beginutt and endutt are both true, CMN_CURRENT and AGC_MAX will
  * be done.  Otherwise only CMN_PRIOR and AGC_EMAX will be done.
  *
+ * The input frames are copied into the live buffer, so they are not
+ * modified, except in the case of an entire utterance.  To avoid the
+ * copy, use feat_live_wrbuf() and feat_live_process() instead (but
+ * do not mix the two within an utterance).
+ *
  * If beginutt is false, endutt is true, and the number of input
  * frames exceeds the input size, then end-of-utterance processing
  * won't actually be done.  This condition can easily be checked,
@@ -361,6 +397,72 @@ int32 feat_s2mfc2feat_live(feat_t  *fcb,     /**< In: Descriptor from feat_init(
     );
 
 
+/**
+ * Set the instruction set used to compute dynamic features.
+ *
+ * This is chosen automatically by feat_init(), so it is only useful
+ * for testing.
+ *
+ * @param level One of simd_level_t.
+ * @return The level actually used, which may be lower than requested.
+ */
+int feat_set_simd(feat_t *fcb, int level);
+
+/**
+ * Discard any frames left in the live buffer from a previous utterance.
+ */
+void feat_live_start(feat_t *fcb);
+
+/**
+ * Get space to write cepstra directly into the live buffer.
+ *
+ * This lets the front end write its output into the ring used by
+ * feat_live_process(), so that frames are not copied on the way to
+ * feature computation.  The returned row pointers are valid across
+ * the wraparound of the ring.
+ *
+ * @param out_nfr Output: number of frames which can be written.
+ * @return Array of pointers to the frames to be written.
+ */
+mfcc_t **feat_live_wrbuf(feat_t *fcb, int32 *out_nfr);
+
+/**
+ * Mark frames written to the space from feat_live_wrbuf() as available.
+ */
+void feat_live_commit(feat_t *fcb, int32 nfr);
+
+/**
+ * Number of frames written to the live buffer and not yet processed.
+ */
+int32 feat_live_pending(feat_t *fcb);
+
+/**
+ * Feature computation for frames already in the live buffer.
+ *
+ * This is the same as feat_s2mfc2feat_live(), except that the input
+ * is the frames committed with feat_live_commit(), which are
+ * normalized and used in place.  The same caveats about the size of
+ * the output buffer apply.
+ *
+ * @param inout_ncep In: Maximum number of pending frames to consume.
+ *                   Out: Number of frames consumed.
+ * @return The number of output frames actually computed.
+ */
+int32 feat_live_process(feat_t *fcb, int32 *inout_ncep,
+                        int32 beginutt, int32 endutt, mfcc_t ***ofeat);
+
+/**
+ * Drop the oldest nfr pending frames from the live buffer.
+ *
+ * The frames consumed before them (including the window of context
+ * for dynamic features) are moved up to meet the remaining ones, so
+ * that feature computation carries on as if the dropped frames had
+ * never been there.
+ *
+ * @return The number of frames dropped (no more than are pending).
+ */
+int32 feat_live_skip(feat_t *fcb, int32 nfr);
+
 /**
  * Update the normalization stats, possibly in the end of utterance
  *
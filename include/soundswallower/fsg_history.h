@@ -76,7 +76,6 @@
 
 #include <soundswallower/prim_type.h>
 #include <soundswallower/fsg_model.h>
-#include <soundswallower/blkarray_list.h>
 #include <soundswallower/fsg_lextree.h>
 #include <soundswallower/dict.h>
 
@@ -115,6 +114,26 @@ typedef struct fsg_hist_entry_s {
 #define fsg_hist_entry_lc(v)		((v)->lc)
 #define fsg_hist_entry_rc(v)		((v)->rc)
 
+/*
+ * A candidate history entry in the current frame.  These are allocated
+ * from a per-frame arena (fsg_history_t.cands) and linked by index, so
+ * that the arena can grow and be reset without any per-entry malloc.
+ */
+typedef struct fsg_hist_cand_s {
+    fsg_hist_entry_t entry;
+    int32 next;                 /* Next candidate in its frame_entries list,
+                                   or -1 if none */
+} fsg_hist_cand_t;
+
+/*
+ * Committed history entries are stored by value in blocks of this many,
+ * which are kept from one utterance to the next.  Blocks never move, so
+ * pointers from fsg_history_entry_get() stay valid until the history is
+ * reset.
+ */
+#define FSG_HIST_BLKSHIFT	10
+#define FSG_HIST_BLKSIZE	(1 << FSG_HIST_BLKSHIFT)
+
 
 /*
  * The entire tree of history entries (fsg_history_t.entries).
@@ -129,6 +148,8 @@ typedef struct fsg_hist_entry_s {
  * pruning is done in two stages: first for the non-null transitions, and then
  * for the null transitions alone.  (This solution is sub-optimal, and can be
  * improved with a little more work.  SMOP.)
+ * The candidates live in an arena which is emptied at the end of the
+ * frame, when the survivors are copied into the entry table.
  * Why is frame_entries a list?  Each entry has a unique terminating state,
  * and has a unique lc CIphone.  But it has a SET of rc CIphones.
  * frame_entries[s][lc] is an ordered list of entries created in the current
@@ -142,12 +163,28 @@ typedef struct fsg_hist_entry_s {
  * empty, it is also discarded.
  * As mentioned earlier, this procedure is applied in two stages, for the
  * non-null transitions, and the null transitions, separately.
+ * Since only a few states have word exits in any given frame, the lists
+ * for state s are only allocated (as a row of n_ciphone list heads) the
+ * first time s is touched in a frame, and s is noted in touched.  At the
+ * end of the frame, only the touched states are visited, in order of
+ * state ID as if all of them had been scanned.
  */
 typedef struct fsg_history_s {
     fsg_model_t *fsg;		/* The FSG for which this object applies */
-    blkarray_list_t *entries;	/* A list of history table entries; the root
-				   entry is the first element of the list */
-    glist_t **frame_entries;
+    fsg_hist_entry_t **blocks;  /* Blocks of history table entries; the root
+				   entry is the first element of the table */
+    int32 n_blocks;             /* Number of blocks allocated */
+    int32 n_entries;            /* Number of entries in the table */
+    fsg_hist_cand_t *cands;     /* Candidate entries in the current frame */
+    int32 n_cands;              /* Number of candidates allocated */
+    int32 n_cands_alloc;        /* Size of cands */
+    int32 *frame_entries;       /* Index in cands of the first candidate for
+                                   each lc in each row, or -1 if none */
+    int32 *state_row;           /* Row of frame_entries for each state, or -1
+                                   if not touched in the current frame */
+    int32 *touched;             /* States touched in the current frame */
+    int32 n_touched;            /* Number of states (and rows) touched */
+    int32 n_rows_alloc;         /* Number of rows allocated */
     int n_ciphone;
 } fsg_history_t;
 
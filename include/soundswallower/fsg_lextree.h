@@ -214,6 +214,16 @@ typedef struct fsg_lextree_s {
 			   via fsg_pnode_t.sibling (root[s]->sibling) */
     fsg_pnode_t **alloc_head;	/* alloc_head[s] = head of linear list of all
 				   pnodes allocated for state s */
+    /*
+     * The same roots, and the null transitions out of each state, in
+     * compressed sparse row form for the search: those for state s are
+     * roots[root_start[s]] to roots[root_start[s+1]-1] and likewise for
+     * null_arcs.  Tag transitions are not included in null_arcs.
+     */
+    fsg_pnode_t **roots;	/* All roots, grouped by state, in sibling order */
+    int32 *root_start;		/* Start of each state's roots (n_state+1) */
+    fsg_link_t **null_arcs;	/* All null transitions, grouped by state */
+    int32 *null_start;		/* Start of each state's null_arcs (n_state+1) */
     int32 n_pnode;	/* #HMM nodes in search structure */
     int32 wip;
     int32 pip;
@@ -222,6 +232,12 @@ typedef struct fsg_lextree_s {
 /* Access macros */
 #define fsg_lextree_root(lt,s)	((lt)->root[s])
 #define fsg_lextree_n_pnode(lt)	((lt)->n_pnode)
+#define fsg_lextree_roots(lt,s)	((lt)->roots + (lt)->root_start[s])
+#define fsg_lextree_n_roots(lt,s) \
+    ((lt)->root_start[(s) + 1] - (lt)->root_start[s])
+#define fsg_lextree_null_arcs(lt,s) ((lt)->null_arcs + (lt)->null_start[s])
+#define fsg_lextree_n_null_arcs(lt,s) \
+    ((lt)->null_start[(s) + 1] - (lt)->null_start[s])
 
 /**
  * Create, initialize, and return a new phonetic lextree for the given FSG.
@@ -78,8 +78,13 @@ typedef struct fsg_search_s {
 				   active FSG */
     struct fsg_history_s *history;/**< For storing the Viterbi search history */
   
-    glist_t pnode_active;	/**< Those active in this frame */
-    glist_t pnode_active_next;	/**< Those activated for the next frame */
+    struct fsg_pnode_s **pnode_active;      /**< Those active in this frame */
+    struct fsg_pnode_s **pnode_active_next; /**< Those activated for the next frame */
+    int32 n_pnode_active;	/**< Number of entries in pnode_active */
+    int32 n_pnode_active_next;	/**< Number of entries in pnode_active_next */
+    int32 n_pnode_alloc;	/**< Space allocated for each of them (every
+                                   pnode in the lextree can be in each
+                                   at most once) */
   
     int32 beam_orig;		/**< Global pruning threshold */
     int32 pbeam_orig;		/**< Pruning threshold for phone transition */
@@ -0,0 +1,188 @@
+/* -*- c-basic-offset: 4; indent-tabs-mode: nil -*- */
+/* ====================================================================
+ * Copyright (c) 2022 Carnegie Mellon University.  All rights
+ * reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer. 
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in
+ *    the documentation and/or other materials provided with the
+ *    distribution.
+ *
+ * This work was supported in part by funding from the Defense Advanced 
+ * Research Projects Agency and the National Science Foundation of the 
+ * United States of America, and the CMU Sphinx Speech Consortium.
+ *
+ * THIS SOFTWARE IS PROVIDED BY CARNEGIE MELLON UNIVERSITY ``AS IS'' AND 
+ * ANY EXPRESSED OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, 
+ * THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ * PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL CARNEGIE MELLON UNIVERSITY
+ * NOR ITS EMPLOYEES BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT 
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, 
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY 
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT 
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE 
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ * ====================================================================
+ *
+ */
+/**
+ * @file gausel.h
+ * @brief Gaussian selection shortlists for continuous codebooks.
+ *
+ * This implements the usual sort of vector-quantization based
+ * Gaussian selection: the feature space of each stream is divided
+ * into cells by a small VQ codebook trained on the Gaussian means,
+ * and for each cell and each mixture Gaussian codebook we keep a
+ * shortlist of the densities which score well at its centre.  At run
+ * time, each frame is assigned to the nearest cell, and only its
+ * shortlists are evaluated.  Frames which are much further from the
+ * centre of their cell than any of the means it was trained on can
+ * be evaluated in full instead (see gausel_select()).
+ *
+ * Shortlists are built offline (see gausel_build() and
+ * soundswallower_pack -gausel-only) and stored with the model, in
+ * native byte order like the precomputed Gaussians, so that they can
+ * be used in place from a memory-mapped file.
+ */
+
+#ifndef __GAUSEL_H__
+#define __GAUSEL_H__
+
+#include <stdio.h>
+
+#include <soundswallower/prim_type.h>
+#include <soundswallower/s3file.h>
+#include <soundswallower/cmd_ln.h>
+#include <soundswallower/ms_gauden.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+#if 0
+/* Fool Emacs. */
+}
+#endif
+
+/** Default number of cells per stream for gausel_build(). */
+#define GAUSEL_DEFAULT_N_CW 256
+/** Default beam (as a probability ratio) for gausel_build(). */
+#define GAUSEL_DEFAULT_BEAM 1e-2
+/** Default minimum shortlist length for gausel_build(). */
+#define GAUSEL_DEFAULT_MIN_SHORT 8
+
+/**
+ * Gaussian selection shortlists.
+ *
+ * Arrays are flat so that they can point into a mapped file.
+ * Shortlists are indexed by (stream, cell, codebook), i.e. those for
+ * cell c of mixture Gaussian m in stream f are list[start[i]] to
+ * list[start[i + 1] - 1] where i = (f * n_cw + c) * n_mgau + m.
+ */
+typedef struct gausel_s {
+    int refcount;
+    s3file_t *s3f;      /**< Mapped file, or NULL if built in memory. */
+    int32 n_mgau;       /**< Number of mixture Gaussian codebooks. */
+    int32 n_feat;       /**< Number of feature streams. */
+    int32 n_density;    /**< Number of densities per codebook. */
+    int32 n_cw;         /**< Number of cells per stream. */
+    int32 *featlen;     /**< Dimension of each stream. */
+    int32 *featoff;     /**< Offset of each stream in a full vector. */
+    float32 *weight;    /**< Per-dimension weights for cell distances. */
+    float32 *cw;        /**< Cell centres (n_cw vectors per stream). */
+    float32 *radius;    /**< Furthest mean from each cell centre. */
+    uint32 *start;      /**< Start of each shortlist in list. */
+    uint16 *list;       /**< Density indices. */
+} gausel_t;
+
+/**
+ * Build shortlists for a set of Gaussians.
+ *
+ * @param g Gaussians (with precomputed variances, as from gauden_init()).
+ * @param n_cw number of cells per stream.
+ * @param beam keep densities whose score at the centre of a cell is
+ *             within this ratio of the best one for their codebook.
+ * @param min_short but always keep at least this many.
+ * @return new shortlists, or NULL on error.
+ */
+gausel_t *gausel_build(gauden_t *g, int32 n_cw, float64 beam, int32 min_short);
+
+/**
+ * Read shortlists from a (memory-mapped) file.
+ *
+ * @return new shortlists (which retain s), or NULL on error.
+ */
+gausel_t *gausel_init_s3file(s3file_t *s);
+
+/**
+ * Read shortlists from a file.
+ */
+gausel_t *gausel_read(const char *path);
+
+/**
+ * Read the shortlists given by -gausel, if any, for a set of Gaussians.
+ *
+ * @return new shortlists, or NULL if there are none, or if they could
+ *         not be read or do not match g (with a warning).
+ */
+gausel_t *gausel_init_config(cmd_ln_t *config, gauden_t *g);
+
+/**
+ * Write shortlists to a file.
+ *
+ * @return number of bytes written, or -1 on error.
+ */
+long gausel_write(gausel_t *gs, FILE *fh);
+
+/**
+ * Retain a pointer to shortlists.
+ */
+gausel_t *gausel_retain(gausel_t *gs);
+
+/**
+ * Release shortlists.
+ *
+ * @return new reference count (0 if freed).
+ */
+int gausel_free(gausel_t *gs);
+
+/**
+ * Verify that shortlists match a set of Gaussians.
+ *
+ * @return 0 if they match, -1 (with an error message) if not.
+ */
+int gausel_check(gausel_t *gs, gauden_t *g);
+
+/**
+ * Find the cell for one stream of an observation.
+ *
+ * @param fallback if non-zero, return -1 when obs is further than
+ *                 this times the radius of its cell from the centre.
+ * @return index of the cell, or -1 if all densities should be evaluated.
+ */
+int32 gausel_select(gausel_t *gs, int32 feat, mfcc_t const *obs,
+                    float32 fallback);
+
+/**
+ * Get the shortlist for a codebook in a cell.
+ *
+ * @param cw cell returned by gausel_select().
+ * @param out_n number of densities in the shortlist.
+ * @return the shortlist, or NULL if cw is negative.
+ */
+uint16 const *gausel_shortlist(gausel_t *gs, int32 feat, int32 cw,
+                               int32 mgau, int32 *out_n);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __GAUSEL_H__ */
@@ -0,0 +1,164 @@
+/* -*- c-basic-offset: 4; indent-tabs-mode: nil -*- */
+/* ====================================================================
+ * Copyright (c) 2022 Carnegie Mellon University.  All rights
+ * reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer. 
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in
+ *    the documentation and/or other materials provided with the
+ *    distribution.
+ *
+ * This work was supported in part by funding from the Defense Advanced 
+ * Research Projects Agency and the National Science Foundation of the 
+ * United States of America, and the CMU Sphinx Speech Consortium.
+ *
+ * THIS SOFTWARE IS PROVIDED BY CARNEGIE MELLON UNIVERSITY ``AS IS'' AND 
+ * ANY EXPRESSED OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, 
+ * THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ * PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL CARNEGIE MELLON UNIVERSITY
+ * NOR ITS EMPLOYEES BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT 
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, 
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY 
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT 
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE 
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ * ====================================================================
+ *
+ */
+/**
+ * @file mlp_mgau.h
+ * @brief Senone scoring with a quantized feed-forward neural network.
+ *
+ * This is not a mixture of Gaussians at all, but it takes the place
+ * of one in the acoustic model.  The network is applied to each
+ * frame of the feature buffer, so any context it needs comes from
+ * splicing neighbouring frames in the feature type (e.g. "1s_4c" or
+ * "13:4" in feat.params).  Hidden layers use ReLU, and the output
+ * layer has one unit per senone, whose outputs are taken to be
+ * logits for the senone posteriors (fold in any priors you wish to
+ * divide by in its biases).
+ *
+ * Weights are stored as 8-bit integers with a scale for each row.
+ * The inputs to each layer are quantized to the same range with a
+ * scale for each frame, and accumulated in 32 bits, so the dot
+ * products are exact and every instruction set gives the same
+ * result.
+ *
+ * The model file is an S3 binary file (version 1.0) containing:
+ *
+ * - int32 number of layers
+ * - int32 input dimension
+ * - int32 output dimension of each layer
+ * - float32 input mean and scale (input dimension each)
+ * - for each layer, float32 weight scales and biases (output
+ *   dimension each), then int8 weights, one row of input dimension
+ *   for each output
+ */
+
+#ifndef __MLP_MGAU_H__
+#define __MLP_MGAU_H__
+
+#include <soundswallower/prim_type.h>
+#include <soundswallower/s3file.h>
+#include <soundswallower/acmod.h>
+#include <soundswallower/workpool.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+#if 0
+}
+#endif
+
+/** Version string of the model file. */
+#define MLP_PARAM_VERSION "1.0"
+/** Weight rows and inputs are padded to a multiple of this. */
+#define MLP_ALIGN 16
+/** Frames scored at once with full-utterance input, unless -gmmblock says otherwise. */
+#define MLP_DEFAULT_BLOCK 32
+
+typedef struct mlp_layer_s {
+    int32 n_in;         /**< Input dimension. */
+    int32 n_out;        /**< Output dimension. */
+    int32 stride;       /**< Input dimension padded to MLP_ALIGN. */
+    int8 *weight;       /**< Weights, n_out rows of stride. */
+    float32 *wscale;    /**< Scale of each row of weights. */
+    float32 *bias;      /**< Bias of each output. */
+} mlp_layer_t;
+
+typedef struct mlp_mgau_s mlp_mgau_t;
+struct mlp_mgau_s {
+    ps_mgau_t base;     /**< base structure. */
+    cmd_ln_t *config;   /**< Configuration parameters */
+    int32 n_sen;        /**< Number of senones (outputs of last layer). */
+    int32 n_layer;      /**< Number of layers. */
+    mlp_layer_t *layer; /**< Layers. */
+    int32 n_in;         /**< Input dimension. */
+    float32 *in_mean;   /**< Mean subtracted from input. */
+    float32 *in_scale;  /**< Scale applied to input after that. */
+    float32 score_scale;/**< Natural log to senone score units. */
+    int32 max_width;    /**< Largest input or output dimension. */
+    int32 max_stride;   /**< Largest padded input dimension. */
+
+    /* Dot product kernel, selected by mlp_mgau_set_simd(). */
+    void (*dot)(int8 const *w, int16 const *x, int32 stride,
+                int32 n_frames, int32 *out, int32 out_stride);
+    int16 simd;         /**< Instruction set used (simd_level_t). */
+
+    /* Scoring state, which is not shared. */
+    int32 n_block;      /**< Number of frames the buffers hold. */
+    float32 *act[2];    /**< Outputs of alternate layers (n_block x max_width). */
+    int16 *qact;        /**< Quantized inputs to a layer (n_block x max_stride). */
+    float32 *qscale;    /**< Scale of quantized inputs for each frame. */
+    int32 *acc;         /**< Dot products (n_block x max_width). */
+    int32 *rows;        /**< Active senones for the current frame. */
+    float32 *out;       /**< Outputs for the block (points into act). */
+    int32 block_first;  /**< First frame done by mlp_mgau_frame_eval_block(). */
+    int32 block_end;    /**< Frame after the last one it did. */
+    workpool_t *pool;   /**< Worker threads for scoring (or NULL). */
+};
+
+ps_mgau_t *mlp_mgau_init(acmod_t *acmod);
+ps_mgau_t *mlp_mgau_init_s3file(acmod_t *acmod, s3file_t *mlp);
+ps_mgau_t *mlp_mgau_share(ps_mgau_t *s, acmod_t *acmod);
+void mlp_mgau_free(ps_mgau_t *s);
+int mlp_mgau_frame_eval(ps_mgau_t *s,
+                        int16 *senone_scores,
+                        uint8 *senone_active,
+                        int32 n_senone_active,
+                        mfcc_t **featbuf,
+                        int32 frame,
+                        int32 compallsen);
+int mlp_mgau_frame_eval_block(ps_mgau_t *s,
+                              mfcc_t ***feats,
+                              int32 frame,
+                              int32 n_frames);
+int mlp_mgau_mllr_transform(ps_mgau_t *s,
+                            ps_mllr_t *mllr);
+/**
+ * Select the dot product kernel for a given instruction set.
+ *
+ * This is done automatically at initialization using the best one
+ * the CPU supports, you only need it to compare them.  AVX-512 uses
+ * the AVX2 kernel.
+ *
+ * @param level an instruction set (simd_level_t)
+ * @return the instruction set actually used, which will be SIMD_NONE
+ *         if the requested one was not compiled in.
+ */
+int mlp_mgau_set_simd(ps_mgau_t *s, int level);
+
+#ifdef __cplusplus
+} /* extern "C" */
+#endif
+
+#endif /* __MLP_MGAU_H__ */
@@ -0,0 +1,164 @@
+/* -*- c-basic-offset: 4; indent-tabs-mode: nil -*- */
+/* ====================================================================
+ * Copyright (c) 2022 Carnegie Mellon University.  All rights
+ * reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer. 
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in
+ *    the documentation and/or other materials provided with the
+ *    distribution.
+ *
+ * This work was supported in part by funding from the Defense Advanced 
+ * Research Projects Agency and the National Science Foundation of the 
+ * United States of America, and the CMU Sphinx Speech Consortium.
+ *
+ * THIS SOFTWARE IS PROVIDED BY CARNEGIE MELLON UNIVERSITY ``AS IS'' AND 
+ * ANY EXPRESSED OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, 
+ * THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ * PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL CARNEGIE MELLON UNIVERSITY
+ * NOR ITS EMPLOYEES BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT 
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, 
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY 
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT 
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE 
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ * ====================================================================
+ *
+ */
+/**
+ * @file modelpack.h
+ * @brief Precompiled acoustic models in a single file.
+ *
+ * A model pack holds the contents of an acoustic model directory
+ * (model definition, transition matrices, mixture weights or neural
+ * network, dictionaries, feature parameters) as named sections of one file,
+ * along with Gaussian parameters which have already been floored and
+ * precomputed for a given log base and variance floor (see
+ * gauden_write_precomp()).  Every section is aligned to
+ * MODELPACK_ALIGN bytes, so they can all be used in place from a
+ * memory-mapped file, which makes loading a model nearly free and
+ * lets several processes share the same pages.
+ *
+ * Everything is written in native byte order.  A pack made on a
+ * machine with the other byte order is refused rather than swapped,
+ * since the whole point is not to touch the data at load time.
+ */
+
+#ifndef __MODELPACK_H__
+#define __MODELPACK_H__
+
+#include <soundswallower/prim_type.h>
+#include <soundswallower/cmd_ln.h>
+#include <soundswallower/logmath.h>
+#include <soundswallower/s3file.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+#if 0
+/* Fool Emacs. */
+}
+#endif
+
+#define MODELPACK_MAGIC "SSWMODEL"
+#define MODELPACK_VERSION 1
+#define MODELPACK_BYTEORDER 0x11223344
+#define MODELPACK_ALIGN 64
+#define MODELPACK_NAME_LEN 24
+
+/**
+ * File header, followed immediately by the section table.
+ */
+typedef struct modelpack_hdr_s {
+    char magic[8];     /**< MODELPACK_MAGIC (not NUL-terminated) */
+    uint32 version;    /**< MODELPACK_VERSION */
+    uint32 byteorder;  /**< MODELPACK_BYTEORDER in native byte order */
+    uint32 n_section;  /**< Number of entries in section table */
+    uint32 align;      /**< Alignment of sections in bytes */
+} modelpack_hdr_t;
+
+/**
+ * Entry in section table.
+ */
+typedef struct modelpack_section_s {
+    char name[MODELPACK_NAME_LEN]; /**< Name, NUL-padded */
+    uint64 offset;                 /**< Offset from start of file */
+    uint64 size;                   /**< Size in bytes */
+} modelpack_section_t;
+
+/**
+ * Check quickly whether a file looks like a model pack.
+ *
+ * @return TRUE if path is a file starting with MODELPACK_MAGIC,
+ *         FALSE otherwise (including if it is a directory).
+ */
+int modelpack_is_pack(const char *path);
+
+/**
+ * Memory-map (or read) a model pack and verify its header and
+ * section table.
+ *
+ * @return the whole file, or NULL on error.
+ */
+s3file_t *modelpack_open(const char *path);
+
+/**
+ * Get a section of a model pack.
+ *
+ * @param pack a model pack returned by modelpack_open().
+ * @param name name of section, such as "mdef" or "dict".
+ * @return new s3file_t for the section (which retains pack), or NULL
+ *         if there is no such section.
+ */
+s3file_t *modelpack_section(s3file_t *pack, const char *name);
+
+/**
+ * Write a model pack for an acoustic model.
+ *
+ * @param config configuration whose model files have been filled in
+ *               from -hmm and friends (i.e. that of a ps_model_t).
+ *               Its -varfloor is used to precompute the Gaussians,
+ *               which may be absent if there is an -mlp file.
+ * @param lmath log math (and thus log base) to precompute them with.
+ * @param outfile file to write.
+ * @return 0 for success, -1 on error.
+ */
+int modelpack_write(cmd_ln_t *config, logmath_t *lmath, const char *outfile);
+
+/**
+ * Write only the precomputed Gaussians for an acoustic model.
+ *
+ * This is the same as the "gauden" section of a model pack, and can
+ * be put in a model directory as "gauden" (or given with -gauden) to
+ * be used in place of its means and variances.
+ *
+ * @return 0 for success, -1 on error.
+ */
+int modelpack_write_gauden(cmd_ln_t *config, logmath_t *lmath, const char *outfile);
+
+/**
+ * Build and write Gaussian selection shortlists for an acoustic model.
+ *
+ * These use the default parameters for gausel_build(), and can be
+ * put in a model directory as "gausel" (or given with -gausel).
+ * Since they are built from the Gaussians as precomputed with lmath
+ * and -varfloor, they should be used with the same ones.
+ *
+ * @return 0 for success, -1 on error.
+ */
+int modelpack_write_gausel(cmd_ln_t *config, logmath_t *lmath, const char *outfile);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __MODELPACK_H__ */
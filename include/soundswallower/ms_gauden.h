@@ -50,6 +50,8 @@
  *
  */
 
+#include <stdio.h>
+
 #include <soundswallower/feat.h>
 #include <soundswallower/logmath.h>
 #include <soundswallower/cmd_ln.h>
@@ -76,6 +78,43 @@ typedef struct gauden_dist_s {
 
 } gauden_dist_t;
 
+typedef struct gauden_quant_s gauden_quant_t;
+
+/**
+ * Function which computes the top-N densities for a quantized
+ * observation in one feature stream of one codebook.
+ */
+typedef void (*gauden_qeval_func_t)(gauden_quant_t *q, int16 const *obs,
+                                    int32 mgau, int32 f, int32 n_density,
+                                    int32 n_top, gauden_dist_t *out_dist);
+
+/**
+ * \struct gauden_quant_t
+ * \brief Fixed-point copy of mixture gaussian parameters.
+ *
+ * Each dimension i of feature stream f is quantized to 16 bits as
+ * (x - center[f][i]) * scale[f][i], both for means and observations.
+ * The inverse variances are replaced by their square roots, divided
+ * by the scale and multiplied by 2**(shift + frac), so that the
+ * product of a difference and one of these, shifted right, is a
+ * distance in the square root of the log domain.  The squares of
+ * these are summed in 32 bits, which is exact and can be done with
+ * integer SIMD.
+ */
+struct gauden_quant_s {
+    int32 *plen;        /**< Feature lengths padded to a multiple of 8 */
+    float32 **center;   /**< center[feature][dimension] */
+    float32 **scale;    /**< scale[feature][dimension] */
+    int16 ***mean;      /**< mean[codebook][feature], n_density * plen */
+    int16 ***wvar;      /**< wvar[codebook][feature], n_density * plen */
+    int32 ***det;       /**< det[codebook][feature][codeword] */
+    uint8 ***shift;     /**< Right shift for products with wvar, for
+                           each codebook, feature and codeword */
+    int frac;           /**< Fractional bits in the results of this */
+    int simd;           /**< Instruction set used by qeval */
+    gauden_qeval_func_t qeval; /**< Codebook evaluation */
+};
+
 /**
  * \struct gauden_t
  * \brief Multivariate gaussian mixture density parameters
@@ -90,6 +129,13 @@ typedef struct gauden_s {
     int32 n_feat;	/**< Number feature streams in each codebook */
     int32 n_density;	/**< Number gaussian densities in each codebook-feature stream */
     int32 *featlen;	/**< feature length for each feature */
+    s3file_t *filemap;  /**< Precomputed parameters, if mapped from a
+                           file (see gauden_init_precomp()) */
+    uint32 srcsum;      /**< Checksum of the means and variances these
+                           came from (see gauden_src_sum()), or 0 if
+                           unknown */
+    gauden_quant_t *quant; /**< Fixed-point parameters, if used (see
+                              gauden_set_quant()) */
 } gauden_t;
 
 
@@ -107,6 +153,9 @@ gauden_t *gauden_init(char const *meanfile,/**< Input: File containing means of
 
 /**
  * Read mixture gaussian codebooks from s3file_t.
+ *
+ * If varfile is NULL, meanfile is expected to contain precomputed
+ * parameters, as for gauden_init_precomp().
  */
 gauden_t *gauden_init_s3file(s3file_t *meanfile,/**< Input: File containing means of mixture gaussians */
                              s3file_t *varfile,/**< Input: File containing variances of mixture gaussians */
@@ -114,12 +163,92 @@ gauden_t *gauden_init_s3file(s3file_t *meanfile,/**< Input: File containing mean
                              logmath_t *lmath
                              );
 
+/**
+ * Map precomputed mixture gaussian codebooks from s3file_t.
+ *
+ * The means, inverse variances and determinants written by
+ * gauden_write_precomp() are used in place, without copying, so the
+ * s3file_t is retained and must not be modified.  They are only
+ * valid with the same log base and variance floor as when they were
+ * written, so this fails if either of these differ.
+ */
+gauden_t *gauden_init_precomp(s3file_t *s, float32 varfloor, logmath_t *lmath);
+
+/**
+ * Open mixture gaussian codebooks named in a configuration.
+ *
+ * If there are precomputed parameters (_gauden, from -gauden or the
+ * model directory) which match -logbase and -varfloor, and which were
+ * computed from the means and variances (_mean and _var) if those
+ * exist, they are returned in out_means with out_vars set to NULL,
+ * which is what gauden_init_s3file() expects.  Otherwise the means
+ * and variances are opened.
+ *
+ * @return 0 for success, -1 on failure.
+ */
+int gauden_open_files(cmd_ln_t *config, logmath_t *lmath,
+                      s3file_t **out_means, s3file_t **out_vars);
+
+/**
+ * Write precomputed mixture gaussian codebooks.
+ *
+ * These are written in native byte order, aligned so that they can
+ * be used directly by gauden_init_precomp() from a memory-mapped file
+ * whose start is aligned to 64 bytes.
+ *
+ * @param varfloor Variance floor used to create g.
+ * @return Number of bytes written, or -1 on error.
+ */
+long gauden_write_precomp(gauden_t *g, float32 varfloor, FILE *fh);
+
+/**
+ * Checksum mean and variance files.
+ *
+ * This is stored with precomputed parameters so that they are not
+ * used with means and variances other than the ones they came from.
+ * It only covers the size of each file and the first and last few
+ * kilobytes, which contain its header and its checksum (if it has
+ * one), so that checking it does not read in the whole model.
+ *
+ * @return Non-zero checksum.
+ */
+uint32 gauden_src_sum(s3file_t *means, s3file_t *vars);
+
 /** Release memory allocated by gauden_init. */
 void gauden_free(gauden_t *g); /**< In: The gauden_t to free */
 
-/** Transform Gaussians according to an MLLR matrix (or, eventually, more). */
+/**
+ * Transform Gaussians according to an MLLR matrix (or, eventually, more).
+ *
+ * Means and variances are reloaded from _mean and _var in config, so
+ * this fails if they are not there, as with a precompiled model.
+ */
 int32 gauden_mllr_transform(gauden_t *s, ps_mllr_t *mllr, cmd_ln_t *config);
 
+/**
+ * Use (or stop using) fixed-point evaluation in gauden_dist().
+ *
+ * This makes 16-bit quantized copies of the means and variances,
+ * which with SIMD can be evaluated about twice as fast as the
+ * originals, at the cost of a small loss in accuracy (see
+ * gauden_quant_t).  They are rebuilt after MLLR.
+ *
+ * @return 0 for success, -1 if the parameters cannot be quantized.
+ */
+int gauden_set_quant(gauden_t *g, int quant);
+
+/**
+ * Select the instruction set used for fixed-point evaluation.
+ *
+ * This is done automatically by gauden_set_quant(), and is only
+ * useful for testing.
+ *
+ * @param level One of simd_level_t.
+ * @return The level actually used, which is SIMD_NONE if level is
+ *         not supported, or -1 if fixed-point evaluation is not in use.
+ */
+int gauden_set_quant_simd(gauden_t *g, int level);
+
 /**
  * Compute gaussian density values for the given input observation vector wrt the
  * specified mixture gaussian codebook (which may consist of several feature streams).
@@ -139,6 +268,19 @@ gauden_dist (gauden_t *g,	/**< In: handle to entire ensemble of codebooks */
 		Caller must allocate memory for this output */
     );
 
+/**
+ * Compute the top-N densities for one feature stream of a codebook,
+ * looking only at a shortlist of densities (see gausel.h).
+ *
+ * All of them are evaluated if list is NULL or shorter than n_top,
+ * or with fixed-point evaluation, which has no shortlist support.
+ *
+ * @return 0 if successful, -1 otherwise.
+ */
+int32 gauden_dist_shortlist(gauden_t *g, int mgau, int32 feat, int32 n_top,
+                            mfcc_t *obs, gauden_dist_t *out_dist,
+                            uint16 const *list, int32 n_list);
+
 /**
    Dump the definitionn of Gaussian distribution. 
 */
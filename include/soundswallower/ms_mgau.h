@@ -103,6 +103,8 @@
 #include <soundswallower/bin_mdef.h>
 #include <soundswallower/ms_gauden.h>
 #include <soundswallower/ms_senone.h>
+#include <soundswallower/gausel.h>
+#include <soundswallower/workpool.h>
 
 #ifdef __cplusplus
 extern "C" {
@@ -125,6 +127,11 @@ typedef struct ms_mgau_model_s {
     gauden_dist_t ***dist;  
     uint8 *mgau_active;
     cmd_ln_t *config;
+    workpool_t *pool;     /**< Worker threads for scoring (or NULL) */
+    int32 *worker_best;   /**< Best senone score found by each worker */
+    gausel_t *gs;         /**< Gaussian selection shortlists (or NULL) */
+    int32 *gs_cw;         /**< Gaussian selection cell for each stream */
+    float32 gs_fallback;  /**< Evaluate all Gaussians outside this (see gausel_select()) */
 } ms_mgau_model_t;  
 
 #define ms_mgau_gauden(msg) (msg->g)
@@ -135,6 +142,7 @@ ps_mgau_t *ms_mgau_init(acmod_t *acmod);
 ps_mgau_t *ms_mgau_init_s3file(acmod_t *acmod,
                                s3file_t *means, s3file_t *vars, s3file_t *mixw,
                                s3file_t *senmgau);
+ps_mgau_t *ms_mgau_share(ps_mgau_t *g, acmod_t *acmod);
 void ms_mgau_free(ps_mgau_t *g);
 int32 ms_cont_mgau_frame_eval(ps_mgau_t * msg,
                               int16 *senscr,
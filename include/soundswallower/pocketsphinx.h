@@ -61,6 +61,10 @@ extern "C" {
  */
 typedef struct ps_decoder_s ps_decoder_t;
 
+/**
+ * Acoustic model and dictionary which can be shared by decoders.
+ */
+typedef struct ps_model_s ps_model_t;
 
 /**
  * PocketSphinx N-best hypothesis iterator object.
@@ -125,6 +129,104 @@ int ps_reinit(ps_decoder_t *ps, cmd_ln_t *config);
  */
 fe_t * ps_reinit_fe(ps_decoder_t *ps, cmd_ln_t *config);
 
+/**
+ * Load an acoustic model and dictionary to share between decoders.
+ *
+ * This loads the model definition, transition matrices, Gaussian
+ * parameters, mixture weights and dictionary given in
+ * <code>config</code> just like ps_init() would, but without
+ * creating a decoder.  Any number of decoders can then be created
+ * with ps_init_shared(), which will use the same copy of these
+ * rather than loading their own.
+ *
+ * @note Since they are shared, the parameters of the acoustic model
+ * cannot be adapted with ps_update_mllr() in any of the decoders.
+ * Adding words with ps_add_word() gives the decoder a private copy
+ * of the dictionary.
+ *
+ * @param config a configuration as for ps_init().  The model retains
+ *               this pointer, so you can free it.
+ * @return newly loaded model, or NULL on failure.
+ */
+ps_model_t *ps_model_init(cmd_ln_t *config);
+
+/**
+ * Retain a pointer to a shared model.
+ *
+ * @return pointer to retained model.
+ */
+ps_model_t *ps_model_retain(ps_model_t *model);
+
+/**
+ * Release a pointer to a shared model.
+ *
+ * Decoders using it retain it, so it is only actually freed along
+ * with the last of them.
+ *
+ * @return New reference count (0 if freed).
+ */
+int ps_model_free(ps_model_t *model);
+
+/**
+ * Get the configuration a shared model was loaded with.
+ *
+ * @return The configuration object for this model.  The model owns
+ *         this pointer, so you should not attempt to free it
+ *         manually.
+ */
+cmd_ln_t *ps_model_get_config(ps_model_t *model);
+
+/**
+ * Write a model as a single precompiled file.
+ *
+ * The file contains the acoustic model, noise dictionary,
+ * dictionary and feature parameters, with the Gaussians precomputed
+ * for the log base and variance floor of the model's configuration.
+ * It can be given to -hmm in place of a model directory, and is then
+ * memory-mapped and used without copying or computation, so loading
+ * takes almost no time and memory is shared between processes.
+ *
+ * @note Precomputed Gaussians cannot be adapted with
+ * ps_update_mllr(), and -logbase and -varfloor must be the same
+ * when loading as when writing.
+ *
+ * @param model a shared model, not itself loaded from such a file.
+ * @param outfile file to write.
+ * @return 0 for success, -1 on failure.
+ */
+int ps_model_write(ps_model_t *model, const char *outfile);
+
+/**
+ * Initialize a decoder using a shared model.
+ *
+ * Apart from the acoustic model and dictionary, which are taken from
+ * <code>model</code>, this works like ps_init().  Feature extraction
+ * parameters in <code>config</code> must match the ones in the
+ * model, which is the case if they use the same -hmm.
+ *
+ * @param model a shared model, which the decoder retains.
+ * @param config a configuration for the decoder, or NULL to use the
+ *               one that <code>model</code> was loaded with.
+ * @return newly initialized decoder, or NULL on failure.
+ */
+ps_decoder_t *ps_init_shared(ps_model_t *model, cmd_ln_t *config);
+
+/**
+ * Get a shared model from a decoder.
+ *
+ * If the decoder was created with ps_init_shared(), this is the
+ * model it uses, and it will keep using it if reinitialized.
+ * Otherwise, the parameters of its acoustic model and its dictionary
+ * are made available to share with other decoders, which do not
+ * share any of its other state.  If it is reinitialized, it loads
+ * them again, while the others keep using this model.
+ *
+ * @return The model used by this decoder.  The decoder owns this
+ *         pointer, so you should not attempt to free it manually.
+ *         Use ps_model_retain() if you wish to reuse it elsewhere.
+ */
+ps_model_t *ps_get_model(ps_decoder_t *ps);
+
 /**
  * Returns the argument definitions used in ps_init().
  *
@@ -306,6 +408,33 @@ int ps_process_cep(ps_decoder_t *ps,
                    int no_search,
                    int full_utt);
 
+/**
+ * Decode precomputed senone scores.
+ *
+ * This allows an external acoustic model (such as a neural network)
+ * to be used with the search.  The scores are used as-is in place of
+ * those from the acoustic model, which must still be loaded for its
+ * model definition and transition matrices.  They are negated
+ * log-likelihoods in the base of the decoder's log-math object,
+ * shifted right by 10 bits (so that smaller is better, and ideally
+ * the best score in each frame is 0).  Raw audio or features cannot
+ * be mixed with scores in the same utterance.
+ *
+ * @param ps Decoder.
+ * @param senscr Scores for n_frames consecutive frames of n_senone
+ *               senones each.
+ * @param n_senone Number of senones in each frame, which must match
+ *                 the acoustic model.
+ * @param no_search If non-zero, queue up the scores but don't do any
+ *                  recognition yet.
+ * @return Number of frames of data searched, or <0 for error.
+ */
+int ps_process_senscr(ps_decoder_t *ps,
+                      int16 const *senscr,
+                      int n_senone,
+                      int n_frames,
+                      int no_search);
+
 /**
  * Get the number of frames of data searched.
  *
@@ -193,10 +193,28 @@ struct ps_seg_s {
 /**
  * Decoder object.
  */
+/**
+ * Acoustic model and dictionary shared between decoders.
+ *
+ * Everything in here is read-only once loaded, except for the
+ * scoring state inside acmod, which only the decoder that loaded it
+ * (if any) will use.
+ */
+struct ps_model_s {
+    int refcount;      /**< Reference count. */
+    cmd_ln_t *config;  /**< Configuration used to load it. */
+    logmath_t *lmath;  /**< Log math computation. */
+    acmod_t *acmod;    /**< Model definition, transitions and GMMs. */
+    dict_t *dict;      /**< Pronunciation dictionary. */
+    dict2pid_t *d2p;   /**< Dictionary to senone mapping. */
+};
+
 struct ps_decoder_s {
     /* Model parameters and such. */
     cmd_ln_t *config;  /**< Configuration. */
     int refcount;      /**< Reference count. */
+    ps_model_t *model; /**< Shared acoustic model (or NULL). */
+    int use_model;     /**< Reinitialize with model rather than loading one. */
 
     /* Basic units of computation. */
     fe_t *fe;          /**< Acoustic feature computation. */
@@ -49,6 +49,8 @@
 #include <soundswallower/hmm.h>
 #include <soundswallower/bin_mdef.h>
 #include <soundswallower/ms_gauden.h>
+#include <soundswallower/gausel.h>
+#include <soundswallower/workpool.h>
 
 #ifdef __cplusplus
 extern "C" {
@@ -67,6 +69,7 @@ typedef struct ptm_topn_s {
 typedef struct ptm_fast_eval_s {
     ptm_topn_t ***topn;     /**< Top-N for each codebook (mgau x feature x topn) */
     bitvec_t *mgau_active; /**< Set of active codebooks */
+    int32 *gs_cw;          /**< Gaussian selection cell for each feature */
 } ptm_fast_eval_t;
 
 struct ptm_mgau_s {
@@ -78,12 +81,31 @@ struct ptm_mgau_s {
     uint8 ***mixw;     /**< Mixture weight distributions by feature, codeword, senone */
     s3file_t *sendump_mmap;/* Memory map for mixw (or NULL if not mmap) */
     uint8 *mixw_cb;    /* Mixture weight codebook, if any (assume it contains 16 values) */
+    uint8 **sen_mixw;  /**< Decoded mixture weights by senone, feature, codeword (or NULL) */
+    uint8 *sen_mixw_buf; /**< Storage for sen_mixw, grouped by codebook. */
     int16 max_topn;
     int16 ds_ratio;
 
+    /* Codebook evaluation kernels, selected by ptm_mgau_set_simd(). */
+    int (*eval_cb)(ptm_mgau_t *s, ptm_fast_eval_t *f, int cb, int feat, mfcc_t *z);
+    int (*eval_topn)(ptm_mgau_t *s, ptm_fast_eval_t *f, int cb, int feat, mfcc_t *z);
+    int16 simd;              /**< Instruction set used (simd_level_t). */
+    int16 ilv_width;         /**< Number of densities per interleaved block. */
+    mfcc_t ***ilv_mean;      /**< Means interleaved by block of densities, or NULL. */
+    mfcc_t ***ilv_var;       /**< Precomputed variances, likewise. */
+    mfcc_t ***ilv_det;       /**< Determinants, padded to a whole block. */
+
     ptm_fast_eval_t *hist;   /**< Fast evaluation info for past frames. */
     ptm_fast_eval_t *f;      /**< Fast eval info for current frame. */
     int n_fast_hist;         /**< Number of past frames tracked. */
+    int32 block_first;       /**< First frame done by ptm_mgau_frame_eval_block(). */
+    int32 block_end;         /**< Frame after the last one it did. */
+
+    workpool_t *pool;        /**< Worker threads for scoring (or NULL). */
+    int32 *worker_best;      /**< Best senone score found by each worker. */
+
+    gausel_t *gs;            /**< Gaussian selection shortlists (or NULL). */
+    float32 gs_fallback;     /**< Evaluate all Gaussians outside this (see gausel_select()). */
 
     /* Log-add table for compressed values. */
     logmath_t *lmath_8b;
@@ -94,6 +116,7 @@ struct ptm_mgau_s {
 ps_mgau_t *ptm_mgau_init(acmod_t *acmod);
 ps_mgau_t *ptm_mgau_init_s3file(acmod_t *acmod, s3file_t *means, s3file_t *vars,
                                 s3file_t *mixw, s3file_t *sendump);
+ps_mgau_t *ptm_mgau_share(ps_mgau_t *s, acmod_t *acmod);
 void ptm_mgau_free(ps_mgau_t *s);
 int ptm_mgau_frame_eval(ps_mgau_t *s,
                         int16 *senone_scores,
@@ -104,6 +127,34 @@ int ptm_mgau_frame_eval(ps_mgau_t *s,
                         int32 compallsen);
 int ptm_mgau_mllr_transform(ps_mgau_t *s,
                             ps_mllr_t *mllr);
+int ptm_mgau_frame_eval_block(ps_mgau_t *s,
+                              mfcc_t ***feats,
+                              int32 frame,
+                              int32 n_frames);
+/**
+ * Select the codebook evaluation kernels for a given instruction set.
+ *
+ * This is done automatically at initialization using the best one
+ * the CPU supports, you only need it to compare them.
+ *
+ * @param level an instruction set (simd_level_t)
+ * @return the instruction set actually used, which will be SIMD_NONE
+ *         if the requested one was not compiled in.
+ */
+int ptm_mgau_set_simd(ps_mgau_t *s, int level);
+/**
+ * Build or free a senone-major copy of the mixture weights.
+ *
+ * The mixture weights are stored by feature, codeword, then senone,
+ * which is the wrong way around for scoring.  This makes a decoded
+ * copy where each senone's weights are contiguous.  It is done at
+ * initialization if -senmajor is set.
+ *
+ * @param enable TRUE to build the copy, FALSE to free it.
+ * @return 0, or -1 if the mixture weights are shared with another
+ *         decoder.
+ */
+int ptm_mgau_set_senmajor(ps_mgau_t *s, int enable);
 
 #ifdef __cplusplus
 } /* extern "C" */
@@ -49,6 +49,7 @@
 #include <soundswallower/hmm.h>
 #include <soundswallower/bin_mdef.h>
 #include <soundswallower/ms_gauden.h>
+#include <soundswallower/workpool.h>
 
 #ifdef __cplusplus
 extern "C" {
@@ -80,15 +81,27 @@ struct s2_semi_mgau_s {
     vqFeature_t **f;          /**< Topn-N for currently scoring frame. */
     int n_topn_hist;          /**< Number of past frames tracked. */
 
+    workpool_t *pool;         /**< Worker threads for scoring (or NULL). */
+    int16 **worker_scores;    /**< Partial senone scores for workers other than the first. */
+
     /* Log-add table for compressed values. */
     logmath_t *lmath_8b;
     /* Log-add object for reloading means/variances. */
     logmath_t *lmath;
+
+    /* 4-bit mixture weight kernels, selected by s2_semi_mgau_set_simd(). */
+    int32 (*scores_4b)(s2_semi_mgau_t *s, int i, int topn,
+                       int16 *senone_scores, uint8 *senone_active,
+                       int32 n_senone_active);
+    int32 (*scores_4b_all)(s2_semi_mgau_t *s, int i, int topn,
+                           int16 *senone_scores);
+    int16 simd;         /**< Instruction set used (simd_level_t). */
 };
 
 ps_mgau_t *s2_semi_mgau_init(acmod_t *acmod);
 ps_mgau_t *s2_semi_mgau_init_s3file(acmod_t *acmod, s3file_t *means, s3file_t *vars,
                                     s3file_t *mixw, s3file_t *sendump);
+ps_mgau_t *s2_semi_mgau_share(ps_mgau_t *s, acmod_t *acmod);
 void s2_semi_mgau_free(ps_mgau_t *s);
 int s2_semi_mgau_frame_eval(ps_mgau_t *s,
                             int16 *senone_scores,
@@ -99,6 +112,21 @@ int s2_semi_mgau_frame_eval(ps_mgau_t *s,
                             int32 compallsen);
 int s2_semi_mgau_mllr_transform(ps_mgau_t *s,
                                 ps_mllr_t *mllr);
+/**
+ * Select the 4-bit mixture weight kernels for a given instruction set.
+ *
+ * This is done automatically at initialization using the best one
+ * the CPU supports, you only need it to compare them.  The vector
+ * kernels look up both the mixture weight codebook and the log-add
+ * table with byte shuffles, so they need AVX2 (or AArch64 NEON), and
+ * AVX-512 uses the AVX2 ones.
+ *
+ * @param level an instruction set (simd_level_t)
+ * @return the instruction set actually used, which will be SIMD_NONE
+ *         if the requested one was not compiled in or cannot
+ *         reproduce the scalar log-add exactly.
+ */
+int s2_semi_mgau_set_simd(ps_mgau_t *s, int level);
 
 #ifdef __cplusplus
 } /* extern "C" */
@@ -81,6 +81,7 @@ typedef struct s3hdr_s {
 typedef struct s3file_s {
     int refcount;
     mmio_file_t *mf;
+    struct s3file_s *parent;
     const void *buf;
     const char *ptr, *end;
     s3hdr_t *headers;
@@ -100,6 +101,12 @@ s3file_t *s3file_init(const void *buf, size_t len);
  */
 s3file_t *s3file_map_file(const char *filename);
 
+/**
+ * Initialize an s3file_t for part of another one, which is retained
+ * so that the memory stays valid for as long as this one does.
+ */
+s3file_t *s3file_init_sub(s3file_t *s, size_t offset, size_t len);
+
 /**
  * Retain s3file_t.
  */
@@ -0,0 +1,108 @@
+/* -*- c-basic-offset: 4; indent-tabs-mode: nil -*- */
+/* ====================================================================
+ * Copyright (c) 2022 Carnegie Mellon University.  All rights
+ * reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer. 
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in
+ *    the documentation and/or other materials provided with the
+ *    distribution.
+ *
+ * This work was supported in part by funding from the Defense Advanced 
+ * Research Projects Agency and the National Science Foundation of the 
+ * United States of America, and the CMU Sphinx Speech Consortium.
+ *
+ * THIS SOFTWARE IS PROVIDED BY CARNEGIE MELLON UNIVERSITY ``AS IS'' AND 
+ * ANY EXPRESSED OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, 
+ * THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ * PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL CARNEGIE MELLON UNIVERSITY
+ * NOR ITS EMPLOYEES BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT 
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, 
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY 
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT 
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE 
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ * ====================================================================
+ *
+ */
+/**
+ * @file simd.h
+ * @brief Run-time detection of SIMD instruction sets.
+ *
+ * Compute kernels which have vectorized variants are compiled for
+ * each instruction set using per-function target attributes, and the
+ * best one supported by the CPU is selected when a model is loaded.
+ * Nothing here requires special compiler flags for the library as a
+ * whole.
+ */
+
+#ifndef __SIMD_H__
+#define __SIMD_H__
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+#if 0
+/* Fool Emacs. */
+}
+#endif
+
+/**
+ * Instruction sets which we know about, in increasing order of
+ * preference within each architecture.
+ */
+typedef enum simd_level_e {
+    SIMD_NONE = 0,  /**< Plain C (always available) */
+    SIMD_SSE2,      /**< x86 SSE2 (always available on x86-64) */
+    SIMD_AVX2,      /**< x86 AVX2 */
+    SIMD_AVX512,    /**< x86 AVX-512F */
+    SIMD_NEON,      /**< ARM Advanced SIMD */
+    SIMD_WASM       /**< WebAssembly 128-bit SIMD */
+} simd_level_t;
+
+/* Whether we can compile kernels for a given architecture. */
+#if (defined(__GNUC__) || defined(__clang__)) \
+    && (defined(__x86_64__) || defined(__i386__)) && !defined(__EMSCRIPTEN__)
+#define HAVE_SIMD_X86 1
+#define SIMD_TARGET(isa) __attribute__((target(isa)))
+#elif defined(_MSC_VER) && (defined(_M_X64) || defined(_M_IX86))
+#define HAVE_SIMD_X86 1
+#define SIMD_TARGET(isa)
+#elif defined(__ARM_NEON) || defined(__ARM_NEON__)
+#define HAVE_SIMD_NEON 1
+#define SIMD_TARGET(isa)
+#elif defined(__wasm_simd128__)
+#define HAVE_SIMD_WASM 1
+#define SIMD_TARGET(isa)
+#else
+#define SIMD_TARGET(isa)
+#endif
+
+/**
+ * Get the best instruction set supported by this CPU.
+ *
+ * This is computed once and cached.  If the environment variable
+ * SOUNDSWALLOWER_SIMD is set to "none", SIMD_NONE is always
+ * returned, which is useful for debugging.
+ */
+simd_level_t simd_detect(void);
+
+/**
+ * Get a printable name for an instruction set.
+ */
+const char *simd_level_name(simd_level_t level);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __SIMD_H__ */
@@ -0,0 +1,156 @@
+/* -*- c-basic-offset: 4; indent-tabs-mode: nil -*- */
+/* ====================================================================
+ * Copyright (c) 2022 Carnegie Mellon University.  All rights
+ * reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer. 
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in
+ *    the documentation and/or other materials provided with the
+ *    distribution.
+ *
+ * This work was supported in part by funding from the Defense Advanced 
+ * Research Projects Agency and the National Science Foundation of the 
+ * United States of America, and the CMU Sphinx Speech Consortium.
+ *
+ * THIS SOFTWARE IS PROVIDED BY CARNEGIE MELLON UNIVERSITY ``AS IS'' AND 
+ * ANY EXPRESSED OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, 
+ * THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ * PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL CARNEGIE MELLON UNIVERSITY
+ * NOR ITS EMPLOYEES BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT 
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, 
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY 
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT 
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE 
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ * ====================================================================
+ *
+ */
+/**
+ * @file vad.h
+ * @brief Energy-based voice activity detection for live input.
+ *
+ * This sits between the front end and the dynamic feature
+ * computation in acmod, and decides, one frame of cepstra at a time,
+ * whether we are in speech or in silence.  It looks only at C0 (the
+ * log energy), compared to a noise floor which follows its lower
+ * envelope: quickly downwards, and slowly upwards, in the same way as
+ * the noise estimate in fe_noise.c.
+ *
+ * A number of consecutive frames above the floor starts speech, and
+ * a longer run of frames below it ends it.  While in silence, the most
+ * recent frames are held back from feature computation, so that some
+ * of them can be kept as leading context when speech starts, and the
+ * rest can be dropped without being scored or searched.  The frames
+ * dropped are recorded, so that times in the search can be mapped
+ * back to times in the input (see vad_input_frame()).
+ */
+
+#ifndef __VAD_H__
+#define __VAD_H__
+
+#include <soundswallower/prim_type.h>
+#include <soundswallower/cmd_ln.h>
+#include <soundswallower/fe.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+#if 0
+/* Fool Emacs. */
+}
+#endif
+
+/**
+ * Silence dropped from the input before a frame of features.
+ */
+typedef struct vad_skip_s {
+    int32 frame;     /**< First frame of features after the silence. */
+    int32 n_skip;    /**< Total frames dropped up to here. */
+} vad_skip_t;
+
+/**
+ * Voice activity detector.
+ */
+typedef struct vad_s {
+    mfcc_t threshold;   /**< C0 above the noise floor for speech. */
+    int32 prespeech;    /**< Frames of silence to keep before speech. */
+    int32 postspeech;   /**< Frames of silence to keep after speech. */
+    int32 startspeech;  /**< Frames of energy needed to start speech. */
+
+    mfcc_t floor;       /**< Current noise floor (in units of C0). */
+    uint8 floor_init;   /**< Has the noise floor been initialized? */
+    uint8 in_speech;    /**< Are we in speech? */
+    int32 n_run;        /**< Frames of energy (in silence) or of silence
+                           (in speech) in a row. */
+    int32 n_held;       /**< Latest frames held back in silence. */
+    int32 n_in;         /**< Frames seen in this utterance. */
+
+    vad_skip_t *skip;   /**< Silence dropped in this utterance. */
+    int32 n_skip;       /**< Number of entries in skip. */
+    int32 n_skip_alloc; /**< Number of entries allocated in skip. */
+} vad_t;
+
+/**
+ * Create a voice activity detector from -vad_* options in config.
+ *
+ * @param max_held Largest number of frames which can be held back at
+ *                 once (the leading context plus the frames needed
+ *                 to start speech are limited to this).
+ * @return a new detector, or NULL on failure.
+ */
+vad_t *vad_init(cmd_ln_t *config, int32 max_held);
+
+/**
+ * Free a voice activity detector.
+ */
+void vad_free(vad_t *vad);
+
+/**
+ * Start an utterance.  The state goes back to silence, but the noise
+ * floor is kept from previous utterances.
+ */
+void vad_start(vad_t *vad);
+
+/**
+ * Update the detector with one frame of cepstra.
+ *
+ * @return TRUE if in speech after this frame, FALSE otherwise.
+ */
+int vad_update(vad_t *vad, mfcc_t const *cep);
+
+/**
+ * Number of held frames which are not needed as leading context and
+ * can be dropped.
+ */
+int32 vad_n_excess(vad_t *vad);
+
+/**
+ * Record that the oldest n_skip held frames were dropped before the
+ * frame of features frame.
+ */
+void vad_skip(vad_t *vad, int32 frame, int32 n_skip);
+
+/**
+ * Map a frame of features to a frame of input in this utterance.
+ */
+int32 vad_input_frame(vad_t *vad, int32 frame);
+
+/**
+ * Total number of frames dropped in this utterance.
+ */
+#define vad_n_skipped(vad) ((vad)->n_skip ? (vad)->skip[(vad)->n_skip - 1].n_skip : 0)
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __VAD_H__ */
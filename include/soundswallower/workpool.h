@@ -0,0 +1,127 @@
+/* -*- c-basic-offset: 4; indent-tabs-mode: nil -*- */
+/* ====================================================================
+ * Copyright (c) 2022 Carnegie Mellon University.  All rights
+ * reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer. 
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in
+ *    the documentation and/or other materials provided with the
+ *    distribution.
+ *
+ * This work was supported in part by funding from the Defense Advanced 
+ * Research Projects Agency and the National Science Foundation of the 
+ * United States of America, and the CMU Sphinx Speech Consortium.
+ *
+ * THIS SOFTWARE IS PROVIDED BY CARNEGIE MELLON UNIVERSITY ``AS IS'' AND 
+ * ANY EXPRESSED OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, 
+ * THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ * PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL CARNEGIE MELLON UNIVERSITY
+ * NOR ITS EMPLOYEES BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT 
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, 
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY 
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT 
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE 
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ * ====================================================================
+ *
+ */
+/**
+ * @file workpool.h
+ * @brief Persistent pool of worker threads for acoustic scoring.
+ *
+ * This is deliberately very simple: a job is a single function which
+ * is called once by each worker (including the calling thread, which
+ * is always worker 0) with its index and the number of workers, and
+ * workpool_run() returns when all of them have finished.  Dividing up
+ * the work is the caller's business.
+ *
+ * If the library was built without threads, or only one worker is
+ * requested, workpool_init() returns NULL, and callers are expected
+ * to just do the work themselves.
+ */
+
+#ifndef __WORKPOOL_H__
+#define __WORKPOOL_H__
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+#if 0
+/* Fool Emacs. */
+}
+#endif
+
+/**
+ * A pool of worker threads.
+ */
+typedef struct workpool_s workpool_t;
+
+/**
+ * Function run by each worker.
+ *
+ * @param arg argument passed to workpool_run()
+ * @param worker index of this worker, from 0 to n_workers - 1
+ * @param n_workers total number of workers
+ */
+typedef void (*workpool_func_t)(void *arg, int worker, int n_workers);
+
+/**
+ * Start a pool of worker threads.
+ *
+ * @param n_workers total number of workers, including the calling
+ *                  thread (so n_workers - 1 threads are started)
+ * @return new pool, or NULL if n_workers <= 1 or threads are not
+ *         available.
+ */
+workpool_t *workpool_init(int n_workers);
+
+/**
+ * Get the number of workers in a pool (1 if pool is NULL).
+ */
+int workpool_n_workers(workpool_t *pool);
+
+/**
+ * Run a job on all workers and wait for it to finish.
+ *
+ * If pool is NULL, this simply calls func(arg, 0, 1).
+ */
+void workpool_run(workpool_t *pool, workpool_func_t func, void *arg);
+
+/**
+ * Start a job on the worker threads and return without waiting.
+ *
+ * The calling thread does not take part, so func is called with
+ * worker indices from 0 to n_workers - 2.  Nothing else may be done
+ * with the pool (or with anything the job uses) until
+ * workpool_wait() is called.
+ *
+ * @return 0, or -1 if pool is NULL, in which case nothing is done.
+ */
+int workpool_start(workpool_t *pool, workpool_func_t func, void *arg);
+
+/**
+ * Wait for a job started with workpool_start() to finish.
+ *
+ * Returns immediately if there is none, or if pool is NULL.
+ */
+void workpool_wait(workpool_t *pool);
+
+/**
+ * Stop the worker threads and free a pool.
+ */
+void workpool_free(workpool_t *pool);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __WORKPOOL_H__ */
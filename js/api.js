@@ -40,6 +40,9 @@ class Config {
      *                 - Directory or base URL of acoustic model.
      * @param {string} [dict.loglevel="ERROR"] - Verbosity of logging.
      * @param {number} [dict.samprate=44100] - Sampling rate of input.
+     * @param {number} [dict.resample=0] - Resample input to this rate
+     *                 (e.g. 16000 for the default model) before
+     *                 computing features, 0 for no resampling.
      */
     constructor(dict) {
 	this.cmd_ln = Module._cmd_ln_parse_r(0, Module._ps_args(), 0, 0, 0);
@@ -195,6 +198,26 @@ class Config {
     }
 };
 
+/**
+ * Acoustic model and dictionary shared between decoders.
+ *
+ * Obtain one with Decoder.get_model(), then pass it to
+ * Decoder.initialize_shared().
+ */
+class Model {
+    constructor(model) {
+	this.model = model;
+    }
+    /**
+     * Release this reference to the model.
+     */
+    delete() {
+	if (this.model)
+	    Module._ps_model_free(this.model);
+	this.model = 0;
+    }
+};
+
 /**
  * Speech recognizer object.
  */
@@ -246,6 +269,59 @@ class Decoder {
 	this.initialized = true;
     }
 
+    /**
+     * (Re-)initialize the decoder asynchronously, using the acoustic
+     * model and dictionary of another one.
+     *
+     * This is much faster and uses much less memory than loading
+     * them again.  Feature extraction parameters have to be the same
+     * as the model's, which they are if they use the same model
+     * directory.
+     * @param {Model} model - Model obtained with get_model().
+     * @param {Object|Config} [config] - New configuration parameters
+     * to apply, if desired.
+     * @returns {Promise} Promise resolved once decoder is ready.
+     */
+    async initialize_shared(model, config) {
+	if (this.ps == 0)
+	    throw new Error("Decoder was somehow not constructed (ps==0)");
+	if (config !== undefined) {
+	    if (this.config)
+		this.config.delete();
+	    if (typeof(config) == 'object' && 'cmd_ln' in config)
+		this.config = config;
+	    else
+		this.config = new Module.Config(config);
+	}
+	await this.init_config();
+	await this.init_fe();
+	await this.init_feat();
+	const rv = Module._ps_init_model(this.ps, model.model);
+	if (rv < 0)
+	    throw new Error("Failed to initialize shared acoustic model");
+	await this.init_grammar();
+
+	this.initialized = true;
+    }
+
+    /**
+     * Get the acoustic model and dictionary to share with other
+     * decoders.
+     *
+     * Note that none of them can be adapted to a speaker after
+     * this, and words added to one are not added to the others.
+     * @returns {Model} Shared model.  You must call its delete()
+     * method once it is no longer needed, though it will not be
+     * freed until all decoders using it are.
+     */
+    get_model() {
+	this.assert_initialized();
+	const model = Module._ps_get_model(this.ps);
+	if (model == 0)
+	    throw new Error("Failed to get acoustic model");
+	return new Model(Module._ps_model_retain(model));
+    }
+
     /**
      * Initialize decoder configuration.
      */
@@ -312,11 +388,23 @@ class Decoder {
 	await this.load_mdef();
 	const tmat = this.config.model_file_path("tmat", "transition_matrices");
 	await this.load_tmat(tmat);
-	const means = this.config.model_file_path("mean", "means");
-	const variances = this.config.model_file_path("var", "variances");
-	const sendump = this.config.model_file_path("sendump", "sendump");
-	const mixw = this.config.model_file_path("mixw", "mixture_weights");
-	await this.load_gmm(means, variances, sendump, mixw);
+	/* Use a neural network instead of the GMMs if there is one. */
+	let mlp;
+	try {
+	    mlp = await load_to_s3file(this.config.model_file_path("mlp", "mlp"));
+	}
+	catch (e) {
+	    mlp = 0;
+	}
+	if (mlp)
+	    await this.load_mlp(mlp);
+	else {
+	    const means = this.config.model_file_path("mean", "means");
+	    const variances = this.config.model_file_path("var", "variances");
+	    const sendump = this.config.model_file_path("sendump", "sendump");
+	    const mixw = this.config.model_file_path("mixw", "mixture_weights");
+	    await this.load_gmm(means, variances, sendump, mixw);
+	}
 	const rv = Module._ps_init_acmod_post(this.ps);
 	if (rv < 0)
 	    throw new Error("Failed to initialize acoustic scoring");
@@ -383,6 +471,16 @@ class Decoder {
 	    throw new Error("Failed to load GMM parameters");
     }
 
+    /**
+     * Load neural network senone scorer
+     */
+    async load_mlp(mlp) {
+	const rv = Module._load_mlp(this.ps, mlp);
+	Module._s3file_free(mlp);
+	if (rv < 0)
+	    throw new Error("Failed to load neural network");
+    }
+
     /**
      * Load dictionary from configuration.
      */
@@ -495,6 +593,36 @@ class Decoder {
 	return rv;
     }
 
+    /**
+     * Process a block of precomputed senone scores asynchronously.
+     * These are used instead of the acoustic model's own scores, and
+     * are negated log-likelihoods in the decoder's log base, shifted
+     * right by 10 bits.  Audio cannot be processed in the same
+     * utterance.
+     * @param {Int16Array} senscr - Scores for some number of frames,
+     * one after the other.
+     * @param {number} n_senone - Number of scores in each frame, which
+     * must be the number of senones in the acoustic model.
+     * @returns {Promise<number>} Promise resolved to the number of
+     * frames searched.
+     */
+    async process_senscr(senscr, n_senone, no_search=false) {
+	this.assert_initialized();
+	const senscr_bytes = senscr.length * senscr.BYTES_PER_ELEMENT;
+	const senscr_addr = Module._malloc(senscr_bytes);
+	const senscr_u8 = new Uint8Array(senscr.buffer, senscr.byteOffset,
+					 senscr_bytes);
+	writeArrayToMemory(senscr_u8, senscr_addr);
+	const rv = Module._ps_process_senscr(this.ps, senscr_addr, n_senone,
+					     senscr.length / n_senone,
+					     no_search);
+	Module._free(senscr_addr);
+	if (rv < 0) {
+	    throw new Error("Senone score processing failed");
+	}
+	return rv;
+    }
+
     /**
      * Get the currently recognized text.
      * @returns {string} Currently recognized text.
@@ -775,3 +903,4 @@ function get_model_path(subpath) {
 Module.get_model_path = get_model_path;
 Module.Config = Config;
 Module.Decoder = Decoder;
+Module.Model = Model;
@@ -14,6 +14,7 @@
 #include <soundswallower/ptm_mgau.h>
 #include <soundswallower/s2_semi_mgau.h>
 #include <soundswallower/ms_mgau.h>
+#include <soundswallower/mlp_mgau.h>
 
 EMSCRIPTEN_KEEPALIVE void
 fsg_set_states(fsg_model_t *fsg, int start_state, int final_state)
@@ -81,3 +82,16 @@ load_gmm(ps_decoder_t *ps, s3file_t *means, s3file_t *vars, s3file_t *mixw, s3fi
     /* FIXME: Apply MLLR as well... */
     return 0;
 }
+
+EMSCRIPTEN_KEEPALIVE int
+load_mlp(ps_decoder_t *ps, s3file_t *mlp)
+{
+    acmod_t *acmod = ps->acmod;
+
+    E_INFO("Using neural network senone scoring\n");
+    if ((acmod->mgau = mlp_mgau_init_s3file(acmod, mlp)) == NULL) {
+	E_ERROR("Failed to read neural network\n");
+	return -1;
+    }
+    return 0;
+}
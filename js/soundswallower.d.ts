@@ -12,10 +12,13 @@ export class Decoder {
     initialized: boolean;
     delete(): void;
     initialize(config?: Config|Object): Promise<any>;
+    initialize_shared(model: Model, config?: Config|Object): Promise<any>;
+    get_model(): Model;
     reinitialize_audio(): Promise<void>;
     start(): Promise<void>;
     stop(): Promise<void>;
     process(pcm: Float32Array|Uint8Array, no_search:boolean, full_utt:boolean): Promise<number>;
+    process_senscr(senscr: Int16Array, n_senone: number, no_search?: boolean): Promise<number>;
     get_hyp(): string;
     get_hypseg(): Array<Segment>;
     lookup_word(word: string): string;
@@ -28,6 +31,9 @@ export class Decoder {
 export interface Grammar {
     delete(): void;
 }
+export interface Model {
+    delete(): void;
+}
 export interface Transition {
     from: number;
     to: number;
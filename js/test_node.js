@@ -157,6 +157,52 @@
 	    assert.equal("go forward ten meters", decoder.get_hyp());
 	});
     });
+    describe("Test senone score input", () => {
+	it('Should accept scores but not mix them with audio', async () => {
+	    let decoder = new ssjs.Decoder({
+		fsg: "testdata/goforward.fsg",
+		samprate: 16000,
+	    });
+	    await decoder.initialize();
+	    const n_sen = 5126; // in en-us
+	    await decoder.start();
+	    assert.equal(await decoder.process_senscr(new Int16Array(100 * n_sen),
+						      n_sen), 100);
+	    await assert.rejects(decoder.process_senscr(new Int16Array(420), 42));
+	    await decoder.stop();
+	    let pcm = await fs.readFile("testdata/goforward-float32.raw");
+	    await decoder.start();
+	    await decoder.process(pcm, false, true);
+	    await assert.rejects(decoder.process_senscr(new Int16Array(n_sen),
+							n_sen));
+	    await decoder.stop();
+	    assert.equal("go forward ten meters", decoder.get_hyp());
+	    decoder.delete();
+	});
+    });
+    describe("Test shared model", () => {
+	it('Should recognize "go forward ten meters" twice', async () => {
+	    let decoder = new ssjs.Decoder({
+		fsg: "testdata/goforward.fsg",
+		samprate: 16000,
+	    });
+	    await decoder.initialize();
+	    let model = decoder.get_model();
+	    let decoder2 = new ssjs.Decoder({
+		fsg: "testdata/goforward.fsg",
+		samprate: 16000,
+	    });
+	    await decoder2.initialize_shared(model);
+	    model.delete();
+	    decoder.delete();
+	    let pcm = await fs.readFile("testdata/goforward-float32.raw");
+	    await decoder2.start();
+	    await decoder2.process(pcm, false, true);
+	    await decoder2.stop();
+	    assert.equal("go forward ten meters", decoder2.get_hyp());
+	    decoder2.delete();
+	});
+    });
     describe("Test dictionary and FSG", () => {
 	it('Should recognize "_go _forward _ten _meters"', async () => {
 	    let decoder = new ssjs.Decoder({samprate: 16000});
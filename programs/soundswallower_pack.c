@@ -0,0 +1,111 @@
+/* -*- c-basic-offset: 4; indent-tabs-mode: nil -*- */
+/* ====================================================================
+ * Copyright (c) 2022 Carnegie Mellon University.  All rights
+ * reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer. 
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in
+ *    the documentation and/or other materials provided with the
+ *    distribution.
+ *
+ * This work was supported in part by funding from the Defense Advanced 
+ * Research Projects Agency and the National Science Foundation of the 
+ * United States of America, and the CMU Sphinx Speech Consortium.
+ *
+ * THIS SOFTWARE IS PROVIDED BY CARNEGIE MELLON UNIVERSITY ``AS IS'' AND 
+ * ANY EXPRESSED OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, 
+ * THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ * PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL CARNEGIE MELLON UNIVERSITY
+ * NOR ITS EMPLOYEES BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT 
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, 
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY 
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT 
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE 
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ * ====================================================================
+ *
+ */
+/**
+ * @file soundswallower_pack.c
+ * @brief Write a precompiled acoustic model.
+ *
+ * Usage: soundswallower_pack [-gauden-only|-gausel-only] -hmm MODELDIR [OPTIONS...] OUTPUT
+ *
+ * OPTIONS are decoder configuration parameters, as for ps_init(), of
+ * which those that affect the acoustic model (-logbase, -varfloor,
+ * -dict, -fdict, etc) are baked into OUTPUT, which can then be
+ * passed to -hmm instead of MODELDIR.  See ps_model_write().
+ *
+ * With -gauden-only, only the precomputed Gaussians are written,
+ * which can be copied to MODELDIR/gauden to load that directory
+ * faster (see modelpack_write_gauden()).  With -gausel-only,
+ * Gaussian selection shortlists are built and written instead, which
+ * can be copied to MODELDIR/gausel to evaluate fewer Gaussians (see
+ * modelpack_write_gausel()).
+ */
+
+#include <stdio.h>
+
+#include <string.h>
+
+#include <soundswallower/pocketsphinx.h>
+#include <soundswallower/modelpack.h>
+#include <soundswallower/err.h>
+
+int
+main(int argc, char *argv[])
+{
+    cmd_ln_t *config;
+    ps_model_t *model;
+    const char *outfile;
+    int gauden_only = FALSE, gausel_only = FALSE;
+    int rv;
+
+    if (argc > 1 && 0 == strcmp(argv[1], "-gausel-only"))
+        gausel_only = TRUE;
+    if (argc > 1 && (gausel_only || 0 == strcmp(argv[1], "-gauden-only"))) {
+        gauden_only = !gausel_only;
+        /* Drop it, keeping the program name for cmd_ln_parse_r() to skip. */
+        argv[1] = argv[0];
+        ++argv;
+        --argc;
+    }
+    /* Options come in pairs, followed by the output file. */
+    if (argc < 2 || argc % 2 != 0) {
+        fprintf(stderr,
+                "Usage: soundswallower_pack [-gauden-only|-gausel-only] "
+                "-hmm MODELDIR [OPTIONS...] OUTPUT\n");
+        return 1;
+    }
+    outfile = argv[argc - 1];
+    if ((config = cmd_ln_parse_r(NULL, ps_args(), argc - 1, argv, TRUE)) == NULL)
+        return 1;
+    if ((model = ps_model_init(config)) == NULL) {
+        E_ERROR("Failed to load acoustic model\n");
+        cmd_ln_free_r(config);
+        return 1;
+    }
+    if (gauden_only || gausel_only) {
+        logmath_t *lmath = logmath_init(cmd_ln_float32_r(config, "-logbase"),
+                                        0, FALSE);
+        if (gausel_only)
+            rv = modelpack_write_gausel(ps_model_get_config(model), lmath, outfile);
+        else
+            rv = modelpack_write_gauden(ps_model_get_config(model), lmath, outfile);
+        logmath_free(lmath);
+    }
+    else
+        rv = ps_model_write(model, outfile);
+    ps_model_free(model);
+    cmd_ln_free_r(config);
+    return rv == 0 ? 0 : 1;
+}
@@ -137,10 +137,18 @@ cdef extern from "soundswallower/jsgf.h":
 cdef extern from "soundswallower/pocketsphinx.h":
     ctypedef struct ps_decoder_t:
         pass
+    ctypedef struct ps_model_t:
+        pass
     ctypedef struct ps_seg_t:
         pass
     arg_t *ps_args()
+    ps_model_t *ps_model_init(cmd_ln_t *config)
+    ps_model_t *ps_model_retain(ps_model_t *model)
+    int ps_model_free(ps_model_t *model)
+    int ps_model_write(ps_model_t *model, const char *outfile)
     ps_decoder_t *ps_init(cmd_ln_t *config)
+    ps_decoder_t *ps_init_shared(ps_model_t *model, cmd_ln_t *config)
+    ps_model_t *ps_get_model(ps_decoder_t *ps)
     int ps_free(ps_decoder_t *ps)
     int ps_reinit(ps_decoder_t *ps, cmd_ln_t *config)
     fe_t *ps_reinit_fe(ps_decoder_t *ps, cmd_ln_t *config)
@@ -149,6 +157,9 @@ cdef extern from "soundswallower/pocketsphinx.h":
     int ps_process_raw(ps_decoder_t *ps,
                        const short *data, size_t n_samples,
                        int no_search, int full_utt)
+    int ps_process_senscr(ps_decoder_t *ps,
+                          const short *senscr, int n_senone,
+                          int n_frames, int no_search)
     int ps_end_utt(ps_decoder_t *ps)
     const char *ps_get_hyp(ps_decoder_t *ps, int *out_best_score)
     int ps_get_prob(ps_decoder_t *ps)
@@ -331,6 +331,57 @@ cdef class FsgModel:
         fsg_model_free(self.fsg)
 
 
+cdef class Model:
+    """Acoustic model and dictionary which can be shared by decoders.
+
+    Loading these takes most of the time and memory needed to create
+    a `Decoder`.  If you need many decoders for the same model, load
+    it once and pass it to each of them with the ``model`` keyword
+    argument.  Note that they cannot be adapted to a speaker, and
+    that words added to one of them are not added to the others.
+
+    Args:
+        config(Config): Optional configuration object, otherwise
+                        keyword arguments are used as for `Decoder`.
+    """
+    cdef ps_model_t *model
+    cdef public Config config
+
+    def __cinit__(self):
+        self.model = NULL
+
+    def __init__(self, *args, **kwargs):
+        if len(args) == 1 and isinstance(args[0], Config):
+            self.config = args[0]
+        else:
+            self.config = Config(*args, **kwargs)
+        if self.config is None:
+            raise RuntimeError, "Failed to parse argument list"
+        self.model = ps_model_init(self.config.cmd_ln)
+        if self.model == NULL:
+            raise RuntimeError, "Failed to load model"
+
+    def __dealloc__(self):
+        ps_model_free(self.model)
+
+    def write(self, path):
+        """Write the model as a single precompiled file.
+
+        This file can be passed as ``hmm`` in place of a model
+        directory, and loads much faster, since it is used in place
+        without copying or computation.  It is specific to the
+        ``logbase`` and ``varfloor`` parameters of this model, and
+        to the byte order of this machine.
+
+        Args:
+            path(str): File to write.
+        Raises:
+            RuntimeError: If writing failed.
+        """
+        if ps_model_write(self.model, path.encode('utf-8')) < 0:
+            raise RuntimeError, "Failed to write model to %s" % path
+
+
 cdef class Decoder:
     """Main class for speech recognition and alignment in SoundSwallower.
 
@@ -350,19 +401,25 @@ cdef class Decoder:
         samprate(float): Sampling rate for raw audio data.
         logfn(str): File to write log messages to (set to `os.devnull` to
                     silence these messages)
+        model(Model): Shared acoustic model and dictionary to use
+                      instead of loading them.
 
     """
     cdef ps_decoder_t *ps
     cdef public Config config
 
     def __cinit__(self, *args, **kwargs):
+        cdef Model model = kwargs.pop("model", None)
         if len(args) == 1 and isinstance(args[0], Config):
             self.config = args[0]
         else:
             self.config = Config(*args, **kwargs)
         if self.config is None:
             raise RuntimeError, "Failed to parse argument list"
-        self.ps = ps_init(self.config.cmd_ln)
+        if model is None:
+            self.ps = ps_init(self.config.cmd_ln)
+        else:
+            self.ps = ps_init_shared(model.model, self.config.cmd_ln)
         if self.ps == NULL:
             raise RuntimeError, "Failed to initialize PocketSphinx"
 
@@ -383,6 +440,17 @@ cdef class Decoder:
         """
         return Config()
 
+    @property
+    def model(self):
+        """Model: Acoustic model and dictionary, to share with other decoders."""
+        cdef Model model = Model.__new__(Model)
+        cdef ps_model_t *cmodel = ps_get_model(self.ps)
+        if cmodel == NULL:
+            raise RuntimeError, "Decoder has no model"
+        model.model = ps_model_retain(cmodel)
+        model.config = self.config
+        return model
+
     def reinit(self, Config config=None):
         """Reinitialize the decoder.
 
@@ -445,6 +513,29 @@ cdef class Decoder:
                           n_samples, no_search, full_utt) < 0:
             raise RuntimeError, "Failed to process %d samples of audio data" % len / 2
 
+    def process_senscr(self, scores, no_search=False):
+        """Process a block of precomputed senone scores.
+
+        These are used instead of the acoustic model's own scores, for
+        instance to decode with a neural network.  They are negated
+        log-likelihoods in the decoder's log base, shifted right by 10
+        bits, so smaller is better.  Raw audio cannot be processed in
+        the same utterance.
+
+        Args:
+            scores: Scores as a two-dimensional buffer (such as a NumPy
+                    array) of 16-bit signed integers, with one row per
+                    frame and one column per senone in the acoustic model.
+            no_search(bool): If `True`, do not do any decoding on this data.
+
+        """
+        cdef const short[:, ::1] cdata = scores
+        if cdata.shape[0] == 0:
+            return
+        if ps_process_senscr(self.ps, &cdata[0, 0], cdata.shape[1],
+                             cdata.shape[0], no_search) < 0:
+            raise RuntimeError, "Failed to process %d frames of senone scores" % cdata.shape[0]
+
     def end_utt(self):
         """Finish processing raw audio input.
 
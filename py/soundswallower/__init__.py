@@ -21,6 +21,7 @@ import os
 
 from ._soundswallower import Config
 from ._soundswallower import Decoder
+from ._soundswallower import Model
 from ._soundswallower import FsgModel
 from ._soundswallower import Segment
 from ._soundswallower import Hypothesis
@@ -1,8 +1,9 @@
 #!/usr/bin/python3
 
 import os
+import tempfile
 import unittest
-from soundswallower import Decoder, get_model_path
+from soundswallower import Decoder, Model, get_model_path
 
 
 DATADIR = os.path.join(os.path.dirname(__file__),
@@ -50,6 +51,30 @@ class TestDecoder(unittest.TestCase):
         decoder.set_fsg(fsg)
         self._run_decode(decoder)
 
+    def test_shared_model(self):
+        model = Model(hmm=os.path.join(get_model_path(), 'en-us'),
+                      dict=os.path.join(DATADIR, 'turtle.dic'))
+        decoders = [Decoder(hmm=os.path.join(get_model_path(), 'en-us'),
+                            fsg=os.path.join(DATADIR, 'goforward.fsg'),
+                            model=model) for _ in range(3)]
+        del model
+        for decoder in decoders:
+            self._run_decode(decoder)
+        decoder = Decoder(decoders[0].config, model=decoders[0].model)
+        self._run_decode(decoder)
+
+    def test_model_write(self):
+        model = Model(hmm=os.path.join(get_model_path(), 'en-us'))
+        with tempfile.TemporaryDirectory() as tempdir:
+            packfile = os.path.join(tempdir, 'en-us.ssm')
+            model.write(packfile)
+            decoder = Decoder(hmm=packfile,
+                              fsg=os.path.join(DATADIR, 'goforward.fsg'),
+                              dict=os.path.join(DATADIR, 'turtle.dic'))
+            self._run_decode(decoder)
+            # It is mapped into memory, so let it go before deleting
+            del decoder
+
     def test_reinit(self):
         decoder = Decoder(hmm=os.path.join(get_model_path(), 'en-us'),
                           fsg=os.path.join(DATADIR, 'goforward.fsg'),
@@ -112,6 +137,33 @@ class TestDecoder(unittest.TestCase):
                 os.path.join(DATADIR, "goforward4k.wav"))
             self._check_hyp(hyp, hypseg)
 
+    def test_process_senscr(self):
+        """Test decoding with external senone scores."""
+        decoder = Decoder(hmm=os.path.join(get_model_path(), 'en-us'),
+                          fsg=os.path.join(DATADIR, 'goforward.fsg'),
+                          dict=os.path.join(DATADIR, 'turtle.dic'))
+        n_sen = 5126  # in en-us
+        scores = memoryview(bytes(100 * n_sen * 2)).cast('h', (100, n_sen))
+        decoder.start_utt()
+        decoder.process_senscr(scores)
+        decoder.end_utt()
+        # Wrong number of senones
+        scores = memoryview(bytes(10 * 42 * 2)).cast('h', (10, 42))
+        decoder.start_utt()
+        with self.assertRaises(RuntimeError):
+            decoder.process_senscr(scores)
+        decoder.end_utt()
+        # Can't mix them with audio
+        with open(os.path.join(DATADIR, 'goforward.raw'), "rb") as fh:
+            buf = fh.read()
+        decoder.start_utt()
+        decoder.process_raw(buf, full_utt=True)
+        with self.assertRaises(RuntimeError):
+            decoder.process_senscr(memoryview(bytes(n_sen * 2)).cast(
+                'h', (1, n_sen)))
+        decoder.end_utt()
+        self._check_hyp(decoder.hyp().hypstr, decoder.seg())
+
     def test_decode_fail(self):
         """Test failure to initialize (should not segfault!)"""
         with self.assertRaises(RuntimeError):
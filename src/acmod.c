@@ -57,13 +57,19 @@
 #include <soundswallower/s2_semi_mgau.h>
 #include <soundswallower/ptm_mgau.h>
 #include <soundswallower/ms_mgau.h>
+#include <soundswallower/mlp_mgau.h>
+#include <soundswallower/modelpack.h>
+#include <soundswallower/vad.h>
 
 static int32 acmod_process_mfcbuf(acmod_t *acmod);
+static int acmod_process_live(acmod_t *acmod, mfcc_t ***inout_cep,
+                              int *inout_n_frames);
+static void acmod_pipe_wait(acmod_t *acmod);
 
-int
-acmod_load_am(acmod_t *acmod)
+static int
+acmod_load_files(acmod_t *acmod)
 {
-    char const *mdeffn, *tmatfn, *mllrfn, *hmmdir;
+    char const *mdeffn, *tmatfn, *hmmdir;
 
     /* Read model definition. */
     if ((mdeffn = cmd_ln_str_r(acmod->config, "_mdef")) == NULL) {
@@ -90,6 +96,14 @@ acmod_load_am(acmod_t *acmod)
     acmod->tmat = tmat_init(tmatfn, acmod->lmath,
                             cmd_ln_float32_r(acmod->config, "-tmatfloor"));
 
+    /* A neural network takes the place of the Gaussians. */
+    if (cmd_ln_str_r(acmod->config, "_mlp")) {
+        E_INFO("Using neural network senone scoring\n");
+        if ((acmod->mgau = mlp_mgau_init(acmod)) == NULL)
+            return -1;
+        return 0;
+    }
+
     /* Read the acoustic models. */
     if ((cmd_ln_str_r(acmod->config, "_mean") == NULL)
         || (cmd_ln_str_r(acmod->config, "_var") == NULL)
@@ -118,6 +132,101 @@ acmod_load_am(acmod_t *acmod)
             }
         }
     }
+    return 0;
+}
+
+/* Load everything from a precompiled model, in the same order as
+ * acmod_load_files() (see also load_gmm() in the JavaScript API). */
+static int
+acmod_load_pack(acmod_t *acmod, const char *packfn)
+{
+    s3file_t *pack, *mdef = NULL, *tmat = NULL, *gauden = NULL;
+    s3file_t *mixw = NULL, *sendump = NULL, *senmgau = NULL, *mlp = NULL;
+    int rv = -1;
+
+    E_INFO("Loading precompiled acoustic model from %s\n", packfn);
+    if ((pack = modelpack_open(packfn)) == NULL)
+        return -1;
+    mlp = modelpack_section(pack, "mlp");
+    if ((mdef = modelpack_section(pack, "mdef")) == NULL
+        || (tmat = modelpack_section(pack, "tmat")) == NULL
+        || ((gauden = modelpack_section(pack, "gauden")) == NULL
+            && mlp == NULL)) {
+        E_ERROR("Model pack %s has no mdef, tmat or gauden section\n", packfn);
+        goto error_out;
+    }
+    mixw = modelpack_section(pack, "mixw");
+    sendump = modelpack_section(pack, "sendump");
+    senmgau = modelpack_section(pack, "senmgau");
+
+    if ((acmod->mdef = bin_mdef_read_s3file(mdef, cmd_ln_boolean_r(acmod->config,
+                                                                   "-cionly"))) == NULL) {
+        E_ERROR("Failed to read acoustic model definition from %s\n", packfn);
+        goto error_out;
+    }
+    if ((acmod->tmat = tmat_init_s3file(tmat, acmod->lmath,
+                                        cmd_ln_float32_r(acmod->config,
+                                                         "-tmatfloor"))) == NULL) {
+        E_ERROR("Failed to read transition matrices from %s\n", packfn);
+        goto error_out;
+    }
+
+    /* The Gaussians are precomputed, so there are no variances (see
+     * gauden_init_s3file()). */
+    if (mlp) {
+        E_INFO("Using neural network senone scoring\n");
+        acmod->mgau = mlp_mgau_init_s3file(acmod, mlp);
+    }
+    else if (senmgau) {
+        E_INFO("Using general multi-stream GMM computation\n");
+        acmod->mgau = ms_mgau_init_s3file(acmod, gauden, NULL, mixw, senmgau);
+    }
+    else {
+        E_INFO("Attempting to use PTM computation module\n");
+        if ((acmod->mgau = ptm_mgau_init_s3file(acmod, gauden, NULL,
+                                                mixw, sendump)) == NULL) {
+            E_INFO("Attempting to use semi-continuous computation module\n");
+            s3file_rewind(mixw);
+            s3file_rewind(sendump);
+            if ((acmod->mgau = s2_semi_mgau_init_s3file(acmod, gauden, NULL,
+                                                        mixw, sendump)) == NULL) {
+                E_INFO("Falling back to general multi-stream GMM computation\n");
+                s3file_rewind(mixw);
+                acmod->mgau = ms_mgau_init_s3file(acmod, gauden, NULL, mixw, NULL);
+            }
+        }
+    }
+    if (acmod->mgau == NULL) {
+        E_ERROR("Failed to read acoustic model\n");
+        goto error_out;
+    }
+    rv = 0;
+
+error_out:
+    s3file_free(mdef);
+    s3file_free(tmat);
+    s3file_free(gauden);
+    s3file_free(mixw);
+    s3file_free(sendump);
+    s3file_free(senmgau);
+    s3file_free(mlp);
+    s3file_free(pack);
+    return rv;
+}
+
+int
+acmod_load_am(acmod_t *acmod)
+{
+    char const *mllrfn, *packfn = NULL;
+
+    if (cmd_ln_exists_r(acmod->config, "_pack"))
+        packfn = cmd_ln_str_r(acmod->config, "_pack");
+    if (packfn) {
+        if (acmod_load_pack(acmod, packfn) < 0)
+            return -1;
+    }
+    else if (acmod_load_files(acmod) < 0)
+        return -1;
 
     /* If there is an MLLR transform, apply it. */
     if ((mllrfn = cmd_ln_str_r(acmod->config, "-mllr"))) {
@@ -129,9 +238,94 @@ acmod_load_am(acmod_t *acmod)
     return 0;
 }
 
+int
+acmod_share_am(acmod_t *acmod, acmod_t *other)
+{
+    int i;
+
+    if (other->mdef == NULL || other->tmat == NULL || other->mgau == NULL) {
+        E_ERROR("Acoustic model to share is not loaded\n");
+        return -1;
+    }
+    if (other->mgau->vt->share == NULL) {
+        E_ERROR("Acoustic model type %s cannot be shared\n",
+                other->mgau->vt->name);
+        return -1;
+    }
+    /* Features have to be the same as the ones it was loaded with. */
+    if (0 != strcmp(feat_name(acmod->fcb), feat_name(other->fcb))
+        || feat_dimension1(acmod->fcb) != feat_dimension1(other->fcb)) {
+        E_ERROR("Feature type %s doesn't match shared acoustic model (%s)\n",
+                feat_name(acmod->fcb), feat_name(other->fcb));
+        return -1;
+    }
+    for (i = 0; i < feat_dimension1(acmod->fcb); ++i) {
+        if (feat_dimension2(acmod->fcb, i) != feat_dimension2(other->fcb, i)) {
+            E_ERROR("Dimension of stream %d doesn't match shared acoustic "
+                    "model: %d != %d\n", i, feat_dimension2(acmod->fcb, i),
+                    feat_dimension2(other->fcb, i));
+            return -1;
+        }
+    }
+    if ((acmod->mgau = ps_mgau_share(other->mgau, acmod)) == NULL)
+        return -1;
+    acmod->shared = acmod_retain(other);
+    acmod->mdef = bin_mdef_retain(other->mdef);
+    acmod->tmat = tmat_retain(other->tmat);
+    if (other->mllr)
+        acmod->mllr = ps_mllr_retain(other->mllr);
+    return 0;
+}
+
+acmod_t *
+acmod_split_am(acmod_t *acmod, fe_t *fe, feat_t *fcb)
+{
+    acmod_t *other;
+
+    if (acmod->shared)
+        return acmod_retain(acmod->shared);
+    if (acmod->mdef == NULL || acmod->tmat == NULL || acmod->mgau == NULL) {
+        E_ERROR("Acoustic model to share is not loaded\n");
+        return NULL;
+    }
+    if (acmod->mgau->vt->share == NULL) {
+        E_ERROR("Acoustic model type %s cannot be shared\n",
+                acmod->mgau->vt->name);
+        return NULL;
+    }
+    if ((other = acmod_create(acmod->config, acmod->lmath, fe, fcb)) == NULL)
+        return NULL;
+    /* Hand the parameters over (not while they are being used) and
+     * then share them back. */
+    acmod_pipe_wait(acmod);
+    other->mdef = acmod->mdef;
+    other->tmat = acmod->tmat;
+    other->mgau = acmod->mgau;
+    other->mllr = acmod->mllr;
+    acmod->mdef = NULL;
+    acmod->tmat = NULL;
+    acmod->mgau = NULL;
+    acmod->mllr = NULL;
+    if (acmod_share_am(acmod, other) < 0) {
+        acmod->mdef = other->mdef;
+        acmod->tmat = other->tmat;
+        acmod->mgau = other->mgau;
+        acmod->mllr = other->mllr;
+        other->mdef = NULL;
+        other->tmat = NULL;
+        other->mgau = NULL;
+        other->mllr = NULL;
+        acmod_free(other);
+        return NULL;
+    }
+    return other;
+}
+
 int
 acmod_init_senscr(acmod_t *acmod)
 {
+    int32 block_size;
+
     if (acmod->mdef == NULL) {
         E_ERROR("Model definition not loaded\n");
         return -1;
@@ -144,6 +338,30 @@ acmod_init_senscr(acmod_t *acmod)
                                                      sizeof(*acmod->senone_active));
     acmod->log_zero = logmath_get_zero(acmod->lmath);
     acmod->compallsen = cmd_ln_boolean_r(acmod->config, "-compallsen");
+    /* Set up blocked scoring, if the model supports it, or if it
+     * asks for it and -gmmblock is 0. */
+    block_size = cmd_ln_int32_r(acmod->config, "-gmmblock");
+    if (block_size == 0 && acmod->mgau)
+        block_size = acmod->mgau->block_size;
+    if (block_size > 1) {
+        if (acmod->mgau && acmod->mgau->vt->frame_eval_block) {
+            acmod->block_size = block_size;
+            acmod->block_feat = ckd_calloc(acmod->block_size,
+                                           sizeof(*acmod->block_feat));
+        }
+        else
+            E_WARN("Acoustic model does not support -gmmblock, ignoring it\n");
+    }
+    /* Set up pipelined scoring, if the scores don't depend on the
+     * search (see acmod_score()). */
+    acmod->pipe_frame = -1;
+    if (cmd_ln_boolean_r(acmod->config, "-pipeline")) {
+        if (!acmod->compallsen)
+            E_WARN("-pipeline only works with -compallsen, ignoring it\n");
+        else if ((acmod->pipe = workpool_init(2)) != NULL)
+            acmod->pipe_scores = ckd_calloc(bin_mdef_n_sen(acmod->mdef),
+                                            sizeof(*acmod->pipe_scores));
+    }
 
     return 0;
 }
@@ -183,6 +401,7 @@ acmod_create(cmd_ln_t *config, logmath_t *lmath, fe_t *fe, feat_t *fcb)
     acmod_t *acmod;
     
     acmod = ckd_calloc(1, sizeof(*acmod));
+    acmod->refcount = 1;
     acmod->config = cmd_ln_retain(config);
     acmod->lmath = logmath_retain(lmath);
     acmod->state = ACMOD_IDLE;
@@ -194,6 +413,11 @@ acmod_create(cmd_ln_t *config, logmath_t *lmath, fe_t *fe, feat_t *fcb)
     if (acmod_feat_mismatch(acmod, fcb))
         goto error_out;
     acmod->fcb = feat_retain(fcb);
+    if (cmd_ln_boolean_r(config, "-vad")) {
+        /* Don't let silence fill up more than half the ring. */
+        if ((acmod->vad = vad_init(config, LIVEBUFBLOCKSIZE / 2)) == NULL)
+            goto error_out;
+    }
 
     /* The MFCC buffer needs to be at least as large as the dynamic
      * feature window.  */
@@ -205,7 +429,6 @@ acmod_create(cmd_ln_t *config, logmath_t *lmath, fe_t *fe, feat_t *fcb)
     /* Feature buffer has to be at least as large as MFCC buffer. */
     acmod->n_feat_alloc = acmod->n_mfc_alloc;
     acmod->feat_buf = feat_array_alloc(acmod->fcb, acmod->n_feat_alloc);
-    acmod->framepos = ckd_calloc(acmod->n_feat_alloc, sizeof(*acmod->framepos));
     return acmod;
 
 error_out:
@@ -234,12 +457,25 @@ error_out:
     return NULL;
 }
 
-void
+acmod_t *
+acmod_retain(acmod_t *acmod)
+{
+    ++acmod->refcount;
+    return acmod;
+}
+
+int
 acmod_free(acmod_t *acmod)
 {
     if (acmod == NULL)
-        return;
-
+        return 0;
+    if (--acmod->refcount > 0)
+        return acmod->refcount;
+
+    acmod_pipe_wait(acmod);
+    workpool_free(acmod->pipe);
+    ckd_free(acmod->pipe_scores);
+    vad_free(acmod->vad);
     feat_free(acmod->fcb);
     fe_free(acmod->fe);
     cmd_ln_free_r(acmod->config);
@@ -249,7 +485,8 @@ acmod_free(acmod_t *acmod)
     if (acmod->feat_buf)
         feat_array_free(acmod->feat_buf);
 
-    ckd_free(acmod->framepos);
+    ckd_free_2d(acmod->senscr_buf);
+    ckd_free(acmod->block_feat);
     if (acmod->senone_scores)
         ckd_free(acmod->senone_scores);
     if (acmod->senone_active_vec)
@@ -261,15 +498,25 @@ acmod_free(acmod_t *acmod)
     tmat_free(acmod->tmat);
     if (acmod->mgau) /* FIXME: Should make this transparent */
         ps_mgau_free(acmod->mgau);
+    /* Only after our scorer is gone, since it uses its parameters. */
+    acmod_free(acmod->shared);
     ps_mllr_free(acmod->mllr);
     logmath_free(acmod->lmath);
 
     ckd_free(acmod);
+    return 0;
 }
 
 ps_mllr_t *
 acmod_update_mllr(acmod_t *acmod, ps_mllr_t *mllr)
 {
+    /* The parameters would change for everybody else too. */
+    if (acmod->shared || acmod->refcount > 1) {
+        E_ERROR("Cannot adapt an acoustic model shared with other decoders\n");
+        return NULL;
+    }
+    acmod_pipe_wait(acmod);
+    acmod->pipe_frame = -1;
     if (acmod->mllr)
         ps_mllr_free(acmod->mllr);
     acmod->mllr = ps_mllr_retain(mllr);
@@ -285,10 +532,17 @@ acmod_grow_feat_buf(acmod_t *acmod, int nfr)
         E_FATAL("Decoder can not process more than %d frames at once, "
                 "requested %d\n", MAX_N_FRAMES, nfr);
 
+    acmod_pipe_wait(acmod);
     acmod->feat_buf = feat_array_realloc(acmod->fcb, acmod->feat_buf,
                                          acmod->n_feat_alloc, nfr);
-    acmod->framepos = ckd_realloc(acmod->framepos,
-                                  nfr * sizeof(*acmod->framepos));
+    if (acmod->senscr_buf) {
+        int n_sen = bin_mdef_n_sen(acmod->mdef);
+        int16 **senscr_buf = ckd_calloc_2d(nfr, n_sen, sizeof(**senscr_buf));
+        memcpy(senscr_buf[0], acmod->senscr_buf[0],
+               (size_t)acmod->n_feat_alloc * n_sen * sizeof(**senscr_buf));
+        ckd_free_2d(acmod->senscr_buf);
+        acmod->senscr_buf = senscr_buf;
+    }
     acmod->n_feat_alloc = nfr;
 }
 
@@ -308,15 +562,21 @@ acmod_set_grow(acmod_t *acmod, int grow_feat)
 int
 acmod_start_utt(acmod_t *acmod)
 {
+    acmod_pipe_wait(acmod);
+    acmod->pipe_frame = -1;
     fe_start(acmod->fe);
+    feat_live_start(acmod->fcb);
+    if (acmod->vad)
+        vad_start(acmod->vad);
     acmod->state = ACMOD_STARTED;
-    acmod->n_mfc_frame = 0;
     acmod->n_feat_frame = 0;
-    acmod->mfc_outidx = 0;
     acmod->feat_outidx = 0;
     acmod->output_frame = 0;
     acmod->senscr_frame = -1;
     acmod->n_senone_active = 0;
+    acmod->block_end = 0;
+    acmod->insenscr = FALSE;
+    acmod->full_utt = FALSE;
     acmod->mgau->frame_idx = 0;
     return 0;
 }
@@ -324,20 +584,34 @@ acmod_start_utt(acmod_t *acmod)
 int
 acmod_end_utt(acmod_t *acmod)
 {
-    int32 ntail = 0;
-
-    acmod->state = ACMOD_ENDED;
-    if (acmod->n_mfc_frame < acmod->n_mfc_alloc) {
-        int inptr, nfr;
-        /* Where to start writing them (circular buffer) */
-        inptr = (acmod->mfc_outidx + acmod->n_mfc_frame) % acmod->n_mfc_alloc;
-        nfr = acmod->n_mfc_alloc - inptr;
-        ntail = fe_end(acmod->fe, acmod->mfc_buf + inptr, nfr);
-        acmod->n_mfc_frame += ntail;
-        /* Process whatever's left, and any leadout. */
-        if (ntail)
-            ntail = acmod_process_mfcbuf(acmod);
+    mfcc_t **cepptr;
+    int32 ntail = 0, nfr;
+
+    acmod_pipe_wait(acmod);
+    /* Write the last frames straight into the feature computation
+     * buffer.  If they don't all fit, make room by computing
+     * features, as acmod_process_raw() would. */
+    while (TRUE) {
+        cepptr = feat_live_wrbuf(acmod->fcb, &nfr);
+        ntail = fe_end(acmod->fe, cepptr, nfr);
+        feat_live_commit(acmod->fcb, ntail);
+        if (ntail < nfr)
+            break;
+        if (acmod_process_mfcbuf(acmod) <= 0) {
+            if ((nfr = fe_end(acmod->fe, NULL, 0)) > 0)
+                E_WARN("Feature buffer is full, dropping up to %d frames "
+                       "at end of utterance\n", nfr);
+            break;
+        }
     }
+    acmod->state = ACMOD_ENDED;
+    /* Process whatever's left (including any silence held back by
+     * the VAD), and any leadout. */
+    if (feat_live_pending(acmod->fcb) > 0)
+        ntail = acmod_process_mfcbuf(acmod);
+    if (acmod->vad)
+        E_INFO("Dropped %d of %d frames of silence\n",
+               vad_n_skipped(acmod->vad), acmod->vad->n_in);
 
     return ntail;
 }
@@ -349,6 +623,10 @@ acmod_process_full_cep(acmod_t *acmod,
 {
     int32 nfr;
 
+    if (acmod->insenscr) {
+        E_ERROR("Cannot process features after senone scores\n");
+        return -1;
+    }
     /* Resize feat_buf to fit. */
     if (acmod->n_feat_alloc < *inout_n_frames) {
 
@@ -358,6 +636,9 @@ acmod_process_full_cep(acmod_t *acmod,
 
         feat_array_free(acmod->feat_buf);
         acmod->feat_buf = feat_array_alloc(acmod->fcb, *inout_n_frames);
+        /* Senone scores (if any) will be reallocated to match. */
+        ckd_free_2d(acmod->senscr_buf);
+        acmod->senscr_buf = NULL;
         acmod->n_feat_alloc = *inout_n_frames;
         acmod->n_feat_frame = 0;
         acmod->feat_outidx = 0;
@@ -366,6 +647,7 @@ acmod_process_full_cep(acmod_t *acmod,
     nfr = feat_s2mfc2feat_live(acmod->fcb, *inout_cep, inout_n_frames,
                                TRUE, TRUE, acmod->feat_buf);
     acmod->n_feat_frame = nfr;
+    acmod->full_utt = TRUE;
     assert(acmod->n_feat_frame <= acmod->n_feat_alloc);
     *inout_cep += *inout_n_frames;
     *inout_n_frames = 0;
@@ -389,8 +671,6 @@ acmod_process_full_raw(acmod_t *acmod,
                                        sizeof(**acmod->mfc_buf));
         acmod->n_mfc_alloc = nfr;
     }
-    acmod->n_mfc_frame = 0;
-    acmod->mfc_outidx = 0;
     fe_start(acmod->fe);
     if ((nvec = fe_process_int16(acmod->fe, inout_raw, inout_n_samps,
                                  acmod->mfc_buf, nfr)) < 0)
@@ -401,7 +681,6 @@ acmod_process_full_raw(acmod_t *acmod,
     cepptr = acmod->mfc_buf;
     nfr = nvec;
     nvec = acmod_process_full_cep(acmod, &cepptr, &nfr);
-    acmod->n_mfc_frame = 0;
     return nvec;
 }
 
@@ -423,8 +702,6 @@ acmod_process_full_float32(acmod_t *acmod,
                                        sizeof(**acmod->mfc_buf));
         acmod->n_mfc_alloc = nfr;
     }
-    acmod->n_mfc_frame = 0;
-    acmod->mfc_outidx = 0;
     fe_start(acmod->fe);
     if ((nvec = fe_process_float32(acmod->fe,
                                    inout_raw, inout_n_samps,
@@ -436,7 +713,6 @@ acmod_process_full_float32(acmod_t *acmod,
     cepptr = acmod->mfc_buf;
     nfr = nvec;
     nvec = acmod_process_full_cep(acmod, &cepptr, &nfr);
-    acmod->n_mfc_frame = 0;
     return nvec;
 }
 
@@ -446,34 +722,48 @@ acmod_process_full_float32(acmod_t *acmod,
 static int32
 acmod_process_mfcbuf(acmod_t *acmod)
 {
-    mfcc_t **mfcptr;
-    int32 ncep;
-
-    ncep = acmod->n_mfc_frame;
-    /* Also do this in two parts because of the circular mfc_buf. */
-    if (acmod->mfc_outidx + ncep > acmod->n_mfc_alloc) {
-        int32 ncep1 = acmod->n_mfc_alloc - acmod->mfc_outidx;
-        int saved_state = acmod->state;
+    mfcc_t **mfcptr = NULL;
+    int ncep, nfr;
+
+    /* The front end writes directly into the ring in fcb, so there
+     * is nothing to copy, and no wraparound to deal with here. */
+    ncep = feat_live_pending(acmod->fcb);
+    /* Frames held back in silence wait until speech starts (or the
+     * utterance ends). */
+    if (acmod->vad && acmod->state != ACMOD_ENDED)
+        ncep -= acmod->vad->n_held;
+    if ((nfr = acmod_process_live(acmod, &mfcptr, &ncep)) < 0)
+        return -1;
 
-        /* Make sure we don't end the utterance here. */
-        if (acmod->state == ACMOD_ENDED)
-            acmod->state = ACMOD_PROCESSING;
-        mfcptr = acmod->mfc_buf + acmod->mfc_outidx;
-        ncep1 = acmod_process_cep(acmod, &mfcptr, &ncep1, FALSE);
-        /* It's possible that not all available frames were filled. */
-        ncep -= ncep1;
-        acmod->n_mfc_frame -= ncep1;
-        acmod->mfc_outidx += ncep1;
-        acmod->mfc_outidx %= acmod->n_mfc_alloc;
-        /* Restore original state (could this really be the end) */
-        acmod->state = saved_state;
+    /* Once everything else has been processed, drop the silence
+     * which is not needed as leading context. */
+    if (acmod->vad && acmod->state != ACMOD_ENDED
+        && feat_live_pending(acmod->fcb) == acmod->vad->n_held) {
+        int32 nskip = vad_n_excess(acmod->vad);
+        if (nskip > 0) {
+            /* Frames consumed so far, which is also the index of the
+             * next frame of features. */
+            int32 frame = acmod->vad->n_in - vad_n_skipped(acmod->vad)
+                - feat_live_pending(acmod->fcb);
+            nskip = feat_live_skip(acmod->fcb, nskip);
+            vad_skip(acmod->vad, frame, nskip);
+        }
     }
-    mfcptr = acmod->mfc_buf + acmod->mfc_outidx;
-    ncep = acmod_process_cep(acmod, &mfcptr, &ncep, FALSE);
-    acmod->n_mfc_frame -= ncep;
-    acmod->mfc_outidx += ncep;
-    acmod->mfc_outidx %= acmod->n_mfc_alloc;
-    return ncep;
+    return nfr;
+}
+
+/**
+ * Run voice activity detection on frames just written to the ring.
+ */
+static void
+acmod_vad_update(acmod_t *acmod, mfcc_t **cep, int32 nfr)
+{
+    int32 i;
+
+    if (acmod->vad == NULL)
+        return;
+    for (i = 0; i < nfr; ++i)
+        vad_update(acmod->vad, cep[i]);
 }
 
 int
@@ -484,46 +774,21 @@ acmod_process_raw(acmod_t *acmod,
 {
     int32 ncep, nvec;
 
+    acmod_pipe_wait(acmod);
     /* If this is a full utterance, process it all at once. */
     if (full_utt)
         return acmod_process_full_raw(acmod, inout_raw, inout_n_samps);
 
     /* Append MFCCs to the end of any that are previously in there
-     * (in practice, there will probably be none) */
+     * (in practice, there will probably be none), writing them
+     * directly into the ring used to compute dynamic features. */
     if (inout_n_samps && *inout_n_samps) {
-        int inptr;
-
-        /* Total number of frames available. */
-        ncep = acmod->n_mfc_alloc - acmod->n_mfc_frame;
-        /* Where to start writing them (circular buffer) */
-        inptr = (acmod->mfc_outidx + acmod->n_mfc_frame) % acmod->n_mfc_alloc;
-
-        /* Write them in two (or more) parts if there is wraparound. */
-        while (inptr + ncep > acmod->n_mfc_alloc) {
-            if ((nvec = fe_process_int16(acmod->fe, inout_raw, inout_n_samps,
-                                         acmod->mfc_buf + inptr,
-                                         acmod->n_mfc_alloc - inptr)) < 0)
-                return -1;
-            /* nvec contains the number of frames actually processed.
-             * This is a good thing, but it means we actually still
-             * might have some room left at the end of the buffer,
-             * hence the while loop.  Unfortunately it also means that
-             * in the case where we are really actually done, we need
-             * to get out totally, hence the goto. */
-            acmod->n_mfc_frame += nvec;
-            ncep -= nvec;
-            inptr += nvec;
-            inptr %= acmod->n_mfc_alloc;
-            if (nvec == 0)
-        	goto alldone;
-        }
-        assert(inptr + ncep <= acmod->n_mfc_alloc);
+        mfcc_t **cepptr = feat_live_wrbuf(acmod->fcb, &ncep);
         if ((nvec = fe_process_int16(acmod->fe, inout_raw, inout_n_samps,
-                                     acmod->mfc_buf + inptr, ncep)) < 0)
+                                     cepptr, ncep)) < 0)
             return -1;
-        acmod->n_mfc_frame += nvec;
-    alldone:
-        ;
+        feat_live_commit(acmod->fcb, nvec);
+        acmod_vad_update(acmod, cepptr, nvec);
     }
 
     /* Hand things off to acmod_process_cep. */
@@ -538,49 +803,21 @@ acmod_process_float32(acmod_t *acmod,
 {
     int32 ncep, nvec;
 
+    acmod_pipe_wait(acmod);
     /* If this is a full utterance, process it all at once. */
     if (full_utt)
         return acmod_process_full_float32(acmod, inout_raw, inout_n_samps);
 
     /* Append MFCCs to the end of any that are previously in there
-     * (in practice, there will probably be none) */
+     * (in practice, there will probably be none), writing them
+     * directly into the ring used to compute dynamic features. */
     if (inout_n_samps && *inout_n_samps) {
-        int inptr;
-
-        /* Total number of frames available. */
-        ncep = acmod->n_mfc_alloc - acmod->n_mfc_frame;
-        /* Where to start writing them (circular buffer) */
-        inptr = (acmod->mfc_outidx + acmod->n_mfc_frame) % acmod->n_mfc_alloc;
-
-        /* Write them in two (or more) parts if there is wraparound. */
-        while (inptr + ncep > acmod->n_mfc_alloc) {
-            if ((nvec = fe_process_float32(acmod->fe, inout_raw,
-                                           inout_n_samps,
-                                           acmod->mfc_buf + inptr,
-                                           acmod->n_mfc_alloc - inptr)) < 0)
-                return -1;
-            /* nvec contains the number of frames actually processed.
-             * This is a good thing, but it means we actually still
-             * might have some room left at the end of the buffer,
-             * hence the while loop.  Unfortunately it also means that
-             * in the case where we are really actually done, we need
-             * to get out totally, hence the goto. */
-            acmod->n_mfc_frame += nvec;
-            ncep -= nvec;
-            inptr += nvec;
-            inptr %= acmod->n_mfc_alloc;
-            if (nvec == 0)
-        	goto alldone;
-        }
-        assert(inptr + ncep <= acmod->n_mfc_alloc);
-        if ((nvec = fe_process_float32(acmod->fe, inout_raw,
-                                       inout_n_samps,
-                                       acmod->mfc_buf + inptr,
-                                       ncep)) < 0)
+        mfcc_t **cepptr = feat_live_wrbuf(acmod->fcb, &ncep);
+        if ((nvec = fe_process_float32(acmod->fe, inout_raw, inout_n_samps,
+                                       cepptr, ncep)) < 0)
             return -1;
-        acmod->n_mfc_frame += nvec;
-    alldone:
-        ;
+        feat_live_commit(acmod->fcb, nvec);
+        acmod_vad_update(acmod, cepptr, nvec);
     }
 
     /* Hand things off to acmod_process_cep. */
@@ -593,13 +830,47 @@ acmod_process_cep(acmod_t *acmod,
 		  int *inout_n_frames,
 		  int full_utt)
 {
-    int32 nfeat, ncep, inptr;
-    int orig_n_frames;
-
+    acmod_pipe_wait(acmod);
     /* If this is a full utterance, process it all at once. */
     if (full_utt)
         return acmod_process_full_cep(acmod, inout_cep, inout_n_frames);
+    return acmod_process_live(acmod, inout_cep, inout_n_frames);
+}
+
+/**
+ * Compute features from cep, or from the frames in the ring in fcb if
+ * cep is NULL.
+ */
+static int32
+acmod_feat_live(acmod_t *acmod, mfcc_t **cep, int32 *inout_ncep,
+                int32 endutt, mfcc_t ***ofeat)
+{
+    int32 beginutt = (acmod->state == ACMOD_STARTED);
+
+    if (cep == NULL)
+        return feat_live_process(acmod->fcb, inout_ncep,
+                                 beginutt, endutt, ofeat);
+    return feat_s2mfc2feat_live(acmod->fcb, cep, inout_ncep,
+                                beginutt, endutt, ofeat);
+}
+
+/**
+ * Compute features for part of an utterance.  If *inout_cep is NULL,
+ * the input is the frames already written into the ring in fcb.
+ */
+static int
+acmod_process_live(acmod_t *acmod,
+                   mfcc_t ***inout_cep,
+                   int *inout_n_frames)
+{
+    mfcc_t ***ofeat = NULL;
+    int32 nfeat, ncep, inptr;
+    int orig_n_frames;
 
+    if (acmod->insenscr) {
+        E_ERROR("Cannot process features after senone scores\n");
+        return -1;
+    }
     /* Maximum number of frames we're going to generate. */
     orig_n_frames = ncep = nfeat = *inout_n_frames;
 
@@ -631,23 +902,22 @@ acmod_process_cep(acmod_t *acmod,
     }
 
 
-    /* FIXME: we can't split the last frame drop properly to be on the bounary, so just return */
+    /* We can't split the last frame drop properly to be on the
+     * boundary, so write through wrapped frame pointers instead. */
     if (inptr + nfeat > acmod->n_feat_alloc && acmod->state == ACMOD_ENDED) {
-	*inout_n_frames -= ncep;
-	*inout_cep += ncep;
-	return 0;
-    }
+        int32 i;
 
-    /* Write them in two parts if there is wraparound. */
-    if (inptr + nfeat > acmod->n_feat_alloc) {
+        ofeat = ckd_calloc(nfeat, sizeof(*ofeat));
+        for (i = 0; i < nfeat; ++i)
+            ofeat[i] = acmod->feat_buf[(inptr + i) % acmod->n_feat_alloc];
+    }
+    /* Otherwise write them in two parts if there is wraparound. */
+    else if (inptr + nfeat > acmod->n_feat_alloc) {
         int32 ncep1 = acmod->n_feat_alloc - inptr;
 
         /* Make sure we don't end the utterance here. */
-        nfeat = feat_s2mfc2feat_live(acmod->fcb, *inout_cep,
-                                     &ncep1,
-                                     (acmod->state == ACMOD_STARTED),
-                                     FALSE,
-                                     acmod->feat_buf + inptr);
+        nfeat = acmod_feat_live(acmod, *inout_cep, &ncep1, FALSE,
+                                acmod->feat_buf + inptr);
         if (nfeat < 0)
             return -1;
         /* Move the output feature pointer forward. */
@@ -657,23 +927,26 @@ acmod_process_cep(acmod_t *acmod,
         inptr %= acmod->n_feat_alloc;
         /* Move the input feature pointers forward. */
         *inout_n_frames -= ncep1;
-        *inout_cep += ncep1;
+        if (*inout_cep)
+            *inout_cep += ncep1;
         ncep -= ncep1;
     }
 
-    nfeat = feat_s2mfc2feat_live(acmod->fcb, *inout_cep,
-                                 &ncep,
-                                 (acmod->state == ACMOD_STARTED),
-                                 (acmod->state == ACMOD_ENDED),
-                                 acmod->feat_buf + inptr);
+    nfeat = acmod_feat_live(acmod, *inout_cep, &ncep,
+                            (acmod->state == ACMOD_ENDED),
+                            ofeat ? ofeat : acmod->feat_buf + inptr);
+    ckd_free(ofeat);
     if (nfeat < 0)
         return -1;
     acmod->n_feat_frame += nfeat;
     assert(acmod->n_feat_frame <= acmod->n_feat_alloc);
     /* Move the input feature pointers forward. */
     *inout_n_frames -= ncep;
-    *inout_cep += ncep;
-    if (acmod->state == ACMOD_STARTED)
+    if (*inout_cep)
+        *inout_cep += ncep;
+    /* Stay at the start of the utterance until there is some input
+     * (which may be held back by the VAD). */
+    if (acmod->state == ACMOD_STARTED && orig_n_frames > *inout_n_frames)
         acmod->state = ACMOD_PROCESSING;
     return orig_n_frames - *inout_n_frames;
 }
@@ -684,6 +957,11 @@ acmod_process_feat(acmod_t *acmod,
 {
     int i, inptr;
 
+    acmod_pipe_wait(acmod);
+    if (acmod->insenscr) {
+        E_ERROR("Cannot process features after senone scores\n");
+        return -1;
+    }
     if (acmod->n_feat_frame == acmod->n_feat_alloc) {
         if (acmod->grow_feat)
             acmod_grow_feat_buf(acmod, acmod->n_feat_alloc * 2);
@@ -709,6 +987,49 @@ acmod_process_feat(acmod_t *acmod,
     return 1;
 }
 
+int
+acmod_process_senscr(acmod_t *acmod,
+                     int16 const **inout_senscr,
+                     int *inout_n_frames)
+{
+    int i, n_sen, nfr, inptr;
+
+    acmod_pipe_wait(acmod);
+    if (!acmod->insenscr && acmod->output_frame + acmod->n_feat_frame > 0) {
+        E_ERROR("Cannot process senone scores after features\n");
+        return -1;
+    }
+    acmod->insenscr = TRUE;
+    n_sen = bin_mdef_n_sen(acmod->mdef);
+    if (acmod->senscr_buf == NULL)
+        acmod->senscr_buf = ckd_calloc_2d(acmod->n_feat_alloc, n_sen,
+                                          sizeof(**acmod->senscr_buf));
+
+    nfr = *inout_n_frames;
+    if (acmod->grow_feat) {
+        /* Grow to avoid wraparound if grow_feat == TRUE. */
+        while (acmod->feat_outidx + acmod->n_feat_frame + nfr
+               >= acmod->n_feat_alloc)
+            acmod_grow_feat_buf(acmod, acmod->n_feat_alloc * 2);
+    }
+    else if (nfr > acmod->n_feat_alloc - acmod->n_feat_frame)
+        nfr = acmod->n_feat_alloc - acmod->n_feat_frame;
+
+    for (i = 0; i < nfr; ++i) {
+        inptr = (acmod->feat_outidx + acmod->n_feat_frame) % acmod->n_feat_alloc;
+        memcpy(acmod->senscr_buf[inptr], *inout_senscr,
+               n_sen * sizeof(**acmod->senscr_buf));
+        *inout_senscr += n_sen;
+        ++acmod->n_feat_frame;
+    }
+    assert(acmod->n_feat_frame <= acmod->n_feat_alloc);
+    *inout_n_frames -= nfr;
+    if (acmod->state == ACMOD_STARTED)
+        acmod->state = ACMOD_PROCESSING;
+
+    return nfr;
+}
+
 int
 acmod_rewind(acmod_t *acmod)
 {
@@ -719,6 +1040,9 @@ acmod_rewind(acmod_t *acmod)
         return -1;
     }
 
+    acmod_pipe_wait(acmod);
+    acmod->pipe_frame = -1;
+
     /* Frames consumed + frames available */
     acmod->n_feat_frame = acmod->output_frame + acmod->n_feat_frame;
 
@@ -731,9 +1055,20 @@ acmod_rewind(acmod_t *acmod)
     return 0;
 }
 
+int
+acmod_input_frame(acmod_t *acmod, int frame_idx)
+{
+    if (acmod->vad == NULL)
+        return frame_idx;
+    return vad_input_frame(acmod->vad, frame_idx);
+}
+
 int
 acmod_advance(acmod_t *acmod)
 {
+    /* The next frame may be being scored from these. */
+    acmod_pipe_wait(acmod);
+
     /* Advance the output pointers. */
     if (++acmod->feat_outidx == acmod->n_feat_alloc)
         acmod->feat_outidx = 0;
@@ -774,7 +1109,7 @@ calc_feat_idx(acmod_t *acmod, int frame_idx)
         return -1;
     }
 
-    /* Get the index in feat_buf/framepos of the frame to be scored. */
+    /* Get the index in feat_buf/senscr_buf of the frame to be scored. */
     feat_idx = (acmod->feat_outidx + frame_idx - acmod->output_frame) %
                acmod->n_feat_alloc;
     if (feat_idx < 0)
@@ -801,6 +1136,92 @@ acmod_get_frame(acmod_t *acmod, int *inout_frame_idx)
     return acmod->feat_buf[feat_idx];
 }
 
+/**
+ * Compute senone scores for a frame which is in the feature buffer.
+ */
+static void
+acmod_eval_frame(acmod_t *acmod, int16 *senone_scores,
+                 int frame_idx, int feat_idx)
+{
+    /* Evaluate as many upcoming frames at once as we can, if
+     * requested.  This treats all codebooks as active, so it is only
+     * done when the whole utterance was input at once, as live input
+     * would lose the per-frame pruning and gain very little. */
+    if (acmod->block_size && acmod->full_utt
+        && frame_idx >= acmod->block_end
+        && frame_idx >= acmod->mgau->frame_idx) {
+        int i, n_frames;
+
+        n_frames = acmod->n_feat_frame - (frame_idx - acmod->output_frame);
+        if (n_frames > acmod->block_size)
+            n_frames = acmod->block_size;
+        for (i = 0; i < n_frames; ++i)
+            acmod->block_feat[i]
+                = acmod->feat_buf[(feat_idx + i) % acmod->n_feat_alloc];
+        acmod->block_end = frame_idx
+            + ps_mgau_frame_eval_block(acmod->mgau, acmod->block_feat,
+                                       frame_idx, n_frames);
+    }
+
+    ps_mgau_frame_eval(acmod->mgau,
+                       senone_scores,
+                       acmod->senone_active,
+                       acmod->n_senone_active,
+                       acmod->feat_buf[feat_idx],
+                       frame_idx,
+                       acmod->compallsen);
+}
+
+/* Run by acmod->pipe to score acmod->pipe_frame. */
+static void
+acmod_pipe_worker(void *arg, int worker, int n_workers)
+{
+    acmod_t *acmod = (acmod_t *)arg;
+
+    (void)worker;
+    (void)n_workers;
+    acmod_eval_frame(acmod, acmod->pipe_scores,
+                     acmod->pipe_frame, acmod->pipe_feat_idx);
+}
+
+/**
+ * Wait for the frame being scored ahead, if any, to be done.
+ *
+ * Anything that touches the feature buffer or the model has to call
+ * this first.
+ */
+static void
+acmod_pipe_wait(acmod_t *acmod)
+{
+    if (acmod->pipe_busy) {
+        workpool_wait(acmod->pipe);
+        acmod->pipe_busy = FALSE;
+    }
+}
+
+/**
+ * Start scoring a frame ahead of time, if it is already in the
+ * feature buffer.
+ *
+ * This is only done if all senones are computed, since otherwise the
+ * active senones in the next frame depend on the search in this one.
+ */
+static void
+acmod_pipe_start(acmod_t *acmod, int frame_idx)
+{
+    if (acmod->pipe == NULL || !acmod->compallsen || acmod->insenscr)
+        return;
+    if (frame_idx <= acmod->output_frame
+        || frame_idx - acmod->output_frame >= acmod->n_feat_frame)
+        return;
+    acmod->pipe_frame = frame_idx;
+    acmod->pipe_feat_idx = calc_feat_idx(acmod, frame_idx);
+    if (workpool_start(acmod->pipe, acmod_pipe_worker, acmod) == 0)
+        acmod->pipe_busy = TRUE;
+    else
+        acmod->pipe_frame = -1;
+}
+
 int16 const *
 acmod_score(acmod_t *acmod, int *inout_frame_idx)
 {
@@ -822,22 +1243,39 @@ acmod_score(acmod_t *acmod, int *inout_frame_idx)
     if ((feat_idx = calc_feat_idx(acmod, frame_idx)) < 0)
         return NULL;
 
+    /* Scores were input directly, so just use them. */
+    if (acmod->insenscr) {
+        acmod_flags2list(acmod);
+        memcpy(acmod->senone_scores, acmod->senscr_buf[feat_idx],
+               bin_mdef_n_sen(acmod->mdef) * sizeof(*acmod->senone_scores));
+        if (inout_frame_idx)
+            *inout_frame_idx = frame_idx;
+        acmod->senscr_frame = frame_idx;
+        return acmod->senone_scores;
+    }
+
     /* Build active senone list. */
+    acmod_pipe_wait(acmod);
     acmod_flags2list(acmod);
 
-    /* Generate scores for the next available frame */
-    ps_mgau_frame_eval(acmod->mgau,
-                       acmod->senone_scores,
-                       acmod->senone_active,
-                       acmod->n_senone_active,
-                       acmod->feat_buf[feat_idx],
-                       frame_idx,
-                       acmod->compallsen);
+    /* Use the scores computed ahead of time if they are for this
+     * frame, otherwise generate them now. */
+    if (frame_idx == acmod->pipe_frame) {
+        int16 *tmp = acmod->senone_scores;
+        acmod->senone_scores = acmod->pipe_scores;
+        acmod->pipe_scores = tmp;
+    }
+    else
+        acmod_eval_frame(acmod, acmod->senone_scores, frame_idx, feat_idx);
+    acmod->pipe_frame = -1;
 
     if (inout_frame_idx)
         *inout_frame_idx = frame_idx;
     acmod->senscr_frame = frame_idx;
 
+    /* Score the next frame while the caller searches this one. */
+    acmod_pipe_start(acmod, frame_idx + 1);
+
     return acmod->senone_scores;
 }
 
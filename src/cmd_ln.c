@@ -79,6 +79,7 @@
 #include <soundswallower/ckd_alloc.h>
 #include <soundswallower/case.h>
 #include <soundswallower/strfuncs.h>
+#include <soundswallower/mmio.h>
 
 static void
 arg_log_r(cmd_ln_t *, arg_t const *, int32, int32);
@@ -595,11 +596,14 @@ cmd_ln_init(cmd_ln_t *inout_cmdln, const arg_t *defn, int32 strict, ...)
     return parse_options(inout_cmdln, defn, f_argc, f_argv, strict);
 }
 
-#ifndef __EMSCRIPTEN__
+/* Next character of the buffer, or EOF */
+#define BUF_GETC(ptr, end) ((ptr) < (end) ? (unsigned char)*(ptr)++ : EOF)
+
 cmd_ln_t *
-cmd_ln_parse_file_r(cmd_ln_t *inout_cmdln, const arg_t * defn, const char *filename, int32 strict)
+cmd_ln_parse_buf_r(cmd_ln_t *inout_cmdln, const arg_t * defn,
+                   const char *buf, size_t buflen, int32 strict)
 {
-    FILE *file;
+    const char *ptr = buf, *end = buf + buflen;
     int argc;
     int argv_size;
     char *str;
@@ -610,20 +614,12 @@ cmd_ln_parse_file_r(cmd_ln_t *inout_cmdln, const arg_t * defn, const char *filen
     int rv = 0;
     const char separator[] = " \t\r\n";
 
-    if ((file = fopen(filename, "r")) == NULL) {
-        E_ERROR("Cannot open configuration file %s for reading\n",
-                filename);
-        return NULL;
-    }
-
-    ch = fgetc(file);
+    ch = BUF_GETC(ptr, end);
     /* Skip to the next interesting character */
-    for (; ch != EOF && strchr(separator, ch); ch = fgetc(file)) ;
+    for (; ch != EOF && strchr(separator, ch); ch = BUF_GETC(ptr, end)) ;
 
-    if (ch == EOF) {
-        fclose(file);
+    if (ch == EOF)
         return NULL;
-    }
 
     /*
      * Initialize default argv, argc, and argv_size.
@@ -640,9 +636,9 @@ cmd_ln_parse_file_r(cmd_ln_t *inout_cmdln, const arg_t * defn, const char *filen
         if (len == 0 && argc % 2 == 0) {
             while (ch == '#') {
                 /* Skip everything until newline */
-                for (ch = fgetc(file); ch != EOF && ch != '\n'; ch = fgetc(file)) ;
+                for (ch = BUF_GETC(ptr, end); ch != EOF && ch != '\n'; ch = BUF_GETC(ptr, end)) ;
                 /* Skip to the next interesting character */
-                for (ch = fgetc(file); ch != EOF && strchr(separator, ch); ch = fgetc(file)) ;
+                for (ch = BUF_GETC(ptr, end); ch != EOF && strchr(separator, ch); ch = BUF_GETC(ptr, end)) ;
             }
 
             /* Check if we are at the last line (without anything interesting in it) */
@@ -685,7 +681,7 @@ cmd_ln_parse_file_r(cmd_ln_t *inout_cmdln, const arg_t * defn, const char *filen
                 E_WARN("Unclosed quotation, having EOF close it...\n");
 
             /* Skip to the next interesting character */
-            for (; ch != EOF && strchr(separator, ch); ch = fgetc(file)) ;
+            for (; ch != EOF && strchr(separator, ch); ch = BUF_GETC(ptr, end)) ;
 
             if (ch == EOF)
                 break;
@@ -710,11 +706,9 @@ cmd_ln_parse_file_r(cmd_ln_t *inout_cmdln, const arg_t * defn, const char *filen
             str[len] = '\0';
         }
 
-        ch = fgetc(file);
+        ch = BUF_GETC(ptr, end);
     } while (1);
 
-    fclose(file);
-
     ckd_free(str);
 
     if (rv) {
@@ -726,6 +720,24 @@ cmd_ln_parse_file_r(cmd_ln_t *inout_cmdln, const arg_t * defn, const char *filen
 
     return parse_options(inout_cmdln, defn, argc, f_argv, strict);
 }
+
+#ifndef __EMSCRIPTEN__
+cmd_ln_t *
+cmd_ln_parse_file_r(cmd_ln_t *inout_cmdln, const arg_t * defn, const char *filename, int32 strict)
+{
+    mmio_file_t *mf;
+    cmd_ln_t *cmdln;
+
+    if ((mf = mmio_file_read(filename)) == NULL) {
+        E_ERROR("Cannot open configuration file %s for reading\n",
+                filename);
+        return NULL;
+    }
+    cmdln = cmd_ln_parse_buf_r(inout_cmdln, defn, mmio_file_ptr(mf),
+                               mmio_file_size(mf), strict);
+    mmio_file_unmap(mf);
+    return cmdln;
+}
 #endif /* not __EMSCRIPTEN__ */
 
 void
@@ -430,6 +430,48 @@ dict_word2basestr(char *word)
     return -1;
 }
 
+dict_t *
+dict_copy(dict_t *d)
+{
+    dict_t *c;
+    int32 i;
+
+    c = (dict_t *) ckd_calloc(1, sizeof(dict_t));       /* freed in dict_free() */
+    c->refcnt = 1;
+    c->max_words = d->max_words;
+    c->n_word = d->n_word;
+    c->filler_start = d->filler_start;
+    c->filler_end = d->filler_end;
+    c->startwid = d->startwid;
+    c->finishwid = d->finishwid;
+    c->silwid = d->silwid;
+    c->nocase = d->nocase;
+    if (d->mdef)
+        c->mdef = bin_mdef_retain(d->mdef);
+    c->word = (dictword_t *) ckd_calloc(c->max_words, sizeof(dictword_t));
+    c->ht = hash_table_new(c->max_words, c->nocase);
+    for (i = 0; i < d->n_word; ++i) {
+        dictword_t *src = d->word + i;
+        dictword_t *dst = c->word + i;
+
+        dst->alt = src->alt;
+        dst->basewid = src->basewid;
+        dst->pronlen = src->pronlen;
+        if (src->ciphone) {
+            dst->ciphone = (s3cipid_t *) ckd_malloc(src->pronlen
+                                                    * sizeof(s3cipid_t));
+            memcpy(dst->ciphone, src->ciphone,
+                   src->pronlen * sizeof(s3cipid_t));
+        }
+        if (src->word) {
+            dst->word = ckd_salloc(src->word);
+            (void)hash_table_enter_int32(c->ht, dst->word, i);
+        }
+    }
+
+    return c;
+}
+
 dict_t *
 dict_retain(dict_t *d)
 {
@@ -0,0 +1,479 @@
+/* -*- c-basic-offset: 4; indent-tabs-mode: nil -*- */
+/* ====================================================================
+ * Copyright (c) 2022 Carnegie Mellon University.  All rights
+ * reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer. 
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in
+ *    the documentation and/or other materials provided with the
+ *    distribution.
+ *
+ * This work was supported in part by funding from the Defense Advanced 
+ * Research Projects Agency and the National Science Foundation of the 
+ * United States of America, and the CMU Sphinx Speech Consortium.
+ *
+ * THIS SOFTWARE IS PROVIDED BY CARNEGIE MELLON UNIVERSITY ``AS IS'' AND 
+ * ANY EXPRESSED OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, 
+ * THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ * PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL CARNEGIE MELLON UNIVERSITY
+ * NOR ITS EMPLOYEES BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT 
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, 
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY 
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT 
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE 
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ * ====================================================================
+ *
+ */
+/**
+ * @file fe_fft.c
+ * @brief Real FFT for the front end.
+ *
+ * A real transform of N points is done as a complex transform of N/2
+ * points (the even samples as real parts and the odd ones as
+ * imaginary parts) followed by a split step to separate the two.
+ * The complex transform is decimation-in-time, with the bit-reversal
+ * permutation and all twiddle factors computed once, in
+ * fe_create_fft().  The permutation is fused with the first stage,
+ * which has no twiddle factors, and the remaining stages are radix-4
+ * (strictly speaking radix-2^2, which needs three complex
+ * multiplications per four points where radix-2 needs four).
+ *
+ * The output has the same layout as the old radix-2 code, that is,
+ * the real part of X[k] is in x[k] for k = 0..N/2 and the imaginary
+ * part is in x[N-k] for k = 1..N/2-1.
+ */
+
+#include "config.h"
+#include <math.h>
+#include <string.h>
+
+#ifndef M_PI
+#define M_PI 3.14159265358979323846
+#endif
+
+#include <soundswallower/prim_type.h>
+#include <soundswallower/ckd_alloc.h>
+#include <soundswallower/err.h>
+#include <soundswallower/simd.h>
+#include <soundswallower/fe_internal.h>
+
+#if defined(HAVE_SIMD_X86)
+#include <immintrin.h>
+#elif defined(HAVE_SIMD_NEON) && defined(__aarch64__)
+#include <arm_neon.h>
+#elif defined(HAVE_SIMD_WASM)
+#include <wasm_simd128.h>
+#endif
+
+/* Length of the first radix-4 stage after the fused first stage. */
+#define FIRST_LEN(fe) (((fe)->fft_order & 1) ? 16 : 8)
+
+/**
+ * Do one radix-4 stage over every group of len complex points in z,
+ * which holds n complex points in all.  The four quarters of each
+ * group are the transforms of length len/4 from the previous stage.
+ * The twiddle factors for this stage are w^k, w^2k and w^3k, with
+ * w = exp(-2 pi i / len), as three consecutive blocks of len/4.
+ */
+static void
+fft_stage_scalar(frame_t *z, frame_t const *tw, int32 n, int32 len)
+{
+    int32 q = len / 4, g, k;
+    frame_t const *tw1 = tw, *tw2 = tw + 2 * q, *tw3 = tw + 4 * q;
+
+    for (g = 0; g < n; g += len) {
+        frame_t *z0 = z + 2 * g, *z1 = z0 + 2 * q;
+        frame_t *z2 = z1 + 2 * q, *z3 = z2 + 2 * q;
+        for (k = 0; k < 2 * q; k += 2) {
+            frame_t ar, ai, br, bi, cr, ci, dr, di;
+            frame_t sr, si, tr, ti, ur, ui, vr, vi;
+
+            ar = z0[k];
+            ai = z0[k + 1];
+            br = z1[k] * tw2[k] - z1[k + 1] * tw2[k + 1];
+            bi = z1[k] * tw2[k + 1] + z1[k + 1] * tw2[k];
+            cr = z2[k] * tw1[k] - z2[k + 1] * tw1[k + 1];
+            ci = z2[k] * tw1[k + 1] + z2[k + 1] * tw1[k];
+            dr = z3[k] * tw3[k] - z3[k + 1] * tw3[k + 1];
+            di = z3[k] * tw3[k + 1] + z3[k + 1] * tw3[k];
+
+            sr = ar + br; si = ai + bi;
+            tr = ar - br; ti = ai - bi;
+            ur = cr + dr; ui = ci + di;
+            vr = cr - dr; vi = ci - di;
+
+            z0[k] = sr + ur; z0[k + 1] = si + ui;
+            z2[k] = sr - ur; z2[k + 1] = si - ui;
+            /* (a - b) -/+ i(c - d) */
+            z1[k] = tr + vi; z1[k + 1] = ti - vr;
+            z3[k] = tr - vi; z3[k + 1] = ti + vr;
+        }
+    }
+}
+
+#if defined(HAVE_SIMD_X86)
+/* One complex number per register, as (re, im). */
+SIMD_TARGET("sse2") static inline __m128d
+cmul_sse2(__m128d a, __m128d w)
+{
+    __m128d wr = _mm_unpacklo_pd(w, w);
+    __m128d wi = _mm_unpackhi_pd(w, w);
+    __m128d as = _mm_shuffle_pd(a, a, 1);
+    return _mm_add_pd(_mm_mul_pd(a, wr),
+                      _mm_xor_pd(_mm_mul_pd(as, wi), _mm_set_pd(0.0, -0.0)));
+}
+
+SIMD_TARGET("sse2") static void
+fft_stage_sse2(frame_t *z, frame_t const *tw, int32 n, int32 len)
+{
+    int32 q = len / 4, g, k;
+    frame_t const *tw1 = tw, *tw2 = tw + 2 * q, *tw3 = tw + 4 * q;
+    __m128d neg_im = _mm_set_pd(-0.0, 0.0);
+
+    for (g = 0; g < n; g += len) {
+        frame_t *z0 = z + 2 * g, *z1 = z0 + 2 * q;
+        frame_t *z2 = z1 + 2 * q, *z3 = z2 + 2 * q;
+        for (k = 0; k < 2 * q; k += 2) {
+            __m128d a = _mm_loadu_pd(z0 + k);
+            __m128d b = cmul_sse2(_mm_loadu_pd(z1 + k), _mm_loadu_pd(tw2 + k));
+            __m128d c = cmul_sse2(_mm_loadu_pd(z2 + k), _mm_loadu_pd(tw1 + k));
+            __m128d d = cmul_sse2(_mm_loadu_pd(z3 + k), _mm_loadu_pd(tw3 + k));
+            __m128d s = _mm_add_pd(a, b), t = _mm_sub_pd(a, b);
+            __m128d u = _mm_add_pd(c, d), v = _mm_sub_pd(c, d);
+            /* -i(c - d) */
+            v = _mm_xor_pd(_mm_shuffle_pd(v, v, 1), neg_im);
+            _mm_storeu_pd(z0 + k, _mm_add_pd(s, u));
+            _mm_storeu_pd(z2 + k, _mm_sub_pd(s, u));
+            _mm_storeu_pd(z1 + k, _mm_add_pd(t, v));
+            _mm_storeu_pd(z3 + k, _mm_sub_pd(t, v));
+        }
+    }
+}
+
+/* Two complex numbers per register.  Every stage after the first has
+ * an even number of points per quarter, so there is no remainder. */
+SIMD_TARGET("avx2") static inline __m256d
+cmul_avx2(__m256d a, __m256d w)
+{
+    __m256d wr = _mm256_movedup_pd(w);
+    __m256d wi = _mm256_permute_pd(w, 0xf);
+    __m256d as = _mm256_permute_pd(a, 0x5);
+    return _mm256_addsub_pd(_mm256_mul_pd(a, wr), _mm256_mul_pd(as, wi));
+}
+
+SIMD_TARGET("avx2") static void
+fft_stage_avx2(frame_t *z, frame_t const *tw, int32 n, int32 len)
+{
+    int32 q = len / 4, g, k;
+    frame_t const *tw1 = tw, *tw2 = tw + 2 * q, *tw3 = tw + 4 * q;
+    __m256d neg_im = _mm256_set_pd(-0.0, 0.0, -0.0, 0.0);
+
+    for (g = 0; g < n; g += len) {
+        frame_t *z0 = z + 2 * g, *z1 = z0 + 2 * q;
+        frame_t *z2 = z1 + 2 * q, *z3 = z2 + 2 * q;
+        for (k = 0; k < 2 * q; k += 4) {
+            __m256d a = _mm256_loadu_pd(z0 + k);
+            __m256d b = cmul_avx2(_mm256_loadu_pd(z1 + k),
+                                  _mm256_loadu_pd(tw2 + k));
+            __m256d c = cmul_avx2(_mm256_loadu_pd(z2 + k),
+                                  _mm256_loadu_pd(tw1 + k));
+            __m256d d = cmul_avx2(_mm256_loadu_pd(z3 + k),
+                                  _mm256_loadu_pd(tw3 + k));
+            __m256d s = _mm256_add_pd(a, b), t = _mm256_sub_pd(a, b);
+            __m256d u = _mm256_add_pd(c, d), v = _mm256_sub_pd(c, d);
+            v = _mm256_xor_pd(_mm256_permute_pd(v, 0x5), neg_im);
+            _mm256_storeu_pd(z0 + k, _mm256_add_pd(s, u));
+            _mm256_storeu_pd(z2 + k, _mm256_sub_pd(s, u));
+            _mm256_storeu_pd(z1 + k, _mm256_add_pd(t, v));
+            _mm256_storeu_pd(z3 + k, _mm256_sub_pd(t, v));
+        }
+    }
+}
+#endif /* HAVE_SIMD_X86 */
+
+/* Double precision NEON only exists on AArch64. */
+#if defined(HAVE_SIMD_NEON) && defined(__aarch64__)
+static inline float64x2_t
+cmul_neon(float64x2_t a, float64x2_t w, float64x2_t sign)
+{
+    float64x2_t wr = vdupq_laneq_f64(w, 0);
+    float64x2_t wi = vdupq_laneq_f64(w, 1);
+    float64x2_t as = vextq_f64(a, a, 1);
+    return vaddq_f64(vmulq_f64(a, wr), vmulq_f64(vmulq_f64(as, wi), sign));
+}
+
+static void
+fft_stage_neon(frame_t *z, frame_t const *tw, int32 n, int32 len)
+{
+    static const float64 sign_re[2] = { -1.0, 1.0 };
+    static const float64 sign_im[2] = { 1.0, -1.0 };
+    int32 q = len / 4, g, k;
+    frame_t const *tw1 = tw, *tw2 = tw + 2 * q, *tw3 = tw + 4 * q;
+    float64x2_t neg_re = vld1q_f64(sign_re), neg_im = vld1q_f64(sign_im);
+
+    for (g = 0; g < n; g += len) {
+        frame_t *z0 = z + 2 * g, *z1 = z0 + 2 * q;
+        frame_t *z2 = z1 + 2 * q, *z3 = z2 + 2 * q;
+        for (k = 0; k < 2 * q; k += 2) {
+            float64x2_t a = vld1q_f64(z0 + k);
+            float64x2_t b = cmul_neon(vld1q_f64(z1 + k), vld1q_f64(tw2 + k),
+                                      neg_re);
+            float64x2_t c = cmul_neon(vld1q_f64(z2 + k), vld1q_f64(tw1 + k),
+                                      neg_re);
+            float64x2_t d = cmul_neon(vld1q_f64(z3 + k), vld1q_f64(tw3 + k),
+                                      neg_re);
+            float64x2_t s = vaddq_f64(a, b), t = vsubq_f64(a, b);
+            float64x2_t u = vaddq_f64(c, d), v = vsubq_f64(c, d);
+            v = vmulq_f64(vextq_f64(v, v, 1), neg_im);
+            vst1q_f64(z0 + k, vaddq_f64(s, u));
+            vst1q_f64(z2 + k, vsubq_f64(s, u));
+            vst1q_f64(z1 + k, vaddq_f64(t, v));
+            vst1q_f64(z3 + k, vsubq_f64(t, v));
+        }
+    }
+}
+#endif /* HAVE_SIMD_NEON */
+
+#if defined(HAVE_SIMD_WASM)
+static inline v128_t
+cmul_wasm(v128_t a, v128_t w, v128_t sign)
+{
+    v128_t wr = wasm_i64x2_shuffle(w, w, 0, 0);
+    v128_t wi = wasm_i64x2_shuffle(w, w, 1, 1);
+    v128_t as = wasm_i64x2_shuffle(a, a, 1, 0);
+    return wasm_f64x2_add(wasm_f64x2_mul(a, wr),
+                          wasm_f64x2_mul(wasm_f64x2_mul(as, wi), sign));
+}
+
+static void
+fft_stage_wasm(frame_t *z, frame_t const *tw, int32 n, int32 len)
+{
+    int32 q = len / 4, g, k;
+    frame_t const *tw1 = tw, *tw2 = tw + 2 * q, *tw3 = tw + 4 * q;
+    v128_t neg_re = wasm_f64x2_make(-1.0, 1.0);
+    v128_t neg_im = wasm_f64x2_make(1.0, -1.0);
+
+    for (g = 0; g < n; g += len) {
+        frame_t *z0 = z + 2 * g, *z1 = z0 + 2 * q;
+        frame_t *z2 = z1 + 2 * q, *z3 = z2 + 2 * q;
+        for (k = 0; k < 2 * q; k += 2) {
+            v128_t a = wasm_v128_load(z0 + k);
+            v128_t b = cmul_wasm(wasm_v128_load(z1 + k),
+                                 wasm_v128_load(tw2 + k), neg_re);
+            v128_t c = cmul_wasm(wasm_v128_load(z2 + k),
+                                 wasm_v128_load(tw1 + k), neg_re);
+            v128_t d = cmul_wasm(wasm_v128_load(z3 + k),
+                                 wasm_v128_load(tw3 + k), neg_re);
+            v128_t s = wasm_f64x2_add(a, b), t = wasm_f64x2_sub(a, b);
+            v128_t u = wasm_f64x2_add(c, d), v = wasm_f64x2_sub(c, d);
+            v = wasm_f64x2_mul(wasm_i64x2_shuffle(v, v, 1, 0), neg_im);
+            wasm_v128_store(z0 + k, wasm_f64x2_add(s, u));
+            wasm_v128_store(z2 + k, wasm_f64x2_sub(s, u));
+            wasm_v128_store(z1 + k, wasm_f64x2_add(t, v));
+            wasm_v128_store(z3 + k, wasm_f64x2_sub(t, v));
+        }
+    }
+}
+#endif /* HAVE_SIMD_WASM */
+
+int
+fe_fft_set_simd(fe_t *fe, int level)
+{
+    fe->fft_stage = fft_stage_scalar;
+    switch (level) {
+#if defined(HAVE_SIMD_X86)
+    case SIMD_AVX512:
+    case SIMD_AVX2:
+        fe->fft_stage = fft_stage_avx2;
+        level = SIMD_AVX2;
+        break;
+    case SIMD_SSE2:
+        fe->fft_stage = fft_stage_sse2;
+        break;
+#endif
+#if defined(HAVE_SIMD_NEON) && defined(__aarch64__)
+    case SIMD_NEON:
+        fe->fft_stage = fft_stage_neon;
+        break;
+#endif
+#if defined(HAVE_SIMD_WASM)
+    case SIMD_WASM:
+        fe->fft_stage = fft_stage_wasm;
+        break;
+#endif
+    default:
+        level = SIMD_NONE;
+    }
+    fe->fft_simd = level;
+
+    return level;
+}
+
+void
+fe_create_fft(fe_t *fe)
+{
+    int32 n = fe->fft_size, m = n / 2, bits = fe->fft_order - 1;
+    int32 i, j, k, len, n_tw;
+    frame_t *tw;
+
+    /* Bit-reversal permutation of the complex input. */
+    fe->fft_rev = ckd_calloc(m, sizeof(*fe->fft_rev));
+    for (i = 0; i < m; ++i) {
+        int32 r = 0;
+        for (j = 0; j < bits; ++j)
+            if (i & (1 << j))
+                r |= 1 << (bits - 1 - j);
+        fe->fft_rev[i] = r;
+    }
+
+    /* Twiddle factors for the radix-4 stages. */
+    n_tw = 0;
+    for (len = FIRST_LEN(fe); len <= m; len *= 4)
+        n_tw += 6 * (len / 4);
+    if (n_tw > 0)
+        fe->fft_tw = ckd_calloc(n_tw, sizeof(*fe->fft_tw));
+    tw = fe->fft_tw;
+    for (len = FIRST_LEN(fe); len <= m; len *= 4) {
+        int32 q = len / 4;
+        for (j = 0; j < 3; ++j) {
+            for (k = 0; k < q; ++k) {
+                float64 a = 2 * M_PI * (j + 1) * k / len;
+                tw[2 * (j * q + k)] = cos(a);
+                tw[2 * (j * q + k) + 1] = -sin(a);
+            }
+        }
+        tw += 6 * q;
+    }
+
+    /* Twiddle factors for the split step, exp(-2 pi i k / N). */
+    fe->fft_rtw = ckd_calloc(2 * (m / 2 + 1), sizeof(*fe->fft_rtw));
+    for (k = 0; k <= m / 2; ++k) {
+        float64 a = 2 * M_PI * k / n;
+        fe->fft_rtw[2 * k] = cos(a);
+        fe->fft_rtw[2 * k + 1] = -sin(a);
+    }
+
+    fe->fft_work = ckd_calloc(n, sizeof(*fe->fft_work));
+    fe->fft_work_frames = 1;
+    fe_fft_set_simd(fe, simd_detect());
+}
+
+void
+fe_free_fft(fe_t *fe)
+{
+    ckd_free(fe->fft_rev);
+    ckd_free(fe->fft_tw);
+    ckd_free(fe->fft_rtw);
+    ckd_free(fe->fft_work);
+}
+
+/**
+ * Permute one frame into bit-reversed order while doing the first
+ * stage, which is radix-2 or radix-4 depending on the number of
+ * points, and has no twiddle factors.
+ */
+static void
+fft_first_stage(fe_t *fe, frame_t const *x, frame_t *z)
+{
+    int32 m = fe->fft_size / 2, g;
+    int32 const *rev = fe->fft_rev;
+
+    if (m == 1) {
+        z[0] = x[0];
+        z[1] = x[1];
+    }
+    else if (fe->fft_order & 1) {
+        for (g = 0; g < m; g += 4) {
+            frame_t const *a = x + 2 * rev[g], *b = x + 2 * rev[g + 1];
+            frame_t const *c = x + 2 * rev[g + 2], *d = x + 2 * rev[g + 3];
+            frame_t sr, si, tr, ti, ur, ui, vr, vi;
+            frame_t *y = z + 2 * g;
+
+            sr = a[0] + b[0]; si = a[1] + b[1];
+            tr = a[0] - b[0]; ti = a[1] - b[1];
+            ur = c[0] + d[0]; ui = c[1] + d[1];
+            vr = c[0] - d[0]; vi = c[1] - d[1];
+            y[0] = sr + ur; y[1] = si + ui;
+            y[2] = tr + vi; y[3] = ti - vr;
+            y[4] = sr - ur; y[5] = si - ui;
+            y[6] = tr - vi; y[7] = ti + vr;
+        }
+    }
+    else {
+        for (g = 0; g < m; g += 2) {
+            frame_t const *a = x + 2 * rev[g], *b = x + 2 * rev[g + 1];
+            frame_t *y = z + 2 * g;
+
+            y[0] = a[0] + b[0]; y[1] = a[1] + b[1];
+            y[2] = a[0] - b[0]; y[3] = a[1] - b[1];
+        }
+    }
+}
+
+/**
+ * Recover the transform of the real input from the complex transform
+ * Z of its even (real part) and odd (imaginary part) samples:
+ *
+ * X[k] = (Z[k] + Z*[M-k]) / 2 - i W^k (Z[k] - Z*[M-k]) / 2
+ *
+ * where M = N/2 and W = exp(-2 pi i / N).  X[M-k] is computed at the
+ * same time, since it needs the same inputs.
+ */
+static void
+fft_split(fe_t *fe, frame_t const *z, frame_t *x)
+{
+    int32 n = fe->fft_size, m = n / 2, k;
+    frame_t const *w = fe->fft_rtw;
+
+    x[0] = z[0] + z[1];
+    x[m] = z[0] - z[1];
+    for (k = 1; k <= m / 2; ++k) {
+        frame_t ar = z[2 * k], ai = z[2 * k + 1];
+        frame_t br = z[2 * (m - k)], bi = -z[2 * (m - k) + 1];
+        frame_t er, ei, hr, hi, tr, ti;
+
+        er = 0.5 * (ar + br);
+        ei = 0.5 * (ai + bi);
+        hr = 0.5 * (ai - bi);
+        hi = 0.5 * (br - ar);
+        tr = w[2 * k] * hr - w[2 * k + 1] * hi;
+        ti = w[2 * k] * hi + w[2 * k + 1] * hr;
+        x[k] = er + tr;
+        x[n - k] = ei + ti;
+        x[m - k] = er - tr;
+        x[m + k] = ti - ei;
+    }
+}
+
+void
+fe_fft_real(fe_t *fe, frame_t *x, int32 n_frames)
+{
+    int32 n = fe->fft_size, m = n / 2, len, f;
+    frame_t const *tw = fe->fft_tw;
+
+    if (n_frames > fe->fft_work_frames) {
+        fe->fft_work = ckd_realloc(fe->fft_work, (size_t)n_frames * n
+                                   * sizeof(*fe->fft_work));
+        fe->fft_work_frames = n_frames;
+    }
+    for (f = 0; f < n_frames; ++f)
+        fft_first_stage(fe, x + (size_t)f * n, fe->fft_work + (size_t)f * n);
+    /* The frames are contiguous, so each stage does all of them in
+     * one pass. */
+    for (len = FIRST_LEN(fe); len <= m; len *= 4) {
+        fe->fft_stage(fe->fft_work, tw, m * n_frames, len);
+        tw += 6 * (len / 4);
+    }
+    for (f = 0; f < n_frames; ++f)
+        fft_split(fe, fe->fft_work + (size_t)f * n, x + (size_t)f * n);
+}
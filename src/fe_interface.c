@@ -56,9 +56,22 @@ int
 fe_parse_general_params(cmd_ln_t *config, fe_t * fe)
 {
     int j, frate, window_samples;
+    float32 resample;
 
     fe->config = cmd_ln_retain(config);
     fe->sampling_rate = cmd_ln_float32_r(config, "-samprate");
+    /* Everything below here is done at the resampled rate. */
+    resample = cmd_ln_float32_r(config, "-resample");
+    if (resample > 0 && resample != fe->sampling_rate) {
+        if (resample != (int32)resample
+            || fe->sampling_rate != (int32)fe->sampling_rate) {
+            E_ERROR("Can only resample between integer rates (%.02f to %.02f)\n",
+                    fe->sampling_rate, resample);
+            return -1;
+        }
+        fe->input_rate = fe->sampling_rate;
+        fe->sampling_rate = resample;
+    }
     frate = cmd_ln_int32_r(config, "-frate");
     if (frate > MAX_INT16 || frate > fe->sampling_rate || frate < 1) {
         E_ERROR
@@ -181,6 +194,8 @@ fe_print_current(fe_t const *fe)
 {
     E_INFO("Current FE Parameters:\n");
     E_INFO("\tSampling Rate:             %f\n", fe->sampling_rate);
+    if (fe->resampler)
+        E_INFO("\tInput Sampling Rate:       %f\n", fe->input_rate);
     E_INFO("\tFrame Size:                %d\n", fe->frame_size);
     E_INFO("\tFrame Shift:               %d\n", fe->frame_shift);
     E_INFO("\tFFT Size:                  %d\n", fe->fft_size);
@@ -281,14 +296,35 @@ fe_init(cmd_ln_t *config)
     /* Create temporary FFT, spectrum and mel-spectrum buffers. */
     /* FIXME: Gosh there are a lot of these. */
     fe->spch = ckd_calloc(fe->frame_size, sizeof(*fe->spch));
-    fe->frame = ckd_calloc(fe->fft_size, sizeof(*fe->frame));
-    fe->spec = ckd_calloc(fe->fft_size, sizeof(*fe->spec));
-    fe->mfspec = ckd_calloc(fe->mel_fb->num_filters, sizeof(*fe->mfspec));
-
-    /* create twiddle factors */
-    fe->ccc = ckd_calloc(fe->fft_size / 4, sizeof(*fe->ccc));
-    fe->sss = ckd_calloc(fe->fft_size / 4, sizeof(*fe->sss));
-    fe_create_twiddle(fe);
+    fe->frames = ckd_calloc((size_t)FE_MAX_BLOCK * fe->fft_size,
+                            sizeof(*fe->frames));
+    fe->frame = fe->frames;
+    fe->spec = ckd_calloc((size_t)FE_MAX_BLOCK * (fe->fft_size / 2 + 1),
+                          sizeof(*fe->spec));
+    fe->mfspec = ckd_calloc((size_t)FE_MAX_BLOCK * fe->mel_fb->num_filters,
+                            sizeof(*fe->mfspec));
+
+    /* create FFT plan */
+    fe_create_fft(fe);
+
+    /* Set up resampling of the input if necessary. */
+    if (fe->input_rate > 0) {
+        size_t n_out;
+        if ((fe->resampler = fe_resampler_init((int32)fe->input_rate,
+                                               (int32)fe->sampling_rate))
+            == NULL) {
+            fe_free(fe);
+            return NULL;
+        }
+        /* The resampler takes care of byteswapping, and its output
+         * is in native byte order. */
+        fe->resample_swap = fe->swap;
+        fe->swap = FALSE;
+        fe->rs_in = ckd_calloc(FE_RESAMPLE_CHUNK, sizeof(*fe->rs_in));
+        n_out = fe_resampler_max_output(fe->resampler, FE_RESAMPLE_CHUNK)
+            + fe_resampler_max_flush(fe->resampler);
+        fe->rs_out = ckd_calloc(n_out, sizeof(*fe->rs_out));
+    }
 
     if (cmd_ln_boolean_r(config, "-verbose")) {
         fe_print_current(fe);
@@ -326,6 +362,10 @@ fe_start(fe_t * fe)
            fe->frame_size * sizeof(*fe->overflow_samps));
     fe->pre_emphasis_prior = 0;
     fe_reset_noisestats(fe->noise_stats);
+    if (fe->resampler)
+        fe_resampler_reset(fe->resampler);
+    fe->n_rs_out = 0;
+    fe->rs_flushed = FALSE;
     return 0;
 }
 
@@ -558,7 +598,7 @@ fe_process(fe_t *fe,
            fe_encoding_t encoding)
 {
     int frame_count;
-    int outidx, i, orig_n_overflow;
+    int outidx, i, orig_n_overflow, n_block;
     void const *orig_spch;
 
     /* No output buffer, do nothing except return max number of frames. */
@@ -585,6 +625,10 @@ fe_process(fe_t *fe,
         frame_count = nframes;
     /* Index of output frame. */
     outidx = 0;
+    /* Frames are read into a block, which is then processed all at
+     * once. */
+    fe->frame = fe->frames;
+    n_block = 1;
 
     /* Start processing, taking care of any incoming overflow. */
     if (fe->num_overflow_samps) {
@@ -601,14 +645,20 @@ fe_process(fe_t *fe,
         }
         *inout_nsamps -= fe->frame_size;
     }
-    fe_write_frame(fe, buf_cep[outidx]);
-    outidx++;
 
     /* Process all remaining frames. */
     for (i = 1; i < frame_count; ++i) {
         int shift;
         assert(*inout_nsamps >= (size_t)fe->frame_shift);
 
+        if (n_block == FE_MAX_BLOCK) {
+            outidx += fe_write_frames(fe, fe->frames,
+                                      buf_cep + outidx, n_block);
+            n_block = 0;
+        }
+        fe->frame = fe->frames + (size_t)n_block * fe->fft_size;
+        ++n_block;
+
         if (encoding == FE_FLOAT32) {
             float32 const **spch = (float32 const **)inout_spch;
             shift = fe_shift_frame_float32(fe, *spch, fe->frame_shift);
@@ -619,14 +669,14 @@ fe_process(fe_t *fe,
             shift = fe_shift_frame_int16(fe, *spch, fe->frame_shift);
             *spch += shift;
         }
-        assert(outidx < frame_count);
-        fe_write_frame(fe, buf_cep[outidx]);
-        outidx++;
         /* Amount of data behind the original input which is still needed. */
         if (fe->num_overflow_samps > 0)
             fe->num_overflow_samps -= shift;
         *inout_nsamps -= shift;
     }
+    outidx += fe_write_frames(fe, fe->frames, buf_cep + outidx, n_block);
+    assert(outidx == frame_count);
+    fe->frame = fe->frames;
 
     /* If there are remaining samples, create an extra frame in
      * fe->overflow_samps, starting from the next input frame, with as
@@ -647,6 +697,98 @@ fe_process(fe_t *fe,
     return outidx;
 }
 
+/**
+ * Turn as many resampled samples as possible into frames.
+ */
+static int
+process_resampled(fe_t *fe, mfcc_t **buf_cep, int nframes)
+{
+    float32 const *ptr = fe->rs_out;
+    size_t nsamps = fe->n_rs_out;
+    int nfr;
+
+    if (nsamps == 0)
+        return 0;
+    nfr = fe_process(fe, &ptr, &nsamps, buf_cep, nframes, FE_FLOAT32);
+    /* Keep whatever is left over for next time. */
+    memmove(fe->rs_out, ptr, nsamps * sizeof(*fe->rs_out));
+    fe->n_rs_out = nsamps;
+
+    return nfr;
+}
+
+/**
+ * Resample up to FE_RESAMPLE_CHUNK input samples.
+ */
+static void
+resample_input(fe_t *fe,
+               void *inout_spch,
+               size_t *inout_nsamps,
+               fe_encoding_t encoding)
+{
+    size_t i, nsamps = *inout_nsamps;
+
+    if (nsamps > FE_RESAMPLE_CHUNK)
+        nsamps = FE_RESAMPLE_CHUNK;
+    if (encoding == FE_FLOAT32) {
+        float32 const **spch = (float32 const **)inout_spch;
+        for (i = 0; i < nsamps; ++i) {
+            float32 sample = (*spch)[i];
+            if (fe->resample_swap)
+                SWAP_FLOAT32(&sample);
+            fe->rs_in[i] = sample;
+        }
+        *spch += nsamps;
+    }
+    else {
+        int16 const **spch = (int16 const **)inout_spch;
+        for (i = 0; i < nsamps; ++i) {
+            int16 sample = (*spch)[i];
+            if (fe->resample_swap)
+                SWAP_INT16(&sample);
+            fe->rs_in[i] = (float32)sample / FLOAT32_SCALE;
+        }
+        *spch += nsamps;
+    }
+    *inout_nsamps -= nsamps;
+    fe->n_rs_out += fe_resampler_process(fe->resampler, fe->rs_in, nsamps,
+                                         fe->rs_out + fe->n_rs_out);
+}
+
+/**
+ * Process input at a different sampling rate.  It is resampled a
+ * chunk at a time, and only once all of the previous chunk has been
+ * used, so the resampled data never takes up more than one chunk
+ * (plus the end of the stream, see fe_end()).
+ */
+static int
+fe_process_resample(fe_t *fe,
+                    void *inout_spch,
+                    size_t *inout_nsamps,
+                    mfcc_t **buf_cep,
+                    int nframes,
+                    fe_encoding_t encoding)
+{
+    int nfr = 0;
+
+    /* No output buffer, return max number of frames, including the
+     * ones fe_end() will get from the end of the resampled data. */
+    if (buf_cep == NULL)
+        return output_frame_count(fe, fe->n_rs_out
+                                  + fe_resampler_max_output(fe->resampler,
+                                                            *inout_nsamps)
+                                  + fe_resampler_max_flush(fe->resampler));
+    while (TRUE) {
+        nfr += process_resampled(fe, buf_cep + nfr, nframes - nfr);
+        /* Either out of input, or out of space for frames. */
+        if (*inout_nsamps == 0 || fe->n_rs_out > 0)
+            break;
+        resample_input(fe, inout_spch, inout_nsamps, encoding);
+    }
+
+    return nfr;
+}
+
 int
 fe_process_float32(fe_t *fe,
                    float32 const **inout_spch,
@@ -654,6 +796,9 @@ fe_process_float32(fe_t *fe,
                    mfcc_t **buf_cep,
                    int nframes)
 {
+    if (fe->resampler)
+        return fe_process_resample(fe, (void *)inout_spch, inout_nsamps,
+                                   buf_cep, nframes, FE_FLOAT32);
     return fe_process(fe, (void *)inout_spch, inout_nsamps,
                       buf_cep, nframes, FE_FLOAT32);
 }
@@ -665,6 +810,9 @@ fe_process_int16(fe_t *fe,
                  mfcc_t **buf_cep,
                  int nframes)
 {
+    if (fe->resampler)
+        return fe_process_resample(fe, (void *)inout_spch, inout_nsamps,
+                                   buf_cep, nframes, FE_PCM16);
     return fe_process(fe, (void *)inout_spch, inout_nsamps,
                       buf_cep, nframes, FE_PCM16);
 }
@@ -673,19 +821,45 @@ int
 fe_end(fe_t *fe, mfcc_t **buf_cep, int nframes)
 {
     int nfr = 0;
-    
+
+    /* Get the end of the resampled data (only once, as we may be
+     * called again for whatever doesn't fit). */
+    if (fe->resampler && !fe->rs_flushed) {
+        fe->n_rs_out += fe_resampler_flush(fe->resampler,
+                                           fe->rs_out + fe->n_rs_out);
+        fe->rs_flushed = TRUE;
+    }
+
+    /* No output buffer, return max number of frames left. */
+    if (buf_cep == NULL) {
+        if (fe->n_rs_out + fe->num_overflow_samps == 0)
+            return 0;
+        return output_frame_count(fe, fe->n_rs_out);
+    }
+
+    /* Keep anything that doesn't fit for the next call. */
+    nfr = process_resampled(fe, buf_cep, nframes);
+    if (fe->n_rs_out > 0)
+        return nfr;
+    buf_cep += nfr;
+    nframes -= nfr;
+
     /* Process any remaining data if possible. */
-    if (buf_cep
-        && nframes > 0
-        && fe->num_overflow_samps > 0) {
+    if (fe->num_overflow_samps > 0) {
+        if (nframes == 0)
+            return nfr;
         fe_read_frame_float32(fe, fe->overflow_samps,
                               fe->num_overflow_samps);
         fe_write_frame(fe, *buf_cep);
-        nfr = 1;
+        nfr++;
     }
 
     /* reset overflow buffers... */
     fe->num_overflow_samps = 0;
+    if (fe->resampler) {
+        fe_resampler_reset(fe->resampler);
+        fe->rs_flushed = FALSE;
+    }
 
     return nfr;
 }
@@ -717,15 +891,17 @@ fe_free(fe_t * fe)
         ckd_free(fe->mel_fb);
     }
     ckd_free(fe->spch);
-    ckd_free(fe->frame);
-    ckd_free(fe->ccc);
-    ckd_free(fe->sss);
+    ckd_free(fe->frames);
+    fe_free_fft(fe);
     ckd_free(fe->spec);
     ckd_free(fe->mfspec);
     ckd_free(fe->overflow_samps);
     ckd_free(fe->hamming_window);
     if (fe->noise_stats)
         fe_free_noisestats(fe->noise_stats);
+    fe_resampler_free(fe->resampler);
+    ckd_free(fe->rs_in);
+    ckd_free(fe->rs_out);
     cmd_ln_free_r(fe->config);
     ckd_free(fe);
 
@@ -273,17 +273,15 @@ fe_free_noisestats(noise_stats_t * noise_stats)
  * so we have to add many processing cases.
  */
 void
-fe_remove_noise(fe_t * fe)
+fe_remove_noise(fe_t * fe, powspec_t * mfspec)
 {
     noise_stats_t *noise_stats;
-    powspec_t *mfspec;
     int32 i, num_filts;
 
     if (fe->noise_stats == NULL)
         return;
 
     noise_stats = fe->noise_stats;
-    mfspec = fe->mfspec;
     num_filts = noise_stats->num_filters;
 
     if (noise_stats->undefined) {
@@ -0,0 +1,276 @@
+/* -*- c-basic-offset: 4; indent-tabs-mode: nil -*- */
+/* ====================================================================
+ * Copyright (c) 2022 Carnegie Mellon University.  All rights
+ * reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer. 
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in
+ *    the documentation and/or other materials provided with the
+ *    distribution.
+ *
+ * This work was supported in part by funding from the Defense Advanced 
+ * Research Projects Agency and the National Science Foundation of the 
+ * United States of America, and the CMU Sphinx Speech Consortium.
+ *
+ * THIS SOFTWARE IS PROVIDED BY CARNEGIE MELLON UNIVERSITY ``AS IS'' AND 
+ * ANY EXPRESSED OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, 
+ * THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ * PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL CARNEGIE MELLON UNIVERSITY
+ * NOR ITS EMPLOYEES BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT 
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, 
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY 
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT 
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE 
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ * ====================================================================
+ *
+ */
+/**
+ * @file fe_resample.c
+ * @brief Streaming polyphase resampler for the front end.
+ *
+ * The ratio of output to input rate is reduced to up/down.  Output
+ * sample n falls at time n * down / up in the input, that is, at
+ * input sample pos with a fractional offset of phase / up, and is
+ * computed with the phase'th polyphase component of a Kaiser-windowed
+ * sinc lowpass filter, whose cutoff is just below the lower of the
+ * two Nyquist frequencies.
+ */
+
+#include "config.h"
+#include <math.h>
+#include <string.h>
+
+#ifndef M_PI
+#define M_PI 3.14159265358979323846
+#endif
+
+#include <soundswallower/prim_type.h>
+#include <soundswallower/ckd_alloc.h>
+#include <soundswallower/err.h>
+#include <soundswallower/fe_resample.h>
+
+/* Zero crossings of the sinc on each side of the filter. */
+#define RS_ZEROS 16
+/* Cutoff frequency as a fraction of the lower Nyquist frequency. */
+#define RS_ROLLOFF 0.95
+/* Kaiser window parameter (about 80dB stopband attenuation). */
+#define RS_BETA 8.0
+/* Maximum number of phases (after reducing the ratio). */
+#define RS_MAX_PHASES 1024
+/* Input samples buffered at a time, in addition to the filter. */
+#define RS_BLOCK 1024
+
+static float64
+bessel_i0(float64 x)
+{
+    float64 sum = 1.0, term = 1.0;
+    int k;
+
+    for (k = 1; k < 100; ++k) {
+        term *= (x / (2 * k)) * (x / (2 * k));
+        sum += term;
+        if (term < sum * 1e-12)
+            break;
+    }
+    return sum;
+}
+
+static int32
+gcd(int32 a, int32 b)
+{
+    while (b) {
+        int32 t = a % b;
+        a = b;
+        b = t;
+    }
+    return a;
+}
+
+fe_resampler_t *
+fe_resampler_init(int32 in_rate, int32 out_rate)
+{
+    fe_resampler_t *rs;
+    float64 fc, i0_beta;
+    int32 g, p, j, half;
+
+    if (in_rate <= 0 || out_rate <= 0) {
+        E_ERROR("Invalid sampling rates for resampling: %d to %d\n",
+                in_rate, out_rate);
+        return NULL;
+    }
+    g = gcd(in_rate, out_rate);
+    if (out_rate / g > RS_MAX_PHASES) {
+        E_ERROR("Cannot resample from %d to %d (ratio %d/%d is too complex)\n",
+                in_rate, out_rate, out_rate / g, in_rate / g);
+        return NULL;
+    }
+    rs = ckd_calloc(1, sizeof(*rs));
+    rs->up = out_rate / g;
+    rs->down = in_rate / g;
+
+    /* Cutoff in cycles per input sample, and half the filter length
+     * in input samples (rounded so that n_taps is a multiple of 4). */
+    fc = 0.5 * RS_ROLLOFF;
+    if (out_rate < in_rate)
+        fc = fc * out_rate / in_rate;
+    half = 2 * (int32)ceil(RS_ZEROS / (2 * fc) / 2);
+    rs->n_taps = 2 * half;
+    rs->taps = ckd_calloc((size_t)rs->up * rs->n_taps, sizeof(*rs->taps));
+    i0_beta = bessel_i0(RS_BETA);
+    for (p = 0; p < rs->up; ++p) {
+        float32 *h = rs->taps + (size_t)p * rs->n_taps;
+        float64 sum = 0;
+        for (j = 0; j < rs->n_taps; ++j) {
+            /* Time from input sample j to the output sample. */
+            float64 t = half - 1 - j + (float64)p / rs->up;
+            float64 x = 2 * fc * t, r = t / half, w;
+            w = (fabs(r) < 1.0)
+                ? bessel_i0(RS_BETA * sqrt(1.0 - r * r)) / i0_beta : 0.0;
+            h[j] = (x == 0.0) ? w : w * sin(M_PI * x) / (M_PI * x);
+            sum += h[j];
+        }
+        /* Unity gain at DC for every phase. */
+        for (j = 0; j < rs->n_taps; ++j)
+            h[j] /= sum;
+    }
+
+    rs->hist_alloc = 2 * rs->n_taps + RS_BLOCK;
+    rs->hist = ckd_calloc(rs->hist_alloc, sizeof(*rs->hist));
+    fe_resampler_reset(rs);
+    E_INFO("Resampling from %d to %d Hz (%d/%d, %d taps per phase)\n",
+           in_rate, out_rate, rs->up, rs->down, rs->n_taps);
+
+    return rs;
+}
+
+void
+fe_resampler_free(fe_resampler_t *rs)
+{
+    if (rs == NULL)
+        return;
+    ckd_free(rs->taps);
+    ckd_free(rs->hist);
+    ckd_free(rs);
+}
+
+void
+fe_resampler_reset(fe_resampler_t *rs)
+{
+    /* The first output sample is centred on the first input sample,
+     * so pad the start with zeros. */
+    rs->n_hist = rs->n_taps / 2 - 1;
+    memset(rs->hist, 0, rs->n_hist * sizeof(*rs->hist));
+    rs->pos = rs->n_hist;
+    rs->phase = 0;
+    rs->n_in = rs->n_out = 0;
+}
+
+size_t
+fe_resampler_max_output(fe_resampler_t *rs, size_t n_in)
+{
+    return (size_t)((uint64)n_in * rs->up / rs->down) + 2;
+}
+
+size_t
+fe_resampler_max_flush(fe_resampler_t *rs)
+{
+    return fe_resampler_max_output(rs, rs->n_taps / 2 + 1);
+}
+
+/**
+ * Produce output samples for as long as there is enough input, up
+ * to a total of limit samples since the last reset.
+ */
+static size_t
+resample(fe_resampler_t *rs, float32 *out, uint64 limit)
+{
+    int32 half = rs->n_taps / 2;
+    size_t n = 0;
+
+    while (rs->pos + half < rs->n_hist && rs->n_out < limit) {
+        float32 const *x = rs->hist + rs->pos - half + 1;
+        float32 const *h = rs->taps + (size_t)rs->phase * rs->n_taps;
+        float32 s0 = 0, s1 = 0, s2 = 0, s3 = 0;
+        int32 j;
+
+        for (j = 0; j < rs->n_taps; j += 4) {
+            s0 += x[j] * h[j];
+            s1 += x[j + 1] * h[j + 1];
+            s2 += x[j + 2] * h[j + 2];
+            s3 += x[j + 3] * h[j + 3];
+        }
+        out[n++] = (s0 + s1) + (s2 + s3);
+        ++rs->n_out;
+        rs->phase += rs->down;
+        rs->pos += rs->phase / rs->up;
+        rs->phase %= rs->up;
+    }
+    return n;
+}
+
+/**
+ * Throw away input which no future output sample will need.
+ */
+static void
+discard(fe_resampler_t *rs)
+{
+    int32 shift = rs->pos - (rs->n_taps / 2 - 1);
+
+    if (shift > rs->n_hist)
+        shift = rs->n_hist;
+    if (shift <= 0)
+        return;
+    memmove(rs->hist, rs->hist + shift,
+            (rs->n_hist - shift) * sizeof(*rs->hist));
+    rs->n_hist -= shift;
+    rs->pos -= shift;
+}
+
+size_t
+fe_resampler_process(fe_resampler_t *rs, float32 const *in,
+                     size_t n_in, float32 *out)
+{
+    size_t n_out = 0;
+
+    while (n_in > 0) {
+        size_t n = rs->hist_alloc - rs->n_hist;
+
+        if (n > n_in)
+            n = n_in;
+        memcpy(rs->hist + rs->n_hist, in, n * sizeof(*in));
+        rs->n_hist += (int32)n;
+        rs->n_in += n;
+        in += n;
+        n_in -= n;
+        n_out += resample(rs, out + n_out, (uint64)-1);
+        discard(rs);
+    }
+    return n_out;
+}
+
+size_t
+fe_resampler_flush(fe_resampler_t *rs, float32 *out)
+{
+    int32 half = rs->n_taps / 2;
+    uint64 limit;
+    size_t n_out;
+
+    /* Pad the end with zeros, and stop at the output sample that
+     * corresponds to the end of the input. */
+    memset(rs->hist + rs->n_hist, 0, half * sizeof(*rs->hist));
+    rs->n_hist += half;
+    limit = ((uint64)rs->n_in * rs->up + rs->down - 1) / rs->down;
+    n_out = resample(rs, out, limit);
+    fe_resampler_reset(rs);
+    return n_out;
+}
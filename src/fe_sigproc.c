@@ -463,266 +463,202 @@ fe_shift_frame_float32(fe_t * fe, float32 const *in, int32 len)
     return len;
 }
 
-/**
- * Create arrays of twiddle factors.
- */
-void
-fe_create_twiddle(fe_t * fe)
-{
-    int i;
-
-    for (i = 0; i < fe->fft_size / 4; ++i) {
-        float64 a = 2 * M_PI * i / fe->fft_size;
-        fe->ccc[i] = cos(a);
-        fe->sss[i] = sin(a);
-    }
-}
-
-
-static int
-fe_fft_real(fe_t * fe)
-{
-    int i, j, k, m, n;
-    frame_t *x, xt;
-
-    x = fe->frame;
-    m = fe->fft_order;
-    n = fe->fft_size;
-
-    /* Bit-reverse the input. */
-    j = 0;
-    for (i = 0; i < n - 1; ++i) {
-        if (i < j) {
-            xt = x[j];
-            x[j] = x[i];
-            x[i] = xt;
-        }
-        k = n / 2;
-        while (k <= j) {
-            j -= k;
-            k /= 2;
-        }
-        j += k;
-    }
-
-    /* Basic butterflies (2-point FFT, real twiddle factors):
-     * x[i]   = x[i] +  1 * x[i+1]
-     * x[i+1] = x[i] + -1 * x[i+1]
-     */
-    for (i = 0; i < n; i += 2) {
-        xt = x[i];
-        x[i] = (xt + x[i + 1]);
-        x[i + 1] = (xt - x[i + 1]);
-    }
-
-    /* The rest of the butterflies, in stages from 1..m */
-    for (k = 1; k < m; ++k) {
-        int n1, n2, n4;
-
-        n4 = k - 1;
-        n2 = k;
-        n1 = k + 1;
-        /* Stride over each (1 << (k+1)) points */
-        for (i = 0; i < n; i += (1 << n1)) {
-            /* Basic butterfly with real twiddle factors:
-             * x[i]          = x[i] +  1 * x[i + (1<<k)]
-             * x[i + (1<<k)] = x[i] + -1 * x[i + (1<<k)]
-             */
-            xt = x[i];
-            x[i] = (xt + x[i + (1 << n2)]);
-            x[i + (1 << n2)] = (xt - x[i + (1 << n2)]);
-
-            /* The other ones with real twiddle factors:
-             * x[i + (1<<k) + (1<<(k-1))]
-             *   = 0 * x[i + (1<<k-1)] + -1 * x[i + (1<<k) + (1<<k-1)]
-             * x[i + (1<<(k-1))]
-             *   = 1 * x[i + (1<<k-1)] +  0 * x[i + (1<<k) + (1<<k-1)]
-             */
-            x[i + (1 << n2) + (1 << n4)] = -x[i + (1 << n2) + (1 << n4)];
-            x[i + (1 << n4)] = x[i + (1 << n4)];
-
-            /* Butterflies with complex twiddle factors.
-             * There are (1<<k-1) of them.
-             */
-            for (j = 1; j < (1 << n4); ++j) {
-                frame_t cc, ss, t1, t2;
-                int i1, i2, i3, i4;
-
-                i1 = i + j;
-                i2 = i + (1 << n2) - j;
-                i3 = i + (1 << n2) + j;
-                i4 = i + (1 << n2) + (1 << n2) - j;
-
-                /*
-                 * cc = real(W[j * n / (1<<(k+1))])
-                 * ss = imag(W[j * n / (1<<(k+1))])
-                 */
-                cc = fe->ccc[j << (m - n1)];
-                ss = fe->sss[j << (m - n1)];
-
-                /* There are some symmetry properties which allow us
-                 * to get away with only four multiplications here. */
-                t1 = COSMUL(x[i3], cc) + COSMUL(x[i4], ss);
-                t2 = COSMUL(x[i3], ss) - COSMUL(x[i4], cc);
-
-                x[i4] = (x[i2] - t2);
-                x[i3] = (-x[i2] - t2);
-                x[i2] = (x[i1] - t1);
-                x[i1] = (x[i1] + t1);
-            }
-        }
-    }
-
-    /* This isn't used, but return it for completeness. */
-    return m;
-}
-
 static void
-fe_spec_magnitude(fe_t * fe)
+fe_spec_magnitude(fe_t * fe, frame_t * frames, int32 n_frames)
 {
-    frame_t *fft;
-    powspec_t *spec;
-    int32 j, scale, fftsize;
+    int32 f, j, fftsize, n_spec;
 
-    /* Do FFT and get the scaling factor back (only actually used in
-     * fixed-point).  Note the scaling factor is expressed in bits. */
-    scale = fe_fft_real(fe);
+    /* Do all the FFTs at once. */
+    fe_fft_real(fe, frames, n_frames);
 
-    /* Convenience pointers to make things less awkward below. */
-    fft = fe->frame;
-    spec = fe->spec;
     fftsize = fe->fft_size;
+    n_spec = fftsize / 2 + 1;
+    for (f = 0; f < n_frames; ++f) {
+        /* Convenience pointers to make things less awkward below. */
+        frame_t const *fft = frames + (size_t)f * fftsize;
+        powspec_t *spec = fe->spec + (size_t)f * n_spec;
 
-    /* We need to scale things up the rest of the way to N. */
-    scale = fe->fft_order - scale;
-
-    /* The first point (DC coefficient) has no imaginary part */
-    {
+        /* The first point (DC coefficient) has no imaginary part */
         spec[0] = fft[0] * fft[0];
-    }
-
-    for (j = 1; j <= fftsize / 2; j++) {
-        spec[j] = fft[j] * fft[j] + fft[fftsize - j] * fft[fftsize - j];
+        for (j = 1; j <= fftsize / 2; j++) {
+            spec[j] = fft[j] * fft[j] + fft[fftsize - j] * fft[fftsize - j];
+        }
     }
 }
 
 static void
-fe_mel_spec(fe_t * fe)
+fe_mel_spec(fe_t * fe, int32 n_frames)
 {
-    int whichfilt;
-    powspec_t *spec, *mfspec;
+    int whichfilt, f;
+    int32 n_spec, n_filt;
 
-    /* Convenience poitners. */
-    spec = fe->spec;
-    mfspec = fe->mfspec;
-    for (whichfilt = 0; whichfilt < fe->mel_fb->num_filters; whichfilt++) {
-        int spec_start, filt_start, i;
+    n_spec = fe->fft_size / 2 + 1;
+    n_filt = fe->mel_fb->num_filters;
+    /* Apply each filter to every frame in the block while its
+     * coefficients are in cache. */
+    for (whichfilt = 0; whichfilt < n_filt; whichfilt++) {
+        int spec_start, filt_start, filt_width, i;
+        mfcc_t const *coeffs;
 
         spec_start = fe->mel_fb->spec_start[whichfilt];
         filt_start = fe->mel_fb->filt_start[whichfilt];
-
-        mfspec[whichfilt] = 0;
-        for (i = 0; i < fe->mel_fb->filt_width[whichfilt]; i++)
-            mfspec[whichfilt] +=
-                spec[spec_start + i] * fe->mel_fb->filt_coeffs[filt_start +
-                                                               i];
+        filt_width = fe->mel_fb->filt_width[whichfilt];
+        coeffs = fe->mel_fb->filt_coeffs + filt_start;
+        for (f = 0; f < n_frames; ++f) {
+            powspec_t const *spec = fe->spec + (size_t)f * n_spec + spec_start;
+            powspec_t *mfspec = fe->mfspec + (size_t)f * n_filt + whichfilt;
+
+            *mfspec = 0;
+            for (i = 0; i < filt_width; i++)
+                *mfspec += spec[i] * coeffs[i];
+        }
     }
-
 }
 
 #define LOG_FLOOR 1e-4
 
+static void fe_spec2cep_block(fe_t * fe, const powspec_t * mflogspec,
+                              mfcc_t ** mfcep, int32 n_frames);
+static void fe_dct2_block(fe_t * fe, const powspec_t * mflogspec,
+                          mfcc_t ** mfcep, int32 n_frames, int htk);
+
 static void
-fe_mel_cep(fe_t * fe, mfcc_t * mfcep)
+fe_mel_cep(fe_t * fe, mfcc_t ** mfcep, int32 n_frames)
 {
-    int32 i;
+    int32 i, f, n_filt;
     powspec_t *mfspec;
 
     /* Convenience pointer. */
     mfspec = fe->mfspec;
+    n_filt = fe->mel_fb->num_filters;
 
-    for (i = 0; i < fe->mel_fb->num_filters; ++i) {
+    for (i = 0; i < n_frames * n_filt; ++i) {
         mfspec[i] = log(mfspec[i] + LOG_FLOOR);
     }
 
     /* If we are doing LOG_SPEC, then do nothing. */
     if (fe->log_spec == RAW_LOG_SPEC) {
-        for (i = 0; i < fe->feature_dimension; i++) {
-            mfcep[i] = (mfcc_t) mfspec[i];
+        for (f = 0; f < n_frames; ++f) {
+            for (i = 0; i < fe->feature_dimension; i++) {
+                mfcep[f][i] = (mfcc_t) mfspec[f * n_filt + i];
+            }
         }
     }
     /* For smoothed spectrum, do DCT-II followed by (its inverse) DCT-III */
     else if (fe->log_spec == SMOOTH_LOG_SPEC) {
         /* FIXME: This is probably broken for fixed-point. */
-        fe_dct2(fe, mfspec, mfcep, 0);
-        fe_dct3(fe, mfcep, mfspec);
-        for (i = 0; i < fe->feature_dimension; i++) {
-            mfcep[i] = (mfcc_t) mfspec[i];
+        for (f = 0; f < n_frames; ++f) {
+            powspec_t *mflogspec = mfspec + f * n_filt;
+            fe_dct2(fe, mflogspec, mfcep[f], 0);
+            fe_dct3(fe, mfcep[f], mflogspec);
+            for (i = 0; i < fe->feature_dimension; i++) {
+                mfcep[f][i] = (mfcc_t) mflogspec[i];
+            }
         }
     }
     else if (fe->transform == DCT_II)
-        fe_dct2(fe, mfspec, mfcep, FALSE);
+        fe_dct2_block(fe, mfspec, mfcep, n_frames, FALSE);
     else if (fe->transform == DCT_HTK)
-        fe_dct2(fe, mfspec, mfcep, TRUE);
+        fe_dct2_block(fe, mfspec, mfcep, n_frames, TRUE);
     else
-        fe_spec2cep(fe, mfspec, mfcep);
+        fe_spec2cep_block(fe, mfspec, mfcep, n_frames);
 
     return;
 }
 
-void
-fe_spec2cep(fe_t * fe, const powspec_t * mflogspec, mfcc_t * mfcep)
+/*
+ * The DCTs are done for a block of frames at once, which makes them a
+ * matrix multiplication of the log mel spectra (one row per frame) by
+ * the cosine table.  Each row of the table is applied to every frame
+ * before moving on to the next one.  The sums are accumulated in the
+ * same order as for a single frame, so the results are identical.
+ */
+static void
+fe_spec2cep_block(fe_t * fe, const powspec_t * mflogspec,
+                  mfcc_t ** mfcep, int32 n_frames)
 {
-    int32 i, j, beta;
-
-    /* Compute C0 separately (its basis vector is 1) to avoid
-     * costly multiplications. */
-    mfcep[0] = mflogspec[0] / 2;        /* beta = 0.5 */
-    for (j = 1; j < fe->mel_fb->num_filters; j++)
-        mfcep[0] += mflogspec[j];       /* beta = 1.0 */
-    mfcep[0] /= (frame_t) fe->mel_fb->num_filters;
+    int32 i, j, f, beta, n_filt;
+
+    n_filt = fe->mel_fb->num_filters;
+    for (f = 0; f < n_frames; ++f) {
+        const powspec_t *mfl = mflogspec + (size_t)f * n_filt;
+        /* Compute C0 separately (its basis vector is 1) to avoid
+         * costly multiplications. */
+        mfcep[f][0] = mfl[0] / 2;       /* beta = 0.5 */
+        for (j = 1; j < n_filt; j++)
+            mfcep[f][0] += mfl[j];      /* beta = 1.0 */
+        mfcep[f][0] /= (frame_t) n_filt;
+    }
 
     for (i = 1; i < fe->num_cepstra; ++i) {
-        mfcep[i] = 0;
-        for (j = 0; j < fe->mel_fb->num_filters; j++) {
-            if (j == 0)
-                beta = 1;       /* 0.5 */
-            else
-                beta = 2;       /* 1.0 */
-            mfcep[i] += COSMUL(mflogspec[j],
-                               fe->mel_fb->mel_cosine[i][j]) * beta;
+        mfcc_t const *cosine = fe->mel_fb->mel_cosine[i];
+        for (f = 0; f < n_frames; ++f) {
+            const powspec_t *mfl = mflogspec + (size_t)f * n_filt;
+            mfcc_t *cep = mfcep[f] + i;
+
+            *cep = 0;
+            for (j = 0; j < n_filt; j++) {
+                if (j == 0)
+                    beta = 1;       /* 0.5 */
+                else
+                    beta = 2;       /* 1.0 */
+                *cep += COSMUL(mfl[j], cosine[j]) * beta;
+            }
+            /* Note that this actually normalizes by num_filters, like the
+             * original Sphinx front-end, due to the doubled 'beta' factor
+             * above.  */
+            *cep /= (frame_t) n_filt * 2;
         }
-        /* Note that this actually normalizes by num_filters, like the
-         * original Sphinx front-end, due to the doubled 'beta' factor
-         * above.  */
-        mfcep[i] /= (frame_t) fe->mel_fb->num_filters * 2;
     }
 }
 
 void
-fe_dct2(fe_t * fe, const powspec_t * mflogspec, mfcc_t * mfcep, int htk)
+fe_spec2cep(fe_t * fe, const powspec_t * mflogspec, mfcc_t * mfcep)
 {
-    int32 i, j;
+    fe_spec2cep_block(fe, mflogspec, &mfcep, 1);
+}
 
-    /* Compute C0 separately (its basis vector is 1) to avoid
-     * costly multiplications. */
-    mfcep[0] = mflogspec[0];
-    for (j = 1; j < fe->mel_fb->num_filters; j++)
-        mfcep[0] += mflogspec[j];
-    if (htk)
-        mfcep[0] = COSMUL(mfcep[0], fe->mel_fb->sqrt_inv_2n);
-    else                        /* sqrt(1/N) = sqrt(2/N) * 1/sqrt(2) */
-        mfcep[0] = COSMUL(mfcep[0], fe->mel_fb->sqrt_inv_n);
+static void
+fe_dct2_block(fe_t * fe, const powspec_t * mflogspec,
+              mfcc_t ** mfcep, int32 n_frames, int htk)
+{
+    int32 i, j, f, n_filt;
+
+    n_filt = fe->mel_fb->num_filters;
+    for (f = 0; f < n_frames; ++f) {
+        const powspec_t *mfl = mflogspec + (size_t)f * n_filt;
+        /* Compute C0 separately (its basis vector is 1) to avoid
+         * costly multiplications. */
+        mfcep[f][0] = mfl[0];
+        for (j = 1; j < n_filt; j++)
+            mfcep[f][0] += mfl[j];
+        if (htk)
+            mfcep[f][0] = COSMUL(mfcep[f][0], fe->mel_fb->sqrt_inv_2n);
+        else                    /* sqrt(1/N) = sqrt(2/N) * 1/sqrt(2) */
+            mfcep[f][0] = COSMUL(mfcep[f][0], fe->mel_fb->sqrt_inv_n);
+    }
 
     for (i = 1; i < fe->num_cepstra; ++i) {
-        mfcep[i] = 0;
-        for (j = 0; j < fe->mel_fb->num_filters; j++) {
-            mfcep[i] += COSMUL(mflogspec[j], fe->mel_fb->mel_cosine[i][j]);
+        mfcc_t const *cosine = fe->mel_fb->mel_cosine[i];
+        for (f = 0; f < n_frames; ++f) {
+            const powspec_t *mfl = mflogspec + (size_t)f * n_filt;
+            mfcc_t *cep = mfcep[f] + i;
+
+            *cep = 0;
+            for (j = 0; j < n_filt; j++) {
+                *cep += COSMUL(mfl[j], cosine[j]);
+            }
+            *cep = COSMUL(*cep, fe->mel_fb->sqrt_inv_2n);
         }
-        mfcep[i] = COSMUL(mfcep[i], fe->mel_fb->sqrt_inv_2n);
     }
 }
 
+void
+fe_dct2(fe_t * fe, const powspec_t * mflogspec, mfcc_t * mfcep, int htk)
+{
+    fe_dct2_block(fe, mflogspec, &mfcep, 1, htk);
+}
+
 void
 fe_lifter(fe_t * fe, mfcc_t * mfcep)
 {
@@ -751,13 +687,25 @@ fe_dct3(fe_t * fe, const mfcc_t * mfcep, powspec_t * mflogspec)
 }
 
 int
-fe_write_frame(fe_t * fe, mfcc_t * feat)
+fe_write_frames(fe_t * fe, frame_t * frames, mfcc_t ** feat, int32 n_frames)
 {
-    fe_spec_magnitude(fe);
-    fe_mel_spec(fe);
-    fe_remove_noise(fe);
-    fe_mel_cep(fe, feat);
-    fe_lifter(fe, feat);
+    int32 f;
+
+    assert(n_frames <= FE_MAX_BLOCK);
+    fe_spec_magnitude(fe, frames, n_frames);
+    fe_mel_spec(fe, n_frames);
+    /* Noise removal carries state from one frame to the next. */
+    for (f = 0; f < n_frames; ++f)
+        fe_remove_noise(fe, fe->mfspec + (size_t)f * fe->mel_fb->num_filters);
+    fe_mel_cep(fe, feat, n_frames);
+    for (f = 0; f < n_frames; ++f)
+        fe_lifter(fe, feat[f]);
+
+    return n_frames;
+}
 
-    return 1;
+int
+fe_write_frame(fe_t * fe, mfcc_t * feat)
+{
+    return fe_write_frames(fe, fe->frame, &feat, 1);
 }
@@ -131,6 +131,15 @@
 #include <soundswallower/ckd_alloc.h>
 #include <soundswallower/prim_type.h>
 #include <soundswallower/glist.h>
+#include <soundswallower/simd.h>
+
+#if defined(HAVE_SIMD_X86)
+#include <immintrin.h>
+#elif defined(HAVE_SIMD_NEON)
+#include <arm_neon.h>
+#elif defined(HAVE_SIMD_WASM)
+#include <wasm_simd128.h>
+#endif
 
 #define FEAT_VERSION	"1.0"
 #define FEAT_DCEP_WIN		2
@@ -435,57 +444,187 @@ feat_array_free(mfcc_t ***feat)
     ckd_free_2d((void **)feat);
 }
 
-static void
-feat_s2_4x_cep2feat(feat_t * fcb, mfcc_t ** mfc, mfcc_t ** feat)
+/*
+ * Delta kernels: f = a - b, and f = (a - b) - (c - d).  These are
+ * inlined into the feature functions below, which are in turn
+ * instantiated for each instruction set, so that the common vector
+ * lengths (12 and 13) are known at compile time.  The operations are
+ * the same in every version, so the results are identical.
+ */
+typedef void (*feat_vsub_t)(mfcc_t *f, mfcc_t const *a, mfcc_t const *b,
+                            int32 n);
+typedef void (*feat_vsub2_t)(mfcc_t *f, mfcc_t const *a, mfcc_t const *b,
+                             mfcc_t const *c, mfcc_t const *d, int32 n);
+
+static inline void
+feat_vsub(mfcc_t *f, mfcc_t const *a, mfcc_t const *b, int32 n)
+{
+    int32 i;
+
+    for (i = 0; i < n; i++)
+        f[i] = a[i] - b[i];
+}
+
+static inline void
+feat_vsub2(mfcc_t *f, mfcc_t const *a, mfcc_t const *b,
+           mfcc_t const *c, mfcc_t const *d, int32 n)
 {
-    mfcc_t *f;
-    mfcc_t *w, *_w;
-    mfcc_t *w1, *w_1, *_w1, *_w_1;
     mfcc_t d1, d2;
-    int32 i, j;
+    int32 i;
 
-    assert(fcb);
-    assert(feat_cepsize(fcb) == 13);
-    assert(feat_n_stream(fcb) == 4);
-    assert(feat_stream_len(fcb, 0) == 12);
-    assert(feat_stream_len(fcb, 1) == 24);
-    assert(feat_stream_len(fcb, 2) == 3);
-    assert(feat_stream_len(fcb, 3) == 12);
-    assert(feat_window_size(fcb) == 4);
+    for (i = 0; i < n; i++) {
+        d1 = a[i] - b[i];
+        d2 = c[i] - d[i];
 
-    /* CEP; skip C0 */
-    memcpy(feat[0], mfc[0] + 1, (feat_cepsize(fcb) - 1) * sizeof(mfcc_t));
+        f[i] = d1 - d2;
+    }
+}
 
-    /*
-     * DCEP(SHORT): mfc[2] - mfc[-2]
-     * DCEP(LONG):  mfc[4] - mfc[-4]
-     */
-    w = mfc[2] + 1;             /* +1 to skip C0 */
-    _w = mfc[-2] + 1;
+#if defined(HAVE_SIMD_X86)
+SIMD_TARGET("sse2") static inline void
+feat_vsub_sse2(mfcc_t *f, mfcc_t const *a, mfcc_t const *b, int32 n)
+{
+    int32 i;
 
-    f = feat[1];
-    for (i = 0; i < feat_cepsize(fcb) - 1; i++) /* Short-term */
-        f[i] = w[i] - _w[i];
+    for (i = 0; i + 4 <= n; i += 4)
+        _mm_storeu_ps(f + i, _mm_sub_ps(_mm_loadu_ps(a + i),
+                                        _mm_loadu_ps(b + i)));
+    for (; i < n; i++)
+        f[i] = a[i] - b[i];
+}
 
-    w = mfc[4] + 1;             /* +1 to skip C0 */
-    _w = mfc[-4] + 1;
+SIMD_TARGET("sse2") static inline void
+feat_vsub2_sse2(mfcc_t *f, mfcc_t const *a, mfcc_t const *b,
+                mfcc_t const *c, mfcc_t const *d, int32 n)
+{
+    int32 i;
 
-    for (j = 0; j < feat_cepsize(fcb) - 1; i++, j++)    /* Long-term */
-        f[i] = w[j] - _w[j];
+    for (i = 0; i + 4 <= n; i += 4) {
+        __m128 d1 = _mm_sub_ps(_mm_loadu_ps(a + i), _mm_loadu_ps(b + i));
+        __m128 d2 = _mm_sub_ps(_mm_loadu_ps(c + i), _mm_loadu_ps(d + i));
+        _mm_storeu_ps(f + i, _mm_sub_ps(d1, d2));
+    }
+    for (; i < n; i++)
+        f[i] = (a[i] - b[i]) - (c[i] - d[i]);
+}
 
-    /* D2CEP: (mfc[3] - mfc[-1]) - (mfc[1] - mfc[-3]) */
-    w1 = mfc[3] + 1;            /* Final +1 to skip C0 */
-    _w1 = mfc[-1] + 1;
-    w_1 = mfc[1] + 1;
-    _w_1 = mfc[-3] + 1;
+SIMD_TARGET("avx2") static inline void
+feat_vsub_avx2(mfcc_t *f, mfcc_t const *a, mfcc_t const *b, int32 n)
+{
+    int32 i;
 
-    f = feat[3];
-    for (i = 0; i < feat_cepsize(fcb) - 1; i++) {
-        d1 = w1[i] - _w1[i];
-        d2 = w_1[i] - _w_1[i];
+    for (i = 0; i + 8 <= n; i += 8)
+        _mm256_storeu_ps(f + i, _mm256_sub_ps(_mm256_loadu_ps(a + i),
+                                              _mm256_loadu_ps(b + i)));
+    for (; i + 4 <= n; i += 4)
+        _mm_storeu_ps(f + i, _mm_sub_ps(_mm_loadu_ps(a + i),
+                                        _mm_loadu_ps(b + i)));
+    for (; i < n; i++)
+        f[i] = a[i] - b[i];
+}
 
-        f[i] = d1 - d2;
+SIMD_TARGET("avx2") static inline void
+feat_vsub2_avx2(mfcc_t *f, mfcc_t const *a, mfcc_t const *b,
+                mfcc_t const *c, mfcc_t const *d, int32 n)
+{
+    int32 i;
+
+    for (i = 0; i + 8 <= n; i += 8) {
+        __m256 d1 = _mm256_sub_ps(_mm256_loadu_ps(a + i),
+                                  _mm256_loadu_ps(b + i));
+        __m256 d2 = _mm256_sub_ps(_mm256_loadu_ps(c + i),
+                                  _mm256_loadu_ps(d + i));
+        _mm256_storeu_ps(f + i, _mm256_sub_ps(d1, d2));
     }
+    for (; i + 4 <= n; i += 4) {
+        __m128 d1 = _mm_sub_ps(_mm_loadu_ps(a + i), _mm_loadu_ps(b + i));
+        __m128 d2 = _mm_sub_ps(_mm_loadu_ps(c + i), _mm_loadu_ps(d + i));
+        _mm_storeu_ps(f + i, _mm_sub_ps(d1, d2));
+    }
+    for (; i < n; i++)
+        f[i] = (a[i] - b[i]) - (c[i] - d[i]);
+}
+#endif /* HAVE_SIMD_X86 */
+
+#if defined(HAVE_SIMD_NEON)
+static inline void
+feat_vsub_neon(mfcc_t *f, mfcc_t const *a, mfcc_t const *b, int32 n)
+{
+    int32 i;
+
+    for (i = 0; i + 4 <= n; i += 4)
+        vst1q_f32(f + i, vsubq_f32(vld1q_f32(a + i), vld1q_f32(b + i)));
+    for (; i < n; i++)
+        f[i] = a[i] - b[i];
+}
+
+static inline void
+feat_vsub2_neon(mfcc_t *f, mfcc_t const *a, mfcc_t const *b,
+                mfcc_t const *c, mfcc_t const *d, int32 n)
+{
+    int32 i;
+
+    for (i = 0; i + 4 <= n; i += 4) {
+        float32x4_t d1 = vsubq_f32(vld1q_f32(a + i), vld1q_f32(b + i));
+        float32x4_t d2 = vsubq_f32(vld1q_f32(c + i), vld1q_f32(d + i));
+        vst1q_f32(f + i, vsubq_f32(d1, d2));
+    }
+    for (; i < n; i++)
+        f[i] = (a[i] - b[i]) - (c[i] - d[i]);
+}
+#endif /* HAVE_SIMD_NEON */
+
+#if defined(HAVE_SIMD_WASM)
+static inline void
+feat_vsub_wasm(mfcc_t *f, mfcc_t const *a, mfcc_t const *b, int32 n)
+{
+    int32 i;
+
+    for (i = 0; i + 4 <= n; i += 4)
+        wasm_v128_store(f + i, wasm_f32x4_sub(wasm_v128_load(a + i),
+                                              wasm_v128_load(b + i)));
+    for (; i < n; i++)
+        f[i] = a[i] - b[i];
+}
+
+static inline void
+feat_vsub2_wasm(mfcc_t *f, mfcc_t const *a, mfcc_t const *b,
+                mfcc_t const *c, mfcc_t const *d, int32 n)
+{
+    int32 i;
+
+    for (i = 0; i + 4 <= n; i += 4) {
+        v128_t d1 = wasm_f32x4_sub(wasm_v128_load(a + i),
+                                   wasm_v128_load(b + i));
+        v128_t d2 = wasm_f32x4_sub(wasm_v128_load(c + i),
+                                   wasm_v128_load(d + i));
+        wasm_v128_store(f + i, wasm_f32x4_sub(d1, d2));
+    }
+    for (; i < n; i++)
+        f[i] = (a[i] - b[i]) - (c[i] - d[i]);
+}
+#endif /* HAVE_SIMD_WASM */
+
+static inline void
+feat_s2_4x(mfcc_t ** mfc, mfcc_t ** feat,
+           feat_vsub_t vsub, feat_vsub2_t vsub2)
+{
+    mfcc_t *f;
+    mfcc_t d1, d2;
+
+    /* CEP; skip C0 */
+    memcpy(feat[0], mfc[0] + 1, 12 * sizeof(mfcc_t));
+
+    /*
+     * DCEP(SHORT): mfc[2] - mfc[-2]
+     * DCEP(LONG):  mfc[4] - mfc[-4]
+     * (+1 to skip C0)
+     */
+    vsub(feat[1], mfc[2] + 1, mfc[-2] + 1, 12);
+    vsub(feat[1] + 12, mfc[4] + 1, mfc[-4] + 1, 12);
+
+    /* D2CEP: (mfc[3] - mfc[-1]) - (mfc[1] - mfc[-3]) */
+    vsub2(feat[3], mfc[3] + 1, mfc[-1] + 1, mfc[1] + 1, mfc[-3] + 1, 12);
 
     /* POW: C0, DC0, D2C0; differences computed as above for rest of cep */
     f = feat[2];
@@ -497,36 +636,23 @@ feat_s2_4x_cep2feat(feat_t * fcb, mfcc_t ** mfc, mfcc_t ** feat)
     f[2] = d1 - d2;
 }
 
-
-static void
-feat_s3_1x39_cep2feat(feat_t * fcb, mfcc_t ** mfc, mfcc_t ** feat)
+static inline void
+feat_s3_1x39(mfcc_t ** mfc, mfcc_t ** feat,
+             feat_vsub_t vsub, feat_vsub2_t vsub2)
 {
     mfcc_t *f;
-    mfcc_t *w, *_w;
-    mfcc_t *w1, *w_1, *_w1, *_w_1;
     mfcc_t d1, d2;
-    int32 i;
-
-    assert(fcb);
-    assert(feat_cepsize(fcb) == 13);
-    assert(feat_n_stream(fcb) == 1);
-    assert(feat_stream_len(fcb, 0) == 39);
-    assert(feat_window_size(fcb) == 3);
 
     /* CEP; skip C0 */
-    memcpy(feat[0], mfc[0] + 1, (feat_cepsize(fcb) - 1) * sizeof(mfcc_t));
+    memcpy(feat[0], mfc[0] + 1, 12 * sizeof(mfcc_t));
     /*
-     * DCEP: mfc[2] - mfc[-2];
+     * DCEP: mfc[2] - mfc[-2]; (+1 to skip C0)
      */
-    f = feat[0] + feat_cepsize(fcb) - 1;
-    w = mfc[2] + 1;             /* +1 to skip C0 */
-    _w = mfc[-2] + 1;
-
-    for (i = 0; i < feat_cepsize(fcb) - 1; i++)
-        f[i] = w[i] - _w[i];
+    f = feat[0] + 12;
+    vsub(f, mfc[2] + 1, mfc[-2] + 1, 12);
 
     /* POW: C0, DC0, D2C0 */
-    f += feat_cepsize(fcb) - 1;
+    f += 12;
 
     f[0] = mfc[0][0];
     f[1] = mfc[2][0] - mfc[-2][0];
@@ -537,18 +663,167 @@ feat_s3_1x39_cep2feat(feat_t * fcb, mfcc_t ** mfc, mfcc_t ** feat)
 
     /* D2CEP: (mfc[3] - mfc[-1]) - (mfc[1] - mfc[-3]) */
     f += 3;
+    vsub2(f, mfc[3] + 1, mfc[-1] + 1, mfc[1] + 1, mfc[-3] + 1, 12);
+}
 
-    w1 = mfc[3] + 1;            /* Final +1 to skip C0 */
-    _w1 = mfc[-1] + 1;
-    w_1 = mfc[1] + 1;
-    _w_1 = mfc[-3] + 1;
+static inline void
+feat_1s_c_d_dd(mfcc_t ** mfc, mfcc_t ** feat, int32 cepsize,
+               feat_vsub_t vsub, feat_vsub2_t vsub2)
+{
+    mfcc_t *f;
 
-    for (i = 0; i < feat_cepsize(fcb) - 1; i++) {
-        d1 = w1[i] - _w1[i];
-        d2 = w_1[i] - _w_1[i];
+    /* CEP */
+    memcpy(feat[0], mfc[0], cepsize * sizeof(mfcc_t));
 
-        f[i] = d1 - d2;
-    }
+    /*
+     * DCEP: mfc[w] - mfc[-w], where w = FEAT_DCEP_WIN;
+     */
+    f = feat[0] + cepsize;
+    vsub(f, mfc[FEAT_DCEP_WIN], mfc[-FEAT_DCEP_WIN], cepsize);
+
+    /* 
+     * D2CEP: (mfc[w+1] - mfc[-w+1]) - (mfc[w-1] - mfc[-w-1]), 
+     * where w = FEAT_DCEP_WIN 
+     */
+    f += cepsize;
+    vsub2(f, mfc[FEAT_DCEP_WIN + 1], mfc[-FEAT_DCEP_WIN + 1],
+          mfc[FEAT_DCEP_WIN - 1], mfc[-FEAT_DCEP_WIN - 1], cepsize);
+}
+
+static inline void
+feat_1s_c_d_ld_dd(mfcc_t ** mfc, mfcc_t ** feat, int32 cepsize,
+                  feat_vsub_t vsub, feat_vsub2_t vsub2)
+{
+    mfcc_t *f;
+
+    /* CEP */
+    memcpy(feat[0], mfc[0], cepsize * sizeof(mfcc_t));
+
+    /*
+     * DCEP: mfc[w] - mfc[-w], where w = FEAT_DCEP_WIN;
+     */
+    f = feat[0] + cepsize;
+    vsub(f, mfc[FEAT_DCEP_WIN], mfc[-FEAT_DCEP_WIN], cepsize);
+
+    /*
+     * LDCEP: mfc[w] - mfc[-w], where w = FEAT_DCEP_WIN * 2;
+     */
+    f += cepsize;
+    vsub(f, mfc[FEAT_DCEP_WIN * 2], mfc[-FEAT_DCEP_WIN * 2], cepsize);
+
+    /* 
+     * D2CEP: (mfc[w+1] - mfc[-w+1]) - (mfc[w-1] - mfc[-w-1]), 
+     * where w = FEAT_DCEP_WIN 
+     */
+    f += cepsize;
+    vsub2(f, mfc[FEAT_DCEP_WIN + 1], mfc[-FEAT_DCEP_WIN + 1],
+          mfc[FEAT_DCEP_WIN - 1], mfc[-FEAT_DCEP_WIN - 1], cepsize);
+}
+
+/*
+ * Block versions of the above, for frames mfc[0..nfr-1], which are
+ * instantiated for each instruction set.  The usual 13-dimensional
+ * cepstrum gets its own copy of the loop.
+ */
+#define FEAT_DELTA_BLOCKS(sfx, target, vsub, vsub2)                     \
+target static void                                                      \
+feat_s2_4x_block_##sfx(feat_t *fcb, mfcc_t **mfc, mfcc_t ***feat,       \
+                       int32 nfr)                                       \
+{                                                                       \
+    int32 i;                                                            \
+    (void)fcb;                                                          \
+    for (i = 0; i < nfr; ++i)                                           \
+        feat_s2_4x(mfc + i, feat[i], vsub, vsub2);                      \
+}                                                                       \
+target static void                                                      \
+feat_s3_1x39_block_##sfx(feat_t *fcb, mfcc_t **mfc, mfcc_t ***feat,     \
+                         int32 nfr)                                     \
+{                                                                       \
+    int32 i;                                                            \
+    (void)fcb;                                                          \
+    for (i = 0; i < nfr; ++i)                                           \
+        feat_s3_1x39(mfc + i, feat[i], vsub, vsub2);                    \
+}                                                                       \
+target static void                                                      \
+feat_1s_c_d_dd_block_##sfx(feat_t *fcb, mfcc_t **mfc, mfcc_t ***feat,   \
+                           int32 nfr)                                   \
+{                                                                       \
+    int32 i, cepsize = feat_cepsize(fcb);                               \
+    if (cepsize == 13)                                                  \
+        for (i = 0; i < nfr; ++i)                                       \
+            feat_1s_c_d_dd(mfc + i, feat[i], 13, vsub, vsub2);          \
+    else                                                                \
+        for (i = 0; i < nfr; ++i)                                       \
+            feat_1s_c_d_dd(mfc + i, feat[i], cepsize, vsub, vsub2);     \
+}                                                                       \
+target static void                                                      \
+feat_1s_c_d_ld_dd_block_##sfx(feat_t *fcb, mfcc_t **mfc, mfcc_t ***feat, \
+                              int32 nfr)                                \
+{                                                                       \
+    int32 i, cepsize = feat_cepsize(fcb);                               \
+    if (cepsize == 13)                                                  \
+        for (i = 0; i < nfr; ++i)                                       \
+            feat_1s_c_d_ld_dd(mfc + i, feat[i], 13, vsub, vsub2);       \
+    else                                                                \
+        for (i = 0; i < nfr; ++i)                                       \
+            feat_1s_c_d_ld_dd(mfc + i, feat[i], cepsize, vsub, vsub2);  \
+}                                                                       \
+static const feat_delta_blocks_t feat_delta_blocks_##sfx = {            \
+    feat_s2_4x_block_##sfx,                                             \
+    feat_s3_1x39_block_##sfx,                                           \
+    feat_1s_c_d_dd_block_##sfx,                                         \
+    feat_1s_c_d_ld_dd_block_##sfx                                       \
+};
+
+typedef void (*feat_block_t)(feat_t *fcb, mfcc_t **mfc, mfcc_t ***feat,
+                             int32 nfr);
+typedef struct feat_delta_blocks_s {
+    feat_block_t s2_4x;
+    feat_block_t s3_1x39;
+    feat_block_t c_d_dd;
+    feat_block_t c_d_ld_dd;
+} feat_delta_blocks_t;
+
+FEAT_DELTA_BLOCKS(scalar, , feat_vsub, feat_vsub2)
+#if defined(HAVE_SIMD_X86)
+FEAT_DELTA_BLOCKS(sse2, SIMD_TARGET("sse2"), feat_vsub_sse2, feat_vsub2_sse2)
+FEAT_DELTA_BLOCKS(avx2, SIMD_TARGET("avx2"), feat_vsub_avx2, feat_vsub2_avx2)
+#endif
+#if defined(HAVE_SIMD_NEON)
+FEAT_DELTA_BLOCKS(neon, , feat_vsub_neon, feat_vsub2_neon)
+#endif
+#if defined(HAVE_SIMD_WASM)
+FEAT_DELTA_BLOCKS(wasm, , feat_vsub_wasm, feat_vsub2_wasm)
+#endif
+
+static void
+feat_s2_4x_cep2feat(feat_t * fcb, mfcc_t ** mfc, mfcc_t ** feat)
+{
+    (void)fcb;
+    assert(fcb);
+    assert(feat_cepsize(fcb) == 13);
+    assert(feat_n_stream(fcb) == 4);
+    assert(feat_stream_len(fcb, 0) == 12);
+    assert(feat_stream_len(fcb, 1) == 24);
+    assert(feat_stream_len(fcb, 2) == 3);
+    assert(feat_stream_len(fcb, 3) == 12);
+    assert(feat_window_size(fcb) == 4);
+
+    feat_s2_4x(mfc, feat, feat_vsub, feat_vsub2);
+}
+
+
+static void
+feat_s3_1x39_cep2feat(feat_t * fcb, mfcc_t ** mfc, mfcc_t ** feat)
+{
+    (void)fcb;
+    assert(fcb);
+    assert(feat_cepsize(fcb) == 13);
+    assert(feat_n_stream(fcb) == 1);
+    assert(feat_stream_len(fcb, 0) == 39);
+    assert(feat_window_size(fcb) == 3);
+
+    feat_s3_1x39(mfc, feat, feat_vsub, feat_vsub2);
 }
 
 
@@ -592,103 +867,23 @@ feat_s3_cep_dcep(feat_t * fcb, mfcc_t ** mfc, mfcc_t ** feat)
 static void
 feat_1s_c_d_dd_cep2feat(feat_t * fcb, mfcc_t ** mfc, mfcc_t ** feat)
 {
-    mfcc_t *f;
-    mfcc_t *w, *_w;
-    mfcc_t *w1, *w_1, *_w1, *_w_1;
-    mfcc_t d1, d2;
-    int32 i;
-
     assert(fcb);
     assert(feat_n_stream(fcb) == 1);
     assert(feat_stream_len(fcb, 0) == (uint32)feat_cepsize(fcb) * 3);
     assert(feat_window_size(fcb) == FEAT_DCEP_WIN + 1);
 
-    /* CEP */
-    memcpy(feat[0], mfc[0], feat_cepsize(fcb) * sizeof(mfcc_t));
-
-    /*
-     * DCEP: mfc[w] - mfc[-w], where w = FEAT_DCEP_WIN;
-     */
-    f = feat[0] + feat_cepsize(fcb);
-    w = mfc[FEAT_DCEP_WIN];
-    _w = mfc[-FEAT_DCEP_WIN];
-
-    for (i = 0; i < feat_cepsize(fcb); i++)
-        f[i] = w[i] - _w[i];
-
-    /* 
-     * D2CEP: (mfc[w+1] - mfc[-w+1]) - (mfc[w-1] - mfc[-w-1]), 
-     * where w = FEAT_DCEP_WIN 
-     */
-    f += feat_cepsize(fcb);
-
-    w1 = mfc[FEAT_DCEP_WIN + 1];
-    _w1 = mfc[-FEAT_DCEP_WIN + 1];
-    w_1 = mfc[FEAT_DCEP_WIN - 1];
-    _w_1 = mfc[-FEAT_DCEP_WIN - 1];
-
-    for (i = 0; i < feat_cepsize(fcb); i++) {
-        d1 = w1[i] - _w1[i];
-        d2 = w_1[i] - _w_1[i];
-
-        f[i] = d1 - d2;
-    }
+    feat_1s_c_d_dd(mfc, feat, feat_cepsize(fcb), feat_vsub, feat_vsub2);
 }
 
 static void
 feat_1s_c_d_ld_dd_cep2feat(feat_t * fcb, mfcc_t ** mfc, mfcc_t ** feat)
 {
-    mfcc_t *f;
-    mfcc_t *w, *_w;
-    mfcc_t *w1, *w_1, *_w1, *_w_1;
-    mfcc_t d1, d2;
-    int32 i;
-
     assert(fcb);
     assert(feat_n_stream(fcb) == 1);
     assert(feat_stream_len(fcb, 0) == (uint32)feat_cepsize(fcb) * 4);
     assert(feat_window_size(fcb) == FEAT_DCEP_WIN * 2);
 
-    /* CEP */
-    memcpy(feat[0], mfc[0], feat_cepsize(fcb) * sizeof(mfcc_t));
-
-    /*
-     * DCEP: mfc[w] - mfc[-w], where w = FEAT_DCEP_WIN;
-     */
-    f = feat[0] + feat_cepsize(fcb);
-    w = mfc[FEAT_DCEP_WIN];
-    _w = mfc[-FEAT_DCEP_WIN];
-
-    for (i = 0; i < feat_cepsize(fcb); i++)
-        f[i] = w[i] - _w[i];
-
-    /*
-     * LDCEP: mfc[w] - mfc[-w], where w = FEAT_DCEP_WIN * 2;
-     */
-    f += feat_cepsize(fcb);
-    w = mfc[FEAT_DCEP_WIN * 2];
-    _w = mfc[-FEAT_DCEP_WIN * 2];
-
-    for (i = 0; i < feat_cepsize(fcb); i++)
-        f[i] = w[i] - _w[i];
-
-    /* 
-     * D2CEP: (mfc[w+1] - mfc[-w+1]) - (mfc[w-1] - mfc[-w-1]), 
-     * where w = FEAT_DCEP_WIN 
-     */
-    f += feat_cepsize(fcb);
-
-    w1 = mfc[FEAT_DCEP_WIN + 1];
-    _w1 = mfc[-FEAT_DCEP_WIN + 1];
-    w_1 = mfc[FEAT_DCEP_WIN - 1];
-    _w_1 = mfc[-FEAT_DCEP_WIN - 1];
-
-    for (i = 0; i < feat_cepsize(fcb); i++) {
-        d1 = w1[i] - _w1[i];
-        d2 = w_1[i] - _w_1[i];
-
-        f[i] = d1 - d2;
-    }
+    feat_1s_c_d_ld_dd(mfc, feat, feat_cepsize(fcb), feat_vsub, feat_vsub2);
 }
 
 static void
@@ -715,6 +910,65 @@ feat_copy(feat_t * fcb, mfcc_t ** mfc, mfcc_t ** feat)
     }
 }
 
+int
+feat_set_simd(feat_t *fcb, int level)
+{
+    feat_delta_blocks_t const *blocks = &feat_delta_blocks_scalar;
+
+    switch (level) {
+#if defined(HAVE_SIMD_X86)
+    case SIMD_AVX512:
+    case SIMD_AVX2:
+        blocks = &feat_delta_blocks_avx2;
+        level = SIMD_AVX2;
+        break;
+    case SIMD_SSE2:
+        blocks = &feat_delta_blocks_sse2;
+        break;
+#endif
+#if defined(HAVE_SIMD_NEON)
+    case SIMD_NEON:
+        blocks = &feat_delta_blocks_neon;
+        break;
+#endif
+#if defined(HAVE_SIMD_WASM)
+    case SIMD_WASM:
+        blocks = &feat_delta_blocks_wasm;
+        break;
+#endif
+    default:
+        level = SIMD_NONE;
+    }
+    if (fcb->compute_feat == feat_s2_4x_cep2feat)
+        fcb->compute_feat_block = blocks->s2_4x;
+    else if (fcb->compute_feat == feat_s3_1x39_cep2feat)
+        fcb->compute_feat_block = blocks->s3_1x39;
+    else if (fcb->compute_feat == feat_1s_c_d_dd_cep2feat)
+        fcb->compute_feat_block = blocks->c_d_dd;
+    else if (fcb->compute_feat == feat_1s_c_d_ld_dd_cep2feat)
+        fcb->compute_feat_block = blocks->c_d_ld_dd;
+    else {
+        fcb->compute_feat_block = NULL;
+        level = SIMD_NONE;
+    }
+    fcb->simd = level;
+    return level;
+}
+
+/* Compute features for frames mfc[0..nfr-1]. */
+static void
+feat_compute_block(feat_t *fcb, mfcc_t **mfc, mfcc_t ***feat, int32 nfr)
+{
+    int32 i;
+
+    if (fcb->compute_feat_block) {
+        fcb->compute_feat_block(fcb, mfc, feat, nfr);
+        return;
+    }
+    for (i = 0; i < nfr; ++i)
+        fcb->compute_feat(fcb, mfc + i, feat[i]);
+}
+
 feat_t *
 feat_init(cmd_ln_t *config)
 {
@@ -741,6 +995,7 @@ feat_init_s3file(cmd_ln_t *config, s3file_t *lda)
     cmn_type_t cmn = cmn_type_from_str(cmd_ln_str_r(config,"-cmn"));
     int varnorm = cmd_ln_boolean_r(config, "-varnorm");
     int cepsize = cmd_ln_int32_r(config, "-ceplen");
+    int i;
 
     if (cepsize == 0)
         cepsize = 13;
@@ -896,6 +1151,8 @@ feat_init_s3file(cmd_ln_t *config, s3file_t *lda)
         ckd_free(wd);
     }
 
+    feat_set_simd(fcb, simd_detect());
+
     /* Set up CMN initialization if requested */
     if (cmn != CMN_NONE) {
         fcb->cmn_struct = cmn_init(feat_cepsize(fcb));
@@ -928,9 +1185,12 @@ feat_init_s3file(cmd_ln_t *config, s3file_t *lda)
                                             feat_cepsize(fcb),
                                             sizeof(mfcc_t));
     /* This one is actually just an array of pointers to "flatten out"
-     * wraparounds. */
-    fcb->tmpcepbuf = (mfcc_t** )ckd_calloc(2 * feat_window_size(fcb) + 1,
-                                sizeof(*fcb->tmpcepbuf));
+     * wraparounds, so frames can be used in place in the ring. */
+    fcb->cepring = (mfcc_t **)ckd_calloc(3 * LIVEBUFBLOCKSIZE,
+                                         sizeof(*fcb->cepring));
+    for (i = 0; i < 3 * LIVEBUFBLOCKSIZE; ++i)
+        fcb->cepring[i] = fcb->cepbuf[i % LIVEBUFBLOCKSIZE];
+    fcb->cepring += LIVEBUFBLOCKSIZE;
 
     /* Load LDA. */
     if (lda) {
@@ -981,14 +1241,10 @@ feat_cmn(feat_t *fcb, mfcc_t **mfc, int32 nfr, int32 beginutt, int32 endutt)
 static void
 feat_compute_utt(feat_t *fcb, mfcc_t **mfc, int32 nfr, int32 win, mfcc_t ***feat)
 {
-    int32 i;
-
     cep_dump_dbg(fcb, mfc, nfr, "Incoming features (after padding)");
 
     /* Create feature vectors */
-    for (i = win; i < nfr - win; i++) {
-        fcb->compute_feat(fcb, mfc + i, feat[i - win]);
-    }
+    feat_compute_block(fcb, mfc + win, feat, nfr - win * 2);
 
     feat_print_dbg(fcb, feat, nfr - win * 2, "After dynamic feature computation");
 
@@ -1035,86 +1291,92 @@ feat_s2mfc2feat_block_utt(feat_t * fcb, mfcc_t ** uttcep,
     return nfr;
 }
 
+void
+feat_live_start(feat_t *fcb)
+{
+    fcb->curpos = fcb->bufpos = fcb->wrpos = 0;
+}
+
 int32
-feat_s2mfc2feat_live(feat_t * fcb, mfcc_t ** uttcep, int32 *inout_ncep,
-		     int32 beginutt, int32 endutt, mfcc_t *** ofeat)
+feat_live_pending(feat_t *fcb)
+{
+    return (fcb->wrpos - fcb->bufpos + LIVEBUFBLOCKSIZE) % LIVEBUFBLOCKSIZE;
+}
+
+mfcc_t **
+feat_live_wrbuf(feat_t *fcb, int32 *out_nfr)
 {
-    int32 win, cepsize, nbufcep;
-    int32 i, j, nfeatvec;
+    int32 nbufcep;
+
+    /* Frames from the trailing window onwards are in use, and we
+     * also have to leave space to replicate the last frame at the
+     * end of the utterance. */
+    nbufcep = (fcb->wrpos - fcb->curpos + LIVEBUFBLOCKSIZE) % LIVEBUFBLOCKSIZE;
+    *out_nfr = LIVEBUFBLOCKSIZE - nbufcep - 2 * feat_window_size(fcb);
+    if (*out_nfr < 0)
+        *out_nfr = 0;
+    return fcb->cepring + fcb->wrpos;
+}
+
+void
+feat_live_commit(feat_t *fcb, int32 nfr)
+{
+    fcb->wrpos = (fcb->wrpos + nfr) % LIVEBUFBLOCKSIZE;
+}
+
+int32
+feat_live_process(feat_t *fcb, int32 *inout_ncep,
+                  int32 beginutt, int32 endutt, mfcc_t ***ofeat)
+{
+    int32 win, cepsize, nbufcep, npending;
+    int32 i, nfeatvec;
     int32 zero = 0;
 
     /* Avoid having to check this everywhere. */
     if (inout_ncep == NULL) inout_ncep = &zero;
 
-    /* Special case for entire utterances. */
-    if (beginutt && endutt && *inout_ncep > 0)
-        return feat_s2mfc2feat_block_utt(fcb, uttcep, *inout_ncep, ofeat);
-
     win = feat_window_size(fcb);
     cepsize = feat_cepsize(fcb);
 
-    /* Empty the input buffer on start of utterance. */
+    /* Only consume frames that have been written, and only end the
+     * utterance if all of them are consumed. */
+    npending = feat_live_pending(fcb);
+    if (*inout_ncep > npending)
+        *inout_ncep = npending;
+    if (*inout_ncep < npending)
+        endutt = FALSE;
+
+    /* Empty the buffer on start of utterance. */
     if (beginutt)
-        fcb->bufpos = fcb->curpos;
+        fcb->curpos = fcb->bufpos;
 
     /* Calculate how much data is in the buffer already. */
-    nbufcep = fcb->bufpos - fcb->curpos;
-    if (nbufcep < 0)
-	nbufcep = fcb->bufpos + LIVEBUFBLOCKSIZE - fcb->curpos;
-    /* Add any data that we have to replicate. */
-    if (beginutt && *inout_ncep > 0)
-        nbufcep += win;
-    if (endutt)
-        nbufcep += win;
-
-    /* Only consume as much input as will fit in the buffer. */
-    if (nbufcep + *inout_ncep > LIVEBUFBLOCKSIZE) {
-        /* We also can't overwrite the trailing window, hence the
-         * reason why win is subtracted here. */
-        *inout_ncep = LIVEBUFBLOCKSIZE - nbufcep - win;
-        /* Cancel end of utterance processing. */
-        endutt = FALSE;
-    }
+    nbufcep = (fcb->bufpos - fcb->curpos + LIVEBUFBLOCKSIZE) % LIVEBUFBLOCKSIZE;
 
-    /* FIXME: Don't modify the input! */
-    feat_cmn(fcb, uttcep, *inout_ncep, beginutt, endutt);
+    feat_cmn(fcb, fcb->cepring + fcb->bufpos, *inout_ncep, beginutt, endutt);
 
-    /* Replicate first frame into the first win frames if we're at the
-     * beginning of the utterance and there was some actual input to
-     * deal with.  (FIXME: Not entirely sure why that condition) */
+    /* Replicate first frame into the win frames before it if we're at
+     * the beginning of the utterance and there was some actual input
+     * to deal with.  (FIXME: Not entirely sure why that condition) */
     if (beginutt && *inout_ncep > 0) {
-        for (i = 0; i < win; i++) {
-            memcpy(fcb->cepbuf[fcb->bufpos++], uttcep[0],
+        for (i = 1; i <= win; i++)
+            memcpy(fcb->cepring[fcb->curpos - i], fcb->cepring[fcb->curpos],
                    cepsize * sizeof(mfcc_t));
-            fcb->bufpos %= LIVEBUFBLOCKSIZE;
-        }
-        /* Move the current pointer past this data. */
-        fcb->curpos = fcb->bufpos;
-        nbufcep -= win;
-    }
-
-    /* Copy in frame data to the circular buffer. */
-    for (i = 0; i < *inout_ncep; ++i) {
-        memcpy(fcb->cepbuf[fcb->bufpos++], uttcep[i],
-               cepsize * sizeof(mfcc_t));
-        fcb->bufpos %= LIVEBUFBLOCKSIZE;
-	++nbufcep;
     }
+    fcb->bufpos = (fcb->bufpos + *inout_ncep) % LIVEBUFBLOCKSIZE;
+    nbufcep += *inout_ncep;
 
     /* Replicate last frame into the last win frames if we're at the
      * end of the utterance (even if there was no input, so we can
      * flush the output). */
     if (endutt) {
-        int32 tpos; /* Index of last input frame. */
-        if (fcb->bufpos == 0)
-            tpos = LIVEBUFBLOCKSIZE - 1;
-        else
-            tpos = fcb->bufpos - 1;
-        for (i = 0; i < win; ++i) {
-            memcpy(fcb->cepbuf[fcb->bufpos++], fcb->cepbuf[tpos],
+        for (i = 0; i < win; ++i)
+            memcpy(fcb->cepring[fcb->bufpos + i],
+                   fcb->cepring[fcb->bufpos - 1],
                    cepsize * sizeof(mfcc_t));
-            fcb->bufpos %= LIVEBUFBLOCKSIZE;
-        }
+        fcb->bufpos = (fcb->bufpos + win) % LIVEBUFBLOCKSIZE;
+        fcb->wrpos = fcb->bufpos;
+        nbufcep += win;
     }
 
     /* We have to leave the trailing window of frames. */
@@ -1122,24 +1384,10 @@ feat_s2mfc2feat_live(feat_t * fcb, mfcc_t ** uttcep, int32 *inout_ncep,
     if (nfeatvec <= 0)
         return 0; /* Do nothing. */
 
-    for (i = 0; i < nfeatvec; ++i) {
-        /* Handle wraparound cases. */
-        if (fcb->curpos - win < 0 || fcb->curpos + win >= LIVEBUFBLOCKSIZE) {
-            /* Use tmpcepbuf for this case.  Actually, we just need the pointers. */
-            for (j = -win; j <= win; ++j) {
-                int32 tmppos =
-                    (fcb->curpos + j + LIVEBUFBLOCKSIZE) % LIVEBUFBLOCKSIZE;
-		fcb->tmpcepbuf[win + j] = fcb->cepbuf[tmppos];
-            }
-            fcb->compute_feat(fcb, fcb->tmpcepbuf + win, ofeat[i]);
-        }
-        else {
-            fcb->compute_feat(fcb, fcb->cepbuf + fcb->curpos, ofeat[i]);
-        }
-	/* Move the read pointer forward. */
-        ++fcb->curpos;
-        fcb->curpos %= LIVEBUFBLOCKSIZE;
-    }
+    /* The ring pointers make the window contiguous everywhere. */
+    feat_compute_block(fcb, fcb->cepring + fcb->curpos, ofeat, nfeatvec);
+    /* Move the read pointer forward. */
+    fcb->curpos = (fcb->curpos + nfeatvec) % LIVEBUFBLOCKSIZE;
 
     if (fcb->lda)
         feat_lda_transform(fcb, ofeat, nfeatvec);
@@ -1150,6 +1398,67 @@ feat_s2mfc2feat_live(feat_t * fcb, mfcc_t ** uttcep, int32 *inout_ncep,
     return nfeatvec;
 }
 
+int32
+feat_live_skip(feat_t *fcb, int32 nfr)
+{
+    int32 nkeep, src, i;
+
+    if (nfr > feat_live_pending(fcb))
+        nfr = feat_live_pending(fcb);
+    if (nfr <= 0)
+        return 0;
+
+    /* Move the frames from the trailing window up to the current
+     * position forward over the dropped ones, last first since they
+     * may overlap.  Indices are within the copies of the ring. */
+    nkeep = feat_window_size(fcb)
+        + (fcb->bufpos - fcb->curpos + LIVEBUFBLOCKSIZE) % LIVEBUFBLOCKSIZE;
+    src = fcb->bufpos - nkeep;
+    for (i = nkeep - 1; i >= 0; --i)
+        memcpy(fcb->cepring[src + nfr + i], fcb->cepring[src + i],
+               feat_cepsize(fcb) * sizeof(mfcc_t));
+    fcb->curpos = (fcb->curpos + nfr) % LIVEBUFBLOCKSIZE;
+    fcb->bufpos = (fcb->bufpos + nfr) % LIVEBUFBLOCKSIZE;
+
+    return nfr;
+}
+
+int32
+feat_s2mfc2feat_live(feat_t * fcb, mfcc_t ** uttcep, int32 *inout_ncep,
+		     int32 beginutt, int32 endutt, mfcc_t *** ofeat)
+{
+    mfcc_t **wrbuf;
+    int32 i, cepsize, nfr;
+    int32 zero = 0;
+
+    /* Avoid having to check this everywhere. */
+    if (inout_ncep == NULL) inout_ncep = &zero;
+
+    /* Special case for entire utterances. */
+    if (beginutt && endutt && *inout_ncep > 0)
+        return feat_s2mfc2feat_block_utt(fcb, uttcep, *inout_ncep, ofeat);
+
+    /* Empty the input buffer on start of utterance. */
+    if (beginutt)
+        fcb->wrpos = fcb->bufpos = fcb->curpos;
+
+    /* Only consume as much input as will fit in the buffer. */
+    wrbuf = feat_live_wrbuf(fcb, &nfr);
+    if (*inout_ncep > nfr) {
+        *inout_ncep = nfr;
+        /* Cancel end of utterance processing. */
+        endutt = FALSE;
+    }
+
+    /* Copy in frame data to the circular buffer. */
+    cepsize = feat_cepsize(fcb);
+    for (i = 0; i < *inout_ncep; ++i)
+        memcpy(wrbuf[i], uttcep[i], cepsize * sizeof(mfcc_t));
+    feat_live_commit(fcb, *inout_ncep);
+
+    return feat_live_process(fcb, inout_ncep, beginutt, endutt, ofeat);
+}
+
 void 
 feat_update_stats(feat_t *fcb)
 {
@@ -1175,13 +1484,15 @@ feat_free(feat_t * f)
 
     if (f->cepbuf)
         ckd_free_2d((void **) f->cepbuf);
-    ckd_free(f->tmpcepbuf);
+    if (f->cepring)
+        ckd_free(f->cepring - LIVEBUFBLOCKSIZE);
 
     if (f->name) {
         ckd_free((void *) f->name);
     }
     if (f->lda)
         ckd_free_3d((void ***) f->lda);
+    ckd_free(f->lda_buf);
 
     if (f->stream_len)
         ckd_free(f->stream_len);
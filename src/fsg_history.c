@@ -50,6 +50,7 @@
 
 #include "config.h"
 #include <assert.h>
+#include <stdlib.h>
 
 #include <soundswallower/prim_type.h>
 #include <soundswallower/err.h>
@@ -67,19 +68,7 @@ fsg_history_init(fsg_model_t * fsg, dict_t *dict)
     fsg_history_t *h;
 
     h = (fsg_history_t *) ckd_calloc(1, sizeof(fsg_history_t));
-    h->fsg = fsg;
-    h->entries = blkarray_list_init();
-
-    if (fsg && dict) {
-        h->n_ciphone = bin_mdef_n_ciphone(dict->mdef);
-        h->frame_entries =
-            (glist_t **) ckd_calloc_2d(fsg_model_n_state(fsg),
-                                       bin_mdef_n_ciphone(dict->mdef),
-                                       sizeof(**h->frame_entries));
-    }
-    else {
-        h->frame_entries = NULL;
-    }
+    fsg_history_set_fsg(h, fsg, dict);
 
     return h;
 }
@@ -87,24 +76,15 @@ fsg_history_init(fsg_model_t * fsg, dict_t *dict)
 void
 fsg_history_free(fsg_history_t *h)
 {
-    int32 s, lc, ns, np;
-    gnode_t *gn;
-
-    if (h->fsg) {
-        ns = fsg_model_n_state(h->fsg);
-        np = h->n_ciphone;
-
-        for (s = 0; s < ns; s++) {
-            for (lc = 0; lc < np; lc++) {
-                for (gn = h->frame_entries[s][lc]; gn; gn = gnode_next(gn)) {
-                    ckd_free(gnode_ptr(gn));
-                }
-                glist_free(h->frame_entries[s][lc]);
-            }
-        }
-    }
-    ckd_free_2d(h->frame_entries);
-    blkarray_list_free(h->entries);
+    int32 i;
+
+    for (i = 0; i < h->n_blocks; i++)
+        ckd_free(h->blocks[i]);
+    ckd_free(h->blocks);
+    ckd_free(h->cands);
+    ckd_free(h->frame_entries);
+    ckd_free(h->state_row);
+    ckd_free(h->touched);
     ckd_free(h);
 }
 
@@ -112,23 +92,84 @@ fsg_history_free(fsg_history_t *h)
 void
 fsg_history_set_fsg(fsg_history_t *h, fsg_model_t *fsg, dict_t *dict)
 {
-    if (blkarray_list_n_valid(h->entries) != 0) {
+    int32 s;
+
+    if (h->n_entries != 0) {
         E_WARN("Switching FSG while history not empty; history cleared\n");
-        blkarray_list_reset(h->entries);
+        fsg_history_reset(h);
     }
 
-    if (h->frame_entries)
-        ckd_free_2d((void **) h->frame_entries);
+    ckd_free(h->frame_entries);
     h->frame_entries = NULL;
+    ckd_free(h->state_row);
+    h->state_row = NULL;
+    ckd_free(h->touched);
+    h->touched = NULL;
+    h->n_touched = h->n_rows_alloc = 0;
+    h->n_cands = 0;
     h->fsg = fsg;
 
     if (fsg && dict) {
         h->n_ciphone = bin_mdef_n_ciphone(dict->mdef);
-        h->frame_entries =
-            (glist_t **) ckd_calloc_2d(fsg_model_n_state(fsg),
-                                       bin_mdef_n_ciphone(dict->mdef),
-                                       sizeof(glist_t));
+        h->state_row = ckd_malloc(fsg_model_n_state(fsg)
+                                  * sizeof(*h->state_row));
+        for (s = 0; s < fsg_model_n_state(fsg); s++)
+            h->state_row[s] = -1;
+    }
+}
+
+
+/* Get the list heads for state s, allocating a row for it if needed. */
+static int32 *
+fsg_history_state_heads(fsg_history_t *h, int32 s)
+{
+    int32 row, lc;
+
+    if ((row = h->state_row[s]) == -1) {
+        if (h->n_touched == h->n_rows_alloc) {
+            h->n_rows_alloc = h->n_rows_alloc ? h->n_rows_alloc * 2 : 16;
+            h->frame_entries =
+                ckd_realloc(h->frame_entries,
+                            (size_t)h->n_rows_alloc * h->n_ciphone
+                            * sizeof(*h->frame_entries));
+            h->touched = ckd_realloc(h->touched,
+                                     h->n_rows_alloc * sizeof(*h->touched));
+        }
+        row = h->state_row[s] = h->n_touched;
+        h->touched[h->n_touched++] = s;
+        for (lc = 0; lc < h->n_ciphone; lc++)
+            h->frame_entries[(size_t)row * h->n_ciphone + lc] = -1;
+    }
+    return h->frame_entries + (size_t)row * h->n_ciphone;
+}
+
+
+/* Add an entry to the end of the history table. */
+static fsg_hist_entry_t *
+fsg_history_append(fsg_history_t *h)
+{
+    int32 blk = h->n_entries >> FSG_HIST_BLKSHIFT;
+
+    if (blk == h->n_blocks) {
+        h->blocks = ckd_realloc(h->blocks,
+                                (h->n_blocks + 1) * sizeof(*h->blocks));
+        h->blocks[h->n_blocks++] =
+            ckd_malloc(FSG_HIST_BLKSIZE * sizeof(**h->blocks));
     }
+    return &h->blocks[blk][h->n_entries++ & (FSG_HIST_BLKSIZE - 1)];
+}
+
+
+/* Allocate a candidate entry, returning its index in h->cands. */
+static int32
+fsg_history_cand_alloc(fsg_history_t *h)
+{
+    if (h->n_cands == h->n_cands_alloc) {
+        h->n_cands_alloc = h->n_cands_alloc ? h->n_cands_alloc * 2 : 256;
+        h->cands = ckd_realloc(h->cands,
+                               h->n_cands_alloc * sizeof(*h->cands));
+    }
+    return h->n_cands++;
 }
 
 
@@ -138,31 +179,29 @@ fsg_history_entry_add(fsg_history_t * h,
                       int32 frame, int32 score, int32 pred,
                       int32 lc, fsg_pnode_ctxt_t rc)
 {
-    fsg_hist_entry_t *entry, *new_entry;
-    int32 s;
-    gnode_t *gn, *prev_gn;
+    fsg_hist_entry_t *entry;
+    int32 *heads;
+    int32 s, c, prev, new_c;
 
     /* Skip the optimization for the initial dummy entries; always enter them */
     if (frame < 0) {
-        new_entry =
-            (fsg_hist_entry_t *) ckd_calloc(1, sizeof(fsg_hist_entry_t));
-        new_entry->fsglink = link;
-        new_entry->frame = frame;
-        new_entry->score = score;
-        new_entry->pred = pred;
-        new_entry->lc = lc;
-        new_entry->rc = rc;
-
-        blkarray_list_append(h->entries, (void *) new_entry);
+        entry = fsg_history_append(h);
+        entry->fsglink = link;
+        entry->frame = frame;
+        entry->score = score;
+        entry->pred = pred;
+        entry->lc = lc;
+        entry->rc = rc;
         return;
     }
 
     s = fsg_link_to_state(link);
+    heads = fsg_history_state_heads(h, s);
 
     /* Locate where this entry should be inserted in frame_entries[s][lc] */
-    prev_gn = NULL;
-    for (gn = h->frame_entries[s][lc]; gn; gn = gnode_next(gn)) {
-        entry = (fsg_hist_entry_t *) gnode_ptr(gn);
+    prev = -1;
+    for (c = heads[lc]; c != -1; c = h->cands[c].next) {
+        entry = &h->cands[c].entry;
 
         if (score BETTER_THAN entry->score)
             break;              /* Found where to insert new entry */
@@ -171,47 +210,52 @@ fsg_history_entry_add(fsg_history_t * h,
         if (FSG_PNODE_CTXT_SUB(&rc, &(entry->rc)) == 0)
             return;             /* rc set reduced to 0; new entry can be ignored */
 
-        prev_gn = gn;
+        prev = c;
     }
 
-    /* Create new entry after prev_gn (if prev_gn is NULL, at head) */
-    new_entry =
-        (fsg_hist_entry_t *) ckd_calloc(1, sizeof(fsg_hist_entry_t));
-    new_entry->fsglink = link;
-    new_entry->frame = frame;
-    new_entry->score = score;
-    new_entry->pred = pred;
-    new_entry->lc = lc;
-    new_entry->rc = rc;         /* Note: rc set must be non-empty at this point */
-
-    if (!prev_gn) {
-        h->frame_entries[s][lc] = glist_add_ptr(h->frame_entries[s][lc],
-                                                (void *) new_entry);
-        prev_gn = h->frame_entries[s][lc];
-    }
+    /* Create new entry after prev (if prev is -1, at head).  Note
+     * that this may move h->cands. */
+    new_c = fsg_history_cand_alloc(h);
+    entry = &h->cands[new_c].entry;
+    entry->fsglink = link;
+    entry->frame = frame;
+    entry->score = score;
+    entry->pred = pred;
+    entry->lc = lc;
+    entry->rc = rc;             /* Note: rc set must be non-empty at this point */
+    h->cands[new_c].next = c;
+    if (prev == -1)
+        heads[lc] = new_c;
     else
-        prev_gn = glist_insert_ptr(prev_gn, (void *) new_entry);
+        h->cands[prev].next = new_c;
 
     /*
      * Update the rc set of all the remaining entries in the list.  At this
-     * point, gn is the entry, if any, immediately following new entry.
+     * point, c is the entry, if any, immediately following new entry.
      */
-    while (gn) {
-        entry = (fsg_hist_entry_t *) gnode_ptr(gn);
+    prev = new_c;
+    while (c != -1) {
+        entry = &h->cands[c].entry;
 
         if (FSG_PNODE_CTXT_SUB(&(entry->rc), &rc) == 0) {
-            /* rc set of entry reduced to 0; can prune this entry */
-            ckd_free((void *) entry);
-            gn = gnode_free(gn, prev_gn);
+            /* rc set of entry reduced to 0; can prune this entry
+             * (its space is reclaimed at the end of the frame) */
+            c = h->cands[prev].next = h->cands[c].next;
         }
         else {
-            prev_gn = gn;
-            gn = gnode_next(gn);
+            prev = c;
+            c = h->cands[c].next;
         }
     }
 }
 
 
+static int
+cmp_state(void const *a, void const *b)
+{
+    return *(int32 const *)a - *(int32 const *)b;
+}
+
 /*
  * Transfer the surviving history entries for this frame into the permanent
  * history table.
@@ -219,63 +263,56 @@ fsg_history_entry_add(fsg_history_t * h,
 void
 fsg_history_end_frame(fsg_history_t * h)
 {
-    int32 s, lc, ns, np;
-    gnode_t *gn;
-    fsg_hist_entry_t *entry;
+    int32 i, s, lc, np, c, *heads;
 
-    ns = fsg_model_n_state(h->fsg);
     np = h->n_ciphone;
 
-    for (s = 0; s < ns; s++) {
+    /* Keep the entries in the same order as a full scan would. */
+    qsort(h->touched, h->n_touched, sizeof(*h->touched), cmp_state);
+    for (i = 0; i < h->n_touched; i++) {
+        s = h->touched[i];
+        heads = h->frame_entries + (size_t)h->state_row[s] * np;
         for (lc = 0; lc < np; lc++) {
-            for (gn = h->frame_entries[s][lc]; gn; gn = gnode_next(gn)) {
-                entry = (fsg_hist_entry_t *) gnode_ptr(gn);
-                blkarray_list_append(h->entries, (void *) entry);
-            }
-
-            glist_free(h->frame_entries[s][lc]);
-            h->frame_entries[s][lc] = NULL;
+            for (c = heads[lc]; c != -1; c = h->cands[c].next)
+                *fsg_history_append(h) = h->cands[c].entry;
         }
+        h->state_row[s] = -1;
     }
+    h->n_touched = 0;
+    h->n_cands = 0;
 }
 
 
 fsg_hist_entry_t *
 fsg_history_entry_get(fsg_history_t * h, int32 id)
 {
-    return ((fsg_hist_entry_t *) blkarray_list_get(h->entries, id));
+    if (id < 0 || id >= h->n_entries)
+        return NULL;
+    return &h->blocks[id >> FSG_HIST_BLKSHIFT][id & (FSG_HIST_BLKSIZE - 1)];
 }
 
 
 void
 fsg_history_reset(fsg_history_t * h)
 {
-    blkarray_list_reset(h->entries);
+    h->n_entries = 0;
 }
 
 
 int32
 fsg_history_n_entries(fsg_history_t * h)
 {
-    return (blkarray_list_n_valid(h->entries));
+    return h->n_entries;
 }
 
 void
 fsg_history_utt_start(fsg_history_t * h)
 {
-    int32 s, lc, ns, np;
-
-    assert(blkarray_list_n_valid(h->entries) == 0);
-    assert(h->frame_entries);
-
-    ns = fsg_model_n_state(h->fsg);
-    np = h->n_ciphone;
-
-    for (s = 0; s < ns; s++) {
-        for (lc = 0; lc < np; lc++) {
-            assert(h->frame_entries[s][lc] == NULL);
-        }
-    }
+    (void)h;
+    assert(h->n_entries == 0);
+    assert(h->n_cands == 0);
+    assert(h->n_touched == 0);
+    assert(h->state_row);
 }
 
 void
@@ -290,7 +327,7 @@ fsg_history_print(fsg_history_t *h, dict_t *dict)
     int bpidx, bp;
     
     (void)dict;
-    for (bpidx = 0; bpidx < blkarray_list_n_valid(h->entries); bpidx++) {
+    for (bpidx = 0; bpidx < h->n_entries; bpidx++) {
         bp = bpidx;
         printf("History entry: ");
         while (bp > 0) {
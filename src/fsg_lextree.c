@@ -205,6 +205,54 @@ fsg_lextree_lc_rc(fsg_lextree_t *lextree)
     }
 }
 
+/*
+ * Flatten the root lists and the null transitions of each state into
+ * contiguous arrays, so that the search doesn't have to chase sibling
+ * pointers or iterate over hash tables for them.  Both keep the order
+ * in which they were previously visited.
+ */
+static void
+fsg_lextree_build_csr(fsg_lextree_t *lextree)
+{
+    fsg_model_t *fsg = lextree->fsg;
+    int32 s, n_root, n_null;
+    fsg_pnode_t *pn;
+    fsg_arciter_t *itor;
+
+    lextree->root_start = ckd_calloc(fsg_model_n_state(fsg) + 1,
+                                     sizeof(*lextree->root_start));
+    lextree->null_start = ckd_calloc(fsg_model_n_state(fsg) + 1,
+                                     sizeof(*lextree->null_start));
+    n_root = n_null = 0;
+    for (s = 0; s < fsg_model_n_state(fsg); s++) {
+        lextree->root_start[s] = n_root;
+        lextree->null_start[s] = n_null;
+        for (pn = lextree->root[s]; pn; pn = pn->sibling)
+            ++n_root;
+        for (itor = fsg_model_arcs(fsg, s); itor;
+             itor = fsg_arciter_next(itor)) {
+            if (fsg_link_wid(fsg_arciter_get(itor)) == -1)
+                ++n_null;
+        }
+    }
+    lextree->root_start[s] = n_root;
+    lextree->null_start[s] = n_null;
+
+    lextree->roots = ckd_calloc(n_root + 1, sizeof(*lextree->roots));
+    lextree->null_arcs = ckd_calloc(n_null + 1, sizeof(*lextree->null_arcs));
+    n_root = n_null = 0;
+    for (s = 0; s < fsg_model_n_state(fsg); s++) {
+        for (pn = lextree->root[s]; pn; pn = pn->sibling)
+            lextree->roots[n_root++] = pn;
+        for (itor = fsg_model_arcs(fsg, s); itor;
+             itor = fsg_arciter_next(itor)) {
+            fsg_link_t *l = fsg_arciter_get(itor);
+            if (fsg_link_wid(l) == -1)
+                lextree->null_arcs[n_null++] = l;
+        }
+    }
+}
+
 /*
  * For now, allocate the entire lextree statically.
  */
@@ -249,6 +297,8 @@ fsg_lextree_init(fsg_model_t * fsg, dict_t *dict, dict2pid_t *d2p,
                 ++n_leaves;
         }
     }
+    fsg_lextree_build_csr(lextree);
+
     E_INFO("%d HMM nodes in lextree (%d leaves)\n",
            lextree->n_pnode, n_leaves);
     E_INFO("Allocated %d bytes (%d KiB) for all lextree nodes\n",
@@ -295,6 +345,10 @@ fsg_lextree_free(fsg_lextree_t * lextree)
     ckd_free_2d(lextree->rc);
     ckd_free(lextree->root);
     ckd_free(lextree->alloc_head);
+    ckd_free(lextree->roots);
+    ckd_free(lextree->root_start);
+    ckd_free(lextree->null_arcs);
+    ckd_free(lextree->null_start);
     ckd_free(lextree);
 }
 
@@ -282,6 +282,8 @@ fsg_search_free(ps_search_t *search)
     }
     hmm_context_free(fsgs->hmmctx);
     fsg_model_free(fsgs->fsg);
+    ckd_free(fsgs->pnode_active);
+    ckd_free(fsgs->pnode_active_next);
     ckd_free(fsgs);
 }
 
@@ -305,6 +307,16 @@ fsg_search_reinit(ps_search_t *search, dict_t *dict, dict2pid_t *d2p)
                                      ps_search_acmod(fsgs)->mdef,
                                      fsgs->hmmctx, fsgs->wip, fsgs->pip);
 
+    /* Active lists can hold every pnode, so they never need to grow
+     * while decoding. */
+    fsgs->n_pnode_alloc = fsg_lextree_n_pnode(fsgs->lextree);
+    fsgs->pnode_active = ckd_realloc(fsgs->pnode_active,
+                                     (fsgs->n_pnode_alloc + 1)
+                                     * sizeof(*fsgs->pnode_active));
+    fsgs->pnode_active_next = ckd_realloc(fsgs->pnode_active_next,
+                                          (fsgs->n_pnode_alloc + 1)
+                                          * sizeof(*fsgs->pnode_active_next));
+
     /* Inform the history module of the new fsg */
     fsg_history_set_fsg(fsgs->history, fsgs->fsg, dict);
 
@@ -312,17 +324,41 @@ fsg_search_reinit(ps_search_t *search, dict_t *dict, dict2pid_t *d2p)
 }
 
 
+/*
+ * Add a pnode to the active list for the next frame.
+ */
+static void
+fsg_search_activate_next(fsg_search_t *fsgs, fsg_pnode_t *pnode)
+{
+    assert(fsgs->n_pnode_active_next < fsgs->n_pnode_alloc);
+    fsgs->pnode_active_next[fsgs->n_pnode_active_next++] = pnode;
+}
+
+/*
+ * Make the next-frame active list the current one.
+ */
+static void
+fsg_search_swap_active(fsg_search_t *fsgs)
+{
+    fsg_pnode_t **tmp = fsgs->pnode_active;
+
+    fsgs->pnode_active = fsgs->pnode_active_next;
+    fsgs->n_pnode_active = fsgs->n_pnode_active_next;
+    fsgs->pnode_active_next = tmp;
+    fsgs->n_pnode_active_next = 0;
+}
+
 static void
 fsg_search_sen_active(fsg_search_t *fsgs)
 {
-    gnode_t *gn;
     fsg_pnode_t *pnode;
     hmm_t *hmm;
+    int32 i;
 
     acmod_clear_active(ps_search_acmod(fsgs));
 
-    for (gn = fsgs->pnode_active; gn; gn = gnode_next(gn)) {
-        pnode = (fsg_pnode_t *) gnode_ptr(gn);
+    for (i = 0; i < fsgs->n_pnode_active; ++i) {
+        pnode = fsgs->pnode_active[i];
         hmm = fsg_pnode_hmmptr(pnode);
         assert(hmm_frame(hmm) == fsgs->frame);
         acmod_activate_hmm(ps_search_acmod(fsgs), hmm);
@@ -337,7 +373,6 @@ fsg_search_sen_active(fsg_search_t *fsgs)
 static void
 fsg_search_hmm_eval(fsg_search_t *fsgs)
 {
-    gnode_t *gn;
     fsg_pnode_t *pnode;
     hmm_t *hmm;
     int32 bestscore;
@@ -345,15 +380,15 @@ fsg_search_hmm_eval(fsg_search_t *fsgs)
 
     bestscore = WORST_SCORE;
 
-    if (!fsgs->pnode_active) {
+    if (fsgs->n_pnode_active == 0) {
         E_ERROR("Frame %d: No active HMM!!\n", fsgs->frame);
         return;
     }
 
-    for (n = 0, gn = fsgs->pnode_active; gn; gn = gnode_next(gn), n++) {
+    for (n = 0; n < fsgs->n_pnode_active; n++) {
         int32 score;
 
-        pnode = (fsg_pnode_t *) gnode_ptr(gn);
+        pnode = fsgs->pnode_active[n];
         hmm = fsg_pnode_hmmptr(pnode);
         assert(hmm_frame(hmm) == fsgs->frame);
 
@@ -434,9 +469,7 @@ fsg_search_pnode_trans(fsg_search_t *fsgs, fsg_pnode_t * pnode)
             /* Incoming score > pruning threshold and > target's existing score */
             if (hmm_frame(&child->hmm) < nf) {
                 /* Child node not yet activated; do so */
-                fsgs->pnode_active_next =
-                    glist_add_ptr(fsgs->pnode_active_next,
-                                  (void *) child);
+                fsg_search_activate_next(fsgs, child);
             }
 
             hmm_enter(&child->hmm, newscore, hmm_out_history(hmm), nf);
@@ -511,28 +544,26 @@ fsg_search_pnode_exit(fsg_search_t *fsgs, fsg_pnode_t * pnode)
 static void
 fsg_search_hmm_prune_prop(fsg_search_t *fsgs)
 {
-    gnode_t *gn;
     fsg_pnode_t *pnode;
     hmm_t *hmm;
     int32 thresh, word_thresh, phone_thresh;
+    int32 i;
 
-    assert(fsgs->pnode_active_next == NULL);
+    assert(fsgs->n_pnode_active_next == 0);
 
     thresh = fsgs->bestscore + fsgs->beam;
     phone_thresh = fsgs->bestscore + fsgs->pbeam;
     word_thresh = fsgs->bestscore + fsgs->wbeam;
 
-    for (gn = fsgs->pnode_active; gn; gn = gnode_next(gn)) {
-        pnode = (fsg_pnode_t *) gnode_ptr(gn);
+    for (i = 0; i < fsgs->n_pnode_active; ++i) {
+        pnode = fsgs->pnode_active[i];
         hmm = fsg_pnode_hmmptr(pnode);
 
         if (hmm_bestscore(hmm) >= thresh) {
             /* Keep this HMM active in the next frame */
             if (hmm_frame(hmm) == fsgs->frame) {
                 hmm_frame(hmm) = fsgs->frame + 1;
-                fsgs->pnode_active_next =
-                    glist_add_ptr(fsgs->pnode_active_next,
-                                  (void *) pnode);
+                fsg_search_activate_next(fsgs, pnode);
             }
             else {
                 assert(hmm_frame(hmm) == fsgs->frame + 1);
@@ -563,8 +594,8 @@ fsg_search_null_prop(fsg_search_t *fsgs)
 {
     int32 bpidx, n_entries, thresh, newscore;
     fsg_hist_entry_t *hist_entry;
-    fsg_link_t *l;
-    int32 s;
+    fsg_link_t *l, **null_arcs;
+    int32 s, i, n_null;
     fsg_model_t *fsg;
 
     fsg = fsgs->fsg;
@@ -573,7 +604,6 @@ fsg_search_null_prop(fsg_search_t *fsgs)
     n_entries = fsg_history_n_entries(fsgs->history);
 
     for (bpidx = fsgs->bpidx_start; bpidx < n_entries; bpidx++) {
-        fsg_arciter_t *itor;
         hist_entry = fsg_history_entry_get(fsgs->history, bpidx);
 
         l = fsg_hist_entry_fsglink(hist_entry);
@@ -587,13 +617,12 @@ fsg_search_null_prop(fsg_search_t *fsgs)
          * transitions.)
          */
         /* Add all links from from_state to dst */
-        for (itor = fsg_model_arcs(fsg, s); itor;
-             itor = fsg_arciter_next(itor)) {
-            fsg_link_t *l = fsg_arciter_get(itor);
-
-            /* FIXME: Need to deal with tag transitions somehow. */
-            if (fsg_link_wid(l) != -1)
-                continue;
+        null_arcs = fsg_lextree_null_arcs(fsgs->lextree, s);
+        n_null = fsg_lextree_n_null_arcs(fsgs->lextree, s);
+        for (i = 0; i < n_null; i++) {
+            /* FIXME: Need to deal with tag transitions somehow
+             * (they are not in null_arcs). */
+            l = null_arcs[i];
             newscore =
                 fsg_hist_entry_score(hist_entry) +
                 (fsg_link_logs2prob(l) >> SENSCR_SHIFT);
@@ -622,8 +651,8 @@ fsg_search_word_trans(fsg_search_t *fsgs)
     fsg_hist_entry_t *hist_entry;
     fsg_link_t *l;
     int32 score, newscore, thresh, nf, d;
-    fsg_pnode_t *root;
-    int32 lc, rc;
+    fsg_pnode_t *root, **roots;
+    int32 lc, rc, i, n_roots;
 
     n_entries = fsg_history_n_entries(fsgs->history);
 
@@ -645,8 +674,10 @@ fsg_search_word_trans(fsg_search_t *fsgs)
         lc = fsg_hist_entry_lc(hist_entry);
 
         /* Transition to all root nodes attached to state d */
-        for (root = fsg_lextree_root(fsgs->lextree, d);
-             root; root = root->sibling) {
+        roots = fsg_lextree_roots(fsgs->lextree, d);
+        n_roots = fsg_lextree_n_roots(fsgs->lextree, d);
+        for (i = 0; i < n_roots; i++) {
+            root = roots[i];
             rc = root->ci_ext;
 
             if ((root->ctxt.bv[lc >> 5] & (1 << (lc & 0x001f))) &&
@@ -664,9 +695,7 @@ fsg_search_word_trans(fsg_search_t *fsgs)
                     && (newscore BETTER_THAN hmm_in_score(&root->hmm))) {
                     if (hmm_frame(&root->hmm) < nf) {
                         /* Newly activated node; add to active list */
-                        fsgs->pnode_active_next =
-                            glist_add_ptr(fsgs->pnode_active_next,
-                                          (void *) root);
+                        fsg_search_activate_next(fsgs, root);
 #if __FSG_DBG__
                         E_INFO
                             ("[%5d] WordTrans bpidx[%d] -> pnode[%08x] (activated)\n",
@@ -695,9 +724,9 @@ fsg_search_step(ps_search_t *search, int frame_idx)
     fsg_search_t *fsgs = (fsg_search_t *)search;
     int16 const *senscr;
     acmod_t *acmod = search->acmod;
-    gnode_t *gn;
     fsg_pnode_t *pnode;
     hmm_t *hmm;
+    int32 i;
 
     /* Activate our HMMs for the current frame if need be. */
     if (!acmod->compallsen)
@@ -740,8 +769,8 @@ fsg_search_step(ps_search_t *search, int frame_idx)
      * Update the active lists, deactivate any currently active HMMs that
      * did not survive into the next frame
      */
-    for (gn = fsgs->pnode_active; gn; gn = gnode_next(gn)) {
-        pnode = (fsg_pnode_t *) gnode_ptr(gn);
+    for (i = 0; i < fsgs->n_pnode_active; ++i) {
+        pnode = fsgs->pnode_active[i];
         hmm = fsg_pnode_hmmptr(pnode);
 
         if (hmm_frame(hmm) == fsgs->frame) {
@@ -753,12 +782,8 @@ fsg_search_step(ps_search_t *search, int frame_idx)
         }
     }
 
-    /* Free the currently active list */
-    glist_free(fsgs->pnode_active);
-
     /* Make the next-frame active list the current one */
-    fsgs->pnode_active = fsgs->pnode_active_next;
-    fsgs->pnode_active_next = NULL;
+    fsg_search_swap_active(fsgs);
 
     /* End of this frame; ready for the next */
     ++fsgs->frame;
@@ -788,8 +813,8 @@ fsg_search_start(ps_search_t *search)
     silcipid = bin_mdef_ciphone_id(ps_search_acmod(fsgs)->mdef, "SIL");
 
     /* Initialize EVERYTHING to be inactive */
-    assert(fsgs->pnode_active == NULL);
-    assert(fsgs->pnode_active_next == NULL);
+    assert(fsgs->n_pnode_active == 0);
+    assert(fsgs->n_pnode_active_next == 0);
 
     fsg_history_reset(fsgs->history);
     fsg_history_utt_start(fsgs->history);
@@ -812,8 +837,7 @@ fsg_search_start(ps_search_t *search)
     fsg_search_word_trans(fsgs);
 
     /* Make the next-frame active list the current one */
-    fsgs->pnode_active = fsgs->pnode_active_next;
-    fsgs->pnode_active_next = NULL;
+    fsg_search_swap_active(fsgs);
 
     ++fsgs->frame;
 
@@ -833,24 +857,15 @@ int
 fsg_search_finish(ps_search_t *search)
 {
     fsg_search_t *fsgs = (fsg_search_t *)search;
-    gnode_t *gn;
-    fsg_pnode_t *pnode;
-    int32 n_hist, cf;
+    int32 i, n_hist, cf;
 
     /* Deactivate all nodes in the current and next-frame active lists */
-    for (gn = fsgs->pnode_active; gn; gn = gnode_next(gn)) {
-        pnode = (fsg_pnode_t *) gnode_ptr(gn);
-        fsg_psubtree_pnode_deactivate(pnode);
-    }
-    for (gn = fsgs->pnode_active_next; gn; gn = gnode_next(gn)) {
-        pnode = (fsg_pnode_t *) gnode_ptr(gn);
-        fsg_psubtree_pnode_deactivate(pnode);
-    }
-
-    glist_free(fsgs->pnode_active);
-    fsgs->pnode_active = NULL;
-    glist_free(fsgs->pnode_active_next);
-    fsgs->pnode_active_next = NULL;
+    for (i = 0; i < fsgs->n_pnode_active; ++i)
+        fsg_psubtree_pnode_deactivate(fsgs->pnode_active[i]);
+    for (i = 0; i < fsgs->n_pnode_active_next; ++i)
+        fsg_psubtree_pnode_deactivate(fsgs->pnode_active_next[i]);
+    fsgs->n_pnode_active = 0;
+    fsgs->n_pnode_active_next = 0;
 
     fsgs->final = TRUE;
 
@@ -0,0 +1,574 @@
+/* -*- c-basic-offset: 4; indent-tabs-mode: nil -*- */
+/* ====================================================================
+ * Copyright (c) 2022 Carnegie Mellon University.  All rights
+ * reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer. 
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in
+ *    the documentation and/or other materials provided with the
+ *    distribution.
+ *
+ * This work was supported in part by funding from the Defense Advanced 
+ * Research Projects Agency and the National Science Foundation of the 
+ * United States of America, and the CMU Sphinx Speech Consortium.
+ *
+ * THIS SOFTWARE IS PROVIDED BY CARNEGIE MELLON UNIVERSITY ``AS IS'' AND 
+ * ANY EXPRESSED OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, 
+ * THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ * PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL CARNEGIE MELLON UNIVERSITY
+ * NOR ITS EMPLOYEES BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT 
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, 
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY 
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT 
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE 
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ * ====================================================================
+ *
+ */
+/**
+ * @file gausel.c
+ * @brief Gaussian selection shortlists for continuous codebooks.
+ */
+
+#include <string.h>
+#include <stdlib.h>
+
+#include <soundswallower/gausel.h>
+#include <soundswallower/ckd_alloc.h>
+#include <soundswallower/err.h>
+
+#define GAUSEL_MAGIC "GAUSELSL"
+#define GAUSEL_BYTEORDER 0x11223344
+#define GAUSEL_ALIGN 64
+#define GAUSEL_PAD(n) (((n) + GAUSEL_ALIGN - 1) \
+                       & ~(size_t)(GAUSEL_ALIGN - 1))
+/* Maximum number of k-means iterations for the cells. */
+#define GAUSEL_MAX_ITER 20
+
+/**
+ * File header, followed by featlen, weight, cw, radius, start and
+ * list, each one aligned to GAUSEL_ALIGN bytes.
+ */
+typedef struct gausel_hdr_s {
+    char magic[8];     /**< GAUSEL_MAGIC (not NUL-terminated) */
+    uint32 byteorder;  /**< GAUSEL_BYTEORDER in native byte order */
+    int32 n_mgau;
+    int32 n_feat;
+    int32 n_density;
+    int32 n_cw;
+    uint32 n_list;     /**< Total length of all shortlists */
+} gausel_hdr_t;
+
+typedef struct gausel_score_s {
+    float64 score;
+    int32 density;
+} gausel_score_t;
+
+static gausel_t *
+gausel_alloc(int32 n_mgau, int32 n_feat, int32 n_density, int32 n_cw,
+             int32 const *featlen)
+{
+    gausel_t *gs;
+    int32 f;
+
+    gs = ckd_calloc(1, sizeof(*gs));
+    gs->refcount = 1;
+    gs->n_mgau = n_mgau;
+    gs->n_feat = n_feat;
+    gs->n_density = n_density;
+    gs->n_cw = n_cw;
+    gs->featlen = ckd_calloc(n_feat, sizeof(*gs->featlen));
+    gs->featoff = ckd_calloc(n_feat + 1, sizeof(*gs->featoff));
+    for (f = 0; f < n_feat; ++f) {
+        gs->featlen[f] = featlen[f];
+        gs->featoff[f + 1] = gs->featoff[f] + featlen[f];
+    }
+    return gs;
+}
+
+static float32
+gausel_dist(float32 const *w, float32 const *cw, mfcc_t const *x,
+            int32 featlen, float32 worst)
+{
+    float32 d = 0;
+    int32 i;
+
+    for (i = 0; i < featlen && d < worst; ++i) {
+        float32 diff = cw[i] - x[i];
+        d += diff * diff * w[i];
+    }
+    return d;
+}
+
+/* Index of the nearest cell centre to x, and its distance. */
+static int32
+gausel_nearest(float32 const *w, float32 const *cw, int32 n_cw,
+               mfcc_t const *x, int32 featlen, float32 *out_dist)
+{
+    float32 best = 1e30f;
+    int32 c, bestc = 0;
+
+    for (c = 0; c < n_cw; ++c) {
+        float32 d = gausel_dist(w, cw + c * featlen, x, featlen, best);
+        if (d < best) {
+            best = d;
+            bestc = c;
+        }
+    }
+    *out_dist = best;
+    return bestc;
+}
+
+/* Divide one stream into cells with k-means over all of the means,
+ * weighting the dimensions by the average (precomputed) inverse
+ * variance, so that distances are in the same units as scores. */
+static void
+gausel_train(gausel_t *gs, gauden_t *g, int32 f)
+{
+    int32 featlen = gs->featlen[f];
+    int32 n_pts = g->n_mgau * g->n_density;
+    float32 *w = gs->weight + gs->featoff[f];
+    float32 *cw = gs->cw + (size_t)gs->n_cw * gs->featoff[f];
+    float32 *radius = gs->radius + (size_t)f * gs->n_cw;
+    float64 *sum;
+    int32 *count, *assign;
+    int32 c, p, i, iter;
+
+    for (p = 0; p < n_pts; ++p) {
+        mfcc_t const *var = g->var[p / g->n_density][f][p % g->n_density];
+        for (i = 0; i < featlen; ++i)
+            w[i] += var[i];
+    }
+    for (i = 0; i < featlen; ++i)
+        w[i] /= n_pts;
+
+    /* Start from evenly spaced means. */
+    for (c = 0; c < gs->n_cw; ++c) {
+        p = (int32)((int64)c * n_pts / gs->n_cw);
+        for (i = 0; i < featlen; ++i)
+            cw[c * featlen + i] = g->mean[p / g->n_density][f][p % g->n_density][i];
+    }
+
+    sum = ckd_calloc((size_t)gs->n_cw * featlen, sizeof(*sum));
+    count = ckd_calloc(gs->n_cw, sizeof(*count));
+    assign = ckd_calloc(n_pts, sizeof(*assign));
+    for (p = 0; p < n_pts; ++p)
+        assign[p] = -1;
+    for (iter = 0; iter < GAUSEL_MAX_ITER; ++iter) {
+        int32 changed = 0;
+
+        memset(sum, 0, (size_t)gs->n_cw * featlen * sizeof(*sum));
+        memset(count, 0, gs->n_cw * sizeof(*count));
+        for (p = 0; p < n_pts; ++p) {
+            mfcc_t const *mean = g->mean[p / g->n_density][f][p % g->n_density];
+            float32 d;
+
+            c = gausel_nearest(w, cw, gs->n_cw, mean, featlen, &d);
+            if (c != assign[p]) {
+                assign[p] = c;
+                ++changed;
+            }
+            ++count[c];
+            for (i = 0; i < featlen; ++i)
+                sum[c * featlen + i] += mean[i];
+        }
+        E_INFO("Stream %d iteration %d: %d means changed cells\n",
+               f, iter, changed);
+        if (changed == 0)
+            break;
+        /* Empty cells just stay where they are. */
+        for (c = 0; c < gs->n_cw; ++c) {
+            if (count[c] == 0)
+                continue;
+            for (i = 0; i < featlen; ++i)
+                cw[c * featlen + i] = (float32)(sum[c * featlen + i] / count[c]);
+        }
+    }
+    for (p = 0; p < n_pts; ++p) {
+        mfcc_t const *mean = g->mean[p / g->n_density][f][p % g->n_density];
+        float32 d;
+
+        c = gausel_nearest(w, cw, gs->n_cw, mean, featlen, &d);
+        if (d > radius[c])
+            radius[c] = d;
+    }
+    ckd_free(sum);
+    ckd_free(count);
+    ckd_free(assign);
+}
+
+static int
+gausel_score_cmp(const void *a, const void *b)
+{
+    gausel_score_t const *sa = (gausel_score_t const *)a;
+    gausel_score_t const *sb = (gausel_score_t const *)b;
+
+    if (sa->score > sb->score)
+        return -1;
+    if (sa->score < sb->score)
+        return 1;
+    return sa->density - sb->density;
+}
+
+gausel_t *
+gausel_build(gauden_t *g, int32 n_cw, float64 beam, int32 min_short)
+{
+    gausel_t *gs;
+    gausel_score_t *scores;
+    float64 logbeam;
+    size_t max_list;
+    int32 f, c, m, d, i;
+
+    if (g->n_density > 65536) {
+        E_ERROR("Too many densities for Gaussian selection: %d\n",
+                g->n_density);
+        return NULL;
+    }
+    if (n_cw <= 0 || beam <= 0.0 || beam > 1.0) {
+        E_ERROR("Invalid Gaussian selection parameters: %d cells, beam %g\n",
+                n_cw, beam);
+        return NULL;
+    }
+    if (n_cw > g->n_mgau * g->n_density)
+        n_cw = g->n_mgau * g->n_density;
+    if (min_short > g->n_density)
+        min_short = g->n_density;
+    if (min_short < 1)
+        min_short = 1;
+    logbeam = -logmath_log(g->lmath, beam);
+
+    gs = gausel_alloc(g->n_mgau, g->n_feat, g->n_density, n_cw, g->featlen);
+    gs->weight = ckd_calloc(gs->featoff[g->n_feat], sizeof(*gs->weight));
+    gs->cw = ckd_calloc((size_t)n_cw * gs->featoff[g->n_feat], sizeof(*gs->cw));
+    gs->radius = ckd_calloc((size_t)g->n_feat * n_cw, sizeof(*gs->radius));
+    gs->start = ckd_calloc((size_t)g->n_feat * n_cw * g->n_mgau + 1,
+                           sizeof(*gs->start));
+    max_list = (size_t)g->n_feat * n_cw * g->n_mgau * g->n_density;
+    gs->list = ckd_calloc(max_list, sizeof(*gs->list));
+    scores = ckd_calloc(g->n_density, sizeof(*scores));
+
+    i = 0;
+    for (f = 0; f < g->n_feat; ++f) {
+        int32 featlen = g->featlen[f];
+
+        gausel_train(gs, g, f);
+        for (c = 0; c < n_cw; ++c) {
+            float32 const *x = gs->cw + (size_t)n_cw * gs->featoff[f] + c * featlen;
+            for (m = 0; m < g->n_mgau; ++m, ++i) {
+                uint32 n, pos = gs->start[i];
+
+                for (d = 0; d < g->n_density; ++d) {
+                    mfcc_t const *mean = g->mean[m][f][d];
+                    mfcc_t const *var = g->var[m][f][d];
+                    float64 score = g->det[m][f][d];
+                    int32 j;
+
+                    for (j = 0; j < featlen; ++j) {
+                        float64 diff = x[j] - mean[j];
+                        score -= diff * diff * var[j];
+                    }
+                    scores[d].score = score;
+                    scores[d].density = d;
+                }
+                /* Best first, which also makes early exit more likely. */
+                qsort(scores, g->n_density, sizeof(*scores), gausel_score_cmp);
+                for (n = 0; n < (uint32)g->n_density; ++n) {
+                    if (n >= (uint32)min_short
+                        && scores[n].score < scores[0].score - logbeam)
+                        break;
+                    gs->list[pos + n] = scores[n].density;
+                }
+                gs->start[i + 1] = pos + n;
+            }
+        }
+    }
+    ckd_free(scores);
+    gs->list = ckd_realloc(gs->list, gs->start[i] * sizeof(*gs->list));
+    E_INFO("Gaussian selection: %d cells, %.1f densities per shortlist\n",
+           n_cw, (double)gs->start[i] / i);
+    return gs;
+}
+
+/* Get the next aligned array from a mapped file. */
+static void *
+gausel_section(s3file_t *s, size_t *pos, size_t size)
+{
+    size_t len = s->end - (const char *)s->buf;
+    void *ptr;
+
+    *pos = GAUSEL_PAD(*pos);
+    if (*pos + size > len) {
+        E_ERROR("Gaussian selection shortlists truncated\n");
+        return NULL;
+    }
+    ptr = (char *)s->buf + *pos;
+    *pos += size;
+    return ptr;
+}
+
+gausel_t *
+gausel_init_s3file(s3file_t *s)
+{
+    gausel_hdr_t hdr;
+    gausel_t *gs;
+    int32 *featlen;
+    int64 veclen;
+    size_t pos, n_start, i;
+    int32 f;
+
+    if ((size_t)(s->end - (const char *)s->buf) < sizeof(hdr)) {
+        E_ERROR("Gaussian selection shortlists truncated\n");
+        return NULL;
+    }
+    memcpy(&hdr, s->buf, sizeof(hdr));
+    if (memcmp(hdr.magic, GAUSEL_MAGIC, sizeof(hdr.magic)) != 0) {
+        E_ERROR("Not a set of Gaussian selection shortlists\n");
+        return NULL;
+    }
+    if (hdr.byteorder != GAUSEL_BYTEORDER) {
+        E_ERROR("Gaussian selection shortlists have the wrong byte order\n");
+        return NULL;
+    }
+    if (hdr.n_mgau <= 0 || hdr.n_feat <= 0
+        || hdr.n_density <= 0 || hdr.n_cw <= 0) {
+        E_ERROR("Invalid dimensions for Gaussian selection: %d x %d x %d x %d\n",
+                hdr.n_mgau, hdr.n_feat, hdr.n_density, hdr.n_cw);
+        return NULL;
+    }
+    /* Shortlist entries are 16-bit density indices. */
+    if (hdr.n_density > 65536) {
+        E_ERROR("Too many densities for Gaussian selection: %d\n",
+                hdr.n_density);
+        return NULL;
+    }
+    pos = sizeof(hdr);
+    if ((featlen = gausel_section(s, &pos, hdr.n_feat * sizeof(int32))) == NULL)
+        return NULL;
+    veclen = 0;
+    for (f = 0; f < hdr.n_feat; ++f) {
+        if (featlen[f] <= 0) {
+            E_ERROR("Invalid dimension for stream %d: %d\n", f, featlen[f]);
+            return NULL;
+        }
+        veclen += featlen[f];
+    }
+    if (veclen > MAX_INT32) {
+        E_ERROR("Invalid feature dimension for Gaussian selection\n");
+        return NULL;
+    }
+    gs = gausel_alloc(hdr.n_mgau, hdr.n_feat, hdr.n_density, hdr.n_cw, featlen);
+    gs->s3f = s3file_retain(s);
+    n_start = (size_t)hdr.n_feat * hdr.n_cw * hdr.n_mgau + 1;
+    if ((gs->weight = gausel_section(s, &pos, gs->featoff[hdr.n_feat]
+                                     * sizeof(float32))) == NULL
+        || (gs->cw = gausel_section(s, &pos, (size_t)hdr.n_cw
+                                    * gs->featoff[hdr.n_feat]
+                                    * sizeof(float32))) == NULL
+        || (gs->radius = gausel_section(s, &pos, (size_t)hdr.n_feat * hdr.n_cw
+                                        * sizeof(float32))) == NULL
+        || (gs->start = gausel_section(s, &pos, n_start
+                                       * sizeof(uint32))) == NULL
+        || (gs->list = gausel_section(s, &pos, (size_t)hdr.n_list
+                                      * sizeof(uint16))) == NULL)
+        goto error_out;
+    if (gs->start[0] != 0 || gs->start[n_start - 1] != hdr.n_list) {
+        E_ERROR("Gaussian selection shortlists are inconsistent\n");
+        goto error_out;
+    }
+    for (i = 1; i < n_start; ++i) {
+        if (gs->start[i] < gs->start[i - 1]) {
+            E_ERROR("Gaussian selection shortlist %d has negative length\n",
+                    (int)(i - 1));
+            goto error_out;
+        }
+    }
+    for (i = 0; i < hdr.n_list; ++i) {
+        if (gs->list[i] >= hdr.n_density) {
+            E_ERROR("Invalid density %d in Gaussian selection shortlists\n",
+                    gs->list[i]);
+            goto error_out;
+        }
+    }
+    return gs;
+error_out:
+    gausel_free(gs);
+    return NULL;
+}
+
+gausel_t *
+gausel_read(const char *path)
+{
+    s3file_t *s;
+    gausel_t *gs;
+
+    if ((s = s3file_map_file(path)) == NULL) {
+        E_ERROR_SYSTEM("Failed to open Gaussian selection shortlists '%s'",
+                       path);
+        return NULL;
+    }
+    gs = gausel_init_s3file(s);
+    s3file_free(s);
+    return gs;
+}
+
+gausel_t *
+gausel_init_config(cmd_ln_t *config, gauden_t *g)
+{
+    const char *path;
+    gausel_t *gs;
+
+    if (!cmd_ln_exists_r(config, "_gausel")
+        || (path = cmd_ln_str_r(config, "_gausel")) == NULL)
+        return NULL;
+    E_INFO("Reading Gaussian selection shortlists: %s\n", path);
+    if ((gs = gausel_read(path)) == NULL) {
+        E_WARN("Evaluating all Gaussians\n");
+        return NULL;
+    }
+    if (gausel_check(gs, g) < 0) {
+        E_WARN("Evaluating all Gaussians\n");
+        gausel_free(gs);
+        return NULL;
+    }
+    return gs;
+}
+
+/* Write one aligned array. */
+static int
+gausel_write_section(FILE *fh, size_t *pos, void const *data, size_t size)
+{
+    static const char zeros[GAUSEL_ALIGN];
+    size_t npad = GAUSEL_PAD(*pos) - *pos;
+
+    if (fwrite(zeros, 1, npad, fh) != npad
+        || fwrite(data, 1, size, fh) != size)
+        return -1;
+    *pos += npad + size;
+    return 0;
+}
+
+long
+gausel_write(gausel_t *gs, FILE *fh)
+{
+    gausel_hdr_t hdr;
+    size_t pos, n_start;
+
+    memset(&hdr, 0, sizeof(hdr));
+    memcpy(hdr.magic, GAUSEL_MAGIC, sizeof(hdr.magic));
+    hdr.byteorder = GAUSEL_BYTEORDER;
+    hdr.n_mgau = gs->n_mgau;
+    hdr.n_feat = gs->n_feat;
+    hdr.n_density = gs->n_density;
+    hdr.n_cw = gs->n_cw;
+    n_start = (size_t)gs->n_feat * gs->n_cw * gs->n_mgau + 1;
+    hdr.n_list = gs->start[n_start - 1];
+
+    pos = 0;
+    if (gausel_write_section(fh, &pos, &hdr, sizeof(hdr)) < 0
+        || gausel_write_section(fh, &pos, gs->featlen,
+                                gs->n_feat * sizeof(int32)) < 0
+        || gausel_write_section(fh, &pos, gs->weight,
+                                gs->featoff[gs->n_feat] * sizeof(float32)) < 0
+        || gausel_write_section(fh, &pos, gs->cw, (size_t)gs->n_cw
+                                * gs->featoff[gs->n_feat]
+                                * sizeof(float32)) < 0
+        || gausel_write_section(fh, &pos, gs->radius, (size_t)gs->n_feat
+                                * gs->n_cw * sizeof(float32)) < 0
+        || gausel_write_section(fh, &pos, gs->start,
+                                n_start * sizeof(uint32)) < 0
+        || gausel_write_section(fh, &pos, gs->list,
+                                hdr.n_list * sizeof(uint16)) < 0) {
+        E_ERROR_SYSTEM("Failed to write Gaussian selection shortlists");
+        return -1;
+    }
+    return (long)pos;
+}
+
+gausel_t *
+gausel_retain(gausel_t *gs)
+{
+    ++gs->refcount;
+    return gs;
+}
+
+int
+gausel_free(gausel_t *gs)
+{
+    if (gs == NULL)
+        return 0;
+    if (--gs->refcount > 0)
+        return gs->refcount;
+    if (gs->s3f)
+        s3file_free(gs->s3f);
+    else {
+        ckd_free(gs->weight);
+        ckd_free(gs->cw);
+        ckd_free(gs->radius);
+        ckd_free(gs->start);
+        ckd_free(gs->list);
+    }
+    ckd_free(gs->featlen);
+    ckd_free(gs->featoff);
+    ckd_free(gs);
+    return 0;
+}
+
+int
+gausel_check(gausel_t *gs, gauden_t *g)
+{
+    int32 f;
+
+    if (gs->n_mgau != g->n_mgau || gs->n_feat != g->n_feat
+        || gs->n_density != g->n_density) {
+        E_ERROR("Gaussian selection is for %d x %d x %d densities, not %d x %d x %d\n",
+                gs->n_mgau, gs->n_feat, gs->n_density,
+                g->n_mgau, g->n_feat, g->n_density);
+        return -1;
+    }
+    for (f = 0; f < g->n_feat; ++f) {
+        if (gs->featlen[f] != g->featlen[f]) {
+            E_ERROR("Dimension of stream %d does not match: %d != %d\n",
+                    f, gs->featlen[f], g->featlen[f]);
+            return -1;
+        }
+    }
+    return 0;
+}
+
+int32
+gausel_select(gausel_t *gs, int32 feat, mfcc_t const *obs, float32 fallback)
+{
+    float32 d;
+    int32 c;
+
+    c = gausel_nearest(gs->weight + gs->featoff[feat],
+                       gs->cw + (size_t)gs->n_cw * gs->featoff[feat],
+                       gs->n_cw, obs, gs->featlen[feat], &d);
+    if (fallback > 0 && d > fallback * gs->radius[feat * gs->n_cw + c])
+        return -1;
+    return c;
+}
+
+uint16 const *
+gausel_shortlist(gausel_t *gs, int32 feat, int32 cw, int32 mgau,
+                 int32 *out_n)
+{
+    size_t i;
+
+    if (cw < 0) {
+        *out_n = 0;
+        return NULL;
+    }
+    i = ((size_t)feat * gs->n_cw + cw) * gs->n_mgau + mgau;
+    *out_n = gs->start[i + 1] - gs->start[i];
+    return gs->list + gs->start[i];
+}
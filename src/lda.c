@@ -54,9 +54,54 @@
 #include <soundswallower/ckd_alloc.h>
 #include <soundswallower/s3file.h>
 #include <soundswallower/err.h>
+#include <soundswallower/simd.h>
+
+#if defined(HAVE_SIMD_X86)
+#include <immintrin.h>
+#elif defined(HAVE_SIMD_NEON)
+#include <arm_neon.h>
+#elif defined(HAVE_SIMD_WASM)
+#include <wasm_simd128.h>
+#endif
 
 #define MATRIX_FILE_VERSION "0.1"
 
+/* Alignment of the transposed matrix and output, in bytes. */
+#define LDA_ALIGN 32
+/* Output dimensions are padded to a multiple of this. */
+#define LDA_LANES 8
+/* Number of frames transformed at once. */
+#define LDA_BLOCK 4
+
+/*
+ * Prepare the first transform for feat_lda_transform(): transpose it
+ * so that each input dimension contributes to a contiguous run of
+ * outputs, and pad the rows to a whole number of vectors.  The
+ * output block for LDA_BLOCK frames goes in the same allocation.
+ */
+static void
+feat_lda_prepare(feat_t *feat)
+{
+    uint32 n = feat->stream_len[0];
+    uint32 dim = feat->out_dim;
+    uint32 j, k;
+    size_t off;
+
+    ckd_free(feat->lda_buf);
+    feat->lda_stride = (dim + LDA_LANES - 1) / LDA_LANES * LDA_LANES;
+    feat->lda_buf = ckd_calloc((size_t)(n + LDA_BLOCK) * feat->lda_stride
+                               * sizeof(float32) + LDA_ALIGN, 1);
+    off = (size_t)feat->lda_buf % LDA_ALIGN;
+    feat->lda_t = (float32 *)((char *)feat->lda_buf
+                              + (off ? LDA_ALIGN - off : 0));
+    feat->lda_out = feat->lda_t + (size_t)n * feat->lda_stride;
+    for (k = 0; k < n; ++k)
+        for (j = 0; j < dim; ++j)
+            feat->lda_t[(size_t)k * feat->lda_stride + j]
+                = feat->lda[0][j][k];
+    feat_lda_set_simd(feat, simd_detect());
+}
+
 int32
 feat_read_lda(feat_t *feat, const char *ldafile, int32 dim)
 {
@@ -118,27 +163,223 @@ feat_read_lda_s3file(feat_t *feat, s3file_t *s, int32 dim)
         dim = m;
     }
     feat->out_dim = dim;
+    feat_lda_prepare(feat);
     return 0;
 }
 
+/*
+ * Matrix-matrix kernels: out[f][j] = sum_k x[f][k] * lda_t[k][j], for
+ * LDA_BLOCK frames and all j < lda_stride.  The sums are accumulated
+ * in order of k with separate multiplies and adds, as in the scalar
+ * version, so all of them give identical results.
+ */
+static void
+lda_gemm(feat_t *fcb, mfcc_t const **x)
+{
+    uint32 n = fcb->stream_len[0];
+    uint32 stride = fcb->lda_stride;
+    uint32 f, j, k;
+
+    memset(fcb->lda_out, 0, LDA_BLOCK * stride * sizeof(*fcb->lda_out));
+    for (f = 0; f < LDA_BLOCK; ++f) {
+        float32 *y = fcb->lda_out + f * stride;
+        for (k = 0; k < n; ++k) {
+            float32 const *a = fcb->lda_t + (size_t)k * stride;
+            for (j = 0; j < stride; ++j)
+                y[j] += MFCCMUL(x[f][k], a[j]);
+        }
+    }
+}
+
+#if defined(HAVE_SIMD_X86)
+SIMD_TARGET("sse2") static void
+lda_gemm_sse2(feat_t *fcb, mfcc_t const **x)
+{
+    uint32 n = fcb->stream_len[0];
+    uint32 stride = fcb->lda_stride;
+    uint32 f, j, k;
+
+    for (j = 0; j < stride; j += 8) {
+        __m128 acc[LDA_BLOCK][2];
+
+        for (f = 0; f < LDA_BLOCK; ++f)
+            acc[f][0] = acc[f][1] = _mm_setzero_ps();
+        for (k = 0; k < n; ++k) {
+            float32 const *a = fcb->lda_t + (size_t)k * stride + j;
+            __m128 a0 = _mm_load_ps(a);
+            __m128 a1 = _mm_load_ps(a + 4);
+            for (f = 0; f < LDA_BLOCK; ++f) {
+                __m128 xk = _mm_set1_ps(x[f][k]);
+                acc[f][0] = _mm_add_ps(acc[f][0], _mm_mul_ps(xk, a0));
+                acc[f][1] = _mm_add_ps(acc[f][1], _mm_mul_ps(xk, a1));
+            }
+        }
+        for (f = 0; f < LDA_BLOCK; ++f) {
+            float32 *y = fcb->lda_out + f * stride + j;
+            _mm_store_ps(y, acc[f][0]);
+            _mm_store_ps(y + 4, acc[f][1]);
+        }
+    }
+}
+
+SIMD_TARGET("avx2") static void
+lda_gemm_avx2(feat_t *fcb, mfcc_t const **x)
+{
+    uint32 n = fcb->stream_len[0];
+    uint32 stride = fcb->lda_stride;
+    uint32 f, j, k;
+
+    for (j = 0; j < stride; j += 8) {
+        __m256 acc[LDA_BLOCK];
+
+        for (f = 0; f < LDA_BLOCK; ++f)
+            acc[f] = _mm256_setzero_ps();
+        for (k = 0; k < n; ++k) {
+            __m256 a = _mm256_load_ps(fcb->lda_t + (size_t)k * stride + j);
+            for (f = 0; f < LDA_BLOCK; ++f)
+                acc[f] = _mm256_add_ps(acc[f],
+                                       _mm256_mul_ps(_mm256_set1_ps(x[f][k]),
+                                                     a));
+        }
+        for (f = 0; f < LDA_BLOCK; ++f)
+            _mm256_store_ps(fcb->lda_out + f * stride + j, acc[f]);
+    }
+}
+#endif /* HAVE_SIMD_X86 */
+
+#if defined(HAVE_SIMD_NEON)
+static void
+lda_gemm_neon(feat_t *fcb, mfcc_t const **x)
+{
+    uint32 n = fcb->stream_len[0];
+    uint32 stride = fcb->lda_stride;
+    uint32 f, j, k;
+
+    for (j = 0; j < stride; j += 8) {
+        float32x4_t acc[LDA_BLOCK][2];
+
+        for (f = 0; f < LDA_BLOCK; ++f)
+            acc[f][0] = acc[f][1] = vdupq_n_f32(0);
+        for (k = 0; k < n; ++k) {
+            float32 const *a = fcb->lda_t + (size_t)k * stride + j;
+            float32x4_t a0 = vld1q_f32(a);
+            float32x4_t a1 = vld1q_f32(a + 4);
+            for (f = 0; f < LDA_BLOCK; ++f) {
+                float32x4_t xk = vdupq_n_f32(x[f][k]);
+                acc[f][0] = vaddq_f32(acc[f][0], vmulq_f32(xk, a0));
+                acc[f][1] = vaddq_f32(acc[f][1], vmulq_f32(xk, a1));
+            }
+        }
+        for (f = 0; f < LDA_BLOCK; ++f) {
+            float32 *y = fcb->lda_out + f * stride + j;
+            vst1q_f32(y, acc[f][0]);
+            vst1q_f32(y + 4, acc[f][1]);
+        }
+    }
+}
+#endif /* HAVE_SIMD_NEON */
+
+#if defined(HAVE_SIMD_WASM)
+static void
+lda_gemm_wasm(feat_t *fcb, mfcc_t const **x)
+{
+    uint32 n = fcb->stream_len[0];
+    uint32 stride = fcb->lda_stride;
+    uint32 f, j, k;
+
+    for (j = 0; j < stride; j += 8) {
+        v128_t acc[LDA_BLOCK][2];
+
+        for (f = 0; f < LDA_BLOCK; ++f)
+            acc[f][0] = acc[f][1] = wasm_f32x4_splat(0);
+        for (k = 0; k < n; ++k) {
+            float32 const *a = fcb->lda_t + (size_t)k * stride + j;
+            v128_t a0 = wasm_v128_load(a);
+            v128_t a1 = wasm_v128_load(a + 4);
+            for (f = 0; f < LDA_BLOCK; ++f) {
+                v128_t xk = wasm_f32x4_splat(x[f][k]);
+                acc[f][0] = wasm_f32x4_add(acc[f][0], wasm_f32x4_mul(xk, a0));
+                acc[f][1] = wasm_f32x4_add(acc[f][1], wasm_f32x4_mul(xk, a1));
+            }
+        }
+        for (f = 0; f < LDA_BLOCK; ++f) {
+            float32 *y = fcb->lda_out + f * stride + j;
+            wasm_v128_store(y, acc[f][0]);
+            wasm_v128_store(y + 4, acc[f][1]);
+        }
+    }
+}
+#endif /* HAVE_SIMD_WASM */
+
+int
+feat_lda_set_simd(feat_t *fcb, int level)
+{
+    switch (level) {
+#if defined(HAVE_SIMD_X86)
+    case SIMD_AVX512:
+    case SIMD_AVX2:
+        level = SIMD_AVX2;
+        break;
+    case SIMD_SSE2:
+        break;
+#endif
+#if defined(HAVE_SIMD_NEON)
+    case SIMD_NEON:
+        break;
+#endif
+#if defined(HAVE_SIMD_WASM)
+    case SIMD_WASM:
+        break;
+#endif
+    default:
+        level = SIMD_NONE;
+    }
+    fcb->lda_simd = level;
+    return level;
+}
+
 void
 feat_lda_transform(feat_t *fcb, mfcc_t ***inout_feat, uint32 nfr)
 {
-    mfcc_t *tmp;
-    uint32 i, j, k;
-
-    tmp = ckd_calloc(fcb->stream_len[0], sizeof(mfcc_t));
-    for (i = 0; i < nfr; ++i) {
-        /* Do the matrix multiplication inline here since fcb->lda
-         * is transposed (eigenvectors in rows not columns). */
-        /* FIXME: In the future we ought to use the BLAS. */
-        memset(tmp, 0, sizeof(mfcc_t) * fcb->stream_len[0]);
-        for (j = 0; j < feat_dimension(fcb); ++j) {
-            for (k = 0; k < fcb->stream_len[0]; ++k) {
-                tmp[j] += MFCCMUL(inout_feat[i][0][k], fcb->lda[0][j][k]);
-            }
+    mfcc_t const *x[LDA_BLOCK];
+    uint32 i, f, nb, dim;
+
+    assert(fcb->lda_t);
+    dim = feat_dimension(fcb);
+    for (i = 0; i < nfr; i += LDA_BLOCK) {
+        nb = nfr - i < LDA_BLOCK ? nfr - i : LDA_BLOCK;
+        /* Repeat the last frame to fill out a partial block. */
+        for (f = 0; f < LDA_BLOCK; ++f)
+            x[f] = inout_feat[i + (f < nb ? f : nb - 1)][0];
+        switch (fcb->lda_simd) {
+#if defined(HAVE_SIMD_X86)
+        case SIMD_AVX2:
+            lda_gemm_avx2(fcb, x);
+            break;
+        case SIMD_SSE2:
+            lda_gemm_sse2(fcb, x);
+            break;
+#endif
+#if defined(HAVE_SIMD_NEON)
+        case SIMD_NEON:
+            lda_gemm_neon(fcb, x);
+            break;
+#endif
+#if defined(HAVE_SIMD_WASM)
+        case SIMD_WASM:
+            lda_gemm_wasm(fcb, x);
+            break;
+#endif
+        default:
+            lda_gemm(fcb, x);
+        }
+        /* Dimensions past the output are zeroed. */
+        for (f = 0; f < nb; ++f) {
+            memcpy(inout_feat[i + f][0], fcb->lda_out + f * fcb->lda_stride,
+                   dim * sizeof(mfcc_t));
+            if (dim < fcb->stream_len[0])
+                memset(inout_feat[i + f][0] + dim, 0,
+                       (fcb->stream_len[0] - dim) * sizeof(mfcc_t));
         }
-        memcpy(inout_feat[i][0], tmp, fcb->stream_len[0] * sizeof(mfcc_t));
     }
-    ckd_free(tmp);
 }
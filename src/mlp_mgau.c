@@ -0,0 +1,701 @@
+/* -*- c-basic-offset: 4; indent-tabs-mode: nil -*- */
+/* ====================================================================
+ * Copyright (c) 2022 Carnegie Mellon University.  All rights
+ * reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer. 
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in
+ *    the documentation and/or other materials provided with the
+ *    distribution.
+ *
+ * This work was supported in part by funding from the Defense Advanced 
+ * Research Projects Agency and the National Science Foundation of the 
+ * United States of America, and the CMU Sphinx Speech Consortium.
+ *
+ * THIS SOFTWARE IS PROVIDED BY CARNEGIE MELLON UNIVERSITY ``AS IS'' AND 
+ * ANY EXPRESSED OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, 
+ * THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ * PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL CARNEGIE MELLON UNIVERSITY
+ * NOR ITS EMPLOYEES BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT 
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, 
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY 
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT 
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE 
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ * ====================================================================
+ *
+ */
+/**
+ * @file mlp_mgau.c Senone scoring with a quantized neural network.
+ */
+
+#include "config.h"
+#include <string.h>
+#include <math.h>
+#include <float.h>
+
+#include <soundswallower/cmd_ln.h>
+#include <soundswallower/ckd_alloc.h>
+#include <soundswallower/err.h>
+#include <soundswallower/prim_type.h>
+#include <soundswallower/mlp_mgau.h>
+#include <soundswallower/simd.h>
+
+#if defined(HAVE_SIMD_X86)
+#include <immintrin.h>
+#elif defined(HAVE_SIMD_NEON)
+#include <arm_neon.h>
+#endif
+
+static ps_mgaufuncs_t mlp_mgau_funcs = {
+    "mlp",
+    mlp_mgau_frame_eval,      /* frame_eval */
+    mlp_mgau_mllr_transform,  /* transform */
+    mlp_mgau_free,            /* free */
+    mlp_mgau_frame_eval_block,/* frame_eval_block */
+    mlp_mgau_share            /* share */
+};
+
+/* Arguments for mlp_mgau_layer_worker() */
+typedef struct mlp_task_s {
+    mlp_mgau_t *s;
+    mlp_layer_t *layer;
+    int32 const *rows;  /* Outputs to compute, or NULL for all of them. */
+    int32 n_rows;
+    int32 n_frames;
+    int relu;
+    float32 *out;       /* n_frames x n_rows */
+} mlp_task_t;
+
+/*
+ * Dot products of one row of weights with the (quantized) inputs for
+ * n_frames frames, which are stride apart.  Both are zero-padded to
+ * stride, which is a multiple of MLP_ALIGN.  The products are at most
+ * 127 * 127, so the sums cannot overflow for any reasonable input
+ * dimension.
+ */
+static void
+dot_scalar(int8 const *w, int16 const *x, int32 stride,
+           int32 n_frames, int32 *out, int32 out_stride)
+{
+    int32 f, i;
+
+    for (f = 0; f < n_frames; ++f, x += stride) {
+        int32 sum = 0;
+        for (i = 0; i < stride; ++i)
+            sum += w[i] * x[i];
+        out[f * out_stride] = sum;
+    }
+}
+
+#if defined(HAVE_SIMD_X86)
+SIMD_TARGET("sse2") static inline int32
+hsum_epi32_sse2(__m128i v)
+{
+    v = _mm_add_epi32(v, _mm_shuffle_epi32(v, _MM_SHUFFLE(1, 0, 3, 2)));
+    v = _mm_add_epi32(v, _mm_shuffle_epi32(v, _MM_SHUFFLE(2, 3, 0, 1)));
+    return _mm_cvtsi128_si32(v);
+}
+
+/* Sign-extend 8 weights to 16 bits (there is no pmovsxbw before SSE4.1). */
+SIMD_TARGET("sse2") static inline __m128i
+load_w_sse2(int8 const *w)
+{
+    __m128i v = _mm_loadl_epi64((const __m128i *)w);
+    return _mm_srai_epi16(_mm_unpacklo_epi8(v, v), 8);
+}
+
+SIMD_TARGET("sse2") static void
+dot_sse2(int8 const *w, int16 const *x, int32 stride,
+         int32 n_frames, int32 *out, int32 out_stride)
+{
+    int32 f, i;
+
+    /* Use each row of weights for four frames at a time. */
+    for (f = 0; f + 4 <= n_frames; f += 4) {
+        int16 const *x0 = x + f * stride, *x1 = x0 + stride;
+        int16 const *x2 = x1 + stride, *x3 = x2 + stride;
+        __m128i s0 = _mm_setzero_si128(), s1 = _mm_setzero_si128();
+        __m128i s2 = _mm_setzero_si128(), s3 = _mm_setzero_si128();
+        for (i = 0; i < stride; i += 8) {
+            __m128i wv = load_w_sse2(w + i);
+            s0 = _mm_add_epi32(s0, _mm_madd_epi16(wv, _mm_loadu_si128((const __m128i *)(x0 + i))));
+            s1 = _mm_add_epi32(s1, _mm_madd_epi16(wv, _mm_loadu_si128((const __m128i *)(x1 + i))));
+            s2 = _mm_add_epi32(s2, _mm_madd_epi16(wv, _mm_loadu_si128((const __m128i *)(x2 + i))));
+            s3 = _mm_add_epi32(s3, _mm_madd_epi16(wv, _mm_loadu_si128((const __m128i *)(x3 + i))));
+        }
+        out[f * out_stride] = hsum_epi32_sse2(s0);
+        out[(f + 1) * out_stride] = hsum_epi32_sse2(s1);
+        out[(f + 2) * out_stride] = hsum_epi32_sse2(s2);
+        out[(f + 3) * out_stride] = hsum_epi32_sse2(s3);
+    }
+    for (; f < n_frames; ++f) {
+        int16 const *x0 = x + f * stride;
+        __m128i s0 = _mm_setzero_si128();
+        for (i = 0; i < stride; i += 8)
+            s0 = _mm_add_epi32(s0, _mm_madd_epi16(load_w_sse2(w + i),
+                                                  _mm_loadu_si128((const __m128i *)(x0 + i))));
+        out[f * out_stride] = hsum_epi32_sse2(s0);
+    }
+}
+
+SIMD_TARGET("avx2") static inline int32
+hsum_epi32_avx2(__m256i v)
+{
+    return hsum_epi32_sse2(_mm_add_epi32(_mm256_castsi256_si128(v),
+                                         _mm256_extracti128_si256(v, 1)));
+}
+
+SIMD_TARGET("avx2") static void
+dot_avx2(int8 const *w, int16 const *x, int32 stride,
+         int32 n_frames, int32 *out, int32 out_stride)
+{
+    int32 f, i;
+
+    for (f = 0; f + 4 <= n_frames; f += 4) {
+        int16 const *x0 = x + f * stride, *x1 = x0 + stride;
+        int16 const *x2 = x1 + stride, *x3 = x2 + stride;
+        __m256i s0 = _mm256_setzero_si256(), s1 = _mm256_setzero_si256();
+        __m256i s2 = _mm256_setzero_si256(), s3 = _mm256_setzero_si256();
+        for (i = 0; i < stride; i += 16) {
+            __m256i wv = _mm256_cvtepi8_epi16(_mm_loadu_si128((const __m128i *)(w + i)));
+            s0 = _mm256_add_epi32(s0, _mm256_madd_epi16(wv, _mm256_loadu_si256((const __m256i *)(x0 + i))));
+            s1 = _mm256_add_epi32(s1, _mm256_madd_epi16(wv, _mm256_loadu_si256((const __m256i *)(x1 + i))));
+            s2 = _mm256_add_epi32(s2, _mm256_madd_epi16(wv, _mm256_loadu_si256((const __m256i *)(x2 + i))));
+            s3 = _mm256_add_epi32(s3, _mm256_madd_epi16(wv, _mm256_loadu_si256((const __m256i *)(x3 + i))));
+        }
+        out[f * out_stride] = hsum_epi32_avx2(s0);
+        out[(f + 1) * out_stride] = hsum_epi32_avx2(s1);
+        out[(f + 2) * out_stride] = hsum_epi32_avx2(s2);
+        out[(f + 3) * out_stride] = hsum_epi32_avx2(s3);
+    }
+    for (; f < n_frames; ++f) {
+        int16 const *x0 = x + f * stride;
+        __m256i s0 = _mm256_setzero_si256();
+        for (i = 0; i < stride; i += 16) {
+            __m256i wv = _mm256_cvtepi8_epi16(_mm_loadu_si128((const __m128i *)(w + i)));
+            s0 = _mm256_add_epi32(s0, _mm256_madd_epi16(wv, _mm256_loadu_si256((const __m256i *)(x0 + i))));
+        }
+        out[f * out_stride] = hsum_epi32_avx2(s0);
+    }
+}
+#endif /* HAVE_SIMD_X86 */
+
+#if defined(HAVE_SIMD_NEON)
+static inline int32
+hsum_s32_neon(int32x4_t v)
+{
+#if defined(__aarch64__)
+    return vaddvq_s32(v);
+#else
+    int32x2_t p = vadd_s32(vget_low_s32(v), vget_high_s32(v));
+    return vget_lane_s32(vpadd_s32(p, p), 0);
+#endif
+}
+
+static inline int32x4_t
+madd_s16_neon(int32x4_t acc, int16x8_t a, int16x8_t b)
+{
+    acc = vmlal_s16(acc, vget_low_s16(a), vget_low_s16(b));
+    return vmlal_s16(acc, vget_high_s16(a), vget_high_s16(b));
+}
+
+static void
+dot_neon(int8 const *w, int16 const *x, int32 stride,
+         int32 n_frames, int32 *out, int32 out_stride)
+{
+    int32 f, i;
+
+    for (f = 0; f + 4 <= n_frames; f += 4) {
+        int16 const *x0 = x + f * stride, *x1 = x0 + stride;
+        int16 const *x2 = x1 + stride, *x3 = x2 + stride;
+        int32x4_t s0 = vdupq_n_s32(0), s1 = vdupq_n_s32(0);
+        int32x4_t s2 = vdupq_n_s32(0), s3 = vdupq_n_s32(0);
+        for (i = 0; i < stride; i += 8) {
+            int16x8_t wv = vmovl_s8(vld1_s8((const int8_t *)w + i));
+            s0 = madd_s16_neon(s0, wv, vld1q_s16(x0 + i));
+            s1 = madd_s16_neon(s1, wv, vld1q_s16(x1 + i));
+            s2 = madd_s16_neon(s2, wv, vld1q_s16(x2 + i));
+            s3 = madd_s16_neon(s3, wv, vld1q_s16(x3 + i));
+        }
+        out[f * out_stride] = hsum_s32_neon(s0);
+        out[(f + 1) * out_stride] = hsum_s32_neon(s1);
+        out[(f + 2) * out_stride] = hsum_s32_neon(s2);
+        out[(f + 3) * out_stride] = hsum_s32_neon(s3);
+    }
+    for (; f < n_frames; ++f) {
+        int16 const *x0 = x + f * stride;
+        int32x4_t s0 = vdupq_n_s32(0);
+        for (i = 0; i < stride; i += 8)
+            s0 = madd_s16_neon(s0, vmovl_s8(vld1_s8((const int8_t *)w + i)),
+                               vld1q_s16(x0 + i));
+        out[f * out_stride] = hsum_s32_neon(s0);
+    }
+}
+#endif /* HAVE_SIMD_NEON */
+
+int
+mlp_mgau_set_simd(ps_mgau_t *ps, int level)
+{
+    mlp_mgau_t *s = (mlp_mgau_t *)ps;
+
+    s->dot = dot_scalar;
+    switch (level) {
+#if defined(HAVE_SIMD_X86)
+    case SIMD_AVX512:
+    case SIMD_AVX2:
+        s->dot = dot_avx2;
+        level = SIMD_AVX2;
+        break;
+    case SIMD_SSE2:
+        s->dot = dot_sse2;
+        break;
+#endif
+#if defined(HAVE_SIMD_NEON)
+    case SIMD_NEON:
+        s->dot = dot_neon;
+        break;
+#endif
+    default:
+        level = SIMD_NONE;
+    }
+    s->simd = level;
+
+    return level;
+}
+
+/**
+ * Quantize the inputs to a layer, with one scale per frame.
+ */
+static void
+mlp_mgau_quantize(mlp_mgau_t *s, mlp_layer_t *l,
+                  float32 const *in, int32 n_frames)
+{
+    int32 f, i;
+
+    for (f = 0; f < n_frames; ++f) {
+        float32 const *x = in + (size_t)f * l->n_in;
+        int16 *q = s->qact + (size_t)f * l->stride;
+        float32 amax = 0, inv;
+
+        for (i = 0; i < l->n_in; ++i) {
+            if (fabsf(x[i]) > amax)
+                amax = fabsf(x[i]);
+        }
+        if (amax == 0) {
+            memset(q, 0, l->stride * sizeof(*q));
+            s->qscale[f] = 0;
+            continue;
+        }
+        inv = 127.0f / amax;
+        for (i = 0; i < l->n_in; ++i)
+            q[i] = (int16)floorf(x[i] * inv + 0.5f);
+        for (; i < l->stride; ++i)
+            q[i] = 0;
+        s->qscale[f] = amax / 127.0f;
+    }
+}
+
+/**
+ * Compute one worker's share of the outputs of a layer.
+ */
+static void
+mlp_mgau_layer_worker(void *arg, int worker, int n_workers)
+{
+    mlp_task_t *t = (mlp_task_t *)arg;
+    mlp_mgau_t *s = t->s;
+    mlp_layer_t *l = t->layer;
+    int32 start = (int32)((int64)t->n_rows * worker / n_workers);
+    int32 end = (int32)((int64)t->n_rows * (worker + 1) / n_workers);
+    int32 f, r;
+
+    for (r = start; r < end; ++r) {
+        int32 j = t->rows ? t->rows[r] : r;
+        s->dot(l->weight + (size_t)j * l->stride, s->qact, l->stride,
+               t->n_frames, s->acc + r, t->n_rows);
+        for (f = 0; f < t->n_frames; ++f) {
+            size_t k = (size_t)f * t->n_rows + r;
+            float32 y = (float32)s->acc[k] * (l->wscale[j] * s->qscale[f])
+                + l->bias[j];
+            if (t->relu && y < 0)
+                y = 0;
+            t->out[k] = y;
+        }
+    }
+}
+
+/**
+ * Run the network on some frames.
+ *
+ * @param rows outputs of the last layer to compute, or NULL for all
+ *             of them.
+ * @return outputs of the last layer, n_frames x n_rows.
+ */
+static float32 *
+mlp_mgau_forward(mlp_mgau_t *s, mfcc_t ***feats, int32 n_frames,
+                 int32 const *rows, int32 n_rows)
+{
+    float32 *in = s->act[0];
+    int32 f, i, l;
+
+    /* Streams are contiguous within a frame (see feat_array_alloc()). */
+    for (f = 0; f < n_frames; ++f) {
+        mfcc_t const *x = feats[f][0];
+        float32 *y = in + (size_t)f * s->n_in;
+        for (i = 0; i < s->n_in; ++i)
+            y[i] = (MFCC2FLOAT(x[i]) - s->in_mean[i]) * s->in_scale[i];
+    }
+    for (l = 0; l < s->n_layer; ++l) {
+        mlp_task_t t;
+
+        mlp_mgau_quantize(s, &s->layer[l], in, n_frames);
+        t.s = s;
+        t.layer = &s->layer[l];
+        t.n_frames = n_frames;
+        if (l == s->n_layer - 1) {
+            t.rows = rows;
+            t.n_rows = rows ? n_rows : s->layer[l].n_out;
+            t.relu = FALSE;
+        }
+        else {
+            t.rows = NULL;
+            t.n_rows = s->layer[l].n_out;
+            t.relu = TRUE;
+        }
+        t.out = s->act[(l + 1) & 1];
+        workpool_run(s->pool, mlp_mgau_layer_worker, &t);
+        in = t.out;
+    }
+    return in;
+}
+
+/**
+ * Convert outputs to senone scores, relative to the best one.
+ *
+ * @param by_senone outputs are indexed by senone rather than by row.
+ */
+static void
+mlp_mgau_senscr(mlp_mgau_t *s, int16 *senone_scores, float32 const *y,
+                int32 const *rows, int32 n_rows, int by_senone)
+{
+    float32 best = -FLT_MAX;
+    int32 r;
+
+    for (r = 0; r < n_rows; ++r) {
+        float32 v = y[(by_senone && rows) ? rows[r] : r];
+        if (v > best)
+            best = v;
+    }
+    for (r = 0; r < n_rows; ++r) {
+        int32 sen = rows ? rows[r] : r;
+        float32 d = (best - y[by_senone ? sen : r]) * s->score_scale + 0.5f;
+        senone_scores[sen] = d < SENSCR_DUMMY ? (int16)d : SENSCR_DUMMY;
+    }
+}
+
+int
+mlp_mgau_frame_eval(ps_mgau_t *ps,
+                    int16 *senone_scores,
+                    uint8 *senone_active,
+                    int32 n_senone_active,
+                    mfcc_t **featbuf, int32 frame,
+                    int32 compallsen)
+{
+    mlp_mgau_t *s = (mlp_mgau_t *)ps;
+    int32 *rows = NULL;
+    int32 n_rows = s->n_sen;
+
+    if (!compallsen) {
+        int32 i, sen = 0;
+        for (i = 0; i < n_senone_active; ++i) {
+            sen += senone_active[i];
+            s->rows[i] = sen;
+        }
+        rows = s->rows;
+        n_rows = n_senone_active;
+    }
+    /* Use the outputs from mlp_mgau_frame_eval_block() if it did
+     * this frame, otherwise only compute the active senones. */
+    if (frame >= s->block_first && frame < s->block_end)
+        mlp_mgau_senscr(s, senone_scores,
+                        s->out + (size_t)(frame - s->block_first) * s->n_sen,
+                        rows, n_rows, TRUE);
+    else {
+        /* This overwrites them. */
+        s->block_first = s->block_end = 0;
+        mlp_mgau_senscr(s, senone_scores,
+                        mlp_mgau_forward(s, &featbuf, 1, rows, n_rows),
+                        rows, n_rows, FALSE);
+    }
+
+    return 0;
+}
+
+int
+mlp_mgau_frame_eval_block(ps_mgau_t *ps, mfcc_t ***feats,
+                          int32 frame, int32 n_frames)
+{
+    mlp_mgau_t *s = (mlp_mgau_t *)ps;
+
+    /* We don't know which senones will be active, so do all of them,
+     * for as many frames as we have room for. */
+    if (n_frames > s->n_block)
+        n_frames = s->n_block;
+    s->out = mlp_mgau_forward(s, feats, n_frames, NULL, s->n_sen);
+    s->block_first = frame;
+    s->block_end = frame + n_frames;
+
+    return n_frames;
+}
+
+/**
+ * Allocate the state used for scoring, which is not shared.
+ */
+static void
+mlp_mgau_init_scoring(mlp_mgau_t *s)
+{
+    /* Scoring many frames at once is much faster, since each row of
+     * weights is used for all of them, so do it by default with
+     * full-utterance input (see acmod_eval_frame()). */
+    s->n_block = cmd_ln_int32_r(s->config, "-gmmblock");
+    if (s->n_block == 0)
+        s->n_block = MLP_DEFAULT_BLOCK;
+    else if (s->n_block < 1)
+        s->n_block = 1;
+    s->base.block_size = s->n_block;
+    s->act[0] = ckd_calloc((size_t)s->n_block * s->max_width,
+                           sizeof(*s->act[0]));
+    s->act[1] = ckd_calloc((size_t)s->n_block * s->max_width,
+                           sizeof(*s->act[1]));
+    s->qact = ckd_calloc((size_t)s->n_block * s->max_stride,
+                         sizeof(*s->qact));
+    s->qscale = ckd_calloc(s->n_block, sizeof(*s->qscale));
+    s->acc = ckd_calloc((size_t)s->n_block * s->max_width, sizeof(*s->acc));
+    s->rows = ckd_calloc(s->n_sen, sizeof(*s->rows));
+    s->out = NULL;
+    s->block_first = s->block_end = 0;
+
+    /* Worker threads, if requested. */
+    s->pool = workpool_init(cmd_ln_int32_r(s->config, "-nthreads"));
+}
+
+static void
+mlp_mgau_free_scoring(mlp_mgau_t *s)
+{
+    workpool_free(s->pool);
+    ckd_free(s->act[0]);
+    ckd_free(s->act[1]);
+    ckd_free(s->qact);
+    ckd_free(s->qscale);
+    ckd_free(s->acc);
+    ckd_free(s->rows);
+}
+
+/* Check that there are n items of size bytes left before allocating
+ * space for them, so that a bad file can't make us run out of
+ * memory. */
+static int
+mlp_check_size(s3file_t *s, size_t size, size_t n)
+{
+    if ((size_t)(s->end - s->ptr) / size < n) {
+        E_ERROR("Neural network file is truncated\n");
+        return -1;
+    }
+    return 0;
+}
+
+ps_mgau_t *
+mlp_mgau_init_s3file(acmod_t *acmod, s3file_t *mlp)
+{
+    mlp_mgau_t *s;
+    ps_mgau_t *ps;
+    int32 i, j, n_in;
+    uint32 n_feat_in;
+
+    s = ckd_calloc(1, sizeof(*s));
+    s->config = acmod->config;
+
+    if (s3file_parse_header(mlp, MLP_PARAM_VERSION) < 0) {
+        E_ERROR("Failed to read header from neural network file\n");
+        goto error_out;
+    }
+    if (s3file_get(&s->n_layer, sizeof(int32), 1, mlp) != 1
+        || s3file_get(&s->n_in, sizeof(int32), 1, mlp) != 1) {
+        E_ERROR("Failed to read neural network dimensions\n");
+        goto error_out;
+    }
+    if (s->n_layer <= 0 || s->n_in <= 0) {
+        E_ERROR("Invalid neural network dimensions: %d layers, %d inputs\n",
+                s->n_layer, s->n_in);
+        goto error_out;
+    }
+    if (mlp_check_size(mlp, sizeof(int32), s->n_layer) < 0)
+        goto error_out;
+    s->layer = ckd_calloc(s->n_layer, sizeof(*s->layer));
+    n_in = s->n_in;
+    s->max_width = n_in;
+    for (i = 0; i < s->n_layer; ++i) {
+        mlp_layer_t *l = &s->layer[i];
+        if (s3file_get(&l->n_out, sizeof(int32), 1, mlp) != 1) {
+            E_ERROR("Failed to read neural network dimensions\n");
+            goto error_out;
+        }
+        if (l->n_out <= 0) {
+            E_ERROR("Invalid output dimension for layer %d: %d\n",
+                    i, l->n_out);
+            goto error_out;
+        }
+        l->n_in = n_in;
+        l->stride = (n_in + MLP_ALIGN - 1) & ~(MLP_ALIGN - 1);
+        if (l->stride > s->max_stride)
+            s->max_stride = l->stride;
+        if (l->n_out > s->max_width)
+            s->max_width = l->n_out;
+        n_in = l->n_out;
+    }
+
+    /* Verify the input and output dimensions against acmod. */
+    s->n_sen = s->layer[s->n_layer - 1].n_out;
+    if (s->n_sen != bin_mdef_n_sen(acmod->mdef)) {
+        E_ERROR("Number of network outputs does not match number of senones: %d != %d\n",
+                s->n_sen, bin_mdef_n_sen(acmod->mdef));
+        goto error_out;
+    }
+    n_feat_in = 0;
+    for (i = 0; i < feat_dimension1(acmod->fcb); ++i)
+        n_feat_in += feat_dimension2(acmod->fcb, i);
+    if ((uint32)s->n_in != n_feat_in) {
+        E_ERROR("Number of network inputs does not match feature dimension: %d != %d\n",
+                s->n_in, n_feat_in);
+        goto error_out;
+    }
+
+    /* Read input normalization and layers. */
+    if (mlp_check_size(mlp, sizeof(float32), 2 * (size_t)s->n_in) < 0)
+        goto error_out;
+    s->in_mean = ckd_calloc(s->n_in, sizeof(*s->in_mean));
+    s->in_scale = ckd_calloc(s->n_in, sizeof(*s->in_scale));
+    if (s3file_get(s->in_mean, sizeof(float32), s->n_in, mlp) != (size_t)s->n_in
+        || s3file_get(s->in_scale, sizeof(float32), s->n_in, mlp) != (size_t)s->n_in) {
+        E_ERROR("Failed to read neural network input normalization\n");
+        goto error_out;
+    }
+    for (i = 0; i < s->n_layer; ++i) {
+        mlp_layer_t *l = &s->layer[i];
+        if (mlp_check_size(mlp, 1, (size_t)l->n_out
+                           * (2 * sizeof(float32) + l->n_in)) < 0)
+            goto error_out;
+        l->wscale = ckd_calloc(l->n_out, sizeof(*l->wscale));
+        l->bias = ckd_calloc(l->n_out, sizeof(*l->bias));
+        /* Rows are padded, so they can't be used in place. */
+        l->weight = ckd_calloc((size_t)l->n_out * l->stride, sizeof(*l->weight));
+        if (s3file_get(l->wscale, sizeof(float32), l->n_out, mlp) != (size_t)l->n_out
+            || s3file_get(l->bias, sizeof(float32), l->n_out, mlp) != (size_t)l->n_out) {
+            E_ERROR("Failed to read parameters for layer %d\n", i);
+            goto error_out;
+        }
+        for (j = 0; j < l->n_out; ++j) {
+            if (s3file_get(l->weight + (size_t)j * l->stride, 1, l->n_in, mlp)
+                != (size_t)l->n_in) {
+                E_ERROR("Failed to read weights for layer %d\n", i);
+                goto error_out;
+            }
+        }
+    }
+    if (s3file_verify_chksum(mlp) != 0)
+        goto error_out;
+    E_INFO("Neural network with %d layers, %d inputs, %d outputs\n",
+           s->n_layer, s->n_in, s->n_sen);
+
+    /* Outputs are natural logs, scores are in the log base. */
+    s->score_scale = (float32)(1.0 / (log(logmath_get_base(acmod->lmath))
+                                      * (1 << SENSCR_SHIFT)));
+    mlp_mgau_set_simd(ps_mgau_base(s), simd_detect());
+    E_INFO("Neural network evaluation using %s\n", simd_level_name(s->simd));
+    mlp_mgau_init_scoring(s);
+
+    ps = (ps_mgau_t *)s;
+    ps->vt = &mlp_mgau_funcs;
+    return ps;
+error_out:
+    mlp_mgau_free(ps_mgau_base(s));
+    return NULL;
+}
+
+ps_mgau_t *
+mlp_mgau_init(acmod_t *acmod)
+{
+    s3file_t *mlp;
+    const char *path;
+    ps_mgau_t *ps;
+
+    path = cmd_ln_str_r(acmod->config, "_mlp");
+    E_INFO("Reading neural network: %s\n", path);
+    if ((mlp = s3file_map_file(path)) == NULL) {
+        E_ERROR_SYSTEM("Failed to open neural network '%s' for reading", path);
+        return NULL;
+    }
+    ps = mlp_mgau_init_s3file(acmod, mlp);
+    s3file_free(mlp);
+    return ps;
+}
+
+int
+mlp_mgau_mllr_transform(ps_mgau_t *ps,
+                        ps_mllr_t *mllr)
+{
+    (void)ps;
+    (void)mllr;
+    E_ERROR("MLLR is not supported for neural network models\n");
+    return -1;
+}
+
+ps_mgau_t *
+mlp_mgau_share(ps_mgau_t *ps, acmod_t *acmod)
+{
+    mlp_mgau_t *other = (mlp_mgau_t *)ps;
+    mlp_mgau_t *s;
+
+    /* Parameters are the same, everything else is our own. */
+    s = ckd_calloc(1, sizeof(*s));
+    memcpy(s, other, sizeof(*s));
+    s->base.frame_idx = 0;
+    s->base.shared = ps;
+    s->config = acmod->config;
+    mlp_mgau_init_scoring(s);
+
+    return ps_mgau_base(s);
+}
+
+void
+mlp_mgau_free(ps_mgau_t *ps)
+{
+    mlp_mgau_t *s = (mlp_mgau_t *)ps;
+    int32 i;
+
+    mlp_mgau_free_scoring(s);
+    if (ps->shared) {
+        ckd_free(s);
+        return;
+    }
+    if (s->layer) {
+        for (i = 0; i < s->n_layer; ++i) {
+            ckd_free(s->layer[i].weight);
+            ckd_free(s->layer[i].wscale);
+            ckd_free(s->layer[i].bias);
+        }
+        ckd_free(s->layer);
+    }
+    ckd_free(s->in_mean);
+    ckd_free(s->in_scale);
+    ckd_free(s);
+}
@@ -0,0 +1,411 @@
+/* -*- c-basic-offset: 4; indent-tabs-mode: nil -*- */
+/* ====================================================================
+ * Copyright (c) 2022 Carnegie Mellon University.  All rights
+ * reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer. 
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in
+ *    the documentation and/or other materials provided with the
+ *    distribution.
+ *
+ * This work was supported in part by funding from the Defense Advanced 
+ * Research Projects Agency and the National Science Foundation of the 
+ * United States of America, and the CMU Sphinx Speech Consortium.
+ *
+ * THIS SOFTWARE IS PROVIDED BY CARNEGIE MELLON UNIVERSITY ``AS IS'' AND 
+ * ANY EXPRESSED OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, 
+ * THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ * PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL CARNEGIE MELLON UNIVERSITY
+ * NOR ITS EMPLOYEES BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT 
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, 
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY 
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT 
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE 
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ * ====================================================================
+ *
+ */
+/**
+ * @file modelpack.c
+ * @brief Precompiled acoustic models in a single file.
+ */
+
+#include <string.h>
+
+#include <soundswallower/modelpack.h>
+#include <soundswallower/ms_gauden.h>
+#include <soundswallower/gausel.h>
+#include <soundswallower/bin_mdef.h>
+#include <soundswallower/ckd_alloc.h>
+#include <soundswallower/err.h>
+
+#define MODELPACK_PAD(n) (((n) + MODELPACK_ALIGN - 1) \
+                          & ~(size_t)(MODELPACK_ALIGN - 1))
+
+/* Model files which are copied as-is into a pack, with the name of
+ * their section and the configuration argument giving their path.
+ * The Gaussians are precomputed in the "gauden" section instead. */
+static const struct {
+    const char *name;
+    const char *arg;
+} modelpack_files[] = {
+    { "mdef", "_mdef" },
+    { "tmat", "_tmat" },
+    { "sendump", "_sendump" },
+    { "mixw", "_mixw" },
+    { "senmgau", "_senmgau" },
+    { "mlp", "_mlp" },
+    { "lda", "_lda" },
+    { "featparams", "_featparams" },
+    { "fdict", "_fdict" },
+    { "dict", "_dict" },
+};
+#define N_MODELPACK_FILES (sizeof(modelpack_files) / sizeof(modelpack_files[0]))
+
+int
+modelpack_is_pack(const char *path)
+{
+    char magic[8];
+    FILE *fh;
+    int rv;
+
+    if ((fh = fopen(path, "rb")) == NULL)
+        return FALSE;
+    /* Reading a directory will fail here. */
+    rv = (fread(magic, 1, sizeof(magic), fh) == sizeof(magic)
+          && memcmp(magic, MODELPACK_MAGIC, sizeof(magic)) == 0);
+    fclose(fh);
+    return rv;
+}
+
+static int
+modelpack_check(s3file_t *pack)
+{
+    modelpack_hdr_t hdr;
+    modelpack_section_t sec;
+    size_t len = pack->end - (const char *)pack->buf;
+    uint32 i;
+
+    if (len < sizeof(hdr)) {
+        E_ERROR("Model pack header truncated\n");
+        return -1;
+    }
+    memcpy(&hdr, pack->buf, sizeof(hdr));
+    if (memcmp(hdr.magic, MODELPACK_MAGIC, sizeof(hdr.magic)) != 0) {
+        E_ERROR("Not a model pack\n");
+        return -1;
+    }
+    if (hdr.byteorder != MODELPACK_BYTEORDER) {
+        E_ERROR("Model pack was written with the other byte order\n");
+        return -1;
+    }
+    if (hdr.version > MODELPACK_VERSION) {
+        E_ERROR("Model pack version %u is newer than %u\n",
+                hdr.version, MODELPACK_VERSION);
+        return -1;
+    }
+    if (hdr.align % MODELPACK_ALIGN != 0) {
+        E_ERROR("Model pack sections are aligned to %u bytes, not %d\n",
+                hdr.align, MODELPACK_ALIGN);
+        return -1;
+    }
+    if (hdr.n_section > (len - sizeof(hdr)) / sizeof(sec)) {
+        E_ERROR("Model pack section table truncated\n");
+        return -1;
+    }
+    for (i = 0; i < hdr.n_section; ++i) {
+        memcpy(&sec, (const char *)pack->buf + sizeof(hdr) + i * sizeof(sec),
+               sizeof(sec));
+        if (sec.offset % MODELPACK_ALIGN != 0
+            || sec.offset > len || sec.size > len - sec.offset) {
+            E_ERROR("Model pack section %d (%.*s) is invalid\n",
+                    i, MODELPACK_NAME_LEN, sec.name);
+            return -1;
+        }
+    }
+    return 0;
+}
+
+s3file_t *
+modelpack_open(const char *path)
+{
+    s3file_t *pack;
+
+    if ((pack = s3file_map_file(path)) == NULL) {
+        E_ERROR_SYSTEM("Failed to open model pack '%s'", path);
+        return NULL;
+    }
+    if (modelpack_check(pack) < 0) {
+        E_ERROR("Failed to read model pack '%s'\n", path);
+        s3file_free(pack);
+        return NULL;
+    }
+    return pack;
+}
+
+s3file_t *
+modelpack_section(s3file_t *pack, const char *name)
+{
+    modelpack_hdr_t hdr;
+    modelpack_section_t sec;
+    uint32 i;
+
+    memcpy(&hdr, pack->buf, sizeof(hdr));
+    for (i = 0; i < hdr.n_section; ++i) {
+        memcpy(&sec, (const char *)pack->buf + sizeof(hdr) + i * sizeof(sec),
+               sizeof(sec));
+        if (strncmp(sec.name, name, MODELPACK_NAME_LEN) == 0)
+            return s3file_init_sub(pack, sec.offset, sec.size);
+    }
+    return NULL;
+}
+
+static int
+modelpack_pad(FILE *fh, size_t *pos)
+{
+    static const char zeros[MODELPACK_ALIGN];
+    size_t npad = MODELPACK_PAD(*pos) - *pos;
+
+    if (fwrite(zeros, 1, npad, fh) != npad)
+        return -1;
+    *pos += npad;
+    return 0;
+}
+
+static void
+modelpack_add_section(modelpack_section_t *sec, const char *name,
+                      size_t offset, size_t size)
+{
+    memset(sec->name, 0, sizeof(sec->name));
+    strncpy(sec->name, name, sizeof(sec->name) - 1);
+    sec->offset = offset;
+    sec->size = size;
+}
+
+/* Only binary model definitions can be used in place. */
+static int
+modelpack_check_mdef(const char *path)
+{
+    s3file_t *s;
+    int32 val;
+    int rv = -1;
+
+    if ((s = s3file_map_file(path)) == NULL) {
+        E_ERROR_SYSTEM("Failed to open model definition '%s'", path);
+        return -1;
+    }
+    if (s3file_get(&val, sizeof(val), 1, s) == 1
+        && (val == BIN_MDEF_NATIVE_ENDIAN || val == BIN_MDEF_OTHER_ENDIAN))
+        rv = 0;
+    else
+        E_ERROR("Model definition '%s' is not binary, "
+                "convert it to mdef.bin before packing\n", path);
+    s3file_free(s);
+    return rv;
+}
+
+int
+modelpack_write(cmd_ln_t *config, logmath_t *lmath, const char *outfile)
+{
+    modelpack_section_t sections[N_MODELPACK_FILES + 1];
+    const char *paths[N_MODELPACK_FILES];
+    modelpack_hdr_t hdr;
+    const char *meanfn, *varfn;
+    float32 varfloor;
+    gauden_t *g = NULL;
+    FILE *fh = NULL;
+    size_t pos;
+    long size;
+    uint32 i, n;
+    int rv = -1;
+
+    if (cmd_ln_exists_r(config, "_pack") && cmd_ln_str_r(config, "_pack")) {
+        E_ERROR("Acoustic model %s is already precompiled\n",
+                cmd_ln_str_r(config, "_pack"));
+        return -1;
+    }
+    meanfn = cmd_ln_str_r(config, "_mean");
+    varfn = cmd_ln_str_r(config, "_var");
+    if (cmd_ln_str_r(config, "_mdef") == NULL
+        || cmd_ln_str_r(config, "_tmat") == NULL
+        || ((meanfn == NULL || varfn == NULL)
+            && cmd_ln_str_r(config, "_mlp") == NULL)) {
+        E_ERROR("No mdef/mean/var/tmat files specified\n");
+        return -1;
+    }
+    if (modelpack_check_mdef(cmd_ln_str_r(config, "_mdef")) < 0)
+        return -1;
+    for (i = 0; i < N_MODELPACK_FILES; ++i)
+        paths[i] = cmd_ln_str_r(config, modelpack_files[i].arg);
+    /* Float mixture weights are only used if there is no sendump,
+     * or by the multi-stream computation, so leave them out. */
+    if (cmd_ln_str_r(config, "_sendump") && !cmd_ln_str_r(config, "_senmgau")) {
+        for (i = 0; i < N_MODELPACK_FILES; ++i)
+            if (0 == strcmp(modelpack_files[i].name, "mixw"))
+                paths[i] = NULL;
+    }
+
+    /* A neural network model may not have any Gaussians at all. */
+    varfloor = cmd_ln_float32_r(config, "-varfloor");
+    if (meanfn && varfn
+        && (g = gauden_init(meanfn, varfn, varfloor, lmath)) == NULL)
+        return -1;
+    if ((fh = fopen(outfile, "wb")) == NULL) {
+        E_ERROR_SYSTEM("Failed to open '%s' for writing", outfile);
+        goto error_out;
+    }
+
+    /* Write the header and a blank section table, which is filled in
+     * afterwards. */
+    n = g ? 1 : 0;
+    for (i = 0; i < N_MODELPACK_FILES; ++i)
+        if (paths[i])
+            ++n;
+    memset(&hdr, 0, sizeof(hdr));
+    memcpy(hdr.magic, MODELPACK_MAGIC, sizeof(hdr.magic));
+    hdr.version = MODELPACK_VERSION;
+    hdr.byteorder = MODELPACK_BYTEORDER;
+    hdr.n_section = n;
+    hdr.align = MODELPACK_ALIGN;
+    memset(sections, 0, sizeof(sections));
+    if (fwrite(&hdr, sizeof(hdr), 1, fh) != 1
+        || fwrite(sections, sizeof(*sections), n, fh) != n)
+        goto write_error;
+    pos = sizeof(hdr) + n * sizeof(*sections);
+    if (modelpack_pad(fh, &pos) < 0)
+        goto write_error;
+
+    n = 0;
+    if (g) {
+        E_INFO("Writing precomputed Gaussians from %s and %s\n", meanfn, varfn);
+        if ((size = gauden_write_precomp(g, varfloor, fh)) < 0)
+            goto error_out;
+        modelpack_add_section(&sections[n++], "gauden", pos, size);
+        pos += size;
+        if (modelpack_pad(fh, &pos) < 0)
+            goto write_error;
+    }
+    for (i = 0; i < N_MODELPACK_FILES; ++i) {
+        s3file_t *s;
+        size_t len;
+
+        if (paths[i] == NULL)
+            continue;
+        E_INFO("Writing %s from %s\n", modelpack_files[i].name, paths[i]);
+        if ((s = s3file_map_file(paths[i])) == NULL) {
+            E_ERROR_SYSTEM("Failed to open '%s'", paths[i]);
+            goto error_out;
+        }
+        len = s->end - (const char *)s->buf;
+        if (fwrite(s->buf, 1, len, fh) != len) {
+            s3file_free(s);
+            goto write_error;
+        }
+        s3file_free(s);
+        modelpack_add_section(&sections[n++], modelpack_files[i].name, pos, len);
+        pos += len;
+        if (modelpack_pad(fh, &pos) < 0)
+            goto write_error;
+    }
+
+    if (fseek(fh, sizeof(hdr), SEEK_SET) < 0
+        || fwrite(sections, sizeof(*sections), n, fh) != n)
+        goto write_error;
+    if (fclose(fh) != 0) {
+        fh = NULL;
+        goto write_error;
+    }
+    fh = NULL;
+    E_INFO("Wrote %u sections (%lu bytes) to %s\n",
+           n, (unsigned long)pos, outfile);
+    rv = 0;
+    goto error_out;
+
+write_error:
+    E_ERROR_SYSTEM("Failed to write model pack '%s'", outfile);
+error_out:
+    if (fh)
+        fclose(fh);
+    gauden_free(g);
+    return rv;
+}
+
+int
+modelpack_write_gauden(cmd_ln_t *config, logmath_t *lmath, const char *outfile)
+{
+    const char *meanfn, *varfn;
+    float32 varfloor;
+    gauden_t *g;
+    FILE *fh;
+    int rv = -1;
+
+    meanfn = cmd_ln_str_r(config, "_mean");
+    varfn = cmd_ln_str_r(config, "_var");
+    if (meanfn == NULL || varfn == NULL) {
+        E_ERROR("No mean/var files specified\n");
+        return -1;
+    }
+    varfloor = cmd_ln_float32_r(config, "-varfloor");
+    if ((g = gauden_init(meanfn, varfn, varfloor, lmath)) == NULL)
+        return -1;
+    if ((fh = fopen(outfile, "wb")) == NULL) {
+        E_ERROR_SYSTEM("Failed to open '%s' for writing", outfile);
+        gauden_free(g);
+        return -1;
+    }
+    if (gauden_write_precomp(g, varfloor, fh) >= 0)
+        rv = 0;
+    if (fclose(fh) != 0) {
+        E_ERROR_SYSTEM("Failed to write '%s'", outfile);
+        rv = -1;
+    }
+    gauden_free(g);
+    return rv;
+}
+
+int
+modelpack_write_gausel(cmd_ln_t *config, logmath_t *lmath, const char *outfile)
+{
+    const char *meanfn, *varfn;
+    gauden_t *g;
+    gausel_t *gs;
+    FILE *fh;
+    int rv = -1;
+
+    meanfn = cmd_ln_str_r(config, "_mean");
+    varfn = cmd_ln_str_r(config, "_var");
+    if (meanfn == NULL || varfn == NULL) {
+        E_ERROR("No mean/var files specified\n");
+        return -1;
+    }
+    if ((g = gauden_init(meanfn, varfn,
+                         cmd_ln_float32_r(config, "-varfloor"), lmath)) == NULL)
+        return -1;
+    gs = gausel_build(g, GAUSEL_DEFAULT_N_CW, GAUSEL_DEFAULT_BEAM,
+                      GAUSEL_DEFAULT_MIN_SHORT);
+    gauden_free(g);
+    if (gs == NULL)
+        return -1;
+    if ((fh = fopen(outfile, "wb")) == NULL) {
+        E_ERROR_SYSTEM("Failed to open '%s' for writing", outfile);
+        gausel_free(gs);
+        return -1;
+    }
+    if (gausel_write(gs, fh) >= 0)
+        rv = 0;
+    if (fclose(fh) != 0) {
+        E_ERROR_SYSTEM("Failed to write '%s'", outfile);
+        rv = -1;
+    }
+    gausel_free(gs);
+    return rv;
+}
@@ -43,6 +43,13 @@
 #include <soundswallower/err.h>
 #include <soundswallower/ckd_alloc.h>
 #include <soundswallower/ms_gauden.h>
+#include <soundswallower/simd.h>
+
+#if defined(HAVE_SIMD_X86)
+#include <immintrin.h>
+#elif defined(HAVE_SIMD_NEON)
+#include <arm_neon.h>
+#endif
 
 #define GAUDEN_PARAM_VERSION	"1.0"
 
@@ -52,6 +59,40 @@
 
 #define WORST_DIST	(int32)(0x80000000)
 
+/* Precomputed parameters (see gauden_write_precomp()) start with this
+ * header, followed by the feature lengths, then the means, inverse
+ * variances and determinants, each one aligned to GAUDEN_PRECOMP_ALIGN
+ * bytes from the start. */
+#define GAUDEN_PRECOMP_MAGIC	"GAUDENPC"
+#define GAUDEN_PRECOMP_ALIGN	64
+#define GAUDEN_PRECOMP_PAD(n)	(((n) + GAUDEN_PRECOMP_ALIGN - 1) \
+                                 & ~(size_t)(GAUDEN_PRECOMP_ALIGN - 1))
+typedef struct gauden_precomp_hdr_s {
+    char magic[8];
+    int32 n_mgau;
+    int32 n_feat;
+    int32 n_density;
+    int32 elsize;	/* sizeof(mfcc_t) */
+    float64 logbase;
+    float32 varfloor;
+    uint32 srcsum;	/* gauden_src_sum() of means and variances, or 0 */
+} gauden_precomp_hdr_t;
+
+/* Limits for fixed-point evaluation (see gauden_quant_t).  Means are
+ * scaled to +/-GAUDEN_QUANT_MAXMEAN, leaving room for observations
+ * twice as far from the center, so their differences always fit in
+ * 16 bits.  Scaled differences are clipped to GAUDEN_QUANT_MAXDIFF,
+ * which along with GAUDEN_QUANT_MAXLEN keeps sums within 32 bits. */
+#define GAUDEN_QUANT_MAXMEAN	8191
+#define GAUDEN_QUANT_MAXOBS	16383
+#define GAUDEN_QUANT_MAXDIFF	4095
+#define GAUDEN_QUANT_MAXLEN	64
+/* Fractional bits in scaled differences (more of these makes
+ * GAUDEN_QUANT_MAXDIFF too small) */
+#define GAUDEN_QUANT_FRAC	2
+/* Dimensions between checks for early exit in vectorized code */
+#define GAUDEN_QUANT_CHECK	16
+
 void
 gauden_dump(const gauden_t * g)
 {
@@ -269,6 +310,8 @@ gauden_init_s3file(s3file_t *means,  /**< Input: File containing means of mixtur
     int32 i, m, f, d, *flen = NULL;
     gauden_t *g;
 
+    if (vars == NULL)
+        return gauden_init_precomp(means, varfloor, lmath);
 
     g = (gauden_t *) ckd_calloc(1, sizeof(gauden_t));
     g->lmath = logmath_retain(lmath);
@@ -296,6 +339,7 @@ gauden_init_s3file(s3file_t *means,  /**< Input: File containing means of mixtur
     }
     ckd_free(flen);
     gauden_dist_precompute(g, lmath, varfloor);
+    g->srcsum = gauden_src_sum(means, vars);
     return g;
 
  error_out:
@@ -332,19 +376,461 @@ gauden_init(char const *meanfile, char const *varfile, float32 varfloor, logmath
     return g;
 }
 
+/* Read and check the header of precomputed parameters.  Returns -1
+ * if they are not valid, or -2 if they are but were precomputed for
+ * some other configuration (logged at level lvl). */
+static int
+gauden_precomp_hdr(s3file_t *s, float32 varfloor, logmath_t *lmath,
+                   err_lvl_t lvl, gauden_precomp_hdr_t *hdr)
+{
+    size_t len = s->end - (const char *)s->buf;
+
+    if (len < sizeof(*hdr)) {
+        E_ERROR("Precomputed Gaussian parameters truncated\n");
+        return -1;
+    }
+    memcpy(hdr, s->buf, sizeof(*hdr));
+    if (memcmp(hdr->magic, GAUDEN_PRECOMP_MAGIC, sizeof(hdr->magic)) != 0) {
+        E_ERROR("Not a set of precomputed Gaussian parameters\n");
+        return -1;
+    }
+    if (hdr->n_mgau <= 0 || hdr->n_feat <= 0 || hdr->n_density <= 0) {
+        E_ERROR("Invalid dimensions for precomputed Gaussian parameters: %d x %d x %d\n",
+                hdr->n_mgau, hdr->n_feat, hdr->n_density);
+        return -1;
+    }
+    if (hdr->elsize != sizeof(mfcc_t)) {
+        err_msg(lvl, FILELINE,
+                "Precomputed Gaussian parameters have %d-byte values, expected %d\n",
+                hdr->elsize, (int)sizeof(mfcc_t));
+        return -2;
+    }
+    if (hdr->logbase != logmath_get_base(lmath)) {
+        err_msg(lvl, FILELINE,
+                "Gaussian parameters were precomputed with -logbase %f, not %f\n",
+                hdr->logbase, logmath_get_base(lmath));
+        return -2;
+    }
+    if (hdr->varfloor != varfloor) {
+        err_msg(lvl, FILELINE,
+                "Gaussian parameters were precomputed with -varfloor %g, not %g\n",
+                hdr->varfloor, varfloor);
+        return -2;
+    }
+    return 0;
+}
+
+gauden_t *
+gauden_init_precomp(s3file_t *s, float32 varfloor, logmath_t *lmath)
+{
+    gauden_precomp_hdr_t hdr;
+    const char *base = s->buf;
+    size_t len = s->end - base;
+    size_t pos, blk, n_param, n_det;
+    mfcc_t *mean, *var, *det;
+    gauden_t *g;
+    int32 i, j, k, l;
+
+    if (gauden_precomp_hdr(s, varfloor, lmath, ERR_ERROR, &hdr) < 0)
+        return NULL;
+    /* We use the values in place, so they had better be aligned. */
+    if ((size_t)base % GAUDEN_PRECOMP_ALIGN != 0) {
+        E_ERROR("Precomputed Gaussian parameters are not aligned in memory\n");
+        return NULL;
+    }
+
+    g = (gauden_t *) ckd_calloc(1, sizeof(gauden_t));
+    g->lmath = logmath_retain(lmath);
+    g->n_mgau = hdr.n_mgau;
+    g->n_feat = hdr.n_feat;
+    g->n_density = hdr.n_density;
+    pos = sizeof(hdr) + g->n_feat * sizeof(int32);
+    if (pos > len)
+        goto truncated;
+    g->featlen = ckd_calloc(g->n_feat, sizeof(int32));
+    memcpy(g->featlen, base + sizeof(hdr), g->n_feat * sizeof(int32));
+    for (i = 0, blk = 0; i < g->n_feat; i++) {
+        if (g->featlen[i] <= 0) {
+            E_ERROR("Invalid dimension for stream %d of precomputed Gaussian parameters: %d\n",
+                    i, g->featlen[i]);
+            gauden_free(g);
+            return NULL;
+        }
+        blk += g->featlen[i];
+    }
+    /* Make sure the sizes below can't overflow. */
+    if ((size_t)g->n_mgau * g->n_density > len
+        || blk > len / ((size_t)g->n_mgau * g->n_density * sizeof(mfcc_t)))
+        goto truncated;
+    n_param = (size_t)g->n_mgau * g->n_density * blk;
+    n_det = (size_t)g->n_mgau * g->n_feat * g->n_density;
+
+    pos = GAUDEN_PRECOMP_PAD(pos);
+    mean = (mfcc_t *)(base + pos);
+    pos = GAUDEN_PRECOMP_PAD(pos + n_param * sizeof(mfcc_t));
+    var = (mfcc_t *)(base + pos);
+    pos = GAUDEN_PRECOMP_PAD(pos + n_param * sizeof(mfcc_t));
+    det = (mfcc_t *)(base + pos);
+    pos += n_det * sizeof(mfcc_t);
+    if (pos > len)
+        goto truncated;
+
+    g->mean = (mfcc_t ****)ckd_calloc_3d(g->n_mgau, g->n_feat, g->n_density,
+                                         sizeof(mfcc_t *));
+    g->var = (mfcc_t ****)ckd_calloc_3d(g->n_mgau, g->n_feat, g->n_density,
+                                        sizeof(mfcc_t *));
+    for (i = 0, l = 0; i < g->n_mgau; i++) {
+        for (j = 0; j < g->n_feat; j++) {
+            for (k = 0; k < g->n_density; k++) {
+                g->mean[i][j][k] = mean + l;
+                g->var[i][j][k] = var + l;
+                l += g->featlen[j];
+            }
+        }
+    }
+    g->det = (mfcc_t ***)ckd_alloc_3d_ptr(g->n_mgau, g->n_feat, g->n_density,
+                                          det, sizeof(mfcc_t));
+    g->filemap = s3file_retain(s);
+    g->srcsum = hdr.srcsum;
+    E_INFO("Mapped %d x %d x %d precomputed Gaussian densities\n",
+           g->n_mgau, g->n_feat, g->n_density);
+    return g;
+
+truncated:
+    E_ERROR("Precomputed Gaussian parameters truncated\n");
+    gauden_free(g);
+    return NULL;
+}
+
+/* Bytes at each end of a file included in gauden_src_sum(). */
+#define GAUDEN_SRCSUM_SPAN	4096
+
+/* FNV-1a over some bytes. */
+static uint32
+gauden_sum_bytes(const void *buf, size_t len, uint32 sum)
+{
+    const unsigned char *p = (const unsigned char *)buf;
+    const unsigned char *end = p + len;
+
+    for (; p < end; ++p) {
+        sum ^= *p;
+        sum *= 16777619U;
+    }
+    return sum;
+}
+
+/* FNV-1a over the size of a file and the bytes at either end. */
+static uint32
+gauden_file_sum(s3file_t *s, uint32 sum)
+{
+    const char *start = (const char *)s->buf;
+    uint64 len = (uint64)(s->end - start);
+    size_t span = len < GAUDEN_SRCSUM_SPAN ? (size_t)len : GAUDEN_SRCSUM_SPAN;
+
+    sum = gauden_sum_bytes(&len, sizeof(len), sum);
+    sum = gauden_sum_bytes(start, span, sum);
+    return gauden_sum_bytes(s->end - span, span, sum);
+}
+
+uint32
+gauden_src_sum(s3file_t *means, s3file_t *vars)
+{
+    uint32 sum = 2166136261U;
+
+    sum = gauden_file_sum(means, sum);
+    sum = gauden_file_sum(vars, sum);
+    /* Zero means "unknown" */
+    return sum ? sum : 1;
+}
+
+static size_t
+gauden_precomp_pad(FILE *fh, size_t pos)
+{
+    static const char zeros[GAUDEN_PRECOMP_ALIGN];
+    size_t npad = GAUDEN_PRECOMP_PAD(pos) - pos;
+
+    if (fwrite(zeros, 1, npad, fh) != npad)
+        return 0;
+    return pos + npad;
+}
+
+long
+gauden_write_precomp(gauden_t *g, float32 varfloor, FILE *fh)
+{
+    gauden_precomp_hdr_t hdr;
+    size_t pos, blk, n_param, n_det;
+    int32 i;
+
+    memset(&hdr, 0, sizeof(hdr));
+    memcpy(hdr.magic, GAUDEN_PRECOMP_MAGIC, sizeof(hdr.magic));
+    hdr.n_mgau = g->n_mgau;
+    hdr.n_feat = g->n_feat;
+    hdr.n_density = g->n_density;
+    hdr.elsize = sizeof(mfcc_t);
+    hdr.logbase = logmath_get_base(g->lmath);
+    hdr.varfloor = varfloor;
+    hdr.srcsum = g->srcsum;
+    for (i = 0, blk = 0; i < g->n_feat; i++)
+        blk += g->featlen[i];
+    n_param = (size_t)g->n_mgau * g->n_density * blk;
+    n_det = (size_t)g->n_mgau * g->n_feat * g->n_density;
+
+    /* Parameters are contiguous in memory whether they were read or
+     * mapped, so they can be written all at once. */
+    if (fwrite(&hdr, sizeof(hdr), 1, fh) != 1
+        || fwrite(g->featlen, sizeof(int32), g->n_feat, fh) != (size_t)g->n_feat)
+        goto error_out;
+    pos = sizeof(hdr) + g->n_feat * sizeof(int32);
+    if ((pos = gauden_precomp_pad(fh, pos)) == 0)
+        goto error_out;
+    if (fwrite(g->mean[0][0][0], sizeof(mfcc_t), n_param, fh) != n_param)
+        goto error_out;
+    pos += n_param * sizeof(mfcc_t);
+    if ((pos = gauden_precomp_pad(fh, pos)) == 0)
+        goto error_out;
+    if (fwrite(g->var[0][0][0], sizeof(mfcc_t), n_param, fh) != n_param)
+        goto error_out;
+    pos += n_param * sizeof(mfcc_t);
+    if ((pos = gauden_precomp_pad(fh, pos)) == 0)
+        goto error_out;
+    if (fwrite(g->det[0][0], sizeof(mfcc_t), n_det, fh) != n_det)
+        goto error_out;
+    pos += n_det * sizeof(mfcc_t);
+    return (long)pos;
+
+error_out:
+    E_ERROR_SYSTEM("Failed to write precomputed Gaussian parameters");
+    return -1;
+}
+
+/* Check that precomputed parameters came from the means and
+ * variances in the configuration, if they exist, which are left
+ * mapped in out_means and out_vars. */
+static int
+gauden_precomp_matches(cmd_ln_t *config, const char *path,
+                       gauden_precomp_hdr_t *hdr,
+                       s3file_t **out_means, s3file_t **out_vars)
+{
+    const char *meanfn = cmd_ln_str_r(config, "_mean");
+    const char *varfn = cmd_ln_str_r(config, "_var");
+
+    *out_means = *out_vars = NULL;
+    if (meanfn == NULL || varfn == NULL
+        || (*out_means = s3file_map_file(meanfn)) == NULL
+        || (*out_vars = s3file_map_file(varfn)) == NULL)
+        return TRUE; /* Nothing to compare them to. */
+    if (hdr->srcsum != gauden_src_sum(*out_means, *out_vars)) {
+        E_WARN("%s was not precomputed from %s and %s\n",
+               path, meanfn, varfn);
+        return FALSE;
+    }
+    return TRUE;
+}
+
+int
+gauden_open_files(cmd_ln_t *config, logmath_t *lmath,
+                  s3file_t **out_means, s3file_t **out_vars)
+{
+    const char *path;
+
+    *out_means = *out_vars = NULL;
+    if (cmd_ln_exists_r(config, "_gauden")
+        && (path = cmd_ln_str_r(config, "_gauden")) != NULL) {
+        gauden_precomp_hdr_t hdr;
+        s3file_t *s;
+
+        E_INFO("Reading precomputed mixture gaussian parameters: %s\n", path);
+        if ((s = s3file_map_file(path)) == NULL)
+            E_ERROR_SYSTEM("Failed to open precomputed Gaussian parameters '%s'",
+                           path);
+        else if (gauden_precomp_hdr(s, cmd_ln_float32_r(config, "-varfloor"),
+                                    lmath, ERR_WARN, &hdr) < 0)
+            s3file_free(s);
+        else if (gauden_precomp_matches(config, path, &hdr,
+                                        out_means, out_vars)) {
+            s3file_free(*out_means);
+            s3file_free(*out_vars);
+            *out_means = s;
+            *out_vars = NULL;
+            return 0;
+        }
+        else {
+            s3file_free(s);
+            /* Already mapped them to check, so just use them. */
+            E_WARN("Using means and variances instead of %s\n", path);
+            return 0;
+        }
+        E_WARN("Using means and variances instead of %s\n", path);
+    }
+
+    path = cmd_ln_str_r(config, "_mean");
+    E_INFO("Reading mixture gaussian parameter: %s\n", path);
+    if ((*out_means = s3file_map_file(path)) == NULL) {
+        E_ERROR_SYSTEM("Failed to open mean file '%s' for reading", path);
+        return -1;
+    }
+    path = cmd_ln_str_r(config, "_var");
+    E_INFO("Reading mixture gaussian parameter: %s\n", path);
+    if ((*out_vars = s3file_map_file(path)) == NULL) {
+        E_ERROR_SYSTEM("Failed to open variance file '%s' for reading", path);
+        s3file_free(*out_means);
+        *out_means = NULL;
+        return -1;
+    }
+    return 0;
+}
+
+static void
+gauden_quant_free(gauden_quant_t *q)
+{
+    if (q == NULL)
+        return;
+    ckd_free(q->plen);
+    ckd_free_2d(q->center);
+    ckd_free_2d(q->scale);
+    if (q->mean) {
+        ckd_free(q->mean[0][0]);
+        ckd_free_2d(q->mean);
+    }
+    if (q->wvar) {
+        ckd_free(q->wvar[0][0]);
+        ckd_free_2d(q->wvar);
+    }
+    if (q->det)
+        ckd_free_3d(q->det);
+    if (q->shift)
+        ckd_free_3d(q->shift);
+    ckd_free(q);
+}
+
+static gauden_quant_t *
+gauden_quant_init(gauden_t *g)
+{
+    gauden_quant_t *q;
+    int16 *mptr, *wptr;
+    int32 m, f, d, i, total;
+
+    for (f = 0; f < g->n_feat; ++f) {
+        if (g->featlen[f] > GAUDEN_QUANT_MAXLEN) {
+            E_ERROR("Feature stream %d is too long to quantize: %d > %d\n",
+                    f, g->featlen[f], GAUDEN_QUANT_MAXLEN);
+            return NULL;
+        }
+    }
+    q = ckd_calloc(1, sizeof(*q));
+    q->frac = GAUDEN_QUANT_FRAC;
+    q->plen = ckd_calloc(g->n_feat, sizeof(*q->plen));
+    q->center = ckd_calloc_2d(g->n_feat, GAUDEN_QUANT_MAXLEN,
+                              sizeof(**q->center));
+    q->scale = ckd_calloc_2d(g->n_feat, GAUDEN_QUANT_MAXLEN,
+                             sizeof(**q->scale));
+
+    /* Scale each dimension to cover the range of its means. */
+    for (total = f = 0; f < g->n_feat; ++f) {
+        q->plen[f] = (g->featlen[f] + 7) & ~7;
+        total += g->n_mgau * g->n_density * q->plen[f];
+        for (i = 0; i < g->featlen[f]; ++i) {
+            float64 lo = FLT_MAX, hi = -FLT_MAX, half;
+            for (m = 0; m < g->n_mgau; ++m) {
+                for (d = 0; d < g->n_density; ++d) {
+                    float64 x = g->mean[m][f][d][i];
+                    if (x < lo) lo = x;
+                    if (x > hi) hi = x;
+                }
+            }
+            half = (hi - lo) / 2;
+            if (half < 1e-3)
+                half = 1e-3;
+            q->center[f][i] = (float32)(lo + half);
+            q->scale[f][i] = (float32)(GAUDEN_QUANT_MAXMEAN / half);
+        }
+    }
+
+    q->mean = ckd_calloc_2d(g->n_mgau, g->n_feat, sizeof(**q->mean));
+    q->wvar = ckd_calloc_2d(g->n_mgau, g->n_feat, sizeof(**q->wvar));
+    q->det = ckd_calloc_3d(g->n_mgau, g->n_feat, g->n_density,
+                           sizeof(***q->det));
+    q->shift = ckd_calloc_3d(g->n_mgau, g->n_feat, g->n_density,
+                             sizeof(***q->shift));
+    mptr = ckd_calloc(total, sizeof(*mptr));
+    wptr = ckd_calloc(total, sizeof(*wptr));
+    for (m = 0; m < g->n_mgau; ++m) {
+        for (f = 0; f < g->n_feat; ++f) {
+            int32 plen = q->plen[f];
+            q->mean[m][f] = mptr;
+            q->wvar[m][f] = wptr;
+            for (d = 0; d < g->n_density; ++d) {
+                float64 maxw = 0;
+                int bits;
+
+                /* Each density gets as many fractional bits in its
+                 * weights as the largest of them allows. */
+                for (i = 0; i < g->featlen[f]; ++i) {
+                    float64 w = sqrt(g->var[m][f][d][i]) / q->scale[f][i];
+                    if (w > maxw)
+                        maxw = w;
+                }
+                for (bits = q->frac;
+                     bits < 30 && maxw * (1 << (bits + 1)) <= 32767; ++bits)
+                    ;
+                q->shift[m][f][d] = bits - q->frac;
+                /* Padding is zero, so it adds nothing to the distance. */
+                for (i = 0; i < g->featlen[f]; ++i) {
+                    float64 x = (g->mean[m][f][d][i] - q->center[f][i])
+                        * q->scale[f][i];
+                    float64 w = sqrt(g->var[m][f][d][i]) / q->scale[f][i]
+                        * (1 << bits);
+                    /* Only for absurdly small variances. */
+                    if (w > 32767)
+                        w = 32767;
+                    mptr[d * plen + i] = (int16)floor(x + 0.5);
+                    wptr[d * plen + i] = (int16)floor(w + 0.5);
+                }
+                q->det[m][f][d] = (int32)floor(g->det[m][f][d]
+                                               * (1 << (2 * q->frac)) + 0.5);
+            }
+            mptr += g->n_density * plen;
+            wptr += g->n_density * plen;
+        }
+    }
+
+    return q;
+}
+
+static void
+gauden_free_params(gauden_t *g)
+{
+    gauden_quant_free(g->quant);
+    g->quant = NULL;
+    if (g->filemap) {
+        /* Only the pointers are ours. */
+        ckd_free_3d(g->mean);
+        ckd_free_3d(g->var);
+        ckd_free_3d_ptr(g->det);
+        s3file_free(g->filemap);
+    }
+    else {
+        if (g->mean)
+            gauden_param_free(g->mean);
+        if (g->var)
+            gauden_param_free(g->var);
+        if (g->det)
+            ckd_free_3d(g->det);
+    }
+    if (g->featlen)
+        ckd_free(g->featlen);
+    g->mean = g->var = NULL;
+    g->det = NULL;
+    g->featlen = NULL;
+    g->filemap = NULL;
+}
+
 void
 gauden_free(gauden_t * g)
 {
     if (g == NULL)
         return;
-    if (g->mean)
-        gauden_param_free(g->mean);
-    if (g->var)
-        gauden_param_free(g->var);
-    if (g->det)
-        ckd_free_3d(g->det);
-    if (g->featlen)
-        ckd_free(g->featlen);
+    gauden_free_params(g);
     if (g->lmath)
         logmath_free(g->lmath);
     ckd_free(g);
@@ -438,6 +924,329 @@ compute_dist(gauden_dist_t * out_dist, int32 n_top,
 }
 
 
+/* Scalar version of the fixed-point distance.  This stops early once
+ * it is worse than worst, as do the vectorized ones (though less
+ * often), which does not affect the results. */
+static int32
+qdist(int16 const *obs, int16 const *mean, int16 const *wvar, int32 plen,
+      int32 det, int32 worst, int shift)
+{
+    int32 round = (1 << shift) >> 1;
+    int32 j, dval;
+
+    dval = det;
+    for (j = 0; j < plen && dval >= worst; ++j) {
+        int32 y = ((obs[j] - mean[j]) * wvar[j] + round) >> shift;
+        if (y > GAUDEN_QUANT_MAXDIFF)
+            y = GAUDEN_QUANT_MAXDIFF;
+        else if (y < -GAUDEN_QUANT_MAXDIFF)
+            y = -GAUDEN_QUANT_MAXDIFF;
+        dval -= y * y;
+    }
+    return dval;
+}
+
+#if defined(HAVE_SIMD_X86)
+/* Squared scaled differences for 8 dimensions, summed in pairs. */
+SIMD_TARGET("sse2") static inline __m128i
+qsq_sse2(int16 const *obs, int16 const *mean, int16 const *wvar,
+         __m128i round, __m128i count)
+{
+    __m128i diff, w, lo, hi, y;
+
+    diff = _mm_subs_epi16(_mm_loadu_si128((__m128i const *)obs),
+                          _mm_loadu_si128((__m128i const *)mean));
+    w = _mm_loadu_si128((__m128i const *)wvar);
+    /* 32-bit products, rounded and shifted, then back to 16. */
+    lo = _mm_mullo_epi16(diff, w);
+    hi = _mm_mulhi_epi16(diff, w);
+    y = _mm_packs_epi32
+        (_mm_sra_epi32(_mm_add_epi32(_mm_unpacklo_epi16(lo, hi), round),
+                       count),
+         _mm_sra_epi32(_mm_add_epi32(_mm_unpackhi_epi16(lo, hi), round),
+                       count));
+    y = _mm_min_epi16(_mm_max_epi16(y, _mm_set1_epi16(-GAUDEN_QUANT_MAXDIFF)),
+                      _mm_set1_epi16(GAUDEN_QUANT_MAXDIFF));
+    return _mm_madd_epi16(y, y);
+}
+
+SIMD_TARGET("sse2") static inline int32
+hsum_sse2(__m128i sq)
+{
+    sq = _mm_add_epi32(sq, _mm_shuffle_epi32(sq, _MM_SHUFFLE(1, 0, 3, 2)));
+    sq = _mm_add_epi32(sq, _mm_shuffle_epi32(sq, _MM_SHUFFLE(2, 3, 0, 1)));
+    return _mm_cvtsi128_si32(sq);
+}
+
+SIMD_TARGET("sse2") static int32
+qdist_sse2(int16 const *obs, int16 const *mean, int16 const *wvar,
+           int32 plen, int32 det, int32 worst, int shift)
+{
+    __m128i round = _mm_set1_epi32((1 << shift) >> 1);
+    __m128i count = _mm_cvtsi32_si128(shift);
+    int32 j, dval;
+
+    dval = det;
+    for (j = 0; j < plen; j += GAUDEN_QUANT_CHECK) {
+        __m128i sq = qsq_sse2(obs + j, mean + j, wvar + j, round, count);
+        if (j + 8 < plen)
+            sq = _mm_add_epi32(sq, qsq_sse2(obs + j + 8, mean + j + 8,
+                                            wvar + j + 8, round, count));
+        dval -= hsum_sse2(sq);
+        if (dval < worst)
+            break;
+    }
+    return dval;
+}
+
+SIMD_TARGET("avx2") static int32
+qdist_avx2(int16 const *obs, int16 const *mean, int16 const *wvar,
+           int32 plen, int32 det, int32 worst, int shift)
+{
+    __m256i round = _mm256_set1_epi32((1 << shift) >> 1);
+    __m128i count = _mm_cvtsi32_si128(shift);
+    __m256i maxd = _mm256_set1_epi16(GAUDEN_QUANT_MAXDIFF);
+    __m256i mind = _mm256_set1_epi16(-GAUDEN_QUANT_MAXDIFF);
+    int32 j, dval;
+
+    dval = det;
+    for (j = 0; j + 16 <= plen; j += 16) {
+        __m256i diff, w, lo, hi, y, sq;
+
+        diff = _mm256_subs_epi16
+            (_mm256_loadu_si256((__m256i const *)(obs + j)),
+             _mm256_loadu_si256((__m256i const *)(mean + j)));
+        w = _mm256_loadu_si256((__m256i const *)(wvar + j));
+        /* These shuffle the dimensions within each half, which
+         * doesn't matter since they all get added up. */
+        lo = _mm256_mullo_epi16(diff, w);
+        hi = _mm256_mulhi_epi16(diff, w);
+        y = _mm256_packs_epi32
+            (_mm256_sra_epi32(_mm256_add_epi32(_mm256_unpacklo_epi16(lo, hi),
+                                               round), count),
+             _mm256_sra_epi32(_mm256_add_epi32(_mm256_unpackhi_epi16(lo, hi),
+                                               round), count));
+        y = _mm256_min_epi16(_mm256_max_epi16(y, mind), maxd);
+        sq = _mm256_madd_epi16(y, y);
+        dval -= hsum_sse2(_mm_add_epi32(_mm256_castsi256_si128(sq),
+                                        _mm256_extracti128_si256(sq, 1)));
+        if (dval < worst)
+            return dval;
+    }
+    if (j < plen)
+        dval -= hsum_sse2(qsq_sse2(obs + j, mean + j, wvar + j,
+                                   _mm256_castsi256_si128(round), count));
+    return dval;
+}
+#endif /* HAVE_SIMD_X86 */
+
+#if defined(HAVE_SIMD_NEON)
+static int32
+qdist_neon(int16 const *obs, int16 const *mean, int16 const *wvar,
+           int32 plen, int32 det, int32 worst, int shift)
+{
+    int32x4_t round = vdupq_n_s32((1 << shift) >> 1);
+    int32x4_t count = vdupq_n_s32(-shift);
+    int16x8_t maxd = vdupq_n_s16(GAUDEN_QUANT_MAXDIFF);
+    int16x8_t mind = vdupq_n_s16(-GAUDEN_QUANT_MAXDIFF);
+    int32 j, dval;
+
+    dval = det;
+    for (j = 0; j < plen; j += GAUDEN_QUANT_CHECK) {
+        int32x4_t sq = vdupq_n_s32(0);
+        int32 k;
+
+        for (k = j; k < j + GAUDEN_QUANT_CHECK && k < plen; k += 8) {
+            int16x8_t diff, w, y;
+            int32x4_t lo, hi;
+
+            diff = vqsubq_s16(vld1q_s16(obs + k), vld1q_s16(mean + k));
+            w = vld1q_s16(wvar + k);
+            lo = vmull_s16(vget_low_s16(diff), vget_low_s16(w));
+            hi = vmull_s16(vget_high_s16(diff), vget_high_s16(w));
+            lo = vshlq_s32(vaddq_s32(lo, round), count);
+            hi = vshlq_s32(vaddq_s32(hi, round), count);
+            y = vcombine_s16(vqmovn_s32(lo), vqmovn_s32(hi));
+            y = vminq_s16(vmaxq_s16(y, mind), maxd);
+            sq = vmlal_s16(sq, vget_low_s16(y), vget_low_s16(y));
+            sq = vmlal_s16(sq, vget_high_s16(y), vget_high_s16(y));
+        }
+#if defined(__aarch64__)
+        dval -= vaddvq_s32(sq);
+#else
+        {
+            int32x2_t s2 = vadd_s32(vget_low_s32(sq), vget_high_s32(sq));
+            dval -= vget_lane_s32(vpadd_s32(s2, s2), 0);
+        }
+#endif
+        if (dval < worst)
+            break;
+    }
+    return dval;
+}
+#endif /* HAVE_SIMD_NEON */
+
+/* Quantize one feature stream of an observation (see gauden_quant_t) */
+static void
+quant_obs(gauden_quant_t *q, int32 f, mfcc_t const *obs, int32 featlen,
+          int16 *out)
+{
+    int32 i;
+
+    for (i = 0; i < featlen; ++i) {
+        float64 x = (obs[i] - q->center[f][i]) * q->scale[f][i];
+        if (x > GAUDEN_QUANT_MAXOBS)
+            x = GAUDEN_QUANT_MAXOBS;
+        else if (x < -GAUDEN_QUANT_MAXOBS)
+            x = -GAUDEN_QUANT_MAXOBS;
+        out[i] = (int16)floor(x + 0.5);
+    }
+    for (; i < q->plen[f]; ++i)
+        out[i] = 0;
+}
+
+/* Fixed-point version of compute_dist(), which is inlined into each
+ * of the qeval functions below with the corresponding qdist(). */
+typedef int32 (*qdist_func_t)(int16 const *obs, int16 const *mean,
+                              int16 const *wvar, int32 plen,
+                              int32 det, int32 worst, int shift);
+static inline void
+compute_dist_quant(gauden_quant_t *q, int16 const *obs,
+                   int32 mgau, int32 f, int32 n_density,
+                   int32 n_top, gauden_dist_t *out_dist,
+                   qdist_func_t qdist_func)
+{
+    int16 const *mean = q->mean[mgau][f];
+    int16 const *wvar = q->wvar[mgau][f];
+    int32 const *det = q->det[mgau][f];
+    uint8 const *shift = q->shift[mgau][f];
+    int32 plen = q->plen[f];
+    int32 i, j, d, worst;
+    int32 topbuf[16], *top = topbuf;
+
+    if (n_top >= n_density) {
+        for (d = 0; d < n_density; ++d) {
+            int32 dval = qdist_func(obs, mean + d * plen, wvar + d * plen,
+                                  plen, det[d], WORST_DIST, shift[d]);
+            out_dist[d].dist = (mfcc_t)dval / (1 << (2 * q->frac));
+            out_dist[d].id = d;
+        }
+        return;
+    }
+
+    /* Keep the distances in 32 bits until the end, as mfcc_t may not
+     * hold them exactly. */
+    if (n_top > (int32)(sizeof(topbuf) / sizeof(topbuf[0])))
+        top = ckd_calloc(n_top, sizeof(*top));
+    for (i = 0; i < n_top; i++)
+        top[i] = WORST_DIST;
+    worst = WORST_DIST;
+
+    for (d = 0; d < n_density; d++) {
+        int32 dval = qdist_func(obs, mean + d * plen, wvar + d * plen, plen,
+                              det[d], worst, shift[d]);
+        if (dval < worst)
+            continue;
+        for (i = 0; (i < n_top) && (dval < top[i]); i++);
+        assert(i < n_top);
+        for (j = n_top - 1; j > i; --j) {
+            top[j] = top[j - 1];
+            out_dist[j].id = out_dist[j - 1].id;
+        }
+        top[i] = dval;
+        out_dist[i].id = d;
+        worst = top[n_top - 1];
+    }
+    for (i = 0; i < n_top; i++)
+        out_dist[i].dist = (mfcc_t)top[i] / (1 << (2 * q->frac));
+    if (top != topbuf)
+        ckd_free(top);
+}
+
+static void
+qeval(gauden_quant_t *q, int16 const *obs, int32 mgau, int32 f,
+      int32 n_density, int32 n_top, gauden_dist_t *out_dist)
+{
+    compute_dist_quant(q, obs, mgau, f, n_density, n_top, out_dist, qdist);
+}
+
+#if defined(HAVE_SIMD_X86)
+SIMD_TARGET("sse2") static void
+qeval_sse2(gauden_quant_t *q, int16 const *obs, int32 mgau, int32 f,
+           int32 n_density, int32 n_top, gauden_dist_t *out_dist)
+{
+    compute_dist_quant(q, obs, mgau, f, n_density, n_top, out_dist,
+                       qdist_sse2);
+}
+
+SIMD_TARGET("avx2") static void
+qeval_avx2(gauden_quant_t *q, int16 const *obs, int32 mgau, int32 f,
+           int32 n_density, int32 n_top, gauden_dist_t *out_dist)
+{
+    compute_dist_quant(q, obs, mgau, f, n_density, n_top, out_dist,
+                       qdist_avx2);
+}
+#endif /* HAVE_SIMD_X86 */
+
+#if defined(HAVE_SIMD_NEON)
+static void
+qeval_neon(gauden_quant_t *q, int16 const *obs, int32 mgau, int32 f,
+           int32 n_density, int32 n_top, gauden_dist_t *out_dist)
+{
+    compute_dist_quant(q, obs, mgau, f, n_density, n_top, out_dist,
+                       qdist_neon);
+}
+#endif /* HAVE_SIMD_NEON */
+
+int
+gauden_set_quant_simd(gauden_t *g, int level)
+{
+    gauden_quant_t *q = g->quant;
+
+    if (q == NULL)
+        return -1;
+    q->qeval = qeval;
+    switch (level) {
+#if defined(HAVE_SIMD_X86)
+    case SIMD_AVX512:
+    case SIMD_AVX2:
+        q->qeval = qeval_avx2;
+        level = SIMD_AVX2;
+        break;
+    case SIMD_SSE2:
+        q->qeval = qeval_sse2;
+        break;
+#endif
+#if defined(HAVE_SIMD_NEON)
+    case SIMD_NEON:
+        q->qeval = qeval_neon;
+        break;
+#endif
+    default:
+        level = SIMD_NONE;
+    }
+    q->simd = level;
+    return level;
+}
+
+int
+gauden_set_quant(gauden_t *g, int quant)
+{
+    if (!quant) {
+        gauden_quant_free(g->quant);
+        g->quant = NULL;
+        return 0;
+    }
+    if (g->quant)
+        return 0;
+    if ((g->quant = gauden_quant_init(g)) == NULL)
+        return -1;
+    gauden_set_quant_simd(g, simd_detect());
+    E_INFO("Fixed-point Gaussian evaluation using %s\n",
+           simd_level_name(g->quant->simd));
+    return 0;
+}
+
 /*
  * Compute distances of the input observation from the top N codewords in the given
  * codebook (g->{mean,var}[mgau]).  The input observation, obs, includes vectors for
@@ -451,6 +1260,15 @@ gauden_dist(gauden_t * g,
 
     assert((n_top > 0) && (n_top <= g->n_density));
 
+    if (g->quant) {
+        int16 qobs[GAUDEN_QUANT_MAXLEN];
+        for (f = 0; f < g->n_feat; f++) {
+            quant_obs(g->quant, f, obs[f], g->featlen[f], qobs);
+            g->quant->qeval(g->quant, qobs, mgau, f, g->n_density,
+                            n_top, out_dist[f]);
+        }
+        return 0;
+    }
     for (f = 0; f < g->n_feat; f++) {
         compute_dist(out_dist[f], n_top,
                      obs[f], g->featlen[f],
@@ -463,27 +1281,94 @@ gauden_dist(gauden_t * g,
     return 0;
 }
 
+/* Like compute_dist(), but only for the densities in list. */
+static int32
+compute_dist_list(gauden_dist_t * out_dist, int32 n_top,
+                  mfcc_t * obs, int32 featlen,
+                  mfcc_t ** mean, mfcc_t ** var, mfcc_t * det,
+                  uint16 const *list, int32 n_list)
+{
+    int32 i, j, l;
+    gauden_dist_t *worst;
+
+    for (i = 0; i < n_top; i++)
+        out_dist[i].dist = WORST_DIST;
+    worst = &(out_dist[n_top - 1]);
+
+    for (l = 0; l < n_list; l++) {
+        int32 d = list[l];
+        mfcc_t *m;
+        mfcc_t *v;
+        mfcc_t dval;
+
+        m = mean[d];
+        v = var[d];
+        dval = det[d];
+
+        for (i = 0; (i < featlen) && (dval >= worst->dist); i++) {
+            mfcc_t diff;
+            diff = obs[i] - m[i];
+            dval -= diff * diff * v[i];
+        }
+
+        if ((i < featlen) || (dval < worst->dist))
+            continue;
+
+        for (i = 0; (i < n_top) && (dval < out_dist[i].dist); i++);
+        assert(i < n_top);
+        for (j = n_top - 1; j > i; --j)
+            out_dist[j] = out_dist[j - 1];
+        out_dist[i].dist = dval;
+        out_dist[i].id = d;
+    }
+
+    return 0;
+}
+
+int32
+gauden_dist_shortlist(gauden_t *g, int mgau, int32 feat, int32 n_top,
+                      mfcc_t *obs, gauden_dist_t *out_dist,
+                      uint16 const *list, int32 n_list)
+{
+    assert((n_top > 0) && (n_top <= g->n_density));
+
+    if (g->quant) {
+        int16 qobs[GAUDEN_QUANT_MAXLEN];
+        quant_obs(g->quant, feat, obs, g->featlen[feat], qobs);
+        g->quant->qeval(g->quant, qobs, mgau, feat, g->n_density,
+                        n_top, out_dist);
+        return 0;
+    }
+    if (list == NULL || n_list < n_top)
+        return compute_dist(out_dist, n_top, obs, g->featlen[feat],
+                            g->mean[mgau][feat], g->var[mgau][feat],
+                            g->det[mgau][feat], g->n_density);
+    return compute_dist_list(out_dist, n_top, obs, g->featlen[feat],
+                             g->mean[mgau][feat], g->var[mgau][feat],
+                             g->det[mgau][feat], list, n_list);
+}
+
 int32
 gauden_mllr_transform(gauden_t *g, ps_mllr_t *mllr, cmd_ln_t *config)
 {
     int32 i, m, f, d, *flen;
     const char *meanfile, *varfile;
     s3file_t *s;
+    int quant;
 
-    /* Free data if already here */
-    if (g->mean)
-        gauden_param_free(g->mean);
-    if (g->var)
-        gauden_param_free(g->var);
-    if (g->det)
-        ckd_free_3d(g->det);
-    if (g->featlen)
-        ckd_free(g->featlen);
-    g->det = NULL;
-    g->featlen = NULL;
+    /* Precomputed parameters can be adapted as long as the originals
+     * are there too, otherwise there is nothing to start from. */
+    meanfile = cmd_ln_str_r(config, "_mean");
+    varfile = cmd_ln_str_r(config, "_var");
+    if (meanfile == NULL || varfile == NULL) {
+        E_ERROR("Cannot adapt precomputed Gaussian parameters without means and variances\n");
+        return -1;
+    }
+    /* Free data if already here (remembering to quantize it again) */
+    quant = g->quant ? g->quant->simd : -1;
+    gauden_free_params(g);
 
     /* Reload means and variances (un-precomputed). */
-    meanfile = cmd_ln_str_r(config, "_mean");
     if ((s = s3file_map_file(meanfile)) == NULL) {
         E_ERROR_SYSTEM("Failed to open mean file '%s' for reading", meanfile);
         return -1;
@@ -491,7 +1376,6 @@ gauden_mllr_transform(gauden_t *g, ps_mllr_t *mllr, cmd_ln_t *config)
     g->mean = (mfcc_t ****)gauden_param_read(s, &g->n_mgau, &g->n_feat, &g->n_density,
                       &g->featlen);
     s3file_free(s);
-    varfile = cmd_ln_str_r(config, "_var");
     if ((s = s3file_map_file(varfile)) == NULL) {
         E_ERROR_SYSTEM("Failed to open mean file '%s' for reading", varfile);
         return -1;
@@ -543,5 +1427,10 @@ gauden_mllr_transform(gauden_t *g, ps_mllr_t *mllr, cmd_ln_t *config)
     /* Re-precompute (if we aren't adapting variances this isn't
      * actually necessary...) */
     gauden_dist_precompute(g, g->lmath, cmd_ln_float32_r(config, "-varfloor"));
+    if (quant != -1) {
+        if (gauden_set_quant(g, TRUE) < 0)
+            return -1;
+        gauden_set_quant_simd(g, quant);
+    }
     return 0;
 }
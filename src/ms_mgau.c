@@ -68,6 +68,8 @@
  *
  */
 
+#include <string.h>
+
 /* Local headers. */
 #include <soundswallower/ms_mgau.h>
 #include <soundswallower/export.h>
@@ -76,9 +78,42 @@ static ps_mgaufuncs_t ms_mgau_funcs = {
     "ms",
     ms_cont_mgau_frame_eval, /* frame_eval */
     ms_mgau_mllr_transform,  /* transform */
-    ms_mgau_free             /* free */
+    ms_mgau_free,            /* free */
+    NULL,                    /* frame_eval_block */
+    ms_mgau_share            /* share */
 };
 
+/**
+ * Allocate the state used for scoring, which is not shared.
+ */
+static void
+ms_mgau_init_scoring(ms_mgau_model_t *msg)
+{
+    gauden_t *g = msg->g;
+
+    msg->topn = cmd_ln_int32_r(msg->config, "-topn");
+    E_INFO("The value of topn: %d\n", msg->topn);
+    if (msg->topn == 0 || msg->topn > msg->g->n_density) {
+        E_WARN
+            ("-topn argument (%d) invalid or > #density codewords (%d); set to latter\n",
+             msg->topn, msg->g->n_density);
+        msg->topn = msg->g->n_density;
+    }
+
+    msg->dist = (gauden_dist_t ***)
+        ckd_calloc_3d(g->n_mgau, g->n_feat, msg->topn,
+                      sizeof(gauden_dist_t));
+    msg->mgau_active = ckd_calloc(g->n_mgau, sizeof(int8));
+
+    /* Worker threads, if requested. */
+    msg->pool = workpool_init(cmd_ln_int32_r(msg->config, "-nthreads"));
+    msg->worker_best = ckd_calloc(workpool_n_workers(msg->pool),
+                                  sizeof(*msg->worker_best));
+
+    msg->gs_cw = ckd_calloc(g->n_feat, sizeof(*msg->gs_cw));
+    msg->gs_fallback = cmd_ln_float32_r(msg->config, "-gsfallback");
+}
+
 EXPORT ps_mgau_t *
 ms_mgau_init_s3file(acmod_t *acmod,
                     s3file_t *means, s3file_t *vars, s3file_t *mixw,
@@ -141,19 +176,16 @@ ms_mgau_init_s3file(acmod_t *acmod,
         E_ERROR("Senones use fewer codebooks (%d) than present (%d)\n",
                 s->n_gauden, g->n_mgau);
 
-    msg->topn = cmd_ln_int32_r(config, "-topn");
-    E_INFO("The value of topn: %d\n", msg->topn);
-    if (msg->topn == 0 || msg->topn > msg->g->n_density) {
-        E_WARN
-            ("-topn argument (%d) invalid or > #density codewords (%d); set to latter\n",
-             msg->topn, msg->g->n_density);
-        msg->topn = msg->g->n_density;
+    /* Quantize the parameters here, since they may be shared. */
+    if (cmd_ln_boolean_r(config, "-quantgau")
+        && gauden_set_quant(g, TRUE) < 0)
+        E_WARN("Using floating-point Gaussian evaluation\n");
+    if ((msg->gs = gausel_init_config(config, g)) != NULL && g->quant) {
+        E_WARN("Gaussian selection is not used with -quantgau\n");
+        gausel_free(msg->gs);
+        msg->gs = NULL;
     }
-
-    msg->dist = (gauden_dist_t ***)
-        ckd_calloc_3d(g->n_mgau, g->n_feat, msg->topn,
-                      sizeof(gauden_dist_t));
-    msg->mgau_active = ckd_calloc(g->n_mgau, sizeof(int8));
+    ms_mgau_init_scoring(msg);
 
     mg = (ps_mgau_t *)msg;
     mg->vt = &ms_mgau_funcs;
@@ -171,6 +203,7 @@ ms_mgau_init(acmod_t *acmod)
     ps_mgau_t *mg;
     gauden_t *g;
     senone_t *s;
+    s3file_t *means, *vars;
     cmd_ln_t *config;
     logmath_t *lmath = acmod->lmath;
     bin_mdef_t *mdef = acmod->mdef;
@@ -183,10 +216,14 @@ ms_mgau_init(acmod_t *acmod)
     msg->g = NULL;
     msg->s = NULL;
     
-    if ((g = msg->g = gauden_init(cmd_ln_str_r(config, "_mean"),
-                             cmd_ln_str_r(config, "_var"),
-                             cmd_ln_float32_r(config, "-varfloor"),
-                             lmath)) == NULL) {
+    if (gauden_open_files(config, lmath, &means, &vars) < 0)
+        goto error_out;
+    g = msg->g = gauden_init_s3file(means, vars,
+                                    cmd_ln_float32_r(config, "-varfloor"),
+                                    lmath);
+    s3file_free(means);
+    s3file_free(vars);
+    if (g == NULL) {
 	E_ERROR("Failed to read means and variances\n");	
 	goto error_out;
     }
@@ -227,19 +264,16 @@ ms_mgau_init(acmod_t *acmod)
         E_ERROR("Senones use fewer codebooks (%d) than present (%d)\n",
                 s->n_gauden, g->n_mgau);
 
-    msg->topn = cmd_ln_int32_r(config, "-topn");
-    E_INFO("The value of topn: %d\n", msg->topn);
-    if (msg->topn == 0 || msg->topn > msg->g->n_density) {
-        E_WARN
-            ("-topn argument (%d) invalid or > #density codewords (%d); set to latter\n",
-             msg->topn, msg->g->n_density);
-        msg->topn = msg->g->n_density;
+    /* Quantize the parameters here, since they may be shared. */
+    if (cmd_ln_boolean_r(config, "-quantgau")
+        && gauden_set_quant(g, TRUE) < 0)
+        E_WARN("Using floating-point Gaussian evaluation\n");
+    if ((msg->gs = gausel_init_config(config, g)) != NULL && g->quant) {
+        E_WARN("Gaussian selection is not used with -quantgau\n");
+        gausel_free(msg->gs);
+        msg->gs = NULL;
     }
-
-    msg->dist = (gauden_dist_t ***)
-        ckd_calloc_3d(g->n_mgau, g->n_feat, msg->topn,
-                      sizeof(gauden_dist_t));
-    msg->mgau_active = ckd_calloc(g->n_mgau, sizeof(int8));
+    ms_mgau_init_scoring(msg);
 
     mg = (ps_mgau_t *)msg;
     mg->vt = &ms_mgau_funcs;
@@ -249,6 +283,23 @@ error_out:
     return NULL;    
 }
 
+ps_mgau_t *
+ms_mgau_share(ps_mgau_t *mg, acmod_t *acmod)
+{
+    ms_mgau_model_t *other = (ms_mgau_model_t *)mg;
+    ms_mgau_model_t *msg;
+
+    /* Parameters are the same, everything else is our own. */
+    msg = ckd_calloc(1, sizeof(*msg));
+    memcpy(msg, other, sizeof(*msg));
+    msg->base.frame_idx = 0;
+    msg->base.shared = mg;
+    msg->config = acmod->config;
+    ms_mgau_init_scoring(msg);
+
+    return ps_mgau_base(msg);
+}
+
 void
 ms_mgau_free(ps_mgau_t * mg)
 {
@@ -256,14 +307,19 @@ ms_mgau_free(ps_mgau_t * mg)
     if (msg == NULL)
         return;
 
-    if (msg->g)
+    if (msg->g && !mg->shared)
 	gauden_free(msg->g);
-    if (msg->s)
+    if (msg->s && !mg->shared)
         senone_free(msg->s);
+    if (!mg->shared)
+        gausel_free(msg->gs);
     if (msg->dist)
         ckd_free_3d((void *) msg->dist);
     if (msg->mgau_active)
         ckd_free(msg->mgau_active);
+    workpool_free(msg->pool);
+    ckd_free(msg->worker_best);
+    ckd_free(msg->gs_cw);
     
     ckd_free(msg);
 }
@@ -276,6 +332,76 @@ ms_mgau_mllr_transform(ps_mgau_t *s,
     return gauden_mllr_transform(msg->g, mllr, msg->config);
 }
 
+/* Arguments for the work functions below. */
+typedef struct ms_mgau_task_s {
+    ms_mgau_model_t *msg;
+    int16 *senscr;
+    uint8 *senone_active;
+    int32 n_senone_active;
+    mfcc_t **feat;
+    int32 compallsen;
+} ms_mgau_task_t;
+
+/* Compute topn gaussian density values for one worker's share of the
+ * (active) codebooks. */
+static void
+ms_mgau_dist_worker(void *arg, int worker, int n_workers)
+{
+    ms_mgau_task_t *t = (ms_mgau_task_t *)arg;
+    ms_mgau_model_t *msg = t->msg;
+    gauden_t *g = ms_mgau_gauden(msg);
+    int32 gid;
+
+    for (gid = worker; gid < g->n_mgau; gid += n_workers) {
+	if (!(t->compallsen || msg->mgau_active[gid]))
+            continue;
+        if (msg->gs) {
+            int32 f;
+            for (f = 0; f < g->n_feat; ++f) {
+                uint16 const *list;
+                int32 n_list;
+
+                list = gausel_shortlist(msg->gs, f, msg->gs_cw[f], gid, &n_list);
+                gauden_dist_shortlist(g, gid, f, ms_mgau_topn(msg), t->feat[f],
+                                      msg->dist[gid][f], list, n_list);
+            }
+        }
+        else
+	    gauden_dist(g, gid, ms_mgau_topn(msg), t->feat, msg->dist[gid]);
+    }
+}
+
+/* Compute senone scores for one worker's share of the active
+ * senones (a contiguous range of them) and find the best one. */
+static void
+ms_mgau_senone_worker(void *arg, int worker, int n_workers)
+{
+    ms_mgau_task_t *t = (ms_mgau_task_t *)arg;
+    ms_mgau_model_t *msg = t->msg;
+    senone_t *sen = ms_mgau_senone(msg);
+    int32 i, n, start, end, best;
+
+    n = t->compallsen ? (int32)sen->n_sen : t->n_senone_active;
+    start = n * worker / n_workers;
+    end = n * (worker + 1) / n_workers;
+    /* senone_active consists of deltas. */
+    n = 0;
+    if (!t->compallsen)
+	for (i = 0; i < start; i++)
+	    n += t->senone_active[i];
+    best = (int32) 0x7fffffff;
+    for (i = start; i < end; i++) {
+	int32 s = t->compallsen ? i : t->senone_active[i] + n;
+	t->senscr[s] = senone_eval(sen, s, msg->dist[sen->mgau[s]],
+				   ms_mgau_topn(msg));
+	if (best > t->senscr[s]) {
+	    best = t->senscr[s];
+	}
+	n = s;
+    }
+    msg->worker_best[worker] = best;
+}
+
 int32
 ms_cont_mgau_frame_eval(ps_mgau_t * mg,
 			int16 *senscr,
@@ -286,30 +412,57 @@ ms_cont_mgau_frame_eval(ps_mgau_t * mg,
 			int32 compallsen)
 {
     ms_mgau_model_t *msg = (ms_mgau_model_t *)mg;
+    ms_mgau_task_t t;
     int32 gid;
-    int32 topn;
     int32 best;
     gauden_t *g;
     senone_t *sen;
 
     (void)frame;
-    topn = ms_mgau_topn(msg);
     g = ms_mgau_gauden(msg);
     sen = ms_mgau_senone(msg);
 
-    if (compallsen) {
-	int32 s;
-
+    t.msg = msg;
+    t.senscr = senscr;
+    t.senone_active = senone_active;
+    t.n_senone_active = n_senone_active;
+    t.feat = feat;
+    t.compallsen = compallsen;
+    if (!compallsen) {
+	int32 i, n;
+	/* Flag all active mixture-gaussian codebooks */
 	for (gid = 0; gid < g->n_mgau; gid++)
-	    gauden_dist(g, gid, topn, feat, msg->dist[gid]);
+	    msg->mgau_active[gid] = 0;
 
-	best = (int32) 0x7fffffff;
-	for (s = 0; (uint32)s < sen->n_sen; s++) {
-	    senscr[s] = senone_eval(sen, s, msg->dist[sen->mgau[s]], topn);
-	    if (best > senscr[s]) {
-		best = senscr[s];
-	    }
+	n = 0;
+	for (i = 0; i < n_senone_active; i++) {
+	    /* senone_active consists of deltas. */
+	    int32 s = senone_active[i] + n;
+	    msg->mgau_active[sen->mgau[s]] = 1;
+	    n = s;
 	}
+    }
+
+    /* Find the Gaussian selection cells for this frame. */
+    if (msg->gs) {
+        int32 f;
+        for (f = 0; f < g->n_feat; ++f)
+            msg->gs_cw[f] = gausel_select(msg->gs, f, feat[f],
+                                          msg->gs_fallback);
+    }
+
+    /* Compute topn gaussian density values (for active codebooks),
+     * then senone scores. */
+    workpool_run(msg->pool, ms_mgau_dist_worker, &t);
+    workpool_run(msg->pool, ms_mgau_senone_worker, &t);
+    best = (int32) 0x7fffffff;
+    for (gid = 0; gid < workpool_n_workers(msg->pool); gid++) {
+	if (best > msg->worker_best[gid])
+	    best = msg->worker_best[gid];
+    }
+
+    if (compallsen) {
+	int32 s;
 
 	/* Normalize senone scores */
 	for (s = 0; (uint32)s < sen->n_sen; s++) {
@@ -323,34 +476,6 @@ ms_cont_mgau_frame_eval(ps_mgau_t * mg,
     }
     else {
 	int32 i, n;
-	/* Flag all active mixture-gaussian codebooks */
-	for (gid = 0; gid < g->n_mgau; gid++)
-	    msg->mgau_active[gid] = 0;
-
-	n = 0;
-	for (i = 0; i < n_senone_active; i++) {
-	    /* senone_active consists of deltas. */
-	    int32 s = senone_active[i] + n;
-	    msg->mgau_active[sen->mgau[s]] = 1;
-	    n = s;
-	}
-
-	/* Compute topn gaussian density values (for active codebooks) */
-	for (gid = 0; gid < g->n_mgau; gid++) {
-	    if (msg->mgau_active[gid])
-		gauden_dist(g, gid, topn, feat, msg->dist[gid]);
-	}
-
-	best = (int32) 0x7fffffff;
-	n = 0;
-	for (i = 0; i < n_senone_active; i++) {
-	    int32 s = senone_active[i] + n;
-	    senscr[s] = senone_eval(sen, s, msg->dist[sen->mgau[s]], topn);
-	    if (best > senscr[s]) {
-		best = senscr[s];
-	    }
-	    n = s;
-	}
 
 	/* Normalize senone scores */
 	n = 0;
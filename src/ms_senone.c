@@ -171,7 +171,7 @@ senone_mixw_read(senone_t *s, s3file_t *s3f, logmath_t *lmath)
                 ((void *) pdf, sizeof(float32), s->n_cw, s3f)
                 != (size_t)s->n_cw) {
                 E_ERROR("s3file_get (arraydata) failed\n");
-                return -1;
+                goto error_out;
             }
 
             /* Normalize and floor */
@@ -198,6 +198,7 @@ senone_mixw_read(senone_t *s, s3file_t *s3f, logmath_t *lmath)
         E_WARN("Weight normalization failed for %d mixture weights components\n", n_err);
     if (s3file_verify_chksum(s3f) < 0)
         goto error_out;
+    ckd_free(pdf);
     E_INFO
         ("Read mixture weights for %d senones: %d features x %d codewords\n",
          s->n_sen, s->n_feat, s->n_cw);
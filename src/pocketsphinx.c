@@ -53,6 +53,7 @@
 #include <soundswallower/jsgf.h>
 #include <soundswallower/hash_table.h>
 #include <soundswallower/cmdln_macro.h>
+#include <soundswallower/modelpack.h>
 #include <soundswallower/pocketsphinx.h>
 
 /* Local headers. */
@@ -115,7 +116,7 @@ ps_expand_model_config(ps_decoder_t *ps)
 #ifdef __EMSCRIPTEN__
     (void)ps;
 #else
-    char const *hmmdir, *featparams;
+    char const *hmmdir, *featparams, *packfn;
     /* Feature and front-end parameters that may be in feat.params */
     static const arg_t feat_defn[] = {
     waveform_to_cepstral_command_line_macro(),
@@ -125,11 +126,23 @@ ps_expand_model_config(ps_decoder_t *ps)
 
     /* Get acoustic model filenames and add them to the command-line */
     hmmdir = cmd_ln_str_r(ps->config, "-hmm");
+    /* A precompiled model (see ps_model_write()) replaces the whole
+     * directory, though files given explicitly still override it. */
+    if (hmmdir && modelpack_is_pack(hmmdir)) {
+        E_INFO("Using precompiled acoustic model %s\n", hmmdir);
+        cmd_ln_set_str_extra_r(ps->config, "_pack", hmmdir);
+        hmmdir = NULL;
+    }
+    else
+        cmd_ln_set_str_extra_r(ps->config, "_pack", NULL);
     if (!ps_expand_file_config(ps, "-mdef", "_mdef", hmmdir, "mdef.bin"))
         if (!ps_expand_file_config(ps, "-mdef", "_mdef", hmmdir, "mdef"))
             ps_expand_file_config(ps, "-mdef", "_mdef", hmmdir, "mdef.txt");
     ps_expand_file_config(ps, "-mean", "_mean", hmmdir, "means");
     ps_expand_file_config(ps, "-var", "_var", hmmdir, "variances");
+    ps_expand_file_config(ps, "-gauden", "_gauden", hmmdir, "gauden");
+    ps_expand_file_config(ps, "-gausel", "_gausel", hmmdir, "gausel");
+    ps_expand_file_config(ps, "-mlp", "_mlp", hmmdir, "mlp");
     ps_expand_file_config(ps, "-tmat", "_tmat", hmmdir, "transition_matrices");
     ps_expand_file_config(ps, "-sendump", "_sendump", hmmdir, "sendump");
     ps_expand_file_config(ps, "-mixw", "_mixw", hmmdir, "mixture_weights");
@@ -145,6 +158,17 @@ ps_expand_model_config(ps_decoder_t *ps)
             E_INFO("Parsed model-specific feature parameters from %s\n",
                     featparams);
     }
+    else if ((packfn = cmd_ln_str_r(ps->config, "_pack"))) {
+        s3file_t *pack, *s = NULL;
+        if ((pack = modelpack_open(packfn)) != NULL
+            && (s = modelpack_section(pack, "featparams")) != NULL
+            && NULL != cmd_ln_parse_buf_r(ps->config, feat_defn, s->buf,
+                                          s->end - (const char *)s->buf, FALSE))
+            E_INFO("Parsed model-specific feature parameters from %s\n",
+                   packfn);
+        s3file_free(s);
+        s3file_free(pack);
+    }
 #endif /* not __EMSCRIPTEN__ */
 }
 
@@ -262,6 +286,15 @@ ps_init_config(ps_decoder_t *ps, cmd_ln_t *config)
     return 0;
 }
 
+/* Stop sharing a model, since we are loading our own. */
+static void
+ps_release_model(ps_decoder_t *ps)
+{
+    ps_model_free(ps->model);
+    ps->model = NULL;
+    ps->use_model = FALSE;
+}
+
 EXPORT int
 ps_init_cleanup(ps_decoder_t *ps)
 {
@@ -281,14 +314,39 @@ ps_init_fe(ps_decoder_t *ps)
     return ps->fe;
 }
 
-feat_t *
-ps_init_feat(ps_decoder_t *ps)
+/* Get the precompiled model, if any, that ps_expand_model_config() found. */
+static const char *
+ps_pack_path(ps_decoder_t *ps)
 {
-    if (ps->config == NULL)
+    if (!cmd_ln_exists_r(ps->config, "_pack"))
         return NULL;
-    feat_free(ps->fcb);
-    ps->fcb = feat_init(ps->config);
-    return ps->fcb;
+    return cmd_ln_str_r(ps->config, "_pack");
+}
+
+/* Open a file given in the configuration, or failing that, the
+ * corresponding section of the precompiled model (or nothing). */
+static int
+ps_open_model_file(ps_decoder_t *ps, const char *extra_arg,
+                   const char *name, s3file_t **out_s3f)
+{
+    const char *path;
+    s3file_t *pack;
+
+    *out_s3f = NULL;
+    if ((path = cmd_ln_str_r(ps->config, extra_arg)) != NULL) {
+        if ((*out_s3f = s3file_map_file(path)) == NULL) {
+            E_ERROR_SYSTEM("Failed to open %s", path);
+            return -1;
+        }
+        return 0;
+    }
+    if ((path = ps_pack_path(ps)) == NULL)
+        return 0;
+    if ((pack = modelpack_open(path)) == NULL)
+        return -1;
+    *out_s3f = modelpack_section(pack, name);
+    s3file_free(pack);
+    return 0;
 }
 
 EXPORT feat_t *
@@ -301,6 +359,24 @@ ps_init_feat_s3file(ps_decoder_t *ps, s3file_t *lda)
     return ps->fcb;
 }
 
+feat_t *
+ps_init_feat(ps_decoder_t *ps)
+{
+    if (ps->config == NULL)
+        return NULL;
+    if (ps_pack_path(ps)) {
+        s3file_t *lda;
+        if (ps_open_model_file(ps, "_lda", "lda", &lda) < 0)
+            return NULL;
+        ps_init_feat_s3file(ps, lda);
+        s3file_free(lda);
+        return ps->fcb;
+    }
+    feat_free(ps->fcb);
+    ps->fcb = feat_init(ps->config);
+    return ps->fcb;
+}
+
 EXPORT acmod_t *
 ps_init_acmod_pre(ps_decoder_t *ps)
 {
@@ -312,6 +388,7 @@ ps_init_acmod_pre(ps_decoder_t *ps)
         return NULL;
     if (ps->fcb == NULL)
         return NULL;
+    ps_release_model(ps);
     acmod_free(ps->acmod);
     ps->acmod = acmod_create(ps->config, ps->lmath, ps->fe, ps->fcb);
     return ps->acmod;
@@ -338,45 +415,91 @@ ps_init_acmod(ps_decoder_t *ps)
         return NULL;
     if (ps->fcb == NULL)
         return NULL;
+    ps_release_model(ps);
     acmod_free(ps->acmod);
     ps->acmod = acmod_init(ps->config, ps->lmath, ps->fe, ps->fcb);
     return ps->acmod;
 }
 
-dict_t *
-ps_init_dict(ps_decoder_t *ps)
+EXPORT int
+ps_init_model(ps_decoder_t *ps, ps_model_t *model)
+{
+    if (ps->config == NULL)
+        return -1;
+    if (ps->fe == NULL)
+        return -1;
+    if (ps->fcb == NULL)
+        return -1;
+    if (model != ps->model) {
+        ps_model_retain(model);
+        ps_model_free(ps->model);
+        ps->model = model;
+    }
+    ps->use_model = TRUE;
+    /* Transition and acoustic scores are in its log base. */
+    logmath_free(ps->lmath);
+    ps->lmath = logmath_retain(model->lmath);
+    acmod_free(ps->acmod);
+    ps->acmod = acmod_create(ps->config, ps->lmath, ps->fe, ps->fcb);
+    if (ps->acmod == NULL)
+        return -1;
+    if (acmod_share_am(ps->acmod, model->acmod) < 0)
+        return -1;
+    if (acmod_init_senscr(ps->acmod) < 0)
+        return -1;
+    dict_free(ps->dict);
+    dict2pid_free(ps->d2p);
+    ps->dict = dict_retain(model->dict);
+    ps->d2p = dict2pid_retain(model->d2p);
+    return 0;
+}
+
+EXPORT dict_t *
+ps_init_dict_s3file(ps_decoder_t *ps, s3file_t *dict, s3file_t *fdict)
 {
     if (ps->config == NULL)
         return NULL;
     if (ps->acmod == NULL)
         return NULL;
+    ps_release_model(ps);
     /* Free old dictionary */
     dict_free(ps->dict);
     /* Free d2p */
     dict2pid_free(ps->d2p);
     /* Dictionary and triphone mappings (depends on acmod). */
     /* FIXME: pass config, change arguments, implement LTS, etc. */
-    if ((ps->dict = dict_init(ps->config, ps->acmod->mdef)) == NULL)
+    if ((ps->dict = dict_init_s3file(ps->config, ps->acmod->mdef, dict, fdict)) == NULL)
         return NULL;
     if ((ps->d2p = dict2pid_build(ps->acmod->mdef, ps->dict)) == NULL)
         return NULL;
     return ps->dict;
 }
 
-EXPORT dict_t *
-ps_init_dict_s3file(ps_decoder_t *ps, s3file_t *dict, s3file_t *fdict)
+dict_t *
+ps_init_dict(ps_decoder_t *ps)
 {
     if (ps->config == NULL)
         return NULL;
     if (ps->acmod == NULL)
         return NULL;
+    if (ps_pack_path(ps)) {
+        s3file_t *dict = NULL, *fdict = NULL;
+        dict_t *d = NULL;
+        if (ps_open_model_file(ps, "_dict", "dict", &dict) == 0
+            && ps_open_model_file(ps, "_fdict", "fdict", &fdict) == 0)
+            d = ps_init_dict_s3file(ps, dict, fdict);
+        s3file_free(dict);
+        s3file_free(fdict);
+        return d;
+    }
+    ps_release_model(ps);
     /* Free old dictionary */
     dict_free(ps->dict);
     /* Free d2p */
     dict2pid_free(ps->d2p);
     /* Dictionary and triphone mappings (depends on acmod). */
     /* FIXME: pass config, change arguments, implement LTS, etc. */
-    if ((ps->dict = dict_init_s3file(ps->config, ps->acmod->mdef, dict, fdict)) == NULL)
+    if ((ps->dict = dict_init(ps->config, ps->acmod->mdef)) == NULL)
         return NULL;
     if ((ps->d2p = dict2pid_build(ps->acmod->mdef, ps->dict)) == NULL)
         return NULL;
@@ -472,10 +595,16 @@ ps_reinit(ps_decoder_t *ps, cmd_ln_t *config)
         return -1;
     if (ps_init_feat(ps) == NULL)
         return -1;
-    if (ps_init_acmod(ps) == NULL)
-        return -1;
-    if (ps_init_dict(ps) == NULL)
-        return -1;
+    if (ps->use_model) {
+        if (ps_init_model(ps, ps->model) < 0)
+            return -1;
+    }
+    else {
+        if (ps_init_acmod(ps) == NULL)
+            return -1;
+        if (ps_init_dict(ps) == NULL)
+            return -1;
+    }
     if (ps_init_grammar(ps) < 0)
         return -1;
     
@@ -502,6 +631,135 @@ ps_init(cmd_ln_t *config)
     return ps;
 }
 
+EXPORT ps_decoder_t *
+ps_init_shared(ps_model_t *model, cmd_ln_t *config)
+{
+    ps_decoder_t *ps;
+
+    ps = ckd_calloc(1, sizeof(*ps));
+    ps->refcount = 1;
+    ps->model = ps_model_retain(model);
+    ps->use_model = TRUE;
+#ifdef __EMSCRIPTEN__
+    (void)config;
+    E_WARN("ps_init_shared(model, config) does nothing in JavaScript\n");
+#else
+    if (config == NULL)
+        config = model->config;
+    if (ps_reinit(ps, config) < 0) {
+        ps_free(ps);
+        return NULL;
+    }
+#endif
+    return ps;
+}
+
+/* Create a model from our parameters and the given acoustic model. */
+static ps_model_t *
+ps_model_create(ps_decoder_t *ps, acmod_t *acmod)
+{
+    ps_model_t *model;
+
+    model = ckd_calloc(1, sizeof(*model));
+    model->refcount = 1;
+    model->config = cmd_ln_retain(ps->config);
+    model->lmath = logmath_retain(ps->lmath);
+    model->acmod = acmod;
+    model->dict = dict_retain(ps->dict);
+    model->d2p = dict2pid_retain(ps->d2p);
+    return model;
+}
+
+EXPORT ps_model_t *
+ps_model_init(cmd_ln_t *config)
+{
+#ifdef __EMSCRIPTEN__
+    (void)config;
+    E_WARN("ps_model_init(config) does nothing in JavaScript\n");
+    return NULL;
+#else
+    ps_decoder_t *ps;
+    ps_model_t *model = NULL;
+
+    /* Load everything just like a decoder would, but without any
+     * search, then keep the parts worth sharing. */
+    ps = ps_init(NULL);
+    if (ps_init_config(ps, config) < 0)
+        goto error_out;
+    if (ps_init_fe(ps) == NULL)
+        goto error_out;
+    if (ps_init_feat(ps) == NULL)
+        goto error_out;
+    if (ps_init_acmod(ps) == NULL)
+        goto error_out;
+    if (ps_init_dict(ps) == NULL)
+        goto error_out;
+    /* Nothing else will use its acmod, so it can be shared as is. */
+    model = ps_model_create(ps, acmod_retain(ps->acmod));
+error_out:
+    ps_free(ps);
+    return model;
+#endif
+}
+
+EXPORT ps_model_t *
+ps_model_retain(ps_model_t *model)
+{
+    ++model->refcount;
+    return model;
+}
+
+EXPORT int
+ps_model_free(ps_model_t *model)
+{
+    if (model == NULL)
+        return 0;
+    if (--model->refcount > 0)
+        return model->refcount;
+    dict2pid_free(model->d2p);
+    dict_free(model->dict);
+    acmod_free(model->acmod);
+    logmath_free(model->lmath);
+    cmd_ln_free_r(model->config);
+    ckd_free(model);
+    return 0;
+}
+
+EXPORT cmd_ln_t *
+ps_model_get_config(ps_model_t *model)
+{
+    return model->config;
+}
+
+EXPORT int
+ps_model_write(ps_model_t *model, const char *outfile)
+{
+    return modelpack_write(model->config, model->lmath, outfile);
+}
+
+EXPORT ps_model_t *
+ps_get_model(ps_decoder_t *ps)
+{
+    ps_decoder_t *tmp;
+    acmod_t *acmod = NULL;
+
+    if (ps->model)
+        return ps->model;
+    if (ps->acmod == NULL || ps->dict == NULL || ps->d2p == NULL)
+        return NULL;
+    /* Our feature computation and scoring state stay ours, so the
+     * model gets its own, and only the parameters are shared. */
+    tmp = ps_init(NULL);
+    tmp->config = cmd_ln_retain(ps->config);
+    if (ps_init_fe(tmp) != NULL && ps_init_feat(tmp) != NULL)
+        acmod = acmod_split_am(ps->acmod, tmp->fe, tmp->fcb);
+    ps_free(tmp);
+    if (acmod == NULL)
+        return NULL;
+    ps->model = ps_model_create(ps, acmod);
+    return ps->model;
+}
+
 EXPORT arg_t const *
 ps_args(void)
 {
@@ -528,6 +786,7 @@ ps_free(ps_decoder_t *ps)
     feat_free(ps->fcb);
     fe_free(ps->fe);
     acmod_free(ps->acmod);
+    ps_model_free(ps->model);
     logmath_free(ps->lmath);
     cmd_ln_free_r(ps->config);
 #ifndef __EMSCRIPTEN__
@@ -695,6 +954,16 @@ ps_add_word(ps_decoder_t *ps,
     }
     ckd_free(phonestr);
 
+    /* Other decoders shouldn't see it, so make our own dictionary. */
+    if (ps->model && ps->dict == ps->model->dict) {
+        dict_t *dict = dict_copy(ps->dict);
+        dict2pid_t *d2p = dict2pid_build(ps->acmod->mdef, dict);
+        dict_free(ps->dict);
+        dict2pid_free(ps->d2p);
+        ps->dict = dict;
+        ps->d2p = d2p;
+    }
+
     /* Add it to the dictionary. */
     if ((wid = dict_add_word(ps->dict, word, pron, np)) == -1) {
         ckd_free(pron);
@@ -902,6 +1171,46 @@ ps_process_cep(ps_decoder_t *ps,
     return n_searchfr;
 }
 
+EXPORT int
+ps_process_senscr(ps_decoder_t *ps,
+                  int16 const *senscr,
+                  int n_senone,
+                  int n_frames,
+                  int no_search)
+{
+    int n_searchfr = 0;
+
+    if (ps->acmod->state == ACMOD_IDLE) {
+	E_ERROR("Failed to process data, utterance is not started. Use start_utt to start it\n");
+	return 0;
+    }
+    if (n_senone != bin_mdef_n_sen(ps->acmod->mdef)) {
+        E_ERROR("Number of senones %d does not match acoustic model (%d)\n",
+                n_senone, bin_mdef_n_sen(ps->acmod->mdef));
+        return -1;
+    }
+
+    if (no_search)
+        acmod_set_grow(ps->acmod, TRUE);
+
+    while (n_frames) {
+        int nfr;
+
+        /* Queue up some scores. */
+        if ((nfr = acmod_process_senscr(ps->acmod, &senscr, &n_frames)) < 0)
+            return nfr;
+
+        /* Search as much data as possible */
+        if (no_search)
+            continue;
+        if ((nfr = ps_search_forward(ps)) < 0)
+            return nfr;
+        n_searchfr += nfr;
+    }
+
+    return n_searchfr;
+}
+
 EXPORT int
 ps_end_utt(ps_decoder_t *ps)
 {
@@ -1022,8 +1331,16 @@ ps_seg_word(ps_seg_t *seg)
 EXPORT void
 ps_seg_frames(ps_seg_t *seg, int *out_sf, int *out_ef)
 {
-    if (out_sf) *out_sf = seg->sf;
-    if (out_ef) *out_ef = seg->ef;
+    int sf = seg->sf, ef = seg->ef;
+
+    /* Report times in the input, including any silence dropped by
+     * the VAD. */
+    if (seg->search && ps_search_acmod(seg->search)) {
+        sf = acmod_input_frame(ps_search_acmod(seg->search), sf);
+        ef = acmod_input_frame(ps_search_acmod(seg->search), ef);
+    }
+    if (out_sf) *out_sf = sf;
+    if (out_ef) *out_ef = ef;
 }
 
 EXPORT int32
@@ -1115,7 +1432,7 @@ ps_nbest_seg(ps_nbest_t *nbest)
 int
 ps_get_n_frames(ps_decoder_t *ps)
 {
-    return ps->acmod->output_frame + 1;
+    return acmod_input_frame(ps->acmod, ps->acmod->output_frame + 1);
 }
 
 void
@@ -46,6 +46,7 @@
 #include <assert.h>
 #include <limits.h>
 #include <math.h>
+#include <float.h>
 
 #include <soundswallower/cmd_ln.h>
 #include <soundswallower/ckd_alloc.h>
@@ -53,15 +54,36 @@
 #include <soundswallower/prim_type.h>
 #include <soundswallower/tied_mgau_common.h>
 #include <soundswallower/ptm_mgau.h>
+#include <soundswallower/simd.h>
 #include <soundswallower/export.h>
 
+#if defined(HAVE_SIMD_X86)
+#include <immintrin.h>
+#elif defined(HAVE_SIMD_NEON)
+#include <arm_neon.h>
+#endif
+
 static ps_mgaufuncs_t ptm_mgau_funcs = {
     "ptm",
     ptm_mgau_frame_eval,      /* frame_eval */
     ptm_mgau_mllr_transform,  /* transform */
-    ptm_mgau_free             /* free */
+    ptm_mgau_free,            /* free */
+    ptm_mgau_frame_eval_block,/* frame_eval_block */
+    ptm_mgau_share            /* share */
 };
 
+/* Arguments for the work functions run by ptm_mgau_t::pool */
+typedef struct ptm_task_s {
+    ptm_mgau_t *s;
+    mfcc_t ***feats;
+    int frame;
+    int n_frames;
+    int16 *senone_scores;
+    uint8 *senone_active;
+    int32 n_senone_active;
+    int compall;
+} ptm_task_t;
+
 #define COMPUTE_GMM_MAP(_idx)                           \
     diff[_idx] = obs[_idx] - mean[_idx];                \
     sqdiff[_idx] = MFCCMUL(diff[_idx], diff[_idx]);     \
@@ -86,12 +108,12 @@ insertion_sort_topn(ptm_topn_t *topn, int i, int32 d)
 }
 
 static int
-eval_topn(ptm_mgau_t *s, int cb, int feat, mfcc_t *z)
+eval_topn(ptm_mgau_t *s, ptm_fast_eval_t *f, int cb, int feat, mfcc_t *z)
 {
     ptm_topn_t *topn;
     int i, ceplen;
 
-    topn = s->f->topn[cb][feat];
+    topn = f->topn[cb][feat];
     ceplen = s->g->featlen[feat];
 
     for (i = 0; i < s->max_topn; i++) {
@@ -112,8 +134,6 @@ eval_topn(ptm_mgau_t *s, int cb, int feat, mfcc_t *z)
             d = GMMSUB(d, compl[0]);
             ++var;
         }
-        /* We could vectorize this but it's unlikely to make much
-         * difference as the outer loop here isn't very big. */
         for (;j < ceplen; j += 4) {
             COMPUTE_GMM_MAP(0);
             COMPUTE_GMM_MAP(1);
@@ -147,14 +167,14 @@ insertion_sort_cb(ptm_topn_t **cur, ptm_topn_t *worst, ptm_topn_t *best,
 }
 
 static int
-eval_cb(ptm_mgau_t *s, int cb, int feat, mfcc_t *z)
+eval_cb(ptm_mgau_t *s, ptm_fast_eval_t *f, int cb, int feat, mfcc_t *z)
 {
     ptm_topn_t *worst, *best, *topn;
     mfcc_t *mean;
     mfcc_t *var, *det, *detP, *detE;
     int32 i, ceplen;
 
-    best = topn = s->f->topn[cb][feat];
+    best = topn = f->topn[cb][feat];
     worst = topn + (s->max_topn - 1);
     mean = s->g->mean[cb][feat][0];
     var = s->g->var[cb][feat][0];
@@ -183,9 +203,10 @@ eval_cb(ptm_mgau_t *s, int cb, int feat, mfcc_t *z)
             compl[0] = MFCCMUL(sqdiff[0], *var++);
             d = GMMSUB(d, compl[0]);
         }
-        /* Now do 4 dimensions at a time.  You'd think that GCC would
-         * vectorize this?  Apparently not.  And it's right, because
-         * that won't make this any faster, at least on x86-64. */
+        /* Now do 4 dimensions at a time.  Vectorizing this over
+         * dimensions doesn't help (and wouldn't give the same
+         * answer), see eval_cb_sse2() and friends below for what
+         * does. */
         for (; j < ceplen && d >= thresh; j += 4) {
             COMPUTE_GMM_MAP(0);
             COMPUTE_GMM_MAP(1);
@@ -221,30 +242,588 @@ eval_cb(ptm_mgau_t *s, int cb, int feat, mfcc_t *z)
 }
 
 /**
- * Compute top-N densities for active codebooks (and prune)
+ * Like eval_cb(), but only for the densities in the Gaussian
+ * selection shortlist for this frame.
  */
 static int
-ptm_mgau_codebook_eval(ptm_mgau_t *s, mfcc_t **z, int frame)
+eval_cb_shortlist(ptm_mgau_t *s, ptm_fast_eval_t *f, int cb, int feat, mfcc_t *z)
 {
-    int i, j;
+    ptm_topn_t *worst, *best, *topn;
+    uint16 const *list;
+    int32 i, l, n_list, ceplen;
 
-    /* First evaluate top-N from previous frame. */
-    for (i = 0; i < s->g->n_mgau; ++i)
-        for (j = 0; j < s->g->n_feat; ++j)
-            eval_topn(s, i, j, z[j]);
+    best = topn = f->topn[cb][feat];
+    worst = topn + (s->max_topn - 1);
+    ceplen = s->g->featlen[feat];
+    list = gausel_shortlist(s->gs, feat, f->gs_cw[feat], cb, &n_list);
 
-    /* If frame downsampling is in effect, possibly do nothing else. */
-    if (frame % s->ds_ratio)
-        return 0;
+    for (l = 0; l < n_list; ++l) {
+        mfcc_t diff[4], sqdiff[4], compl[4]; /* diff, diff^2, component likelihood */
+        mfcc_t *mean, *var, *obs, d, thresh;
+        ptm_topn_t *cur;
+        int32 cw, j;
 
-    /* Evaluate remaining codebooks. */
-    for (i = 0; i < s->g->n_mgau; ++i) {
-        if (bitvec_is_clear(s->f->mgau_active, i))
+        cw = list[l];
+        mean = s->g->mean[cb][feat][0] + cw * ceplen;
+        var = s->g->var[cb][feat][0] + cw * ceplen;
+        d = s->g->det[cb][feat][cw];
+        thresh = (mfcc_t) worst->score;
+        obs = z;
+        for (j = 0; (j < ceplen % 4) && (d >= thresh); ++j) {
+            diff[0] = *obs++ - *mean++;
+            sqdiff[0] = MFCCMUL(diff[0], diff[0]);
+            compl[0] = MFCCMUL(sqdiff[0], *var++);
+            d = GMMSUB(d, compl[0]);
+        }
+        for (; j < ceplen && d >= thresh; j += 4) {
+            COMPUTE_GMM_MAP(0);
+            COMPUTE_GMM_MAP(1);
+            COMPUTE_GMM_MAP(2);
+            COMPUTE_GMM_MAP(3);
+            COMPUTE_GMM_REDUCE(0);
+            COMPUTE_GMM_REDUCE(1);
+            COMPUTE_GMM_REDUCE(2);
+            COMPUTE_GMM_REDUCE(3);
+            var += 4;
+            obs += 4;
+            mean += 4;
+        }
+        if (j < ceplen || d < thresh)
+            continue;
+        for (i = 0; i < s->max_topn; i++) {
+            /* already there, so don't need to insert */
+            if (topn[i].cw == cw)
+                break;
+        }
+        if (i < s->max_topn)
+            continue;       /* already there.  Don't insert */
+        insertion_sort_cb(&cur, worst, best, cw, (int32)d);
+    }
+
+    return best->score;
+}
+
+/*
+ * Vectorized codebook evaluation.
+ *
+ * Rather than vectorizing over dimensions (which changes the order
+ * of the summation and thus the scores) these evaluate several
+ * densities at once, each one in its own lane, in exactly the same
+ * order as the scalar code above, so the results are bit-exact.  For
+ * eval_cb() this uses copies of the means and variances which are
+ * interleaved by blocks of densities (see ptm_mgau_interleave()).
+ * The early exit is done once all the lanes in a block have fallen
+ * below the threshold, and the survivors are then inserted in
+ * codeword order, each one checked against the current worst
+ * score, exactly as eval_cb() would have done.
+ */
+static void
+insert_cb_block(ptm_mgau_t *s, ptm_topn_t *topn, mfcc_t const *dist,
+                int cw, int n)
+{
+    ptm_topn_t *worst = topn + (s->max_topn - 1);
+    int i, l;
+
+    for (l = 0; l < n; ++l, ++cw) {
+        ptm_topn_t *cur;
+
+        if (dist[l] < (mfcc_t)worst->score)
+            continue;
+        for (i = 0; i < s->max_topn; i++) {
+            /* already there, so don't need to insert */
+            if (topn[i].cw == cw)
+                break;
+        }
+        if (i < s->max_topn)
+            continue;       /* already there.  Don't insert */
+        insertion_sort_cb(&cur, worst, topn, cw, (int32)dist[l]);
+    }
+}
+
+#if defined(HAVE_SIMD_X86)
+SIMD_TARGET("sse2") static int
+eval_topn_sse2(ptm_mgau_t *s, ptm_fast_eval_t *f, int cb, int feat, mfcc_t *z)
+{
+    ptm_topn_t *topn;
+    int i, ceplen;
+
+    topn = f->topn[cb][feat];
+    ceplen = s->g->featlen[feat];
+
+    for (i = 0; i < s->max_topn; i += 4) {
+        mfcc_t *mean[4], *var[4], dist[4];
+        __m128 d;
+        int32 j, l, n;
+
+        n = MIN(4, s->max_topn - i);
+        for (l = 0; l < 4; ++l) {
+            int32 cw = topn[i + (l < n ? l : 0)].cw;
+            mean[l] = s->g->mean[cb][feat][0] + cw * ceplen;
+            var[l] = s->g->var[cb][feat][0] + cw * ceplen;
+            dist[l] = s->g->det[cb][feat][cw];
+        }
+        d = _mm_loadu_ps(dist);
+        for (j = 0; j < ceplen % 4; ++j) {
+            __m128 diff = _mm_sub_ps(_mm_set1_ps(z[j]),
+                                     _mm_setr_ps(mean[0][j], mean[1][j],
+                                                 mean[2][j], mean[3][j]));
+            d = _mm_sub_ps(d, _mm_mul_ps(_mm_mul_ps(diff, diff),
+                                         _mm_setr_ps(var[0][j], var[1][j],
+                                                     var[2][j], var[3][j])));
+        }
+        for (; j < ceplen; j += 4) {
+            __m128 m[4], v[4];
+            for (l = 0; l < 4; ++l) {
+                m[l] = _mm_loadu_ps(mean[l] + j);
+                v[l] = _mm_loadu_ps(var[l] + j);
+            }
+            _MM_TRANSPOSE4_PS(m[0], m[1], m[2], m[3]);
+            _MM_TRANSPOSE4_PS(v[0], v[1], v[2], v[3]);
+            for (l = 0; l < 4; ++l) {
+                __m128 diff = _mm_sub_ps(_mm_set1_ps(z[j + l]), m[l]);
+                d = _mm_sub_ps(d, _mm_mul_ps(_mm_mul_ps(diff, diff), v[l]));
+            }
+        }
+        _mm_storeu_ps(dist, d);
+        /* This only touches topn[0..i+l], so it is safe to do it
+         * after reading the codewords. */
+        for (l = 0; l < n; ++l)
+            insertion_sort_topn(topn, i + l, (int32)dist[l]);
+    }
+
+    return topn[0].score;
+}
+
+SIMD_TARGET("sse2") static int
+eval_cb_sse2(ptm_mgau_t *s, ptm_fast_eval_t *f, int cb, int feat, mfcc_t *z)
+{
+    ptm_topn_t *topn, *worst;
+    mfcc_t *mean, *var, *det;
+    int32 cw, ceplen;
+
+    topn = f->topn[cb][feat];
+    worst = topn + (s->max_topn - 1);
+    mean = s->ilv_mean[cb][feat];
+    var = s->ilv_var[cb][feat];
+    det = s->ilv_det[cb][feat];
+    ceplen = s->g->featlen[feat];
+
+    for (cw = 0; cw < s->g->n_density; cw += 4) {
+        mfcc_t dist[4];
+        __m128 d, thresh;
+        int32 j, k;
+
+        d = _mm_loadu_ps(det);
+        thresh = _mm_set1_ps((mfcc_t)worst->score);
+        for (j = 0; j < ceplen; j = k) {
+            if (_mm_movemask_ps(_mm_cmpge_ps(d, thresh)) == 0)
+                break;
+            for (k = j; k < j + 4 && k < ceplen; ++k) {
+                __m128 diff = _mm_sub_ps(_mm_set1_ps(z[k]),
+                                         _mm_loadu_ps(mean + k * 4));
+                d = _mm_sub_ps(d, _mm_mul_ps(_mm_mul_ps(diff, diff),
+                                             _mm_loadu_ps(var + k * 4)));
+            }
+        }
+        mean += ceplen * 4;
+        var += ceplen * 4;
+        det += 4;
+        if (j < ceplen)
+            continue;
+        _mm_storeu_ps(dist, d);
+        insert_cb_block(s, topn, dist, cw, MIN(4, s->g->n_density - cw));
+    }
+
+    return topn[0].score;
+}
+
+SIMD_TARGET("avx2") static int
+eval_cb_avx2(ptm_mgau_t *s, ptm_fast_eval_t *f, int cb, int feat, mfcc_t *z)
+{
+    ptm_topn_t *topn, *worst;
+    mfcc_t *mean, *var, *det;
+    int32 cw, ceplen;
+
+    topn = f->topn[cb][feat];
+    worst = topn + (s->max_topn - 1);
+    mean = s->ilv_mean[cb][feat];
+    var = s->ilv_var[cb][feat];
+    det = s->ilv_det[cb][feat];
+    ceplen = s->g->featlen[feat];
+
+    for (cw = 0; cw < s->g->n_density; cw += 8) {
+        mfcc_t dist[8];
+        __m256 d, thresh;
+        int32 j, k;
+
+        d = _mm256_loadu_ps(det);
+        thresh = _mm256_set1_ps((mfcc_t)worst->score);
+        for (j = 0; j < ceplen; j = k) {
+            if (_mm256_movemask_ps(_mm256_cmp_ps(d, thresh, _CMP_GE_OQ)) == 0)
+                break;
+            for (k = j; k < j + 4 && k < ceplen; ++k) {
+                __m256 diff = _mm256_sub_ps(_mm256_set1_ps(z[k]),
+                                            _mm256_loadu_ps(mean + k * 8));
+                d = _mm256_sub_ps(d, _mm256_mul_ps(_mm256_mul_ps(diff, diff),
+                                                   _mm256_loadu_ps(var + k * 8)));
+            }
+        }
+        mean += ceplen * 8;
+        var += ceplen * 8;
+        det += 8;
+        if (j < ceplen)
+            continue;
+        _mm256_storeu_ps(dist, d);
+        insert_cb_block(s, topn, dist, cw, MIN(8, s->g->n_density - cw));
+    }
+
+    return topn[0].score;
+}
+
+SIMD_TARGET("avx512f") static int
+eval_cb_avx512(ptm_mgau_t *s, ptm_fast_eval_t *f, int cb, int feat, mfcc_t *z)
+{
+    ptm_topn_t *topn, *worst;
+    mfcc_t *mean, *var, *det;
+    int32 cw, ceplen;
+
+    topn = f->topn[cb][feat];
+    worst = topn + (s->max_topn - 1);
+    mean = s->ilv_mean[cb][feat];
+    var = s->ilv_var[cb][feat];
+    det = s->ilv_det[cb][feat];
+    ceplen = s->g->featlen[feat];
+
+    for (cw = 0; cw < s->g->n_density; cw += 16) {
+        mfcc_t dist[16];
+        __m512 d, thresh;
+        int32 j, k;
+
+        d = _mm512_loadu_ps(det);
+        thresh = _mm512_set1_ps((mfcc_t)worst->score);
+        for (j = 0; j < ceplen; j = k) {
+            if (_mm512_cmp_ps_mask(d, thresh, _CMP_GE_OQ) == 0)
+                break;
+            for (k = j; k < j + 4 && k < ceplen; ++k) {
+                __m512 diff = _mm512_sub_ps(_mm512_set1_ps(z[k]),
+                                            _mm512_loadu_ps(mean + k * 16));
+                d = _mm512_sub_ps(d, _mm512_mul_ps(_mm512_mul_ps(diff, diff),
+                                                   _mm512_loadu_ps(var + k * 16)));
+            }
+        }
+        mean += ceplen * 16;
+        var += ceplen * 16;
+        det += 16;
+        if (j < ceplen)
+            continue;
+        _mm512_storeu_ps(dist, d);
+        insert_cb_block(s, topn, dist, cw, MIN(16, s->g->n_density - cw));
+    }
+
+    return topn[0].score;
+}
+#endif /* HAVE_SIMD_X86 */
+
+#if defined(HAVE_SIMD_NEON)
+static int
+neon_any(uint32x4_t mask)
+{
+#if defined(__aarch64__)
+    return vmaxvq_u32(mask) != 0;
+#else
+    uint32x2_t m = vorr_u32(vget_low_u32(mask), vget_high_u32(mask));
+    return (vget_lane_u32(m, 0) | vget_lane_u32(m, 1)) != 0;
+#endif
+}
+
+static void
+neon_transpose4(float32x4_t *r)
+{
+    float32x4x2_t t01 = vtrnq_f32(r[0], r[1]);
+    float32x4x2_t t23 = vtrnq_f32(r[2], r[3]);
+    r[0] = vcombine_f32(vget_low_f32(t01.val[0]), vget_low_f32(t23.val[0]));
+    r[1] = vcombine_f32(vget_low_f32(t01.val[1]), vget_low_f32(t23.val[1]));
+    r[2] = vcombine_f32(vget_high_f32(t01.val[0]), vget_high_f32(t23.val[0]));
+    r[3] = vcombine_f32(vget_high_f32(t01.val[1]), vget_high_f32(t23.val[1]));
+}
+
+static int
+eval_topn_neon(ptm_mgau_t *s, ptm_fast_eval_t *f, int cb, int feat, mfcc_t *z)
+{
+    ptm_topn_t *topn;
+    int i, ceplen;
+
+    topn = f->topn[cb][feat];
+    ceplen = s->g->featlen[feat];
+
+    for (i = 0; i < s->max_topn; i += 4) {
+        mfcc_t *mean[4], *var[4], dist[4], tm[4], tv[4];
+        float32x4_t d;
+        int32 j, l, n;
+
+        n = MIN(4, s->max_topn - i);
+        for (l = 0; l < 4; ++l) {
+            int32 cw = topn[i + (l < n ? l : 0)].cw;
+            mean[l] = s->g->mean[cb][feat][0] + cw * ceplen;
+            var[l] = s->g->var[cb][feat][0] + cw * ceplen;
+            dist[l] = s->g->det[cb][feat][cw];
+        }
+        d = vld1q_f32(dist);
+        for (j = 0; j < ceplen % 4; ++j) {
+            float32x4_t diff;
+            for (l = 0; l < 4; ++l) {
+                tm[l] = mean[l][j];
+                tv[l] = var[l][j];
+            }
+            diff = vsubq_f32(vdupq_n_f32(z[j]), vld1q_f32(tm));
+            d = vsubq_f32(d, vmulq_f32(vmulq_f32(diff, diff), vld1q_f32(tv)));
+        }
+        for (; j < ceplen; j += 4) {
+            float32x4_t m[4], v[4];
+            for (l = 0; l < 4; ++l) {
+                m[l] = vld1q_f32(mean[l] + j);
+                v[l] = vld1q_f32(var[l] + j);
+            }
+            neon_transpose4(m);
+            neon_transpose4(v);
+            for (l = 0; l < 4; ++l) {
+                float32x4_t diff = vsubq_f32(vdupq_n_f32(z[j + l]), m[l]);
+                d = vsubq_f32(d, vmulq_f32(vmulq_f32(diff, diff), v[l]));
+            }
+        }
+        vst1q_f32(dist, d);
+        for (l = 0; l < n; ++l)
+            insertion_sort_topn(topn, i + l, (int32)dist[l]);
+    }
+
+    return topn[0].score;
+}
+
+static int
+eval_cb_neon(ptm_mgau_t *s, ptm_fast_eval_t *f, int cb, int feat, mfcc_t *z)
+{
+    ptm_topn_t *topn, *worst;
+    mfcc_t *mean, *var, *det;
+    int32 cw, ceplen;
+
+    topn = f->topn[cb][feat];
+    worst = topn + (s->max_topn - 1);
+    mean = s->ilv_mean[cb][feat];
+    var = s->ilv_var[cb][feat];
+    det = s->ilv_det[cb][feat];
+    ceplen = s->g->featlen[feat];
+
+    for (cw = 0; cw < s->g->n_density; cw += 4) {
+        mfcc_t dist[4];
+        float32x4_t d, thresh;
+        int32 j, k;
+
+        d = vld1q_f32(det);
+        thresh = vdupq_n_f32((mfcc_t)worst->score);
+        for (j = 0; j < ceplen; j = k) {
+            if (!neon_any(vcgeq_f32(d, thresh)))
+                break;
+            for (k = j; k < j + 4 && k < ceplen; ++k) {
+                float32x4_t diff = vsubq_f32(vdupq_n_f32(z[k]),
+                                             vld1q_f32(mean + k * 4));
+                d = vsubq_f32(d, vmulq_f32(vmulq_f32(diff, diff),
+                                           vld1q_f32(var + k * 4)));
+            }
+        }
+        mean += ceplen * 4;
+        var += ceplen * 4;
+        det += 4;
+        if (j < ceplen)
             continue;
-        for (j = 0; j < s->g->n_feat; ++j) {
-            eval_cb(s, i, j, z[j]);
+        vst1q_f32(dist, d);
+        insert_cb_block(s, topn, dist, cw, MIN(4, s->g->n_density - cw));
+    }
+
+    return topn[0].score;
+}
+#endif /* HAVE_SIMD_NEON */
+
+/**
+ * Make (or remove) interleaved copies of the means, variances and
+ * determinants for the vectorized eval_cb().
+ */
+static void
+ptm_mgau_interleave(ptm_mgau_t *s)
+{
+    int32 width, n_block, total, cb, f, cw, j;
+    mfcc_t *ptr;
+
+    if (s->ilv_mean) {
+        ckd_free(s->ilv_mean[0][0]);
+        ckd_free_2d(s->ilv_mean);
+        ckd_free_2d(s->ilv_var);
+        ckd_free_2d(s->ilv_det);
+        s->ilv_mean = s->ilv_var = s->ilv_det = NULL;
+    }
+    width = s->ilv_width;
+    if (width <= 1)
+        return;
+
+    n_block = (s->g->n_density + width - 1) / width;
+    for (total = f = 0; f < s->g->n_feat; ++f)
+        total += s->g->n_mgau * n_block * width * (2 * s->g->featlen[f] + 1);
+    s->ilv_mean = ckd_calloc_2d(s->g->n_mgau, s->g->n_feat, sizeof(mfcc_t *));
+    s->ilv_var = ckd_calloc_2d(s->g->n_mgau, s->g->n_feat, sizeof(mfcc_t *));
+    s->ilv_det = ckd_calloc_2d(s->g->n_mgau, s->g->n_feat, sizeof(mfcc_t *));
+    ptr = ckd_calloc(total, sizeof(*ptr));
+    for (cb = 0; cb < s->g->n_mgau; ++cb) {
+        for (f = 0; f < s->g->n_feat; ++f) {
+            int32 ceplen = s->g->featlen[f];
+            int32 blksize = ceplen * width;
+
+            s->ilv_mean[cb][f] = ptr;
+            ptr += n_block * blksize;
+            s->ilv_var[cb][f] = ptr;
+            ptr += n_block * blksize;
+            s->ilv_det[cb][f] = ptr;
+            ptr += n_block * width;
+            for (cw = 0; cw < n_block * width; ++cw) {
+                int32 blk = cw / width, lane = cw % width;
+                if (cw >= s->g->n_density) {
+                    /* Padding, which will never make the top-N */
+                    s->ilv_det[cb][f][cw] = -FLT_MAX;
+                    continue;
+                }
+                s->ilv_det[cb][f][cw] = s->g->det[cb][f][cw];
+                for (j = 0; j < ceplen; ++j) {
+                    s->ilv_mean[cb][f][blk * blksize + j * width + lane]
+                        = s->g->mean[cb][f][cw][j];
+                    s->ilv_var[cb][f][blk * blksize + j * width + lane]
+                        = s->g->var[cb][f][cw][j];
+                }
+            }
         }
     }
+}
+
+int
+ptm_mgau_set_simd(ps_mgau_t *ps, int level)
+{
+    ptm_mgau_t *s = (ptm_mgau_t *)ps;
+
+    /* The interleaved parameters belong to somebody else. */
+    if (ps->shared) {
+        E_ERROR("Cannot change instruction set of a shared model\n");
+        return s->simd;
+    }
+    s->eval_cb = eval_cb;
+    s->eval_topn = eval_topn;
+    s->ilv_width = 1;
+    switch (level) {
+#if defined(HAVE_SIMD_X86)
+    case SIMD_AVX512:
+        s->eval_cb = eval_cb_avx512;
+        s->eval_topn = eval_topn_sse2;
+        s->ilv_width = 16;
+        break;
+    case SIMD_AVX2:
+        s->eval_cb = eval_cb_avx2;
+        s->eval_topn = eval_topn_sse2;
+        s->ilv_width = 8;
+        break;
+    case SIMD_SSE2:
+        s->eval_cb = eval_cb_sse2;
+        s->eval_topn = eval_topn_sse2;
+        s->ilv_width = 4;
+        break;
+#endif
+#if defined(HAVE_SIMD_NEON)
+    case SIMD_NEON:
+        s->eval_cb = eval_cb_neon;
+        s->eval_topn = eval_topn_neon;
+        s->ilv_width = 4;
+        break;
+#endif
+    default:
+        level = SIMD_NONE;
+    }
+    s->simd = level;
+    ptm_mgau_interleave(s);
+
+    return level;
+}
+
+/**
+ * Compute top-N densities for one worker's share of the codebooks.
+ *
+ * Each codebook only touches its own top-N entries in s->hist, so
+ * they can be divided up among workers with no further ado.  When
+ * there are several frames, they are done one codebook at a time,
+ * so that its means and variances stay in the cache.
+ */
+static void
+ptm_mgau_codebook_eval_worker(void *arg, int worker, int n_workers)
+{
+    ptm_task_t *t = (ptm_task_t *)arg;
+    ptm_mgau_t *s = t->s;
+    int i, j, k;
+
+    for (i = worker; i < s->g->n_mgau; i += n_workers) {
+        for (k = 0; k < t->n_frames; ++k) {
+            int frame = t->frame + k;
+            ptm_fast_eval_t *f, *lastf;
+            mfcc_t **z = t->feats[k];
+
+            /* Get the previous frame's top-N information (on the
+             * first frame of the input this is just all WORST_DIST,
+             * no harm in that) */
+            f = s->hist + frame % s->n_fast_hist;
+            lastf = s->hist + (frame + s->n_fast_hist - 1) % s->n_fast_hist;
+            memcpy(f->topn[i][0], lastf->topn[i][0],
+                   s->g->n_feat * s->max_topn * sizeof(ptm_topn_t));
+
+            /* First evaluate top-N from previous frame. */
+            for (j = 0; j < s->g->n_feat; ++j)
+                (*s->eval_topn)(s, f, i, j, z[j]);
+
+            /* If frame downsampling is in effect, possibly do nothing else. */
+            if (frame % s->ds_ratio)
+                continue;
+
+            /* Evaluate remaining codebooks. */
+            if (bitvec_is_clear(f->mgau_active, i))
+                continue;
+            for (j = 0; j < s->g->n_feat; ++j) {
+                if (s->gs && f->gs_cw[j] >= 0)
+                    eval_cb_shortlist(s, f, i, j, z[j]);
+                else
+                    (*s->eval_cb)(s, f, i, j, z[j]);
+            }
+        }
+    }
+}
+
+/**
+ * Compute top-N densities for active codebooks (and prune) in one or
+ * more frames, whose active codebooks have already been set.
+ */
+static int
+ptm_mgau_codebook_eval(ptm_mgau_t *s, mfcc_t ***feats, int frame, int n_frames)
+{
+    ptm_task_t t;
+
+    /* Find the Gaussian selection cells for each frame. */
+    if (s->gs) {
+        int k, j;
+        for (k = 0; k < n_frames; ++k) {
+            ptm_fast_eval_t *f = s->hist + (frame + k) % s->n_fast_hist;
+            for (j = 0; j < s->g->n_feat; ++j)
+                f->gs_cw[j] = gausel_select(s->gs, j, feats[k][j],
+                                            s->gs_fallback);
+        }
+    }
+
+    memset(&t, 0, sizeof(t));
+    t.s = s;
+    t.feats = feats;
+    t.frame = frame;
+    t.n_frames = n_frames;
+    workpool_run(s->pool, ptm_mgau_codebook_eval_worker, &t);
     return 0;
 }
 
@@ -317,25 +896,24 @@ ptm_mgau_calc_cb_active(ptm_mgau_t *s, uint8 *senone_active,
 }
 
 /**
- * Compute senone scores from top-N densities for active codebooks.
+ * Compute senone scores for a range of entries in senone_active.
+ *
+ * @return the best score in this range.
  */
-static int
-ptm_mgau_senone_eval(ptm_mgau_t *s, int16 *senone_scores,
-                     uint8 *senone_active, int32 n_senone_active,
-                     int compall)
+static int32
+ptm_mgau_senone_eval_range(ptm_mgau_t *s, int16 *senone_scores,
+                           uint8 *senone_active, int32 start, int32 end,
+                           int compall)
 {
     int i, lastsen, bestscore;
 
-    memset(senone_scores, 0, s->n_sen * sizeof(*senone_scores));
-    /* FIXME: This is the non-cache-efficient way to do this.  We want
-     * to evaluate one codeword at a time but this requires us to have
-     * a reverse codebook to senone mapping, which we don't have
-     * (yet), since different codebooks have different top-N
-     * codewords. */
-    if (compall)
-        n_senone_active = s->n_sen;
+    /* Find the senone preceding this range. */
+    lastsen = 0;
+    if (!compall)
+        for (i = 0; i < start; ++i)
+            lastsen += senone_active[i];
     bestscore = 0x7fffffff;
-    for (lastsen = i = 0; i < n_senone_active; ++i) {
+    for (i = start; i < end; ++i) {
         int sen, f, cb;
         int ascore;
 
@@ -346,18 +924,6 @@ ptm_mgau_senone_eval(ptm_mgau_t *s, int16 *senone_scores,
         lastsen = sen;
         cb = s->sen2cb[sen];
 
-        if (bitvec_is_clear(s->f->mgau_active, cb)) {
-            int j;
-            /* Because senone_active is deltas we can't really "knock
-             * out" senones from pruned codebooks, and in any case,
-             * it wouldn't make any difference to the search code,
-             * which doesn't expect senone_active to change. */
-            for (f = 0; f < s->g->n_feat; ++f) {
-                for (j = 0; j < s->max_topn; ++j) {
-                    s->f->topn[cb][f][j].score = MAX_NEG_ASCR;
-                }
-            }
-        }
         /* For each feature, log-sum codeword scores + mixw to get
          * feature density, then sum (multiply) to get ascore */
         ascore = 0;
@@ -368,9 +934,12 @@ ptm_mgau_senone_eval(ptm_mgau_t *s, int16 *senone_scores,
             for (j = 0; j < s->max_topn; ++j) {
                 int mixw;
                 /* Find mixture weight for this codeword. */
-                if (s->mixw_cb) {
+                if (s->sen_mixw) {
+                    mixw = s->sen_mixw[sen][f * s->g->n_density + topn[j].cw];
+                }
+                else if (s->mixw_cb) {
                     int dcw = s->mixw[f][topn[j].cw][sen/2];
-                    dcw = (dcw & 1) ? dcw >> 4 : dcw & 0x0f;
+                    dcw = (sen & 1) ? dcw >> 4 : dcw & 0x0f;
                     mixw = s->mixw_cb[dcw];
                 }
                 else {
@@ -389,6 +958,72 @@ ptm_mgau_senone_eval(ptm_mgau_t *s, int16 *senone_scores,
         if (ascore < bestscore) bestscore = ascore;
         senone_scores[sen] = ascore;
     }
+    return bestscore;
+}
+
+/**
+ * Compute senone scores for one worker's share of the active senones.
+ */
+static void
+ptm_mgau_senone_eval_worker(void *arg, int worker, int n_workers)
+{
+    ptm_task_t *t = (ptm_task_t *)arg;
+    int32 n = t->compall ? t->s->n_sen : t->n_senone_active;
+
+    t->s->worker_best[worker]
+        = ptm_mgau_senone_eval_range(t->s, t->senone_scores,
+                                     t->senone_active,
+                                     n * worker / n_workers,
+                                     n * (worker + 1) / n_workers,
+                                     t->compall);
+}
+
+/**
+ * Compute senone scores from top-N densities for active codebooks.
+ */
+static int
+ptm_mgau_senone_eval(ptm_mgau_t *s, int16 *senone_scores,
+                     uint8 *senone_active, int32 n_senone_active,
+                     int compall)
+{
+    ptm_task_t t;
+    int i, cb, bestscore;
+
+    memset(senone_scores, 0, s->n_sen * sizeof(*senone_scores));
+    /* Unless sen_mixw is there (see ptm_mgau_set_senmajor()), this
+     * is the non-cache-efficient way to do this, since the top-N
+     * codewords for each senone are strided across the whole of
+     * mixw.  We could evaluate one codeword at a time but this
+     * requires a reverse codebook to senone mapping, which we don't
+     * have, since different codebooks have different top-N
+     * codewords. */
+    for (cb = 0; cb < s->g->n_mgau; ++cb) {
+        int f, j;
+        if (bitvec_is_set(s->f->mgau_active, cb))
+            continue;
+        /* Because senone_active is deltas we can't really "knock
+         * out" senones from pruned codebooks, and in any case, it
+         * wouldn't make any difference to the search code, which
+         * doesn't expect senone_active to change. */
+        for (f = 0; f < s->g->n_feat; ++f) {
+            for (j = 0; j < s->max_topn; ++j) {
+                s->f->topn[cb][f][j].score = MAX_NEG_ASCR;
+            }
+        }
+    }
+
+    memset(&t, 0, sizeof(t));
+    t.s = s;
+    t.senone_scores = senone_scores;
+    t.senone_active = senone_active;
+    t.n_senone_active = n_senone_active;
+    t.compall = compall;
+    workpool_run(s->pool, ptm_mgau_senone_eval_worker, &t);
+    bestscore = 0x7fffffff;
+    for (i = 0; i < workpool_n_workers(s->pool); ++i)
+        if (s->worker_best[i] < bestscore)
+            bestscore = s->worker_best[i];
+
     /* Normalize the scores again (finishing the job we started above
      * in ptm_mgau_codebook_eval...) */
     for (i = 0; i < s->n_sen; ++i) {
@@ -398,6 +1033,58 @@ ptm_mgau_senone_eval(ptm_mgau_t *s, int16 *senone_scores,
     return 0;
 }
 
+int
+ptm_mgau_set_senmajor(ps_mgau_t *ps, int enable)
+{
+    ptm_mgau_t *s = (ptm_mgau_t *)ps;
+    int n_feat = s->g->n_feat;
+    int n_density = s->g->n_density;
+    int cb, sen, f, cw;
+    uint8 *row;
+
+    if (ps->shared) {
+        E_ERROR("Cannot change mixture weights of a shared model\n");
+        return -1;
+    }
+    ckd_free(s->sen_mixw_buf);
+    ckd_free(s->sen_mixw);
+    s->sen_mixw_buf = NULL;
+    s->sen_mixw = NULL;
+    if (!enable)
+        return 0;
+
+    /* Rows of n_feat x n_density weights, one per senone, with the
+     * senones for each codebook next to each other, so that the
+     * top-N codewords for a senone share a cache line or two and
+     * active senones are visited more or less in memory order. */
+    s->sen_mixw_buf = ckd_calloc((size_t)s->n_sen * n_feat * n_density,
+                                 sizeof(*s->sen_mixw_buf));
+    s->sen_mixw = ckd_calloc(s->n_sen, sizeof(*s->sen_mixw));
+    row = s->sen_mixw_buf;
+    for (cb = 0; cb < s->g->n_mgau; ++cb) {
+        for (sen = 0; sen < s->n_sen; ++sen) {
+            if (s->sen2cb[sen] != cb)
+                continue;
+            s->sen_mixw[sen] = row;
+            for (f = 0; f < n_feat; ++f) {
+                for (cw = 0; cw < n_density; ++cw) {
+                    if (s->mixw_cb) {
+                        int dcw = s->mixw[f][cw][sen/2];
+                        dcw = (sen & 1) ? dcw >> 4 : dcw & 0x0f;
+                        *row++ = s->mixw_cb[dcw];
+                    }
+                    else {
+                        *row++ = s->mixw[f][cw][sen];
+                    }
+                }
+            }
+        }
+    }
+    E_INFO("Senone-major mixture weights: %d x %d x %d\n",
+           s->n_sen, n_feat, n_density);
+    return 0;
+}
+
 /**
  * Compute senone scores for the active senones.
  */
@@ -423,23 +1110,14 @@ ptm_mgau_frame_eval(ps_mgau_t *ps,
     /* Compute the top-N codewords for every codebook, unless this
      * is a past frame, in which case we already have them (we
      * hope!) */
-    if (frame >= ps_mgau_base(ps)->frame_idx) {
-        ptm_fast_eval_t *lastf;
-        /* Get the previous frame's top-N information (on the
-         * first frame of the input this is just all WORST_DIST,
-         * no harm in that) */
-        if (fast_eval_idx == 0)
-            lastf = s->hist + s->n_fast_hist - 1;
-        else
-            lastf = s->hist + fast_eval_idx - 1;
-        /* Copy in initial top-N info */
-        memcpy(s->f->topn[0][0], lastf->topn[0][0],
-               s->g->n_mgau * s->g->n_feat * s->max_topn * sizeof(ptm_topn_t));
+    if (frame >= ps_mgau_base(ps)->frame_idx
+        /* Or one that ptm_mgau_frame_eval_block() already did. */
+        && !(frame >= s->block_first && frame < s->block_end)) {
         /* Generate initial active codebook list (this might not be
          * necessary) */
         ptm_mgau_calc_cb_active(s, senone_active, n_senone_active, compallsen);
         /* Now evaluate top-N, prune, and evaluate remaining codebooks. */
-        ptm_mgau_codebook_eval(s, featbuf, frame);
+        ptm_mgau_codebook_eval(s, &featbuf, frame, 1);
         ptm_mgau_codebook_norm(s, featbuf, frame);
     }
     /* Evaluate intersection of active senones and active codebooks. */
@@ -449,6 +1127,32 @@ ptm_mgau_frame_eval(ps_mgau_t *ps,
     return 0;
 }
 
+int
+ptm_mgau_frame_eval_block(ps_mgau_t *ps, mfcc_t ***feats,
+                          int32 frame, int32 n_frames)
+{
+    ptm_mgau_t *s = (ptm_mgau_t *)ps;
+    int i;
+
+    /* We need to keep the frame before the block. */
+    if (n_frames > s->n_fast_hist - 1)
+        n_frames = s->n_fast_hist - 1;
+    /* We don't know which senones will be active in these frames, so
+     * all codebooks are active. */
+    for (i = 0; i < n_frames; ++i)
+        bitvec_set_all(s->hist[(frame + i) % s->n_fast_hist].mgau_active,
+                       s->g->n_mgau);
+    ptm_mgau_codebook_eval(s, feats, frame, n_frames);
+    for (i = 0; i < n_frames; ++i) {
+        s->f = s->hist + (frame + i) % s->n_fast_hist;
+        ptm_mgau_codebook_norm(s, feats[i], frame + i);
+    }
+    s->block_first = frame;
+    s->block_end = frame + n_frames;
+
+    return n_frames;
+}
+
 int
 read_sendump(s3file_t *s3f, gauden_t *g,
              int32 mdef_n_sen, uint8 **out_mixw_cb,
@@ -688,6 +1392,68 @@ read_mixw(s3file_t *s3f, gauden_t *g, logmath_t *lmath,
     return n_sen;
 }
 
+/**
+ * Allocate the state used for scoring, which is not shared.
+ */
+static void
+ptm_mgau_init_scoring(ptm_mgau_t *s)
+{
+    int i;
+
+    /* Allocate fast-match history buffers.  We need enough for the
+     * phoneme lookahead window, plus the current frame, plus one for
+     * good measure? (FIXME: I don't remember why) */
+    s->n_fast_hist = 2;
+    /* Or enough for a block of frames, plus the one before. */
+    if (cmd_ln_int32_r(s->config, "-gmmblock") > 1)
+        s->n_fast_hist = cmd_ln_int32_r(s->config, "-gmmblock") + 1;
+    s->hist = ckd_calloc(s->n_fast_hist, sizeof(*s->hist));
+    /* s->f will be a rotating pointer into s->hist. */
+    s->f = s->hist;
+    for (i = 0; i < s->n_fast_hist; ++i) {
+        int j, k, m;
+        /* Top-N codewords for every codebook and feature. */
+        s->hist[i].topn = ckd_calloc_3d(s->g->n_mgau, s->g->n_feat,
+                                        s->max_topn, sizeof(ptm_topn_t));
+        /* Initialize them to sane (yet arbitrary) defaults. */
+        for (j = 0; j < s->g->n_mgau; ++j) {
+            for (k = 0; k < s->g->n_feat; ++k) {
+                for (m = 0; m < s->max_topn; ++m) {
+                    s->hist[i].topn[j][k][m].cw = m;
+                    s->hist[i].topn[j][k][m].score = WORST_DIST;
+                }
+            }
+        }
+        /* Active codebook mapping (just codebook, not features,
+           at least not yet) */
+        s->hist[i].mgau_active = bitvec_alloc(s->g->n_mgau);
+        /* Start with them all on, prune them later. */
+        bitvec_set_all(s->hist[i].mgau_active, s->g->n_mgau);
+        s->hist[i].gs_cw = ckd_calloc(s->g->n_feat, sizeof(int32));
+    }
+    s->gs_fallback = cmd_ln_float32_r(s->config, "-gsfallback");
+
+    /* Worker threads, if requested. */
+    s->pool = workpool_init(cmd_ln_int32_r(s->config, "-nthreads"));
+    s->worker_best = ckd_calloc(workpool_n_workers(s->pool),
+                                sizeof(*s->worker_best));
+}
+
+static void
+ptm_mgau_free_scoring(ptm_mgau_t *s)
+{
+    int i;
+
+    workpool_free(s->pool);
+    ckd_free(s->worker_best);
+    for (i = 0; i < s->n_fast_hist; i++) {
+	ckd_free_3d(s->hist[i].topn);
+	bitvec_free(s->hist[i].mgau_active);
+	ckd_free(s->hist[i].gs_cw);
+    }
+    ckd_free(s->hist);
+}
+
 EXPORT ps_mgau_t *
 ptm_mgau_init_s3file(acmod_t *acmod, s3file_t *means, s3file_t *vars,
                      s3file_t *mixw, s3file_t *sendump)
@@ -759,40 +1525,19 @@ ptm_mgau_init_s3file(acmod_t *acmod, s3file_t *means, s3file_t *vars,
     s->ds_ratio = cmd_ln_int32_r(s->config, "-ds");
     s->max_topn = cmd_ln_int32_r(s->config, "-topn");
     E_INFO("Maximum top-N: %d\n", s->max_topn);
+    ptm_mgau_set_simd(ps_mgau_base(s), simd_detect());
+    E_INFO("Codebook evaluation using %s\n", simd_level_name(s->simd));
 
     /* Assume mapping of senones to their base phones, though this
      * will become more flexible in the future. */
     s->sen2cb = ckd_calloc(s->n_sen, sizeof(*s->sen2cb));
     for (i = 0; i < s->n_sen; ++i)
         s->sen2cb[i] = (uint8)bin_mdef_sen2cimap(acmod->mdef, i);
+    if (cmd_ln_boolean_r(s->config, "-senmajor"))
+        ptm_mgau_set_senmajor(ps_mgau_base(s), TRUE);
+    s->gs = gausel_init_config(s->config, s->g);
 
-    /* Allocate fast-match history buffers.  We need enough for the
-     * phoneme lookahead window, plus the current frame, plus one for
-     * good measure? (FIXME: I don't remember why) */
-    s->n_fast_hist = 2;
-    s->hist = ckd_calloc(s->n_fast_hist, sizeof(*s->hist));
-    /* s->f will be a rotating pointer into s->hist. */
-    s->f = s->hist;
-    for (i = 0; i < s->n_fast_hist; ++i) {
-        int j, k, m;
-        /* Top-N codewords for every codebook and feature. */
-        s->hist[i].topn = ckd_calloc_3d(s->g->n_mgau, s->g->n_feat,
-                                        s->max_topn, sizeof(ptm_topn_t));
-        /* Initialize them to sane (yet arbitrary) defaults. */
-        for (j = 0; j < s->g->n_mgau; ++j) {
-            for (k = 0; k < s->g->n_feat; ++k) {
-                for (m = 0; m < s->max_topn; ++m) {
-                    s->hist[i].topn[j][k][m].cw = m;
-                    s->hist[i].topn[j][k][m].score = WORST_DIST;
-                }
-            }
-        }
-        /* Active codebook mapping (just codebook, not features,
-           at least not yet) */
-        s->hist[i].mgau_active = bitvec_alloc(s->g->n_mgau);
-        /* Start with them all on, prune them later. */
-        bitvec_set_all(s->hist[i].mgau_active, s->g->n_mgau);
-    }
+    ptm_mgau_init_scoring(s);
 
     ps = (ps_mgau_t *)s;
     ps->vt = &ptm_mgau_funcs;
@@ -812,18 +1557,8 @@ ptm_mgau_init(acmod_t *acmod)
     const char *path;
     ps_mgau_t *ps = NULL;
 
-    path = cmd_ln_str_r(acmod->config, "_mean");
-    E_INFO("Reading mixture gaussian parameter: %s\n", path);
-    if ((means = s3file_map_file(path)) == NULL) {
-        E_ERROR_SYSTEM("Failed to open mean file '%s' for reading", path);
+    if (gauden_open_files(acmod->config, acmod->lmath, &means, &vars) < 0)
         goto error_out;
-    }
-    path = cmd_ln_str_r(acmod->config, "_var");
-    E_INFO("Reading mixture gaussian parameter: %s\n", path);
-    if ((vars = s3file_map_file(path)) == NULL) {
-        E_ERROR_SYSTEM("Failed to open variance file '%s' for reading", path);
-        goto error_out;
-    }
     if ((path = cmd_ln_str_r(acmod->config, "_sendump"))) {
         E_INFO("Loading senones from dump file %s\n", path);
         if ((sendump = s3file_map_file(path)) == NULL) {
@@ -855,17 +1590,48 @@ ptm_mgau_mllr_transform(ps_mgau_t *ps,
                             ps_mllr_t *mllr)
 {
     ptm_mgau_t *s = (ptm_mgau_t *)ps;
-    return gauden_mllr_transform(s->g, mllr, s->config);
+    int rv;
+
+    rv = gauden_mllr_transform(s->g, mllr, s->config);
+    /* Interleaved parameters have to be redone. */
+    ptm_mgau_interleave(s);
+    return rv;
+}
+
+ps_mgau_t *
+ptm_mgau_share(ps_mgau_t *ps, acmod_t *acmod)
+{
+    ptm_mgau_t *other = (ptm_mgau_t *)ps;
+    ptm_mgau_t *s;
+
+    /* Parameters are the same, everything else is our own. */
+    s = ckd_calloc(1, sizeof(*s));
+    memcpy(s, other, sizeof(*s));
+    s->base.frame_idx = 0;
+    s->base.shared = ps;
+    s->block_first = s->block_end = 0;
+    s->config = acmod->config;
+    s->lmath = logmath_retain(other->lmath);
+    s->lmath_8b = logmath_retain(other->lmath_8b);
+    s->ds_ratio = cmd_ln_int32_r(s->config, "-ds");
+    s->max_topn = cmd_ln_int32_r(s->config, "-topn");
+    ptm_mgau_init_scoring(s);
+
+    return ps_mgau_base(s);
 }
 
 void
 ptm_mgau_free(ps_mgau_t *ps)
 {
-    int i;
     ptm_mgau_t *s = (ptm_mgau_t *)ps;
 
+    ptm_mgau_free_scoring(s);
     logmath_free(s->lmath);
     logmath_free(s->lmath_8b);
+    if (ps->shared) {
+        ckd_free(s);
+        return;
+    }
     if (s->sendump_mmap) {
         ckd_free_2d(s->mixw); 
         s3file_free(s->sendump_mmap);
@@ -873,14 +1639,12 @@ ptm_mgau_free(ps_mgau_t *ps)
     else {
         ckd_free_3d(s->mixw);
     }
+    ckd_free(s->sen_mixw_buf);
+    ckd_free(s->sen_mixw);
     ckd_free(s->sen2cb);
-    
-    for (i = 0; i < s->n_fast_hist; i++) {
-	ckd_free_3d(s->hist[i].topn);
-	bitvec_free(s->hist[i].mgau_active);
-    }
-    ckd_free(s->hist);
-    
+    s->ilv_width = 0;
+    ptm_mgau_interleave(s);
+    gausel_free(s->gs);
     gauden_free(s->g);
     ckd_free(s);
 }
@@ -52,13 +52,22 @@
 #include <soundswallower/prim_type.h>
 #include <soundswallower/s2_semi_mgau.h>
 #include <soundswallower/tied_mgau_common.h>
+#include <soundswallower/simd.h>
 #include <soundswallower/export.h>
 
+#if defined(HAVE_SIMD_X86)
+#include <immintrin.h>
+#elif defined(HAVE_SIMD_NEON)
+#include <arm_neon.h>
+#endif
+
 static ps_mgaufuncs_t s2_semi_mgau_funcs = {
     "s2_semi",
     s2_semi_mgau_frame_eval,      /* frame_eval */
     s2_semi_mgau_mllr_transform,  /* transform */
-    s2_semi_mgau_free             /* free */
+    s2_semi_mgau_free,            /* free */
+    NULL,                         /* frame_eval_block */
+    s2_semi_mgau_share            /* share */
 };
 
 struct vqFeature_s {
@@ -730,34 +739,43 @@ get_scores_4b_feat_1(s2_semi_mgau_t * s, int i,
     return 0;
 }
 
+/**
+ * Compute the score for a single senone with 4-bit mixture weights.
+ */
+static inline int32
+get_scores_4b_sen(s2_semi_mgau_t * s, int i, int topn, int n)
+{
+    int32 k, tmp, cw;
+    uint8 *pid_cw;
+
+    pid_cw = s->mixw[i][s->f[i][0].codeword];
+    if (n & 1)
+        cw = pid_cw[n/2] >> 4;
+    else
+        cw = pid_cw[n/2] & 0x0f;
+    tmp = s->mixw_cb[cw] + s->f[i][0].score;
+    for (k = 1; k < topn; ++k) {
+        pid_cw = s->mixw[i][s->f[i][k].codeword];
+        if (n & 1)
+            cw = pid_cw[n/2] >> 4;
+        else
+            cw = pid_cw[n/2] & 0x0f;
+        tmp = fast_logmath_add(s->lmath_8b, tmp,
+                               s->mixw_cb[cw] + s->f[i][k].score);
+    }
+    return tmp;
+}
+
 static int32
 get_scores_4b_feat_any(s2_semi_mgau_t * s, int i, int topn,
                        int16 *senone_scores, uint8 *senone_active,
                        int32 n_senone_active)
 {
-    int32 j, k, l;
+    int32 j, l;
 
     for (l = j = 0; j < n_senone_active; j++) {
         int n = senone_active[j] + l;
-        int tmp, cw;
-        uint8 *pid_cw;
-    
-        pid_cw = s->mixw[i][s->f[i][0].codeword];
-        if (n & 1)
-            cw = pid_cw[n/2] >> 4;
-        else
-            cw = pid_cw[n/2] & 0x0f;
-        tmp = s->mixw_cb[cw] + s->f[i][0].score;
-        for (k = 1; k < topn; ++k) {
-            pid_cw = s->mixw[i][s->f[i][k].codeword];
-            if (n & 1)
-                cw = pid_cw[n/2] >> 4;
-            else
-                cw = pid_cw[n/2] & 0x0f;
-            tmp = fast_logmath_add(s->lmath_8b, tmp,
-                                   s->mixw_cb[cw] + s->f[i][k].score);
-        }
-        senone_scores[n] += tmp;
+        senone_scores[n] += get_scores_4b_sen(s, i, topn, n);
         l = n;
     }
     return 0;
@@ -792,12 +810,15 @@ get_scores_4b_feat(s2_semi_mgau_t * s, int i, int topn,
     }
 }
 
+/**
+ * Compute scores for all senones from j onwards.
+ */
 static int32
-get_scores_4b_feat_all(s2_semi_mgau_t * s, int i, int topn, int16 *senone_scores)
+get_scores_4b_feat_all_from(s2_semi_mgau_t * s, int i, int topn,
+                            int16 *senone_scores, int j)
 {
-    int j, last_sen;
+    int last_sen;
 
-    j = 0;
     /* Number of senones is always even, but don't overrun if it isn't. */
     last_sen = s->n_sen & ~1;
     while (j < last_sen) {
@@ -823,54 +844,373 @@ get_scores_4b_feat_all(s2_semi_mgau_t * s, int i, int topn, int16 *senone_scores
     return 0;
 }
 
+static int32
+get_scores_4b_feat_all(s2_semi_mgau_t * s, int i, int topn, int16 *senone_scores)
+{
+    return get_scores_4b_feat_all_from(s, i, topn, senone_scores, 0);
+}
+
 /*
- * Compute senone scores for the active senones.
+ * Vector versions of the 4-bit kernels.  The 16-entry mixture weight
+ * codebook fits in a byte shuffle, as do the first 32 entries of the
+ * 8-bit log-add table.  Only the first 31 are non-zero in practice
+ * (s2_semi_mgau_set_simd() checks this), so the log-add is done with
+ * a table lookup just like fast_logmath_add() and the results are
+ * exactly the same as the scalar code.  Scores are kept in 16-bit
+ * lanes since the log-add can take them slightly below zero.
+ *
+ * Senones are evaluated in blocks of 32, i.e. 16 bytes of weights.
+ * For the active list we evaluate any block containing an active
+ * senone, which is still cheaper than unpacking the nibbles one at a
+ * time unless very few senones are active.
  */
-int32
-s2_semi_mgau_frame_eval(ps_mgau_t *ps,
-                        int16 *senone_scores,
-                        uint8 *senone_active,
-                        int32 n_senone_active,
-			mfcc_t ** featbuf, int32 frame,
-			int32 compallsen)
+#define S2_SEMI_BLOCK 32
+
+#if defined(HAVE_SIMD_X86)
+SIMD_TARGET("avx2") static inline __m256i
+logadd_4b_avx2(__m256i a, __m256i b, __m256i tlo, __m256i thi)
+{
+    __m256i d, idx, t;
+
+    d = _mm256_min_epi16(_mm256_abs_epi16(_mm256_sub_epi16(a, b)),
+                         _mm256_set1_epi16(31));
+    /* Shuffle indices with the high bit set give zero, so the high
+     * byte of each lane comes out empty. */
+    idx = _mm256_or_si256(d, _mm256_set1_epi16((short)0x8000));
+    t = _mm256_blendv_epi8(_mm256_shuffle_epi8(tlo, idx),
+                           _mm256_shuffle_epi8(thi, idx),
+                           _mm256_cmpgt_epi16(d, _mm256_set1_epi16(15)));
+    return _mm256_sub_epi16(_mm256_min_epi16(a, b), t);
+}
+
+SIMD_TARGET("avx2") static inline void
+get_scores_4b_block_avx2(s2_semi_mgau_t * s, int i, int topn, int j,
+                         __m256i *out)
+{
+    uint8 const *table = (uint8 const *)LOGMATH_TABLE(s->lmath_8b)->table;
+    __m128i cb, mask;
+    __m256i tlo, thi, tmp0, tmp1;
+    int k;
+
+    cb = _mm_loadu_si128((__m128i const *)s->mixw_cb);
+    mask = _mm_set1_epi8(0x0f);
+    tlo = _mm256_broadcastsi128_si256(_mm_loadu_si128((__m128i const *)table));
+    thi = _mm256_broadcastsi128_si256(_mm_loadu_si128((__m128i const *)(table + 16)));
+    tmp0 = tmp1 = _mm256_setzero_si256();
+    for (k = 0; k < topn; ++k) {
+        __m128i pid, lo, hi;
+        __m256i score, w0, w1;
+
+        pid = _mm_loadu_si128((__m128i const *)
+                               (s->mixw[i][s->f[i][k].codeword] + j / 2));
+        lo = _mm_and_si128(pid, mask);
+        hi = _mm_and_si128(_mm_srli_epi16(pid, 4), mask);
+        score = _mm256_set1_epi16(s->f[i][k].score);
+        w0 = _mm256_add_epi16(_mm256_cvtepu8_epi16
+                              (_mm_shuffle_epi8(cb, _mm_unpacklo_epi8(lo, hi))),
+                              score);
+        w1 = _mm256_add_epi16(_mm256_cvtepu8_epi16
+                              (_mm_shuffle_epi8(cb, _mm_unpackhi_epi8(lo, hi))),
+                              score);
+        if (k == 0) {
+            tmp0 = w0;
+            tmp1 = w1;
+        }
+        else {
+            tmp0 = logadd_4b_avx2(tmp0, w0, tlo, thi);
+            tmp1 = logadd_4b_avx2(tmp1, w1, tlo, thi);
+        }
+    }
+    out[0] = tmp0;
+    out[1] = tmp1;
+}
+
+SIMD_TARGET("avx2") static int32
+get_scores_4b_feat_all_avx2(s2_semi_mgau_t * s, int i, int topn,
+                            int16 *senone_scores)
+{
+    int j;
+
+    for (j = 0; j + S2_SEMI_BLOCK <= s->n_sen; j += S2_SEMI_BLOCK) {
+        __m256i *sc = (__m256i *)(senone_scores + j);
+        __m256i tmp[2];
+
+        get_scores_4b_block_avx2(s, i, topn, j, tmp);
+        _mm256_storeu_si256(sc, _mm256_add_epi16(_mm256_loadu_si256(sc),
+                                                 tmp[0]));
+        _mm256_storeu_si256(sc + 1, _mm256_add_epi16(_mm256_loadu_si256(sc + 1),
+                                                     tmp[1]));
+    }
+    return get_scores_4b_feat_all_from(s, i, topn, senone_scores, j);
+}
+
+SIMD_TARGET("avx2") static int32
+get_scores_4b_feat_avx2(s2_semi_mgau_t * s, int i, int topn,
+                        int16 *senone_scores, uint8 *senone_active,
+                        int32 n_senone_active)
+{
+    int16 block[S2_SEMI_BLOCK];
+    int32 j, l, base, last_block;
+
+    /* Blocks can't read past the end of the weights. */
+    last_block = s->n_sen & ~(S2_SEMI_BLOCK - 1);
+    base = -S2_SEMI_BLOCK;
+    for (l = j = 0; j < n_senone_active; j++) {
+        int n = senone_active[j] + l;
+
+        if (n >= last_block)
+            senone_scores[n] += get_scores_4b_sen(s, i, topn, n);
+        else {
+            if (n - base >= S2_SEMI_BLOCK) {
+                __m256i tmp[2];
+
+                base = n & ~(S2_SEMI_BLOCK - 1);
+                get_scores_4b_block_avx2(s, i, topn, base, tmp);
+                _mm256_storeu_si256((__m256i *)block, tmp[0]);
+                _mm256_storeu_si256((__m256i *)(block + 16), tmp[1]);
+            }
+            senone_scores[n] += block[n - base];
+        }
+        l = n;
+    }
+    return 0;
+}
+#endif /* HAVE_SIMD_X86 */
+
+#if defined(HAVE_SIMD_NEON) && defined(__aarch64__)
+static inline int16x8_t
+logadd_4b_neon(int16x8_t a, int16x8_t b, uint8x16x2_t table)
+{
+    uint16x8_t d;
+    uint8x8_t t;
+
+    d = vminq_u16(vreinterpretq_u16_s16(vabdq_s16(a, b)), vdupq_n_u16(31));
+    t = vqtbl2_u8(table, vmovn_u16(d));
+    return vsubq_s16(vminq_s16(a, b), vreinterpretq_s16_u16(vmovl_u8(t)));
+}
+
+static inline void
+get_scores_4b_block_neon(s2_semi_mgau_t * s, int i, int topn, int j,
+                         int16x8_t *out)
+{
+    uint8 const *table = (uint8 const *)LOGMATH_TABLE(s->lmath_8b)->table;
+    uint8x16_t cb;
+    uint8x16x2_t t;
+    int k, m;
+
+    cb = vld1q_u8(s->mixw_cb);
+    t.val[0] = vld1q_u8(table);
+    t.val[1] = vld1q_u8(table + 16);
+    for (k = 0; k < topn; ++k) {
+        uint8x16_t pid, lo, hi, w0, w1;
+        int16x8_t score, w[4];
+
+        pid = vld1q_u8(s->mixw[i][s->f[i][k].codeword] + j / 2);
+        lo = vandq_u8(pid, vdupq_n_u8(0x0f));
+        hi = vshrq_n_u8(pid, 4);
+        w0 = vqtbl1q_u8(cb, vzip1q_u8(lo, hi));
+        w1 = vqtbl1q_u8(cb, vzip2q_u8(lo, hi));
+        score = vdupq_n_s16(s->f[i][k].score);
+        w[0] = vaddq_s16(vreinterpretq_s16_u16(vmovl_u8(vget_low_u8(w0))), score);
+        w[1] = vaddq_s16(vreinterpretq_s16_u16(vmovl_high_u8(w0)), score);
+        w[2] = vaddq_s16(vreinterpretq_s16_u16(vmovl_u8(vget_low_u8(w1))), score);
+        w[3] = vaddq_s16(vreinterpretq_s16_u16(vmovl_high_u8(w1)), score);
+        for (m = 0; m < 4; ++m)
+            out[m] = (k == 0) ? w[m] : logadd_4b_neon(out[m], w[m], t);
+    }
+}
+
+static int32
+get_scores_4b_feat_all_neon(s2_semi_mgau_t * s, int i, int topn,
+                            int16 *senone_scores)
+{
+    int j, m;
+
+    for (j = 0; j + S2_SEMI_BLOCK <= s->n_sen; j += S2_SEMI_BLOCK) {
+        int16x8_t tmp[4];
+
+        get_scores_4b_block_neon(s, i, topn, j, tmp);
+        for (m = 0; m < 4; ++m) {
+            int16 *sc = senone_scores + j + m * 8;
+            vst1q_s16(sc, vaddq_s16(vld1q_s16(sc), tmp[m]));
+        }
+    }
+    return get_scores_4b_feat_all_from(s, i, topn, senone_scores, j);
+}
+
+static int32
+get_scores_4b_feat_neon(s2_semi_mgau_t * s, int i, int topn,
+                        int16 *senone_scores, uint8 *senone_active,
+                        int32 n_senone_active)
+{
+    int16 block[S2_SEMI_BLOCK];
+    int32 j, l, m, base, last_block;
+
+    /* Blocks can't read past the end of the weights. */
+    last_block = s->n_sen & ~(S2_SEMI_BLOCK - 1);
+    base = -S2_SEMI_BLOCK;
+    for (l = j = 0; j < n_senone_active; j++) {
+        int n = senone_active[j] + l;
+
+        if (n >= last_block)
+            senone_scores[n] += get_scores_4b_sen(s, i, topn, n);
+        else {
+            if (n - base >= S2_SEMI_BLOCK) {
+                int16x8_t tmp[4];
+
+                base = n & ~(S2_SEMI_BLOCK - 1);
+                get_scores_4b_block_neon(s, i, topn, base, tmp);
+                for (m = 0; m < 4; ++m)
+                    vst1q_s16(block + m * 8, tmp[m]);
+            }
+            senone_scores[n] += block[n - base];
+        }
+        l = n;
+    }
+    return 0;
+}
+#endif /* HAVE_SIMD_NEON && __aarch64__ */
+
+int
+s2_semi_mgau_set_simd(ps_mgau_t *ps, int level)
 {
     s2_semi_mgau_t *s = (s2_semi_mgau_t *)ps;
-    int i, topn_idx;
-    int n_feat = s->g->n_feat;
+    logadd_t *t = LOGMATH_TABLE(s->lmath_8b);
+    uint32 d;
+
+    s->scores_4b = get_scores_4b_feat;
+    s->scores_4b_all = get_scores_4b_feat_all;
+    /* Vector log-add loads the first 32 entries, and uses the last
+     * of them for any larger difference, so it and the rest must be
+     * zero. */
+    if (t->table_size < 32)
+        level = SIMD_NONE;
+    for (d = 31; d < t->table_size; ++d) {
+        if (((uint8 *)t->table)[d] != 0) {
+            level = SIMD_NONE;
+            break;
+        }
+    }
+    switch (level) {
+#if defined(HAVE_SIMD_X86)
+    case SIMD_AVX512:
+    case SIMD_AVX2:
+        s->scores_4b = get_scores_4b_feat_avx2;
+        s->scores_4b_all = get_scores_4b_feat_all_avx2;
+        level = SIMD_AVX2;
+        break;
+#endif
+#if defined(HAVE_SIMD_NEON) && defined(__aarch64__)
+    case SIMD_NEON:
+        s->scores_4b = get_scores_4b_feat_neon;
+        s->scores_4b_all = get_scores_4b_feat_all_neon;
+        break;
+#endif
+    default:
+        level = SIMD_NONE;
+    }
+    s->simd = level;
 
-    memset(senone_scores, 0, s->n_sen * sizeof(*senone_scores));
-    /* No bounds checking is done here, which just means you'll get
-     * semi-random crap if you request a frame in the future or one
-     * that's too far in the past. */
-    topn_idx = frame % s->n_topn_hist;
-    s->f = s->topn_hist[topn_idx];
-    for (i = 0; i < n_feat; ++i) {
+    return level;
+}
+
+/* Arguments for s2_semi_mgau_feat_worker() */
+typedef struct s2_semi_task_s {
+    s2_semi_mgau_t *s;
+    int16 *senone_scores;
+    uint8 *senone_active;
+    int32 n_senone_active;
+    mfcc_t **featbuf;
+    int32 frame;
+    int32 compallsen;
+    int topn_idx;
+} s2_semi_task_t;
+
+/**
+ * Compute top-N and senone scores for one worker's share of the
+ * feature streams.
+ *
+ * Each feature has its own top-N, but they all add into the senone
+ * scores, so all workers but the first accumulate into their own
+ * buffer, and these are summed at the end.  Since this is integer
+ * addition the result is the same regardless of the order.
+ */
+static void
+s2_semi_mgau_feat_worker(void *arg, int worker, int n_workers)
+{
+    s2_semi_task_t *t = (s2_semi_task_t *)arg;
+    s2_semi_mgau_t *s = t->s;
+    int16 *senone_scores;
+    int i, topn_idx = t->topn_idx;
+
+    if (worker == 0)
+        senone_scores = t->senone_scores;
+    else {
+        senone_scores = s->worker_scores[worker];
+        memset(senone_scores, 0, s->n_sen * sizeof(*senone_scores));
+    }
+    for (i = worker; i < s->g->n_feat; i += n_workers) {
         /* For past frames this will already be computed. */
-        if (frame >= ps_mgau_base(ps)->frame_idx) {
+        if (t->frame >= ps_mgau_base(s)->frame_idx) {
             vqFeature_t **lastf;
             if (topn_idx == 0)
                 lastf = s->topn_hist[s->n_topn_hist-1];
             else
                 lastf = s->topn_hist[topn_idx-1];
             memcpy(s->f[i], lastf[i], sizeof(vqFeature_t) * s->max_topn);
-            mgau_dist(s, frame, i, featbuf[i]);
+            mgau_dist(s, t->frame, i, t->featbuf[i]);
             s->topn_hist_n[topn_idx][i] = mgau_norm(s, i);
         }
         if (s->mixw_cb) {
-            if (compallsen)
-                get_scores_4b_feat_all(s, i, s->topn_hist_n[topn_idx][i], senone_scores);
+            if (t->compallsen)
+                s->scores_4b_all(s, i, s->topn_hist_n[topn_idx][i], senone_scores);
             else
-                get_scores_4b_feat(s, i, s->topn_hist_n[topn_idx][i], senone_scores,
-                                   senone_active, n_senone_active);
+                s->scores_4b(s, i, s->topn_hist_n[topn_idx][i], senone_scores,
+                             t->senone_active, t->n_senone_active);
         }
         else {
-            if (compallsen)
+            if (t->compallsen)
                 get_scores_8b_feat_all(s, i, s->topn_hist_n[topn_idx][i], senone_scores);
             else
                 get_scores_8b_feat(s, i, s->topn_hist_n[topn_idx][i], senone_scores,
-                                   senone_active, n_senone_active);
+                                   t->senone_active, t->n_senone_active);
         }
     }
+}
+
+/**
+ * Compute senone scores for the active senones.
+ */
+int32
+s2_semi_mgau_frame_eval(ps_mgau_t *ps,
+                        int16 *senone_scores,
+                        uint8 *senone_active,
+                        int32 n_senone_active,
+			mfcc_t ** featbuf, int32 frame,
+			int32 compallsen)
+{
+    s2_semi_mgau_t *s = (s2_semi_mgau_t *)ps;
+    s2_semi_task_t t;
+    int i, j;
+
+    memset(senone_scores, 0, s->n_sen * sizeof(*senone_scores));
+    /* No bounds checking is done here, which just means you'll get
+     * semi-random crap if you request a frame in the future or one
+     * that's too far in the past. */
+    t.topn_idx = frame % s->n_topn_hist;
+    s->f = s->topn_hist[t.topn_idx];
+    t.s = s;
+    t.senone_scores = senone_scores;
+    t.senone_active = senone_active;
+    t.n_senone_active = n_senone_active;
+    t.featbuf = featbuf;
+    t.frame = frame;
+    t.compallsen = compallsen;
+    workpool_run(s->pool, s2_semi_mgau_feat_worker, &t);
+    for (i = 1; i < workpool_n_workers(s->pool); ++i) {
+        for (j = 0; j < s->n_sen; ++j)
+            senone_scores[j] += s->worker_scores[i][j];
+    }
 
     return 0;
 }
@@ -906,6 +1246,64 @@ split_topn(char const *str, uint8 *out, int nfeat)
 }
 
 
+/**
+ * Allocate the state used for scoring, which is not shared.
+ */
+static void
+s2_semi_mgau_init_scoring(s2_semi_mgau_t *s)
+{
+    int i;
+
+    /* Determine top-N for each feature */
+    s->topn_beam = ckd_calloc(s->g->n_feat, sizeof(*s->topn_beam));
+    s->max_topn = cmd_ln_int32_r(s->config, "-topn");
+    split_topn(cmd_ln_str_r(s->config, "-topn_beam"), s->topn_beam, s->g->n_feat);
+    E_INFO("Maximum top-N: %d ", s->max_topn);
+    E_INFOCONT("Top-N beams:");
+    for (i = 0; i < s->g->n_feat; ++i) {
+        E_INFOCONT(" %d", s->topn_beam[i]);
+    }
+    E_INFOCONT("\n");
+
+    /* Top-N scores from recent frames */
+    s->n_topn_hist = 2;
+    s->topn_hist = (vqFeature_t ***)
+        ckd_calloc_3d(s->n_topn_hist, s->g->n_feat, s->max_topn,
+                      sizeof(***s->topn_hist));
+    s->topn_hist_n = ckd_calloc_2d(s->n_topn_hist, s->g->n_feat,
+                                   sizeof(**s->topn_hist_n));
+    for (i = 0; i < s->n_topn_hist; ++i) {
+        int j;
+        for (j = 0; j < s->g->n_feat; ++j) {
+            int k;
+            for (k = 0; k < s->max_topn; ++k) {
+                s->topn_hist[i][j][k].score = WORST_DIST;
+                s->topn_hist[i][j][k].codeword = k;
+            }
+        }
+    }
+
+    /* Worker threads, if requested (no more than one per feature). */
+    i = cmd_ln_int32_r(s->config, "-nthreads");
+    s->pool = workpool_init(MIN(i, s->g->n_feat));
+    if (s->pool)
+        s->worker_scores = ckd_calloc_2d(workpool_n_workers(s->pool), s->n_sen,
+                                         sizeof(**s->worker_scores));
+}
+
+static void
+s2_semi_mgau_free_scoring(s2_semi_mgau_t *s)
+{
+    workpool_free(s->pool);
+    if (s->worker_scores)
+        ckd_free_2d(s->worker_scores);
+    ckd_free(s->topn_beam);
+    if (s->topn_hist_n)
+        ckd_free_2d(s->topn_hist_n);
+    if (s->topn_hist)
+        ckd_free_3d((void **)s->topn_hist);
+}
+
 EXPORT ps_mgau_t *
 s2_semi_mgau_init_s3file(acmod_t *acmod, s3file_t *means, s3file_t *vars,
                          s3file_t *mixw, s3file_t *sendump)
@@ -972,34 +1370,10 @@ s2_semi_mgau_init_s3file(acmod_t *acmod, s3file_t *means, s3file_t *vars,
     }
     s->ds_ratio = cmd_ln_int32_r(s->config, "-ds");
 
-    /* Determine top-N for each feature */
-    s->topn_beam = ckd_calloc(n_feat, sizeof(*s->topn_beam));
-    s->max_topn = cmd_ln_int32_r(s->config, "-topn");
-    split_topn(cmd_ln_str_r(s->config, "-topn_beam"), s->topn_beam, n_feat);
-    E_INFO("Maximum top-N: %d ", s->max_topn);
-    E_INFOCONT("Top-N beams:");
-    for (i = 0; i < n_feat; ++i) {
-        E_INFOCONT(" %d", s->topn_beam[i]);
-    }
-    E_INFOCONT("\n");
-
-    /* Top-N scores from recent frames */
-    s->n_topn_hist = 2;
-    s->topn_hist = (vqFeature_t ***)
-        ckd_calloc_3d(s->n_topn_hist, n_feat, s->max_topn,
-                      sizeof(***s->topn_hist));
-    s->topn_hist_n = ckd_calloc_2d(s->n_topn_hist, n_feat,
-                                   sizeof(**s->topn_hist_n));
-    for (i = 0; i < s->n_topn_hist; ++i) {
-        int j;
-        for (j = 0; j < n_feat; ++j) {
-            int k;
-            for (k = 0; k < s->max_topn; ++k) {
-                s->topn_hist[i][j][k].score = WORST_DIST;
-                s->topn_hist[i][j][k].codeword = k;
-            }
-        }
-    }
+    s2_semi_mgau_init_scoring(s);
+    s2_semi_mgau_set_simd(ps_mgau_base(s), simd_detect());
+    if (s->mixw_cb)
+        E_INFO("4-bit mixture weights using %s\n", simd_level_name(s->simd));
 
     ps = (ps_mgau_t *)s;
     ps->vt = &s2_semi_mgau_funcs;
@@ -1020,18 +1394,8 @@ s2_semi_mgau_init(acmod_t *acmod)
     const char *path;
     ps_mgau_t *ps = NULL;
 
-    path = cmd_ln_str_r(acmod->config, "_mean");
-    E_INFO("Reading mixture gaussian parameter: %s\n", path);
-    if ((means = s3file_map_file(path)) == NULL) {
-        E_ERROR_SYSTEM("Failed to open mean file '%s' for reading", path);
+    if (gauden_open_files(acmod->config, acmod->lmath, &means, &vars) < 0)
         goto error_out;
-    }
-    path = cmd_ln_str_r(acmod->config, "_var");
-    E_INFO("Reading mixture gaussian parameter: %s\n", path);
-    if ((vars = s3file_map_file(path)) == NULL) {
-        E_ERROR_SYSTEM("Failed to open variance file '%s' for reading", path);
-        goto error_out;
-    }
     if ((path = cmd_ln_str_r(acmod->config, "_sendump"))) {
         E_INFO("Loading senones from dump file %s\n", path);
         if ((sendump = s3file_map_file(path)) == NULL) {
@@ -1066,13 +1430,38 @@ s2_semi_mgau_mllr_transform(ps_mgau_t *ps,
     return gauden_mllr_transform(s->g, mllr, s->config);
 }
 
+ps_mgau_t *
+s2_semi_mgau_share(ps_mgau_t *ps, acmod_t *acmod)
+{
+    s2_semi_mgau_t *other = (s2_semi_mgau_t *)ps;
+    s2_semi_mgau_t *s;
+
+    /* Parameters are the same, everything else is our own. */
+    s = ckd_calloc(1, sizeof(*s));
+    memcpy(s, other, sizeof(*s));
+    s->base.frame_idx = 0;
+    s->base.shared = ps;
+    s->config = acmod->config;
+    s->lmath = logmath_retain(other->lmath);
+    s->lmath_8b = logmath_retain(other->lmath_8b);
+    s->ds_ratio = cmd_ln_int32_r(s->config, "-ds");
+    s2_semi_mgau_init_scoring(s);
+
+    return ps_mgau_base(s);
+}
+
 void
 s2_semi_mgau_free(ps_mgau_t *ps)
 {
     s2_semi_mgau_t *s = (s2_semi_mgau_t *)ps;
 
+    s2_semi_mgau_free_scoring(s);
     logmath_free(s->lmath);
     logmath_free(s->lmath_8b);
+    if (ps->shared) {
+        ckd_free(s);
+        return;
+    }
     if (s->sendump_mmap) {
         ckd_free_2d(s->mixw); 
         s3file_free(s->sendump_mmap);
@@ -1083,8 +1472,5 @@ s2_semi_mgau_free(ps_mgau_t *ps)
             ckd_free(s->mixw_cb);
     }
     gauden_free(s->g);
-    ckd_free(s->topn_beam);
-    ckd_free_2d(s->topn_hist_n);
-    ckd_free_3d((void **)s->topn_hist);
     ckd_free(s);
 }
@@ -89,6 +89,21 @@ s3file_map_file(const char *filename)
     return s;
 }
 
+s3file_t *
+s3file_init_sub(s3file_t *s, size_t offset, size_t len)
+{
+    s3file_t *sub;
+
+    if ((const char *)s->buf + offset + len > s->end) {
+        E_ERROR("Section of %lu bytes at %lu extends past end of file\n",
+                (unsigned long)len, (unsigned long)offset);
+        return NULL;
+    }
+    sub = s3file_init((const char *)s->buf + offset, len);
+    sub->parent = s3file_retain(s);
+    return sub;
+}
+
 s3file_t *
 s3file_retain(s3file_t *s)
 {
@@ -107,6 +122,7 @@ s3file_free(s3file_t *s)
         return s->refcount;
     if (s->mf)
         mmio_file_unmap(s->mf);
+    s3file_free(s->parent);
     ckd_free(s->headers);
     ckd_free(s);
     return 0;
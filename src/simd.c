@@ -0,0 +1,136 @@
+/* -*- c-basic-offset: 4; indent-tabs-mode: nil -*- */
+/* ====================================================================
+ * Copyright (c) 2022 Carnegie Mellon University.  All rights
+ * reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer. 
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in
+ *    the documentation and/or other materials provided with the
+ *    distribution.
+ *
+ * This work was supported in part by funding from the Defense Advanced 
+ * Research Projects Agency and the National Science Foundation of the 
+ * United States of America, and the CMU Sphinx Speech Consortium.
+ *
+ * THIS SOFTWARE IS PROVIDED BY CARNEGIE MELLON UNIVERSITY ``AS IS'' AND 
+ * ANY EXPRESSED OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, 
+ * THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ * PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL CARNEGIE MELLON UNIVERSITY
+ * NOR ITS EMPLOYEES BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT 
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, 
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY 
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT 
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE 
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ * ====================================================================
+ *
+ */
+/**
+ * @file simd.c
+ * @brief Run-time detection of SIMD instruction sets.
+ */
+
+#include "config.h"
+#include <stdlib.h>
+#include <string.h>
+
+#include <soundswallower/simd.h>
+
+#if defined(_MSC_VER) && defined(HAVE_SIMD_X86)
+#include <intrin.h>
+#endif
+
+#if defined(_MSC_VER) && defined(HAVE_SIMD_X86)
+static simd_level_t
+detect_x86_msvc(void)
+{
+    int info[4];
+    unsigned long long xcr0;
+
+    __cpuid(info, 0);
+    if (info[0] < 7)
+        return SIMD_SSE2;
+    __cpuid(info, 1);
+    /* OSXSAVE and AVX */
+    if ((info[2] & (1 << 27)) == 0 || (info[2] & (1 << 28)) == 0)
+        return SIMD_SSE2;
+    xcr0 = _xgetbv(0);
+    if ((xcr0 & 0x6) != 0x6)
+        return SIMD_SSE2;
+    __cpuidex(info, 7, 0);
+    if ((info[1] & (1 << 16)) && (xcr0 & 0xe6) == 0xe6)
+        return SIMD_AVX512;
+    if (info[1] & (1 << 5))
+        return SIMD_AVX2;
+    return SIMD_SSE2;
+}
+#endif
+
+static simd_level_t
+detect(void)
+{
+    const char *env;
+
+    if ((env = getenv("SOUNDSWALLOWER_SIMD")) != NULL
+        && 0 == strcmp(env, "none"))
+        return SIMD_NONE;
+#if defined(HAVE_SIMD_X86) && defined(_MSC_VER)
+    return detect_x86_msvc();
+#elif defined(HAVE_SIMD_X86)
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx512f"))
+        return SIMD_AVX512;
+    if (__builtin_cpu_supports("avx2"))
+        return SIMD_AVX2;
+    if (__builtin_cpu_supports("sse2"))
+        return SIMD_SSE2;
+    return SIMD_NONE;
+#elif defined(HAVE_SIMD_NEON)
+    /* If we were compiled for it, we have it. */
+    return SIMD_NEON;
+#elif defined(HAVE_SIMD_WASM)
+    /* Likewise (the module will not load otherwise). */
+    return SIMD_WASM;
+#else
+    return SIMD_NONE;
+#endif
+}
+
+simd_level_t
+simd_detect(void)
+{
+    /* Harmless race here, since every thread computes the same thing. */
+    static int level = -1;
+
+    if (level == -1)
+        level = detect();
+    return (simd_level_t)level;
+}
+
+const char *
+simd_level_name(simd_level_t level)
+{
+    switch (level) {
+    case SIMD_SSE2:
+        return "SSE2";
+    case SIMD_AVX2:
+        return "AVX2";
+    case SIMD_AVX512:
+        return "AVX-512";
+    case SIMD_NEON:
+        return "NEON";
+    case SIMD_WASM:
+        return "WASM SIMD128";
+    default:
+        return "none";
+    }
+}
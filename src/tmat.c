@@ -136,6 +136,7 @@ tmat_init_s3file(s3file_t *s, logmath_t *lmath, float64 tpfloor)
 
 
     t = (tmat_t *) ckd_calloc(1, sizeof(tmat_t));
+    t->refcount = 1;
 
     /* Read header, including argument-value info and 32-bit byteorder magic */
     if (s3file_parse_header(s, TMAT_PARAM_VERSION) < 0) {
@@ -237,12 +238,22 @@ tmat_init_s3file(s3file_t *s, logmath_t *lmath, float64 tpfloor)
 /* 
  *  RAH, Free memory allocated in tmat_init ()
  */
-void
+tmat_t *
+tmat_retain(tmat_t *t)
+{
+    ++t->refcount;
+    return t;
+}
+
+int
 tmat_free(tmat_t * t)
 {
-    if (t) {
-        if (t->tp)
-            ckd_free_3d(t->tp);
-        ckd_free(t);
-    }
+    if (t == NULL)
+        return 0;
+    if (--t->refcount > 0)
+        return t->refcount;
+    if (t->tp)
+        ckd_free_3d(t->tp);
+    ckd_free(t);
+    return 0;
 }
@@ -0,0 +1,214 @@
+/* -*- c-basic-offset: 4; indent-tabs-mode: nil -*- */
+/* ====================================================================
+ * Copyright (c) 2022 Carnegie Mellon University.  All rights
+ * reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer. 
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in
+ *    the documentation and/or other materials provided with the
+ *    distribution.
+ *
+ * This work was supported in part by funding from the Defense Advanced 
+ * Research Projects Agency and the National Science Foundation of the 
+ * United States of America, and the CMU Sphinx Speech Consortium.
+ *
+ * THIS SOFTWARE IS PROVIDED BY CARNEGIE MELLON UNIVERSITY ``AS IS'' AND 
+ * ANY EXPRESSED OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, 
+ * THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ * PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL CARNEGIE MELLON UNIVERSITY
+ * NOR ITS EMPLOYEES BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT 
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, 
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY 
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT 
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE 
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ * ====================================================================
+ *
+ */
+/**
+ * @file vad.c
+ * @brief Energy-based voice activity detection for live input.
+ */
+
+#include <assert.h>
+#include <string.h>
+#include <math.h>
+
+#include <soundswallower/vad.h>
+#include <soundswallower/ckd_alloc.h>
+#include <soundswallower/err.h>
+
+/* Smoothing of the noise floor, as in fe_noise.c: it rises slowly
+ * with the energy and falls quickly. */
+#define VAD_LAMBDA_RISE 0.995
+#define VAD_LAMBDA_FALL 0.5
+
+vad_t *
+vad_init(cmd_ln_t *config, int32 max_held)
+{
+    vad_t *vad;
+    const char *transform;
+    double threshold;
+    int32 nfilt;
+
+    vad = ckd_calloc(1, sizeof(*vad));
+    /* The threshold is in units of the mean log mel energy, and C0 is
+     * scaled differently depending on the DCT (see fe_sigproc.c). */
+    threshold = cmd_ln_float_r(config, "-vad_threshold");
+    transform = cmd_ln_str_r(config, "-transform");
+    nfilt = cmd_ln_int32_r(config, "-nfilt");
+    if (0 == strcmp(transform, "dct"))
+        threshold *= sqrt(nfilt);
+    else if (0 == strcmp(transform, "htk"))
+        threshold *= sqrt(nfilt / 2.0);
+    vad->threshold = FLOAT2MFCC(threshold);
+    vad->prespeech = cmd_ln_int32_r(config, "-vad_prespeech");
+    vad->postspeech = cmd_ln_int32_r(config, "-vad_postspeech");
+    vad->startspeech = cmd_ln_int32_r(config, "-vad_startspeech");
+    if (vad->prespeech < 0 || vad->postspeech < 0 || vad->startspeech < 1) {
+        E_ERROR("Invalid VAD parameters: -vad_prespeech %d, "
+                "-vad_postspeech %d, -vad_startspeech %d\n",
+                vad->prespeech, vad->postspeech, vad->startspeech);
+        ckd_free(vad);
+        return NULL;
+    }
+    if (vad->startspeech > max_held) {
+        E_WARN("Reducing -vad_startspeech from %d to %d\n",
+               vad->startspeech, max_held);
+        vad->startspeech = max_held;
+    }
+    if (vad->prespeech + vad->startspeech > max_held) {
+        E_WARN("Reducing -vad_prespeech from %d to %d\n",
+               vad->prespeech, max_held - vad->startspeech);
+        vad->prespeech = max_held - vad->startspeech;
+    }
+    return vad;
+}
+
+void
+vad_free(vad_t *vad)
+{
+    if (vad == NULL)
+        return;
+    ckd_free(vad->skip);
+    ckd_free(vad);
+}
+
+void
+vad_start(vad_t *vad)
+{
+    vad->in_speech = FALSE;
+    vad->n_run = 0;
+    vad->n_held = 0;
+    vad->n_in = 0;
+    vad->n_skip = 0;
+}
+
+int
+vad_update(vad_t *vad, mfcc_t const *cep)
+{
+    mfcc_t c0 = cep[0];
+    int energy;
+
+    if (!vad->floor_init) {
+        vad->floor = c0;
+        vad->floor_init = TRUE;
+    }
+    energy = (c0 - vad->floor > vad->threshold);
+    if (c0 > vad->floor)
+        vad->floor = VAD_LAMBDA_RISE * vad->floor
+            + (1.0 - VAD_LAMBDA_RISE) * c0;
+    else
+        vad->floor = VAD_LAMBDA_FALL * vad->floor
+            + (1.0 - VAD_LAMBDA_FALL) * c0;
+    ++vad->n_in;
+
+    if (vad->in_speech) {
+        /* Frames are passed through until enough silence. */
+        if (energy)
+            vad->n_run = 0;
+        else if (++vad->n_run > vad->postspeech) {
+            vad->in_speech = FALSE;
+            vad->n_run = 0;
+            vad->n_held = 1;
+        }
+    }
+    else {
+        /* Frames are held until enough energy to start speech. */
+        ++vad->n_held;
+        if (!energy)
+            vad->n_run = 0;
+        else if (++vad->n_run >= vad->startspeech) {
+            vad->in_speech = TRUE;
+            vad->n_run = 0;
+            vad->n_held = 0;
+        }
+    }
+    return vad->in_speech;
+}
+
+int32
+vad_n_excess(vad_t *vad)
+{
+    int32 n_excess;
+
+    if (vad->in_speech)
+        return 0;
+    /* Keep the leading context and any frames which may start speech. */
+    n_excess = vad->n_held - vad->prespeech - vad->n_run;
+    return n_excess > 0 ? n_excess : 0;
+}
+
+void
+vad_skip(vad_t *vad, int32 frame, int32 n_skip)
+{
+    int32 total;
+
+    if (n_skip <= 0)
+        return;
+    assert(n_skip <= vad->n_held);
+    vad->n_held -= n_skip;
+    total = vad_n_skipped(vad) + n_skip;
+    /* Merge with the last one if nothing was kept in between. */
+    if (vad->n_skip && vad->skip[vad->n_skip - 1].frame == frame) {
+        vad->skip[vad->n_skip - 1].n_skip = total;
+        return;
+    }
+    if (vad->n_skip == vad->n_skip_alloc) {
+        vad->n_skip_alloc = vad->n_skip_alloc ? vad->n_skip_alloc * 2 : 16;
+        vad->skip = ckd_realloc(vad->skip,
+                                vad->n_skip_alloc * sizeof(*vad->skip));
+    }
+    vad->skip[vad->n_skip].frame = frame;
+    vad->skip[vad->n_skip].n_skip = total;
+    ++vad->n_skip;
+}
+
+int32
+vad_input_frame(vad_t *vad, int32 frame)
+{
+    int32 lo, hi;
+
+    /* Find the last silence dropped at or before this frame. */
+    lo = 0;
+    hi = vad->n_skip;
+    while (lo < hi) {
+        int32 mid = (lo + hi) / 2;
+        if (vad->skip[mid].frame <= frame)
+            lo = mid + 1;
+        else
+            hi = mid;
+    }
+    if (lo == 0)
+        return frame;
+    return frame + vad->skip[lo - 1].n_skip;
+}
@@ -0,0 +1,270 @@
+/* -*- c-basic-offset: 4; indent-tabs-mode: nil -*- */
+/* ====================================================================
+ * Copyright (c) 2022 Carnegie Mellon University.  All rights
+ * reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer. 
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in
+ *    the documentation and/or other materials provided with the
+ *    distribution.
+ *
+ * This work was supported in part by funding from the Defense Advanced 
+ * Research Projects Agency and the National Science Foundation of the 
+ * United States of America, and the CMU Sphinx Speech Consortium.
+ *
+ * THIS SOFTWARE IS PROVIDED BY CARNEGIE MELLON UNIVERSITY ``AS IS'' AND 
+ * ANY EXPRESSED OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, 
+ * THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ * PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL CARNEGIE MELLON UNIVERSITY
+ * NOR ITS EMPLOYEES BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT 
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, 
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY 
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT 
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE 
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ * ====================================================================
+ *
+ */
+/**
+ * @file workpool.c
+ * @brief Persistent pool of worker threads for acoustic scoring.
+ */
+
+#include "config.h"
+
+#ifdef HAVE_PTHREAD
+#include <pthread.h>
+#endif
+
+#include <soundswallower/workpool.h>
+#include <soundswallower/ckd_alloc.h>
+#include <soundswallower/err.h>
+
+#ifdef HAVE_PTHREAD
+struct workpool_s {
+    int n_workers;
+    pthread_t *threads;
+    pthread_mutex_t mtx;
+    pthread_cond_t start;   /**< Signalled when a job is posted. */
+    pthread_cond_t done;    /**< Signalled when the last worker finishes. */
+    workpool_func_t func;
+    void *arg;
+    unsigned int job;       /**< Incremented for every job posted. */
+    int n_running;          /**< Number of threads still working. */
+    int background;         /**< Job doesn't include the calling thread. */
+    int shutdown;
+};
+
+typedef struct worker_s {
+    workpool_t *pool;
+    int idx;
+} worker_t;
+
+static void *
+worker_main(void *data)
+{
+    worker_t *w = (worker_t *)data;
+    workpool_t *pool = w->pool;
+    int idx = w->idx;
+    unsigned int job = 0;
+
+    ckd_free(w);
+    for (;;) {
+        workpool_func_t func;
+        void *arg;
+        int background;
+
+        pthread_mutex_lock(&pool->mtx);
+        while (pool->job == job && !pool->shutdown)
+            pthread_cond_wait(&pool->start, &pool->mtx);
+        if (pool->shutdown) {
+            pthread_mutex_unlock(&pool->mtx);
+            break;
+        }
+        job = pool->job;
+        func = pool->func;
+        arg = pool->arg;
+        background = pool->background;
+        pthread_mutex_unlock(&pool->mtx);
+
+        /* Background jobs are numbered without the calling thread. */
+        if (background)
+            (*func)(arg, idx - 1, pool->n_workers - 1);
+        else
+            (*func)(arg, idx, pool->n_workers);
+
+        pthread_mutex_lock(&pool->mtx);
+        if (--pool->n_running == 0)
+            pthread_cond_signal(&pool->done);
+        pthread_mutex_unlock(&pool->mtx);
+    }
+    return NULL;
+}
+
+workpool_t *
+workpool_init(int n_workers)
+{
+    workpool_t *pool;
+    int i;
+
+    if (n_workers <= 1)
+        return NULL;
+    pool = ckd_calloc(1, sizeof(*pool));
+    pool->threads = ckd_calloc(n_workers - 1, sizeof(*pool->threads));
+    pthread_mutex_init(&pool->mtx, NULL);
+    pthread_cond_init(&pool->start, NULL);
+    pthread_cond_init(&pool->done, NULL);
+    pool->n_workers = 1;
+    for (i = 1; i < n_workers; ++i) {
+        worker_t *w = ckd_calloc(1, sizeof(*w));
+        w->pool = pool;
+        w->idx = i;
+        if (pthread_create(&pool->threads[i - 1], NULL, worker_main, w) != 0) {
+            E_ERROR("Failed to start worker thread %d\n", i);
+            ckd_free(w);
+            break;
+        }
+        ++pool->n_workers;
+    }
+    /* Not fatal, but if none started we might as well not bother. */
+    if (pool->n_workers == 1) {
+        workpool_free(pool);
+        return NULL;
+    }
+    E_INFO("Started %d worker threads\n", pool->n_workers - 1);
+    return pool;
+}
+
+int
+workpool_n_workers(workpool_t *pool)
+{
+    if (pool == NULL)
+        return 1;
+    return pool->n_workers;
+}
+
+void
+workpool_run(workpool_t *pool, workpool_func_t func, void *arg)
+{
+    if (pool == NULL) {
+        (*func)(arg, 0, 1);
+        return;
+    }
+    pthread_mutex_lock(&pool->mtx);
+    pool->func = func;
+    pool->arg = arg;
+    pool->background = 0;
+    pool->n_running = pool->n_workers - 1;
+    ++pool->job;
+    pthread_cond_broadcast(&pool->start);
+    pthread_mutex_unlock(&pool->mtx);
+
+    (*func)(arg, 0, pool->n_workers);
+
+    workpool_wait(pool);
+}
+
+int
+workpool_start(workpool_t *pool, workpool_func_t func, void *arg)
+{
+    if (pool == NULL)
+        return -1;
+    pthread_mutex_lock(&pool->mtx);
+    pool->func = func;
+    pool->arg = arg;
+    pool->background = 1;
+    pool->n_running = pool->n_workers - 1;
+    ++pool->job;
+    pthread_cond_broadcast(&pool->start);
+    pthread_mutex_unlock(&pool->mtx);
+
+    return 0;
+}
+
+void
+workpool_wait(workpool_t *pool)
+{
+    if (pool == NULL)
+        return;
+    pthread_mutex_lock(&pool->mtx);
+    while (pool->n_running > 0)
+        pthread_cond_wait(&pool->done, &pool->mtx);
+    pthread_mutex_unlock(&pool->mtx);
+}
+
+void
+workpool_free(workpool_t *pool)
+{
+    int i;
+
+    if (pool == NULL)
+        return;
+    pthread_mutex_lock(&pool->mtx);
+    pool->shutdown = 1;
+    pthread_cond_broadcast(&pool->start);
+    pthread_mutex_unlock(&pool->mtx);
+    for (i = 0; i < pool->n_workers - 1; ++i)
+        pthread_join(pool->threads[i], NULL);
+    pthread_cond_destroy(&pool->done);
+    pthread_cond_destroy(&pool->start);
+    pthread_mutex_destroy(&pool->mtx);
+    ckd_free(pool->threads);
+    ckd_free(pool);
+}
+
+#else /* !HAVE_PTHREAD */
+
+workpool_t *
+workpool_init(int n_workers)
+{
+    if (n_workers > 1)
+        E_WARN("Threads not available, ignoring request for %d workers\n",
+               n_workers);
+    return NULL;
+}
+
+int
+workpool_n_workers(workpool_t *pool)
+{
+    (void)pool;
+    return 1;
+}
+
+void
+workpool_run(workpool_t *pool, workpool_func_t func, void *arg)
+{
+    (void)pool;
+    (*func)(arg, 0, 1);
+}
+
+int
+workpool_start(workpool_t *pool, workpool_func_t func, void *arg)
+{
+    (void)pool;
+    (void)func;
+    (void)arg;
+    return -1;
+}
+
+void
+workpool_wait(workpool_t *pool)
+{
+    (void)pool;
+}
+
+void
+workpool_free(workpool_t *pool)
+{
+    (void)pool;
+}
+
+#endif /* !HAVE_PTHREAD */
@@ -0,0 +1,130 @@
+/* Benchmark continuous density Gaussian evaluation in ms_gauden with
+ * floating point and fixed point.
+ *
+ * Usage: bench_gauden [REPEAT]
+ *
+ * This is not run as part of the test suite, since the timings are
+ * only meaningful in an optimized build.  The top-N densities for
+ * every codebook in the en-us model are computed REPEAT times for
+ * each frame of goforward.raw, which is what ms_mgau does with
+ * -compallsen.
+ */
+
+#include "config.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include <soundswallower/pocketsphinx.h>
+#include <soundswallower/pocketsphinx_internal.h>
+#include <soundswallower/ms_gauden.h>
+#include <soundswallower/simd.h>
+
+#include "test_macros.h"
+
+static clock_t
+time_dist(gauden_t *g, acmod_t *acmod, int nfr, int n_top, int repeat)
+{
+    gauden_dist_t **dist;
+    clock_t t;
+    int frame, m, j;
+
+    dist = ckd_calloc_2d(g->n_feat, n_top, sizeof(**dist));
+    t = clock();
+    for (frame = 0; frame < nfr; ++frame) {
+        mfcc_t **feat = acmod->feat_buf[(acmod->feat_outidx + frame)
+                                        % acmod->n_feat_alloc];
+        for (j = 0; j < repeat; ++j)
+            for (m = 0; m < g->n_mgau; ++m)
+                gauden_dist(g, m, n_top, feat, dist);
+    }
+    t = clock() - t;
+    ckd_free_2d(dist);
+    return t;
+}
+
+int
+main(int argc, char *argv[])
+{
+    logmath_t *lmath;
+    cmd_ln_t *config;
+    acmod_t *acmod;
+    fe_t *fe;
+    feat_t *fcb;
+    gauden_t *g;
+    int16 *buf;
+    int16 const *bptr;
+    FILE *rawfh;
+    size_t nsamps;
+    clock_t t_float, t_scalar, t_simd;
+    int repeat, nfr, n_top, level;
+
+    repeat = (argc > 1) ? atoi(argv[1]) : 20;
+    lmath = logmath_init(1.0001, 0, 0);
+    config = cmd_ln_init(NULL, ps_args(), TRUE,
+                         "-input_endian", "little",
+                         NULL);
+    cmd_ln_parse_file_r(config, ps_args(), MODELDIR "/en-us/feat.params", FALSE);
+    cmd_ln_set_str_extra_r(config, "_mdef", MODELDIR "/en-us/mdef.bin");
+    cmd_ln_set_str_extra_r(config, "_mean", MODELDIR "/en-us/means");
+    cmd_ln_set_str_extra_r(config, "_var", MODELDIR "/en-us/variances");
+    cmd_ln_set_str_extra_r(config, "_tmat", MODELDIR "/en-us/transition_matrices");
+    cmd_ln_set_str_extra_r(config, "_sendump", MODELDIR "/en-us/sendump");
+    cmd_ln_set_str_extra_r(config, "_mixw", NULL);
+    cmd_ln_set_str_extra_r(config, "_lda", NULL);
+    cmd_ln_set_str_extra_r(config, "_mlp", NULL);
+    cmd_ln_set_str_extra_r(config, "_senmgau", NULL);
+    fe = fe_init(config);
+    fcb = feat_init(config);
+    TEST_ASSERT((acmod = acmod_init(config, lmath, fe, fcb)));
+
+    TEST_ASSERT(rawfh = fopen(TESTDATADIR "/goforward.raw", "rb"));
+    fseek(rawfh, 0, SEEK_END);
+    nsamps = ftell(rawfh) / sizeof(*buf);
+    fseek(rawfh, 0, SEEK_SET);
+    buf = ckd_calloc(nsamps, sizeof(*buf));
+    TEST_EQUAL(nsamps, fread(buf, sizeof(*buf), nsamps, rawfh));
+    fclose(rawfh);
+    TEST_EQUAL(0, acmod_start_utt(acmod));
+    bptr = buf;
+    acmod_process_raw(acmod, &bptr, &nsamps, TRUE);
+    TEST_EQUAL(0, acmod_end_utt(acmod));
+    nfr = acmod->n_feat_frame;
+
+    TEST_ASSERT(g = gauden_init(MODELDIR "/en-us/means",
+                                MODELDIR "/en-us/variances",
+                                cmd_ln_float32_r(config, "-varfloor"),
+                                lmath));
+    n_top = cmd_ln_int32_r(config, "-topn");
+    printf("%d codebooks of %d densities, top %d, %d frames, %d repetitions\n",
+           g->n_mgau, g->n_density, n_top, nfr, repeat);
+    t_float = time_dist(g, acmod, nfr, n_top, repeat);
+    TEST_EQUAL(0, gauden_set_quant(g, TRUE));
+    TEST_EQUAL(SIMD_NONE, gauden_set_quant_simd(g, SIMD_NONE));
+    t_scalar = time_dist(g, acmod, nfr, n_top, repeat);
+    level = gauden_set_quant_simd(g, simd_detect());
+    t_simd = time_dist(g, acmod, nfr, n_top, repeat);
+
+    printf("float32 (us/frame)  int16 (us/frame)  int16 %s (us/frame)\n",
+           simd_level_name(level));
+    printf("%18.2f  %16.2f  %*.2f\n",
+           (double)t_float / CLOCKS_PER_SEC * 1e6 / nfr / repeat,
+           (double)t_scalar / CLOCKS_PER_SEC * 1e6 / nfr / repeat,
+           (int)strlen(simd_level_name(level)) + 17,
+           (double)t_simd / CLOCKS_PER_SEC * 1e6 / nfr / repeat);
+    printf("speedup: %.2f (scalar) %.2f (%s)\n",
+           (double)t_float / (t_scalar ? t_scalar : 1),
+           (double)t_float / (t_simd ? t_simd : 1),
+           simd_level_name(level));
+
+    ckd_free(buf);
+    gauden_free(g);
+    acmod_free(acmod);
+    fe_free(fe);
+    feat_free(fcb);
+    logmath_free(lmath);
+    cmd_ln_free_r(config);
+    return 0;
+}
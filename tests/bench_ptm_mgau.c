@@ -0,0 +1,159 @@
+/* Benchmark senone scoring in ptm_mgau with both mixture weight layouts.
+ *
+ * Usage: bench_ptm_mgau [REPEAT]
+ *
+ * This is not run as part of the test suite, since the timings are
+ * only meaningful in an optimized build.  Top-N codewords are
+ * computed once for each frame of goforward.raw, then senone scores
+ * are computed REPEAT times for a random set of active senones at
+ * various ratios, with the feature/codeword/senone mixture weights
+ * from the sendump and with the senone-major copy built by
+ * ptm_mgau_set_senmajor().
+ */
+
+#include "config.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include <soundswallower/pocketsphinx.h>
+#include <soundswallower/pocketsphinx_internal.h>
+#include <soundswallower/ptm_mgau.h>
+
+#include "test_macros.h"
+
+static int
+make_active(uint8 *senone_active, int n_sen, double ratio)
+{
+    int sen, n, last;
+
+    n = last = 0;
+    for (sen = 0; sen < n_sen; ++sen) {
+        int delta;
+        if ((double)rand() / RAND_MAX >= ratio)
+            continue;
+        delta = sen - last;
+        while (delta > 255) {
+            senone_active[n++] = 255;
+            delta -= 255;
+        }
+        senone_active[n++] = delta;
+        last = sen;
+    }
+    return n;
+}
+
+int
+main(int argc, char *argv[])
+{
+    static const double ratios[] = { 0.05, 0.1, 0.25, 0.5, 1.0 };
+    logmath_t *lmath;
+    cmd_ln_t *config;
+    acmod_t *acmod;
+    fe_t *fe;
+    feat_t *fcb;
+    ptm_mgau_t *s;
+    uint8 **sen_mixw, *senone_active;
+    int16 *scores, *sen_scores;
+    int16 *buf;
+    int16 const *bptr;
+    FILE *rawfh;
+    size_t nsamps;
+    int i, repeat, nfr, n_sen;
+
+    repeat = (argc > 1) ? atoi(argv[1]) : 20;
+    lmath = logmath_init(1.0001, 0, 0);
+    config = cmd_ln_init(NULL, ps_args(), TRUE,
+                         "-input_endian", "little",
+                         "-senmajor", "yes",
+                         NULL);
+    cmd_ln_parse_file_r(config, ps_args(), MODELDIR "/en-us/feat.params", FALSE);
+    cmd_ln_set_str_extra_r(config, "_mdef", MODELDIR "/en-us/mdef.bin");
+    cmd_ln_set_str_extra_r(config, "_mean", MODELDIR "/en-us/means");
+    cmd_ln_set_str_extra_r(config, "_var", MODELDIR "/en-us/variances");
+    cmd_ln_set_str_extra_r(config, "_tmat", MODELDIR "/en-us/transition_matrices");
+    cmd_ln_set_str_extra_r(config, "_sendump", MODELDIR "/en-us/sendump");
+    cmd_ln_set_str_extra_r(config, "_mixw", NULL);
+    cmd_ln_set_str_extra_r(config, "_lda", NULL);
+    cmd_ln_set_str_extra_r(config, "_mlp", NULL);
+    cmd_ln_set_str_extra_r(config, "_senmgau", NULL);
+    fe = fe_init(config);
+    fcb = feat_init(config);
+    TEST_ASSERT((acmod = acmod_init(config, lmath, fe, fcb)));
+    TEST_EQUAL(0, strcmp(acmod->mgau->vt->name, "ptm"));
+    s = (ptm_mgau_t *)acmod->mgau;
+    TEST_ASSERT(s->sen_mixw);
+    sen_mixw = s->sen_mixw;
+    n_sen = s->n_sen;
+
+    TEST_ASSERT(rawfh = fopen(TESTDATADIR "/goforward.raw", "rb"));
+    fseek(rawfh, 0, SEEK_END);
+    nsamps = ftell(rawfh) / sizeof(*buf);
+    fseek(rawfh, 0, SEEK_SET);
+    buf = ckd_calloc(nsamps, sizeof(*buf));
+    TEST_EQUAL(nsamps, fread(buf, sizeof(*buf), nsamps, rawfh));
+    fclose(rawfh);
+    TEST_EQUAL(0, acmod_start_utt(acmod));
+    bptr = buf;
+    acmod_process_raw(acmod, &bptr, &nsamps, TRUE);
+    TEST_EQUAL(0, acmod_end_utt(acmod));
+    nfr = acmod->n_feat_frame;
+
+    senone_active = ckd_calloc(n_sen * 2, sizeof(*senone_active));
+    scores = ckd_calloc(n_sen, sizeof(*scores));
+    sen_scores = ckd_calloc(n_sen, sizeof(*sen_scores));
+    printf("%d senones, %d frames, %d repetitions\n", n_sen, nfr, repeat);
+    printf("ratio  mixw (us/frame)  senmajor (us/frame)  speedup\n");
+    for (i = 0; i < (int)(sizeof(ratios) / sizeof(ratios[0])); ++i) {
+        clock_t t_mixw = 0, t_sen = 0;
+        int compall = (ratios[i] == 1.0);
+        int frame, j;
+
+        srand(42);
+        for (frame = 0; frame < nfr; ++frame) {
+            mfcc_t **feat = acmod->feat_buf[(acmod->feat_outidx + frame)
+                                            % acmod->n_feat_alloc];
+            int n_active = make_active(senone_active, n_sen, ratios[i]);
+            clock_t t;
+
+            /* Compute top-N for this frame, then pretend it's a past
+             * frame so that only senones are scored afterwards. */
+            acmod->mgau->frame_idx = frame;
+            ps_mgau_frame_eval(acmod->mgau, scores, senone_active,
+                               n_active, feat, frame, compall);
+            acmod->mgau->frame_idx = frame + 1;
+
+            s->sen_mixw = NULL;
+            t = clock();
+            for (j = 0; j < repeat; ++j)
+                ps_mgau_frame_eval(acmod->mgau, scores, senone_active,
+                                   n_active, feat, frame, compall);
+            t_mixw += clock() - t;
+
+            s->sen_mixw = sen_mixw;
+            t = clock();
+            for (j = 0; j < repeat; ++j)
+                ps_mgau_frame_eval(acmod->mgau, sen_scores, senone_active,
+                                   n_active, feat, frame, compall);
+            t_sen += clock() - t;
+            TEST_EQUAL(0, memcmp(scores, sen_scores, n_sen * sizeof(*scores)));
+        }
+        printf("%5.2f  %15.2f  %19.2f  %7.2f\n", ratios[i],
+               (double)t_mixw / CLOCKS_PER_SEC * 1e6 / nfr / repeat,
+               (double)t_sen / CLOCKS_PER_SEC * 1e6 / nfr / repeat,
+               (double)t_mixw / (t_sen ? t_sen : 1));
+    }
+
+    ckd_free(senone_active);
+    ckd_free(scores);
+    ckd_free(sen_scores);
+    ckd_free(buf);
+    acmod_free(acmod);
+    fe_free(fe);
+    feat_free(fcb);
+    logmath_free(lmath);
+    cmd_ln_free_r(config);
+    return 0;
+}
@@ -69,6 +69,7 @@ main(int argc, char *argv[])
     cmd_ln_set_str_extra_r(config, "_sendump", MODELDIR "/en-us/sendump");
     cmd_ln_set_str_extra_r(config, "_mixw", NULL);
     cmd_ln_set_str_extra_r(config, "_lda", NULL);
+    cmd_ln_set_str_extra_r(config, "_mlp", NULL);
     cmd_ln_set_str_extra_r(config, "_senmgau", NULL);	
 
     fe = fe_init(config);
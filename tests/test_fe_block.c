@@ -0,0 +1,121 @@
+/* -*- c-basic-offset: 4 -*- */
+#include "config.h"
+
+#include <stdio.h>
+#include <string.h>
+
+#include <soundswallower/fe.h>
+#include <soundswallower/fe_internal.h>
+#include <soundswallower/err.h>
+#include <soundswallower/cmd_ln.h>
+#include <soundswallower/ckd_alloc.h>
+
+#include "test_macros.h"
+
+/* Process all of the input in one call, which goes in blocks. */
+static mfcc_t **
+process_all(fe_t *fe, int16 const *data, size_t nsamp, int *out_nfr)
+{
+    mfcc_t **cepbuf;
+    int nfr, rv;
+
+    TEST_EQUAL(0, fe_start(fe));
+    nfr = fe_process_int16(fe, NULL, &nsamp, NULL, 0);
+    cepbuf = ckd_calloc_2d(nfr, fe_get_output_size(fe), sizeof(**cepbuf));
+    rv = fe_process_int16(fe, &data, &nsamp, cepbuf, nfr);
+    TEST_EQUAL(0, nsamp);
+    rv += fe_end(fe, cepbuf + rv, nfr - rv);
+    TEST_EQUAL(nfr, rv);
+    *out_nfr = nfr;
+    return cepbuf;
+}
+
+/* Process one frame per call (fe_process_int16() won't take more
+ * than MAX_INT16 samples if it isn't going to use them all). */
+static mfcc_t **
+process_frames(fe_t *fe, int16 const *data, size_t nsamp, int *out_nfr)
+{
+    mfcc_t **cepbuf;
+    int nfr, i;
+
+    TEST_EQUAL(0, fe_start(fe));
+    nfr = fe_process_int16(fe, NULL, &nsamp, NULL, 0);
+    cepbuf = ckd_calloc_2d(nfr, fe_get_output_size(fe), sizeof(**cepbuf));
+    i = 0;
+    while (nsamp > 0) {
+        size_t chunk = nsamp < 4096 ? nsamp : 4096;
+        int rv;
+
+        nsamp -= chunk;
+        rv = fe_process_int16(fe, &data, &chunk, cepbuf + i, 1);
+        TEST_ASSERT(rv <= 1);
+        nsamp += chunk;
+        i += rv;
+    }
+    i += fe_end(fe, cepbuf + i, nfr - i);
+    TEST_EQUAL(nfr, i);
+    *out_nfr = nfr;
+    return cepbuf;
+}
+
+static void
+test_block(cmd_ln_t *config, int16 const *data, size_t nsamp)
+{
+    fe_t *fe;
+    mfcc_t **ref, **cep;
+    int nfr, nfr2, ncep;
+
+    TEST_ASSERT(fe = fe_init(config));
+    ncep = fe_get_output_size(fe);
+    ref = process_frames(fe, data, nsamp, &nfr);
+    cep = process_all(fe, data, nsamp, &nfr2);
+    printf("%d frames (%d blocks)\n", nfr, (nfr + FE_MAX_BLOCK - 1) / FE_MAX_BLOCK);
+    TEST_EQUAL(nfr, nfr2);
+    TEST_ASSERT(nfr > FE_MAX_BLOCK * 2);
+    TEST_EQUAL(0, memcmp(ref[0], cep[0], nfr * ncep * sizeof(**cep)));
+    ckd_free_2d(ref);
+    ckd_free_2d(cep);
+    fe_free(fe);
+}
+
+int
+main(int argc, char *argv[])
+{
+    static const arg_t fe_args[] = {
+        waveform_to_cepstral_command_line_macro(),
+        { NULL, 0, NULL, NULL }
+    };
+    cmd_ln_t *config;
+    FILE *raw;
+    int16 *data;
+    size_t nsamp;
+
+    (void)argc; (void)argv;
+    TEST_ASSERT(raw = fopen(TESTDATADIR "/goforward.raw", "rb"));
+    fseek(raw, 0, SEEK_END);
+    nsamp = ftell(raw) / sizeof(*data);
+    fseek(raw, 0, SEEK_SET);
+    data = ckd_calloc(nsamp, sizeof(*data));
+    TEST_EQUAL(nsamp, fread(data, sizeof(*data), nsamp, raw));
+    fclose(raw);
+
+    TEST_ASSERT(config = cmd_ln_init(NULL, fe_args, TRUE,
+                                     "-input_endian", "little", NULL));
+    test_block(config, data, nsamp);
+    cmd_ln_set_boolean_r(config, "-remove_noise", TRUE);
+    test_block(config, data, nsamp);
+    cmd_ln_set_str_r(config, "-transform", "dct");
+    test_block(config, data, nsamp);
+    cmd_ln_set_str_r(config, "-transform", "htk");
+    cmd_ln_set_int_r(config, "-lifter", 22);
+    test_block(config, data, nsamp);
+    cmd_ln_set_boolean_r(config, "-smoothspec", TRUE);
+    test_block(config, data, nsamp);
+    cmd_ln_set_boolean_r(config, "-smoothspec", FALSE);
+    cmd_ln_set_boolean_r(config, "-logspec", TRUE);
+    test_block(config, data, nsamp);
+
+    ckd_free(data);
+    cmd_ln_free_r(config);
+    return 0;
+}
@@ -0,0 +1,121 @@
+/* -*- c-basic-offset: 4 -*- */
+#include "config.h"
+
+#include <stdio.h>
+#include <string.h>
+#include <math.h>
+
+#include <soundswallower/fe.h>
+#include <soundswallower/fe_internal.h>
+#include <soundswallower/simd.h>
+#include <soundswallower/err.h>
+#include <soundswallower/cmd_ln.h>
+#include <soundswallower/ckd_alloc.h>
+
+#include "test_macros.h"
+
+#ifndef M_PI
+#define M_PI 3.14159265358979323846
+#endif
+
+#define N_FRAMES 3
+
+/* Straightforward DFT, in the same layout as fe_fft_real(). */
+static void
+dft_real(frame_t const *x, frame_t *out, int n)
+{
+    int j, k;
+
+    for (k = 0; k <= n / 2; ++k) {
+        float64 re = 0, im = 0;
+        for (j = 0; j < n; ++j) {
+            float64 a = 2 * M_PI * (((int64)j * k) % n) / n;
+            re += x[j] * cos(a);
+            im -= x[j] * sin(a);
+        }
+        out[k] = re;
+        if (k > 0 && k < n / 2)
+            out[n - k] = im;
+    }
+}
+
+static void
+test_fft(cmd_ln_t *config, int nfft)
+{
+    static const int levels[] = {
+        SIMD_NONE, SIMD_SSE2, SIMD_AVX2, SIMD_NEON, SIMD_WASM
+    };
+    fe_t *fe;
+    frame_t *x, *ref, *batch;
+    uint32 seed = 42;
+    float64 err, max;
+    int i, j, n;
+
+    cmd_ln_set_int_r(config, "-nfft", nfft);
+    TEST_ASSERT(fe = fe_init(config));
+    n = fe->fft_size;
+    x = ckd_calloc(n * N_FRAMES, sizeof(*x));
+    ref = ckd_calloc(n * N_FRAMES, sizeof(*ref));
+    batch = ckd_calloc(n * N_FRAMES, sizeof(*batch));
+    for (i = 0; i < n * N_FRAMES; ++i) {
+        seed = seed * 1103515245 + 12345;
+        x[i] = (float64)(int16)(seed >> 16);
+    }
+    max = 0;
+    for (j = 0; j < N_FRAMES; ++j) {
+        dft_real(x + j * n, ref + j * n, n);
+        for (i = 0; i < n; ++i)
+            if (fabs(ref[j * n + i]) > max)
+                max = fabs(ref[j * n + i]);
+    }
+
+    for (i = 0; i < (int)(sizeof(levels) / sizeof(levels[0])); ++i) {
+        if (levels[i] > (int)simd_detect())
+            continue;
+        if (fe_fft_set_simd(fe, levels[i]) != levels[i])
+            continue;
+        /* All frames at once. */
+        memcpy(batch, x, n * N_FRAMES * sizeof(*batch));
+        fe_fft_real(fe, batch, N_FRAMES);
+        err = 0;
+        for (j = 0; j < n * N_FRAMES; ++j)
+            if (fabs(batch[j] - ref[j]) > err)
+                err = fabs(batch[j] - ref[j]);
+        printf("%d points, %s: max error %g (max value %g)\n",
+               n, simd_level_name(levels[i]), err, max);
+        TEST_ASSERT(err < max * 1e-10);
+        /* One at a time gives exactly the same thing. */
+        for (j = 0; j < N_FRAMES; ++j) {
+            memcpy(fe->frame, x + j * n, n * sizeof(*fe->frame));
+            fe_fft_real(fe, fe->frame, 1);
+            TEST_EQUAL(0, memcmp(fe->frame, batch + j * n,
+                                 n * sizeof(*fe->frame)));
+        }
+    }
+
+    ckd_free(x);
+    ckd_free(ref);
+    ckd_free(batch);
+    fe_free(fe);
+}
+
+int
+main(int argc, char *argv[])
+{
+    static const arg_t fe_args[] = {
+        waveform_to_cepstral_command_line_macro(),
+        { NULL, 0, NULL, NULL }
+    };
+    cmd_ln_t *config;
+
+    (void)argc; (void)argv;
+    TEST_ASSERT(config = cmd_ln_init(NULL, fe_args, TRUE, NULL));
+    /* Both odd and even numbers of stages. */
+    test_fft(config, 512);
+    test_fft(config, 1024);
+    test_fft(config, 2048);
+    test_fft(config, 4096);
+    cmd_ln_free_r(config);
+
+    return 0;
+}
@@ -0,0 +1,238 @@
+/* -*- c-basic-offset: 4 -*- */
+#include "config.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+
+#include <soundswallower/pocketsphinx.h>
+#include <soundswallower/fe.h>
+#include <soundswallower/fe_internal.h>
+#include <soundswallower/fe_resample.h>
+#include <soundswallower/err.h>
+#include <soundswallower/cmd_ln.h>
+#include <soundswallower/ckd_alloc.h>
+
+#include "test_macros.h"
+
+#ifndef M_PI
+#define M_PI 3.14159265358979323846
+#endif
+
+/* Resample a sine wave, all at once and in pieces. */
+static void
+test_sine(int32 in_rate, int32 out_rate)
+{
+    static const size_t pieces[] = { 1, 7, 100, 333, 4096 };
+    fe_resampler_t *rs;
+    float32 *in, *out, *out2;
+    size_t n_in, n_out, n_out2, i, j, max_out;
+    float64 err;
+
+    TEST_ASSERT(rs = fe_resampler_init(in_rate, out_rate));
+    n_in = in_rate / 2;
+    in = ckd_calloc(n_in, sizeof(*in));
+    for (i = 0; i < n_in; ++i)
+        in[i] = 0.5 * sin(2 * M_PI * 1000 * i / in_rate);
+    max_out = fe_resampler_max_output(rs, n_in) + fe_resampler_max_flush(rs);
+    out = ckd_calloc(max_out, sizeof(*out));
+    out2 = ckd_calloc(max_out, sizeof(*out2));
+
+    n_out = fe_resampler_process(rs, in, n_in, out);
+    TEST_ASSERT(n_out <= fe_resampler_max_output(rs, n_in));
+    n_out += fe_resampler_flush(rs, out + n_out);
+    TEST_EQUAL(n_out, ((size_t)n_in * out_rate + in_rate - 1) / in_rate);
+
+    /* Compare to the ideal, away from the edges. */
+    err = 0;
+    for (i = 100; i < n_out - 100; ++i) {
+        float64 ref = 0.5 * sin(2 * M_PI * 1000 * i / out_rate);
+        if (fabs(out[i] - ref) > err)
+            err = fabs(out[i] - ref);
+    }
+    printf("%d to %d: %lu samples, max error %g\n",
+           in_rate, out_rate, (unsigned long)n_out, err);
+    TEST_ASSERT(err < 1e-3);
+
+    /* Streaming gives exactly the same thing. */
+    n_out2 = i = j = 0;
+    while (i < n_in) {
+        size_t n = pieces[j++ % (sizeof(pieces) / sizeof(pieces[0]))];
+        if (n > n_in - i)
+            n = n_in - i;
+        n_out2 += fe_resampler_process(rs, in + i, n, out2 + n_out2);
+        i += n;
+    }
+    n_out2 += fe_resampler_flush(rs, out2 + n_out2);
+    TEST_EQUAL(n_out, n_out2);
+    TEST_EQUAL(0, memcmp(out, out2, n_out * sizeof(*out)));
+
+    ckd_free(in);
+    ckd_free(out);
+    ckd_free(out2);
+    fe_resampler_free(rs);
+}
+
+/* Make 48kHz audio out of the 16kHz test data. */
+static int16 *
+read_upsampled(size_t *out_nsamp)
+{
+    fe_resampler_t *rs;
+    FILE *raw;
+    int16 *data, *out;
+    float32 *in, *up;
+    size_t nsamp, n, i;
+
+    TEST_ASSERT(raw = fopen(TESTDATADIR "/goforward.raw", "rb"));
+    fseek(raw, 0, SEEK_END);
+    nsamp = ftell(raw) / sizeof(*data);
+    fseek(raw, 0, SEEK_SET);
+    data = ckd_calloc(nsamp, sizeof(*data));
+    TEST_EQUAL(nsamp, fread(data, sizeof(*data), nsamp, raw));
+    fclose(raw);
+
+    TEST_ASSERT(rs = fe_resampler_init(16000, 48000));
+    in = ckd_calloc(nsamp, sizeof(*in));
+    for (i = 0; i < nsamp; ++i)
+        in[i] = data[i];
+    up = ckd_calloc(fe_resampler_max_output(rs, nsamp)
+                    + fe_resampler_max_flush(rs), sizeof(*up));
+    n = fe_resampler_process(rs, in, nsamp, up);
+    n += fe_resampler_flush(rs, up + n);
+    TEST_EQUAL(n, nsamp * 3);
+    out = ckd_calloc(n, sizeof(*out));
+    for (i = 0; i < n; ++i) {
+        float32 s = floor(up[i] + 0.5);
+        out[i] = s > 32767 ? 32767 : (s < -32768 ? -32768 : (int16)s);
+    }
+    ckd_free(data);
+    ckd_free(in);
+    ckd_free(up);
+    fe_resampler_free(rs);
+    *out_nsamp = n;
+    return out;
+}
+
+/* The front end gives the same features however the input is split. */
+static void
+test_fe(cmd_ln_t *config, int16 const *data, size_t nsamp)
+{
+    fe_t *fe;
+    mfcc_t **ref, **cep;
+    int16 const *inptr;
+    size_t n;
+    int nfr, nfr2, ncep, rv;
+
+    TEST_ASSERT(fe = fe_init(config));
+    TEST_EQUAL(16000, (int)fe->sampling_rate);
+    ncep = fe_get_output_size(fe);
+
+    TEST_EQUAL(0, fe_start(fe));
+    n = nsamp;
+    nfr = fe_process_int16(fe, NULL, &n, NULL, 0);
+    ref = ckd_calloc_2d(nfr, ncep, sizeof(**ref));
+    inptr = data;
+    rv = fe_process_int16(fe, &inptr, &n, ref, nfr);
+    TEST_EQUAL(0, n);
+    rv += fe_end(fe, ref + rv, nfr - rv);
+    printf("%lu samples at 48kHz: %d frames (at most %d)\n",
+           (unsigned long)nsamp, rv, nfr);
+    TEST_ASSERT(rv <= nfr);
+    TEST_ASSERT(rv >= nfr - 1);
+    /* Same number of frames as at 16kHz, give or take one. */
+    TEST_ASSERT(abs(rv - (int)(nsamp / 3 / 160)) <= 1);
+    nfr = rv;
+
+    /* Odd-sized pieces, with few frames at a time. */
+    TEST_EQUAL(0, fe_start(fe));
+    cep = ckd_calloc_2d(nfr + 1, ncep, sizeof(**cep));
+    inptr = data;
+    nfr2 = 0;
+    while (inptr < data + nsamp) {
+        n = data + nsamp - inptr;
+        if (n > 1234)
+            n = 1234;
+        while (n > 0) {
+            rv = fe_process_int16(fe, &inptr, &n, cep + nfr2, 3);
+            TEST_ASSERT(rv >= 0);
+            nfr2 += rv;
+        }
+    }
+    /* With room for only one frame, fe_end() keeps the rest for
+     * the next call. */
+    TEST_ASSERT(fe_end(fe, NULL, 0) > 0);
+    while ((rv = fe_end(fe, cep + nfr2, 1)) > 0)
+        nfr2 += rv;
+    TEST_EQUAL(0, fe_end(fe, NULL, 0));
+    TEST_EQUAL(nfr, nfr2);
+    TEST_EQUAL(0, memcmp(ref[0], cep[0], nfr2 * ncep * sizeof(**cep)));
+
+    ckd_free_2d(ref);
+    ckd_free_2d(cep);
+    fe_free(fe);
+}
+
+static void
+test_decode(int16 const *data, size_t nsamp)
+{
+    ps_decoder_t *ps;
+    cmd_ln_t *config;
+    const char *hyp;
+    int32 score;
+
+    TEST_ASSERT(config =
+            cmd_ln_init(NULL, ps_args(), TRUE,
+			"-hmm", MODELDIR "/en-us",
+			"-fsg", TESTDATADIR "/goforward.fsg",
+			"-dict", TESTDATADIR "/turtle.dic",
+			"-samprate", "48000",
+			"-resample", "16000", NULL));
+    TEST_ASSERT(ps = ps_init(config));
+    TEST_EQUAL(0, ps_start_utt(ps));
+    while (nsamp > 0) {
+        size_t n = nsamp < 4410 ? nsamp : 4410;
+        TEST_ASSERT(ps_process_raw(ps, data, n, FALSE, FALSE) >= 0);
+        data += n;
+        nsamp -= n;
+    }
+    TEST_EQUAL(0, ps_end_utt(ps));
+    hyp = ps_get_hyp(ps, &score);
+    printf("%s (%d)\n", hyp, score);
+    TEST_EQUAL(0, strcmp("go forward ten meters", hyp));
+    ps_free(ps);
+    cmd_ln_free_r(config);
+}
+
+int
+main(int argc, char *argv[])
+{
+    static const arg_t fe_args[] = {
+        waveform_to_cepstral_command_line_macro(),
+        { NULL, 0, NULL, NULL }
+    };
+    cmd_ln_t *config;
+    int16 *data;
+    size_t nsamp;
+
+    (void)argc; (void)argv;
+    test_sine(44100, 16000);
+    test_sine(48000, 16000);
+    test_sine(22050, 16000);
+    test_sine(48000, 8000);
+    test_sine(44100, 8000);
+    test_sine(16000, 48000);
+    /* Not a reasonable ratio. */
+    TEST_EQUAL(NULL, fe_resampler_init(44101, 16000));
+
+    data = read_upsampled(&nsamp);
+    TEST_ASSERT(config = cmd_ln_init(NULL, fe_args, TRUE,
+                                     "-samprate", "48000",
+                                     "-resample", "16000", NULL));
+    test_fe(config, data, nsamp);
+    cmd_ln_free_r(config);
+    test_decode(data, nsamp);
+    ckd_free(data);
+
+    return 0;
+}
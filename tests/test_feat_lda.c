@@ -0,0 +1,118 @@
+/* -*- c-basic-offset: 4 -*- */
+#include "config.h"
+
+#include <stdio.h>
+#include <string.h>
+
+#include <soundswallower/pocketsphinx.h>
+#include <soundswallower/feat.h>
+#include <soundswallower/simd.h>
+#include <soundswallower/ckd_alloc.h>
+
+#include "test_macros.h"
+
+#define LDAFILE "test_feat_lda.lda"
+#define N_FRAMES 11
+#define N_ROWS 29
+#define N_COLS 39
+
+static float32 lda[N_ROWS][N_COLS];
+
+static void
+write_lda(void)
+{
+    FILE *fh;
+    uint32 magic = 0x11223344, dims[4] = { 1, N_ROWS, N_COLS,
+                                           N_ROWS * N_COLS };
+    uint32 seed = 42;
+    int j, k;
+
+    for (j = 0; j < N_ROWS; ++j) {
+        for (k = 0; k < N_COLS; ++k) {
+            seed = seed * 1103515245 + 12345;
+            lda[j][k] = (int16)(seed >> 16) / 32768.0;
+        }
+    }
+    TEST_ASSERT(fh = fopen(LDAFILE, "wb"));
+    fprintf(fh, "s3\nversion 0.1\nendhdr\n");
+    fwrite(&magic, sizeof(magic), 1, fh);
+    fwrite(dims, sizeof(*dims), 4, fh);
+    fwrite(lda, sizeof(float32), N_ROWS * N_COLS, fh);
+    fclose(fh);
+}
+
+/* Transform all frames with each instruction set, and compare them
+ * to the straightforward matrix-vector product. */
+static void
+test_lda(cmd_ln_t *config, int dim)
+{
+    static const int levels[] = {
+        SIMD_NONE, SIMD_SSE2, SIMD_AVX2, SIMD_NEON, SIMD_WASM
+    };
+    feat_t *fcb;
+    mfcc_t ***in, ***ref, ***out;
+    uint32 seed = 1;
+    int i, j, k, nfr;
+
+    cmd_ln_set_int_r(config, "-ldadim", dim);
+    TEST_ASSERT(fcb = feat_init(config));
+    TEST_EQUAL(0, feat_read_lda(fcb, LDAFILE, dim));
+    TEST_EQUAL((uint32)dim, feat_dimension(fcb));
+    in = feat_array_alloc(fcb, N_FRAMES);
+    ref = feat_array_alloc(fcb, N_FRAMES);
+    out = feat_array_alloc(fcb, N_FRAMES);
+    for (i = 0; i < N_FRAMES; ++i) {
+        for (k = 0; k < N_COLS; ++k) {
+            seed = seed * 1103515245 + 12345;
+            in[i][0][k] = FLOAT2MFCC((int16)(seed >> 16) / 1000.0);
+        }
+        for (j = 0; j < N_COLS; ++j) {
+            ref[i][0][j] = 0;
+            if (j >= dim)
+                continue;
+            for (k = 0; k < N_COLS; ++k)
+                ref[i][0][j] += MFCCMUL(in[i][0][k], lda[j][k]);
+        }
+    }
+
+    for (i = 0; i < (int)(sizeof(levels) / sizeof(levels[0])); ++i) {
+        if (levels[i] > (int)simd_detect())
+            continue;
+        if (feat_lda_set_simd(fcb, levels[i]) != levels[i])
+            continue;
+        /* Whole blocks and a partial one. */
+        for (nfr = 1; nfr <= N_FRAMES; nfr += 5) {
+            printf("dim %d, %d frames, %s\n", dim, nfr,
+                   simd_level_name(levels[i]));
+            memcpy(out[0][0], in[0][0], N_FRAMES * N_COLS * sizeof(mfcc_t));
+            feat_lda_transform(fcb, out, nfr);
+            TEST_EQUAL(0, memcmp(ref[0][0], out[0][0],
+                                 nfr * N_COLS * sizeof(mfcc_t)));
+        }
+    }
+
+    feat_array_free(in);
+    feat_array_free(ref);
+    feat_array_free(out);
+    feat_free(fcb);
+}
+
+int
+main(int argc, char *argv[])
+{
+    cmd_ln_t *config;
+
+    (void)argc; (void)argv;
+    write_lda();
+    TEST_ASSERT(config = cmd_ln_init(NULL, ps_args(), TRUE,
+                                     "-feat", "1s_c_d_dd",
+                                     "-cmn", "none",
+                                     NULL));
+    test_lda(config, N_ROWS);
+    test_lda(config, 16);
+    test_lda(config, 5);
+    cmd_ln_free_r(config);
+    remove(LDAFILE);
+
+    return 0;
+}
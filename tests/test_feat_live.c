@@ -37,6 +37,87 @@ mfcc_t data[6][13] = {
 	  FLOAT2MFCC(-0.124), FLOAT2MFCC(-0.445), FLOAT2MFCC(-0.352), FLOAT2MFCC(-0.400)},
 };
 
+/* Feed n_cep frames through the live ring (with feat_live_wrbuf()
+ * and friends, as acmod does) in uneven chunks, dropping nskip of
+ * them at frame skip_at, and check that the result is the same as
+ * for the whole utterance without the dropped frames. */
+static void
+run_ring_test(cmd_ln_t *config, int32 n_cep, int32 skip_at, int32 nskip)
+{
+	static const int32 chunks[] = { 1, 7, 30, 113, 2, 64 };
+	feat_t *fcb;
+	mfcc_t **cep, **kept, ***ref, ***out;
+	uint32 seed = 42;
+	int32 i, j, n_kept, nfr, nref, nout, nin, chunk;
+
+	cep = (mfcc_t **)ckd_calloc_2d(n_cep, 13, sizeof(mfcc_t));
+	for (i = 0; i < n_cep; ++i) {
+		for (j = 0; j < 13; ++j) {
+			seed = seed * 1103515245 + 12345;
+			cep[i][j] = FLOAT2MFCC(((seed >> 8) & 0xffff) / 4096.0 - 8.0);
+		}
+	}
+	kept = ckd_calloc(n_cep, sizeof(*kept));
+	for (n_kept = i = 0; i < n_cep; ++i)
+		if (i < skip_at || i >= skip_at + nskip)
+			kept[n_kept++] = cep[i];
+
+	fcb = feat_init(config);
+	ref = feat_array_alloc(fcb, n_kept);
+	nref = n_kept;
+	nref = feat_s2mfc2feat_live(fcb, kept, &nref, TRUE, TRUE, ref);
+	TEST_EQUAL(n_kept, nref);
+
+	out = feat_array_alloc(fcb, n_kept);
+	feat_live_start(fcb);
+	nout = nin = 0;
+	for (i = 0; nin < n_cep; ++i) {
+		mfcc_t **wrbuf;
+		int32 ncep;
+
+		wrbuf = feat_live_wrbuf(fcb, &nfr);
+		chunk = chunks[i % (sizeof(chunks) / sizeof(chunks[0]))];
+		if (nin == skip_at && chunk < nskip)
+			chunk = nskip;
+		if (chunk > nfr)
+			chunk = nfr;
+		if (chunk > n_cep - nin)
+			chunk = n_cep - nin;
+		/* Stop at the frames to drop, so they can be dropped
+		 * before being processed. */
+		if (nin < skip_at && chunk > skip_at - nin)
+			chunk = skip_at - nin;
+		for (j = 0; j < chunk; ++j)
+			memcpy(wrbuf[j], cep[nin + j], 13 * sizeof(mfcc_t));
+		feat_live_commit(fcb, chunk);
+		nin += chunk;
+		if (nin > skip_at && nin - chunk <= skip_at && nskip > 0)
+			TEST_EQUAL(nskip, feat_live_skip(fcb, nskip));
+		/* Keep some frames pending at times (but not before the
+		 * ones to drop, as the oldest pending ones are dropped). */
+		ncep = feat_live_pending(fcb);
+		if (i % 3 == 2 && nin != skip_at)
+			ncep /= 2;
+		nout += feat_live_process(fcb, &ncep, i == 0, FALSE, out + nout);
+		TEST_ASSERT(nout <= n_kept);
+	}
+	/* End of utterance with whatever is still pending. */
+	nfr = feat_live_pending(fcb);
+	nout += feat_live_process(fcb, &nfr, FALSE, TRUE, out + nout);
+	printf("%d frames (%d dropped at %d), ring ends at %d: %d frames\n",
+	       n_cep, nskip, skip_at, n_cep % LIVEBUFBLOCKSIZE, nout);
+	TEST_EQUAL(n_kept, nout);
+	for (i = 0; i < n_kept; ++i)
+		TEST_EQUAL(0, memcmp(ref[i][0], out[i][0],
+				     feat_dimension(fcb) * sizeof(mfcc_t)));
+
+	feat_array_free(ref);
+	feat_array_free(out);
+	feat_free(fcb);
+	ckd_free(kept);
+	ckd_free_2d(cep);
+}
+
 int
 main(int argc, char *argv[])
 {
@@ -121,5 +202,16 @@ main(int argc, char *argv[])
 	ckd_free_3d(out_feats);
 	ckd_free(in_feats);
 
+	/* Across the end of the ring, ending the utterance right at the
+	 * end of it, just before it, and just after it. */
+	run_ring_test(config, 600, 0, 0);
+	run_ring_test(config, LIVEBUFBLOCKSIZE * 2, 0, 0);
+	run_ring_test(config, LIVEBUFBLOCKSIZE * 2 - 1, 0, 0);
+	run_ring_test(config, LIVEBUFBLOCKSIZE + 1, 0, 0);
+	/* Dropping frames across the end of the ring. */
+	run_ring_test(config, 600, LIVEBUFBLOCKSIZE - 3, 10);
+	run_ring_test(config, 600, 100, 40);
+	cmd_ln_free_r(config);
+
 	return 0;
 }
@@ -0,0 +1,82 @@
+/* -*- c-basic-offset: 4 -*- */
+#include "config.h"
+
+#include <stdio.h>
+#include <string.h>
+
+#include <soundswallower/pocketsphinx.h>
+#include <soundswallower/feat.h>
+#include <soundswallower/simd.h>
+#include <soundswallower/ckd_alloc.h>
+
+#include "test_macros.h"
+
+#define N_FRAMES 50
+
+/* Compare vectorized features to the scalar ones frame by frame. */
+static void
+test_feat(const char *type, int ceplen)
+{
+    static const int levels[] = {
+        SIMD_NONE, SIMD_SSE2, SIMD_AVX2, SIMD_NEON, SIMD_WASM
+    };
+    cmd_ln_t *config;
+    feat_t *fcb;
+    mfcc_t **cep, ***ref, ***out;
+    uint32 seed = 42;
+    int32 i, j, win, nfr;
+
+    TEST_ASSERT(config = cmd_ln_init(NULL, ps_args(), TRUE,
+                                     "-feat", type,
+                                     "-cmn", "none",
+                                     NULL));
+    cmd_ln_set_int_r(config, "-ceplen", ceplen);
+    TEST_ASSERT(fcb = feat_init(config));
+    TEST_ASSERT(fcb->compute_feat_block != NULL);
+    win = feat_window_size(fcb);
+    nfr = N_FRAMES - 2 * win;
+    cep = (mfcc_t **)ckd_calloc_2d(N_FRAMES, ceplen, sizeof(**cep));
+    for (i = 0; i < N_FRAMES; ++i) {
+        for (j = 0; j < ceplen; ++j) {
+            seed = seed * 1103515245 + 12345;
+            cep[i][j] = FLOAT2MFCC((int16)(seed >> 16) / 1000.0);
+        }
+    }
+    ref = feat_array_alloc(fcb, nfr);
+    out = feat_array_alloc(fcb, nfr);
+    for (i = 0; i < nfr; ++i)
+        fcb->compute_feat(fcb, cep + win + i, ref[i]);
+
+    for (i = 0; i < (int)(sizeof(levels) / sizeof(levels[0])); ++i) {
+        if (levels[i] > (int)simd_detect())
+            continue;
+        if (feat_set_simd(fcb, levels[i]) != levels[i])
+            continue;
+        printf("%s, ceplen %d, %s\n", type, ceplen,
+               simd_level_name(levels[i]));
+        memset(out[0][0], 0, nfr * feat_dimension(fcb) * sizeof(mfcc_t));
+        fcb->compute_feat_block(fcb, cep + win, out, nfr);
+        TEST_EQUAL(0, memcmp(ref[0][0], out[0][0],
+                             nfr * feat_dimension(fcb) * sizeof(mfcc_t)));
+    }
+
+    feat_array_free(ref);
+    feat_array_free(out);
+    ckd_free_2d(cep);
+    feat_free(fcb);
+    cmd_ln_free_r(config);
+}
+
+int
+main(int argc, char *argv[])
+{
+    (void)argc; (void)argv;
+    test_feat("s2_4x", 13);
+    test_feat("s3_1x39", 13);
+    test_feat("1s_c_d_dd", 13);
+    test_feat("1s_c_d_dd", 20);
+    test_feat("1s_c_d_ld_dd", 13);
+    test_feat("1s_c_d_ld_dd", 7);
+
+    return 0;
+}
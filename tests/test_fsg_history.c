@@ -0,0 +1,126 @@
+/* -*- c-basic-offset: 4 -*- */
+#include "config.h"
+
+#include <stdio.h>
+#include <string.h>
+
+#include <soundswallower/pocketsphinx.h>
+#include <soundswallower/bin_mdef.h>
+#include <soundswallower/dict.h>
+#include <soundswallower/fsg_history.h>
+
+#include "test_macros.h"
+
+#define N_FRAMES 3000
+#define N_STATE 64
+
+static fsg_pnode_ctxt_t
+make_rc(uint32 bits)
+{
+    fsg_pnode_ctxt_t rc;
+
+    memset(&rc, 0, sizeof(rc));
+    rc.bv[0] = bits;
+    return rc;
+}
+
+int
+main(int argc, char *argv[])
+{
+    fsg_link_t links[N_STATE];
+    logmath_t *lmath;
+    cmd_ln_t *config;
+    bin_mdef_t *mdef;
+    dict_t *dict;
+    fsg_model_t *fsg;
+    fsg_history_t *h;
+    fsg_hist_entry_t *entry;
+    int32 i;
+
+    (void)argc; (void)argv;
+    TEST_ASSERT(config = cmd_ln_init(NULL, NULL, FALSE,
+                                     "_dict", MODELDIR "/en-us/dict.txt",
+                                     "_fdict", MODELDIR "/en-us/noisedict",
+                                     NULL));
+    TEST_ASSERT(mdef = bin_mdef_read(NULL, MODELDIR "/en-us/mdef.bin"));
+    TEST_ASSERT(dict = dict_init(config, mdef));
+    lmath = logmath_init(1.0001, 0, 0);
+    TEST_ASSERT(fsg = fsg_model_init("test", lmath, 1.0, N_STATE));
+    for (i = 0; i < N_STATE; ++i) {
+        links[i].from_state = 0;
+        links[i].to_state = i;
+        links[i].logs2prob = 0;
+        links[i].wid = -1;
+    }
+
+    TEST_ASSERT(h = fsg_history_init(fsg, dict));
+    fsg_history_utt_start(h);
+    fsg_history_entry_add(h, NULL, -1, 0, -1, 0, make_rc(~0));
+    TEST_EQUAL(1, fsg_history_n_entries(h));
+
+    /* Entries in the same state with the same left context are pruned
+     * by score and right context. */
+    fsg_history_entry_add(h, &links[1], 0, -100, 0, 0, make_rc(3));
+    fsg_history_entry_add(h, &links[1], 0, -200, 0, 0, make_rc(1));
+    fsg_history_entry_add(h, &links[1], 0, -50, 0, 0, make_rc(2));
+    fsg_history_entry_add(h, &links[1], 0, -10, 0, 0, make_rc(1));
+    /* But not with a different one. */
+    fsg_history_entry_add(h, &links[1], 0, -300, 0, 1, make_rc(1));
+    TEST_EQUAL(1, fsg_history_n_entries(h));
+    fsg_history_end_frame(h);
+    TEST_EQUAL(4, fsg_history_n_entries(h));
+    entry = fsg_history_entry_get(h, 1);
+    TEST_EQUAL(-10, fsg_hist_entry_score(entry));
+    entry = fsg_history_entry_get(h, 2);
+    TEST_EQUAL(-50, fsg_hist_entry_score(entry));
+    TEST_EQUAL(2, fsg_hist_entry_rc(entry).bv[0]);
+    entry = fsg_history_entry_get(h, 3);
+    TEST_EQUAL(-300, fsg_hist_entry_score(entry));
+    TEST_EQUAL(1, fsg_hist_entry_lc(entry));
+    TEST_EQUAL(NULL, fsg_history_entry_get(h, 4));
+
+    /* Lots of entries stay put across blocks. */
+    for (i = 1; i < N_FRAMES; ++i) {
+        fsg_history_entry_add(h, &links[i % 4], i, -i, i + 2,
+                              i % h->n_ciphone, make_rc(1));
+        fsg_history_end_frame(h);
+    }
+    entry = fsg_history_entry_get(h, 4);
+    TEST_EQUAL(N_FRAMES + 3, fsg_history_n_entries(h));
+    for (i = 1; i < N_FRAMES; ++i) {
+        TEST_EQUAL(i, fsg_hist_entry_frame(fsg_history_entry_get(h, i + 3)));
+        TEST_EQUAL(i + 2, fsg_hist_entry_pred(fsg_history_entry_get(h, i + 3)));
+    }
+    TEST_ASSERT(entry == fsg_history_entry_get(h, 4));
+
+    /* Entries come out in order of state and left context, whatever
+     * order they went in. */
+    for (i = N_STATE - 1; i > 0; --i) {
+        fsg_history_entry_add(h, &links[i], N_FRAMES, -i, 0, 1, make_rc(1));
+        fsg_history_entry_add(h, &links[i], N_FRAMES, -i, 0, 0, make_rc(1));
+    }
+    fsg_history_end_frame(h);
+    TEST_EQUAL(N_FRAMES + 3 + 2 * (N_STATE - 1), fsg_history_n_entries(h));
+    for (i = 1; i < N_STATE; ++i) {
+        entry = fsg_history_entry_get(h, N_FRAMES + 1 + 2 * i);
+        TEST_EQUAL(i, fsg_link_to_state(fsg_hist_entry_fsglink(entry)));
+        TEST_EQUAL(0, fsg_hist_entry_lc(entry));
+        entry = fsg_history_entry_get(h, N_FRAMES + 2 + 2 * i);
+        TEST_EQUAL(i, fsg_link_to_state(fsg_hist_entry_fsglink(entry)));
+        TEST_EQUAL(1, fsg_hist_entry_lc(entry));
+    }
+
+    fsg_history_utt_end(h);
+    fsg_history_reset(h);
+    TEST_EQUAL(0, fsg_history_n_entries(h));
+    fsg_history_utt_start(h);
+
+    fsg_history_set_fsg(h, NULL, NULL);
+    fsg_history_free(h);
+    fsg_model_free(fsg);
+    logmath_free(lmath);
+    dict_free(dict);
+    bin_mdef_free(mdef);
+    cmd_ln_free_r(config);
+    return 0;
+}
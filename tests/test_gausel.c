@@ -0,0 +1,266 @@
+/* -*- c-basic-offset: 4 -*- */
+#include "config.h"
+
+#include <stdio.h>
+#include <string.h>
+
+#include <soundswallower/pocketsphinx.h>
+#include <soundswallower/pocketsphinx_internal.h>
+#include <soundswallower/ms_gauden.h>
+#include <soundswallower/ptm_mgau.h>
+#include <soundswallower/gausel.h>
+#include <soundswallower/modelpack.h>
+
+#include "test_macros.h"
+
+#define GAUSELFILE "test_gausel.gausel"
+#define BADFILE "test_gausel_bad.gausel"
+#define N_CW 64
+
+static const char *
+decode(ps_decoder_t *ps, int32 *score)
+{
+    FILE *rawfh;
+    int16 buf[2048];
+    size_t nread;
+
+    TEST_ASSERT(rawfh = fopen(TESTDATADIR "/goforward.raw", "rb"));
+    TEST_EQUAL(0, ps_start_utt(ps));
+    while (!feof(rawfh)) {
+	nread = fread(buf, sizeof(*buf), sizeof(buf)/sizeof(*buf), rawfh);
+        ps_process_raw(ps, buf, nread, FALSE, FALSE);
+    }
+    fclose(rawfh);
+    TEST_EQUAL(0, ps_end_utt(ps));
+    return ps_get_hyp(ps, score);
+}
+
+static cmd_ln_t *
+decode_config(const char *gausel, double fallback)
+{
+    cmd_ln_t *config;
+
+    TEST_ASSERT(config =
+            cmd_ln_init(NULL, ps_args(), TRUE,
+			"-hmm", MODELDIR "/en-us",
+			"-fsg", TESTDATADIR "/goforward.fsg",
+			"-dict", TESTDATADIR "/turtle.dic",
+			"-input_endian", "little", /* raw data demands it */
+			"-samprate", "16000", NULL));
+    cmd_ln_set_str_r(config, "-gausel", gausel);
+    cmd_ln_set_float_r(config, "-gsfallback", fallback);
+    return config;
+}
+
+/* Overwrite size bytes at offset in a copy of GAUSELFILE, which
+ * should then be rejected. */
+static void
+check_corrupt(size_t offset, void const *value, size_t size)
+{
+    FILE *fh;
+    char *buf;
+    long len;
+
+    TEST_ASSERT(fh = fopen(GAUSELFILE, "rb"));
+    fseek(fh, 0, SEEK_END);
+    len = ftell(fh);
+    fseek(fh, 0, SEEK_SET);
+    buf = ckd_malloc(len);
+    TEST_EQUAL((size_t)len, fread(buf, 1, len, fh));
+    fclose(fh);
+    TEST_ASSERT(offset + size <= (size_t)len);
+    memcpy(buf + offset, value, size);
+    TEST_ASSERT(fh = fopen(BADFILE, "wb"));
+    TEST_EQUAL((size_t)len, fwrite(buf, 1, len, fh));
+    fclose(fh);
+    ckd_free(buf);
+    TEST_EQUAL(NULL, gausel_read(BADFILE));
+    remove(BADFILE);
+}
+
+static void
+check_lists(gausel_t *gs, gauden_t *g)
+{
+    uint8 *seen;
+    int32 f, c, m, i, n;
+
+    seen = ckd_calloc(g->n_density, 1);
+    for (f = 0; f < gs->n_feat; ++f) {
+        for (c = 0; c < gs->n_cw; ++c) {
+            for (m = 0; m < gs->n_mgau; ++m) {
+                uint16 const *list = gausel_shortlist(gs, f, c, m, &n);
+                TEST_ASSERT(list);
+                TEST_ASSERT(n >= GAUSEL_DEFAULT_MIN_SHORT);
+                TEST_ASSERT(n <= g->n_density);
+                memset(seen, 0, g->n_density);
+                for (i = 0; i < n; ++i) {
+                    TEST_ASSERT(list[i] < g->n_density);
+                    TEST_EQUAL(0, seen[list[i]]);
+                    seen[list[i]] = 1;
+                }
+            }
+        }
+    }
+    ckd_free(seen);
+    TEST_EQUAL(NULL, gausel_shortlist(gs, 0, -1, 0, &n));
+    TEST_EQUAL(0, n);
+}
+
+int
+main(int argc, char *argv[])
+{
+    logmath_t *lmath;
+    cmd_ln_t *config;
+    ps_decoder_t *ps;
+    gauden_t *g;
+    gausel_t *gs, *gs2;
+    gauden_dist_t *ref, *dist;
+    mfcc_t *obs;
+    uint16 *all;
+    FILE *fh;
+    const char *hyp;
+    int32 f, c, i, n_list, score, score2;
+    long len;
+
+    (void)argc; (void)argv;
+    config = cmd_ln_init(NULL, ps_args(), TRUE, NULL);
+    cmd_ln_set_str_extra_r(config, "_mean", MODELDIR "/en-us/means");
+    cmd_ln_set_str_extra_r(config, "_var", MODELDIR "/en-us/variances");
+    lmath = logmath_init(cmd_ln_float32_r(config, "-logbase"), 0, FALSE);
+    TEST_ASSERT(g = gauden_init(MODELDIR "/en-us/means",
+                                MODELDIR "/en-us/variances",
+                                cmd_ln_float32_r(config, "-varfloor"),
+                                lmath));
+
+    /* Build some (small) shortlists and make sure they make sense. */
+    TEST_ASSERT(gs = gausel_build(g, N_CW, GAUSEL_DEFAULT_BEAM,
+                                  GAUSEL_DEFAULT_MIN_SHORT));
+    TEST_EQUAL(0, gausel_check(gs, g));
+    TEST_EQUAL(N_CW, gs->n_cw);
+    check_lists(gs, g);
+    obs = ckd_calloc(gs->featoff[g->n_feat - 1] + g->featlen[g->n_feat - 1], sizeof(*obs));
+
+    /* The centre of a cell is in that cell. */
+    for (f = 0; f < g->n_feat; ++f) {
+        for (c = 0; c < N_CW; ++c) {
+            float32 *cw = gs->cw + (size_t)N_CW * gs->featoff[f]
+                + (size_t)c * g->featlen[f];
+            for (i = 0; i < g->featlen[f]; ++i)
+                obs[i] = FLOAT2MFCC(cw[i]);
+            TEST_EQUAL(c, gausel_select(gs, f, obs, 0));
+            TEST_EQUAL(c, gausel_select(gs, f, obs, 2.0));
+        }
+    }
+
+    /* Evaluating a complete "shortlist" is the same as a full scan. */
+    ref = ckd_calloc(g->n_density, sizeof(*ref));
+    dist = ckd_calloc(g->n_density, sizeof(*dist));
+    all = ckd_calloc(g->n_density, sizeof(*all));
+    for (i = 0; i < g->n_density; ++i)
+        all[i] = i;
+    for (f = 0; f < g->n_feat; ++f) {
+        float32 *cw = gs->cw + (size_t)N_CW * gs->featoff[f];
+        uint16 const *list;
+        for (i = 0; i < g->featlen[f]; ++i)
+            obs[i] = FLOAT2MFCC(cw[i]);
+        TEST_EQUAL(0, gauden_dist_shortlist(g, 0, f, 4, obs, ref, NULL, 0));
+        TEST_EQUAL(0, gauden_dist_shortlist(g, 0, f, 4, obs, dist,
+                                            all, g->n_density));
+        for (i = 0; i < 4; ++i) {
+            TEST_EQUAL(ref[i].id, dist[i].id);
+            TEST_EQUAL(ref[i].dist, dist[i].dist);
+        }
+        /* And the best density at the centre is on its shortlist. */
+        list = gausel_shortlist(gs, f, 0, 0, &n_list);
+        TEST_EQUAL(0, gauden_dist_shortlist(g, 0, f, 1, obs, dist,
+                                            list, n_list));
+        TEST_EQUAL(ref[0].id, dist[0].id);
+        TEST_EQUAL(ref[0].dist, dist[0].dist);
+    }
+    ckd_free(all);
+    ckd_free(ref);
+    ckd_free(dist);
+    ckd_free(obs);
+
+    /* Write and read them back. */
+    TEST_ASSERT(fh = fopen(GAUSELFILE, "wb"));
+    TEST_ASSERT((len = gausel_write(gs, fh)) > 0);
+    fclose(fh);
+    TEST_ASSERT(gs2 = gausel_read(GAUSELFILE));
+    TEST_EQUAL(0, gausel_check(gs2, g));
+    TEST_EQUAL(gs->n_mgau, gs2->n_mgau);
+    TEST_EQUAL(gs->n_feat, gs2->n_feat);
+    TEST_EQUAL(gs->n_density, gs2->n_density);
+    TEST_EQUAL(gs->n_cw, gs2->n_cw);
+    for (f = 0; f < gs->n_feat; ++f) {
+        TEST_EQUAL(gs->featlen[f], gs2->featlen[f]);
+        TEST_EQUAL(gs->featoff[f], gs2->featoff[f]);
+    }
+    i = gs->n_feat * gs->n_cw * gs->n_mgau;
+    TEST_EQUAL(0, memcmp(gs->start, gs2->start,
+                         (i + 1) * sizeof(*gs->start)));
+    TEST_EQUAL(0, memcmp(gs->list, gs2->list,
+                         gs->start[i] * sizeof(*gs->list)));
+    TEST_EQUAL(0, memcmp(gs->radius, gs2->radius,
+                         gs->n_feat * gs->n_cw * sizeof(*gs->radius)));
+    TEST_EQUAL(0, memcmp(gs->cw, gs2->cw,
+                         (size_t)gs->n_cw * g->featlen[0] * g->n_feat
+                         * sizeof(*gs->cw)));
+
+    /* Corrupt files are rejected. */
+    {
+        char const *base = (char const *)gs2->s3f->buf;
+        int32 zero = 0;
+        uint32 bad_start = gs2->start[2] + 1;
+        uint16 bad_density = (uint16)g->n_density;
+
+        /* featlen comes right after the header, aligned to 64 bytes. */
+        check_corrupt(64, &zero, sizeof(zero));
+        check_corrupt((char const *)&gs2->start[1] - base,
+                      &bad_start, sizeof(bad_start));
+        check_corrupt((char const *)&gs2->list[0] - base,
+                      &bad_density, sizeof(bad_density));
+    }
+    gausel_free(gs2);
+
+    /* They don't match other Gaussians. */
+    gs->n_density = 64;
+    TEST_EQUAL(-1, gausel_check(gs, g));
+    gausel_free(gs);
+    gauden_free(g);
+
+    /* Decode with the default ones. */
+    TEST_EQUAL(0, modelpack_write_gausel(config, lmath, GAUSELFILE));
+    logmath_free(lmath);
+    cmd_ln_free_r(config);
+
+    config = decode_config(NULL, 2.0);
+    TEST_ASSERT(ps = ps_init(config));
+    hyp = decode(ps, &score);
+    printf("%s (%d)\n", hyp, score);
+    TEST_EQUAL(0, strcmp("go forward ten meters", hyp));
+    ps_free(ps);
+    cmd_ln_free_r(config);
+
+    config = decode_config(GAUSELFILE, 2.0);
+    TEST_ASSERT(ps = ps_init(config));
+    TEST_ASSERT(((ptm_mgau_t *)ps->acmod->mgau)->gs);
+    hyp = decode(ps, &score2);
+    printf("%s (%d)\n", hyp, score2);
+    TEST_EQUAL(0, strcmp("go forward ten meters", hyp));
+    ps_free(ps);
+    cmd_ln_free_r(config);
+
+    /* Falling back in every frame is the same as not using them. */
+    config = decode_config(GAUSELFILE, 1e-6);
+    TEST_ASSERT(ps = ps_init(config));
+    hyp = decode(ps, &score2);
+    printf("%s (%d)\n", hyp, score2);
+    TEST_EQUAL(0, strcmp("go forward ten meters", hyp));
+    TEST_EQUAL(score, score2);
+    ps_free(ps);
+    cmd_ln_free_r(config);
+
+    remove(GAUSELFILE);
+    return 0;
+}
@@ -0,0 +1,361 @@
+/* -*- c-basic-offset: 4 -*- */
+#include "config.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+
+#include <soundswallower/pocketsphinx.h>
+#include <soundswallower/pocketsphinx_internal.h>
+#include <soundswallower/mlp_mgau.h>
+#include <soundswallower/modelpack.h>
+#include <soundswallower/simd.h>
+#include <soundswallower/bitvec.h>
+
+#include "test_macros.h"
+
+/* There is no neural network model in the tree, so we make a random
+ * one for en-us, with a hidden layer whose size isn't a multiple of
+ * MLP_ALIGN. */
+#define MLPFILE "test_mlp_mgau.mlp"
+#define PACKFILE "test_mlp_mgau.pack"
+#define N_IN 39
+#define N_HID 40
+
+static int n_out[2] = { N_HID, 0 };
+static float32 in_scale[N_IN];
+static int8 *weight[2];
+static float32 *wscale[2], *bias[2];
+
+static float32
+frand(uint32 *seed)
+{
+    *seed = *seed * 1103515245 + 12345;
+    return (float32)((*seed >> 8) & 0xffff) / 65536.0f;
+}
+
+static void
+write_mlp(int n_sen)
+{
+    FILE *fh;
+    uint32 magic = 0x11223344;
+    uint32 seed = 42;
+    int32 n_layer = 2, n_in = N_IN;
+    float32 in_mean[N_IN];
+    int i, j, l;
+
+    n_out[1] = n_sen;
+    for (i = 0; i < N_IN; ++i) {
+        in_mean[i] = 0;
+        in_scale[i] = 0.1f;
+    }
+    for (l = 0; l < 2; ++l) {
+        int rows = n_out[l], cols = l ? N_HID : N_IN;
+        weight[l] = ckd_calloc((size_t)rows * cols, sizeof(int8));
+        wscale[l] = ckd_calloc(rows, sizeof(float32));
+        bias[l] = ckd_calloc(rows, sizeof(float32));
+        for (i = 0; i < rows; ++i) {
+            wscale[l][i] = (0.5f + frand(&seed)) / (127.0f * sqrtf(cols));
+            bias[l][i] = 4.0f * (frand(&seed) - 0.5f);
+            for (j = 0; j < cols; ++j)
+                weight[l][i * cols + j] = (int8)(frand(&seed) * 255.0f - 127.0f);
+        }
+    }
+
+    TEST_ASSERT(fh = fopen(MLPFILE, "wb"));
+    fprintf(fh, "s3\nversion 1.0\nendhdr\n");
+    fwrite(&magic, sizeof(magic), 1, fh);
+    fwrite(&n_layer, sizeof(int32), 1, fh);
+    fwrite(&n_in, sizeof(int32), 1, fh);
+    for (l = 0; l < 2; ++l)
+        fwrite(&n_out[l], sizeof(int32), 1, fh);
+    fwrite(in_mean, sizeof(float32), N_IN, fh);
+    fwrite(in_scale, sizeof(float32), N_IN, fh);
+    for (l = 0; l < 2; ++l) {
+        fwrite(wscale[l], sizeof(float32), n_out[l], fh);
+        fwrite(bias[l], sizeof(float32), n_out[l], fh);
+        fwrite(weight[l], 1, (size_t)n_out[l] * (l ? N_HID : N_IN), fh);
+    }
+    fclose(fh);
+}
+
+/* Unquantized network, to check that quantizing doesn't lose too
+ * much. */
+static void
+score_float(mfcc_t const *feat, float64 score_scale, int16 *senscr)
+{
+    float64 hid[N_HID], *out, best;
+    int i, j, n_sen = n_out[1];
+
+    for (i = 0; i < N_HID; ++i) {
+        float64 y = 0;
+        for (j = 0; j < N_IN; ++j)
+            y += weight[0][i * N_IN + j] * MFCC2FLOAT(feat[j]) * in_scale[j];
+        y = y * wscale[0][i] + bias[0][i];
+        hid[i] = y < 0 ? 0 : y;
+    }
+    out = ckd_calloc(n_sen, sizeof(*out));
+    best = -1e30;
+    for (i = 0; i < n_sen; ++i) {
+        float64 y = 0;
+        for (j = 0; j < N_HID; ++j)
+            y += weight[1][i * N_HID + j] * hid[j];
+        out[i] = y * wscale[1][i] + bias[1][i];
+        if (out[i] > best)
+            best = out[i];
+    }
+    for (i = 0; i < n_sen; ++i)
+        senscr[i] = (int16)((best - out[i]) * score_scale + 0.5);
+    ckd_free(out);
+}
+
+/* Activate a different, more or less sparse, set of senones in each
+ * frame. */
+static void
+activate_senones(acmod_t *acmod, int frame)
+{
+    int n_sen = bin_mdef_n_sen(acmod->mdef);
+    int i, step = 1 + (frame % 4) * 7;
+
+    acmod_clear_active(acmod);
+    for (i = frame % 3; i < n_sen; i += step)
+        bitvec_set(acmod->senone_active_vec, i);
+}
+
+static int16 **
+score_utt(acmod_t *acmod, int16 const *buf, size_t nsamps, int *out_nfr,
+          int16 ***out_ref)
+{
+    int16 **scores, **ref = NULL;
+    int n_sen, nfr;
+    float64 score_scale;
+
+    n_sen = bin_mdef_n_sen(acmod->mdef);
+    score_scale = 1.0 / (log(logmath_get_base(acmod->lmath)) * (1 << SENSCR_SHIFT));
+    TEST_EQUAL(0, acmod_start_utt(acmod));
+    acmod_process_raw(acmod, &buf, &nsamps, TRUE);
+    TEST_EQUAL(0, acmod_end_utt(acmod));
+    scores = ckd_calloc_2d(acmod->n_feat_frame, n_sen, sizeof(**scores));
+    if (out_ref)
+        ref = ckd_calloc_2d(acmod->n_feat_frame, n_sen, sizeof(**ref));
+    nfr = 0;
+    while (acmod->n_feat_frame > 0) {
+        int frame_idx = -1;
+        int16 const *senscr;
+        if (!acmod->compallsen)
+            activate_senones(acmod, nfr);
+        if (ref)
+            score_float(acmod->feat_buf[acmod->feat_outidx][0],
+                        score_scale, ref[nfr]);
+        senscr = acmod_score(acmod, &frame_idx);
+        TEST_EQUAL(nfr, frame_idx);
+        if (acmod->compallsen)
+            memcpy(scores[nfr], senscr, n_sen * sizeof(*senscr));
+        else {
+            /* Only the active ones are valid. */
+            int i, sen = 0;
+            for (i = 0; i < acmod->n_senone_active; ++i) {
+                sen += acmod->senone_active[i];
+                scores[nfr][sen] = senscr[sen];
+            }
+        }
+        acmod_advance(acmod);
+        ++nfr;
+    }
+    *out_nfr = nfr;
+    if (out_ref)
+        *out_ref = ref;
+    return scores;
+}
+
+static void
+compare_scores(int16 **a, int16 **b, int nfr, int n_sen)
+{
+    int j;
+    for (j = 0; j < nfr; ++j)
+        TEST_EQUAL(0, memcmp(a[j], b[j], n_sen * sizeof(**a)));
+}
+
+static void
+run_test(cmd_ln_t *config, logmath_t *lmath, fe_t *fe, feat_t *fcb,
+         int16 const *buf, size_t nsamps)
+{
+    static const int levels[] = {
+        SIMD_NONE, SIMD_SSE2, SIMD_AVX2, SIMD_AVX512, SIMD_NEON
+    };
+    int16 **ref, **scores, **fref;
+    acmod_t *acmod;
+    int i, j, nfr, simd_nfr, n_sen, compallsen;
+
+    compallsen = cmd_ln_boolean_r(config, "-compallsen");
+    /* The reference scores one frame at a time. */
+    cmd_ln_set_int_r(config, "-gmmblock", 1);
+    TEST_ASSERT((acmod = acmod_init(config, lmath, fe, fcb)));
+    TEST_EQUAL(0, acmod->block_size);
+    TEST_EQUAL(0, strcmp(acmod->mgau->vt->name, "mlp"));
+    TEST_EQUAL(SIMD_NONE, mlp_mgau_set_simd(acmod->mgau, SIMD_NONE));
+    n_sen = bin_mdef_n_sen(acmod->mdef);
+    ref = score_utt(acmod, buf, nsamps, &nfr, compallsen ? &fref : NULL);
+    acmod_free(acmod);
+
+    /* Quantization should not change the scores too much. */
+    if (compallsen) {
+        float64 err = 0, total = 0;
+        for (i = 0; i < nfr; ++i) {
+            for (j = 0; j < n_sen; ++j) {
+                err += abs(ref[i][j] - fref[i][j]);
+                total += fref[i][j];
+            }
+        }
+        printf("Mean score %.2f, mean error %.2f\n",
+               total / nfr / n_sen, err / nfr / n_sen);
+        TEST_ASSERT(err < total * 0.05);
+        ckd_free_2d(fref);
+    }
+
+    /* By default, full utterances are scored in blocks of frames,
+     * which gives the same scores with any instruction set. */
+    cmd_ln_set_int_r(config, "-gmmblock", 0);
+    for (i = 0; i < (int)(sizeof(levels) / sizeof(levels[0])); ++i) {
+        if (levels[i] > (int)simd_detect())
+            continue;
+        TEST_ASSERT((acmod = acmod_init(config, lmath, fe, fcb)));
+        TEST_EQUAL(MLP_DEFAULT_BLOCK, acmod->block_size);
+        if (mlp_mgau_set_simd(acmod->mgau, levels[i]) != levels[i]) {
+            acmod_free(acmod);
+            continue;
+        }
+        printf("Comparing %s to scalar (gmmblock %d, compallsen %d)\n",
+               simd_level_name(levels[i]),
+               (int)cmd_ln_int_r(config, "-gmmblock"), compallsen);
+        scores = score_utt(acmod, buf, nsamps, &simd_nfr, NULL);
+        TEST_EQUAL(nfr, simd_nfr);
+        compare_scores(ref, scores, nfr, n_sen);
+        ckd_free_2d(scores);
+        acmod_free(acmod);
+    }
+
+    /* So does a different block size. */
+    cmd_ln_set_int_r(config, "-gmmblock", 16);
+    TEST_ASSERT((acmod = acmod_init(config, lmath, fe, fcb)));
+    TEST_EQUAL(16, acmod->block_size);
+    scores = score_utt(acmod, buf, nsamps, &simd_nfr, NULL);
+    TEST_EQUAL(nfr, simd_nfr);
+    compare_scores(ref, scores, nfr, n_sen);
+    ckd_free_2d(scores);
+    acmod_free(acmod);
+
+    /* And so does using more threads. */
+    cmd_ln_set_int_r(config, "-nthreads", 3);
+    TEST_ASSERT((acmod = acmod_init(config, lmath, fe, fcb)));
+    scores = score_utt(acmod, buf, nsamps, &simd_nfr, NULL);
+    TEST_EQUAL(nfr, simd_nfr);
+    compare_scores(ref, scores, nfr, n_sen);
+    ckd_free_2d(scores);
+    acmod_free(acmod);
+    cmd_ln_set_int_r(config, "-nthreads", 1);
+
+    /* And so does loading it from a model pack. */
+    TEST_EQUAL(0, modelpack_write(config, lmath, PACKFILE));
+    cmd_ln_set_str_extra_r(config, "_pack", PACKFILE);
+    TEST_ASSERT((acmod = acmod_init(config, lmath, fe, fcb)));
+    TEST_EQUAL(0, strcmp(acmod->mgau->vt->name, "mlp"));
+    scores = score_utt(acmod, buf, nsamps, &simd_nfr, NULL);
+    TEST_EQUAL(nfr, simd_nfr);
+    compare_scores(ref, scores, nfr, n_sen);
+    ckd_free_2d(scores);
+    acmod_free(acmod);
+    cmd_ln_set_str_extra_r(config, "_pack", NULL);
+    cmd_ln_set_int_r(config, "-gmmblock", 0);
+
+    ckd_free_2d(ref);
+}
+
+int
+main(int argc, char *argv[])
+{
+    logmath_t *lmath;
+    cmd_ln_t *config;
+    bin_mdef_t *mdef;
+    ps_decoder_t *ps;
+    fe_t *fe;
+    feat_t *fcb;
+    FILE *rawfh;
+    int16 *buf;
+    size_t nsamps;
+    int i;
+
+    (void)argc; (void)argv;
+    TEST_ASSERT(mdef = bin_mdef_read(NULL, MODELDIR "/en-us/mdef.bin"));
+    write_mlp(bin_mdef_n_sen(mdef));
+    bin_mdef_free(mdef);
+
+    TEST_ASSERT(rawfh = fopen(TESTDATADIR "/goforward.raw", "rb"));
+    fseek(rawfh, 0, SEEK_END);
+    nsamps = ftell(rawfh) / sizeof(*buf);
+    fseek(rawfh, 0, SEEK_SET);
+    buf = ckd_calloc(nsamps, sizeof(*buf));
+    TEST_EQUAL(nsamps, fread(buf, sizeof(*buf), nsamps, rawfh));
+    fclose(rawfh);
+
+    lmath = logmath_init(1.0001, 0, 0);
+    config = cmd_ln_init(NULL, ps_args(), TRUE,
+                         "-input_endian", "little", /* raw data demands it */
+                         NULL);
+    TEST_ASSERT(config);
+    cmd_ln_parse_file_r(config, ps_args(), MODELDIR "/en-us/feat.params", FALSE);
+    cmd_ln_set_str_extra_r(config, "_mdef", MODELDIR "/en-us/mdef.bin");
+    cmd_ln_set_str_extra_r(config, "_tmat", MODELDIR "/en-us/transition_matrices");
+    cmd_ln_set_str_extra_r(config, "_mlp", MLPFILE);
+    cmd_ln_set_str_extra_r(config, "_mean", NULL);
+    cmd_ln_set_str_extra_r(config, "_var", NULL);
+    cmd_ln_set_str_extra_r(config, "_sendump", NULL);
+    cmd_ln_set_str_extra_r(config, "_mixw", NULL);
+    cmd_ln_set_str_extra_r(config, "_lda", NULL);
+    cmd_ln_set_str_extra_r(config, "_senmgau", NULL);
+    cmd_ln_set_str_extra_r(config, "_featparams", NULL);
+    cmd_ln_set_str_extra_r(config, "_fdict", NULL);
+    cmd_ln_set_str_extra_r(config, "_dict", NULL);
+    cmd_ln_set_str_extra_r(config, "_pack", NULL);
+    fe = fe_init(config);
+    fcb = feat_init(config);
+
+    cmd_ln_set_boolean_r(config, "-compallsen", TRUE);
+    run_test(config, lmath, fe, fcb, buf, nsamps);
+    cmd_ln_set_boolean_r(config, "-compallsen", FALSE);
+    run_test(config, lmath, fe, fcb, buf, nsamps);
+
+    fe_free(fe);
+    feat_free(fcb);
+    logmath_free(lmath);
+    cmd_ln_free_r(config);
+
+    /* The decoder finds it in the model directory (or with -mlp). */
+    TEST_ASSERT(config =
+            cmd_ln_init(NULL, ps_args(), TRUE,
+			"-hmm", MODELDIR "/en-us",
+			"-mlp", MLPFILE,
+			"-fsg", TESTDATADIR "/goforward.fsg",
+			"-dict", TESTDATADIR "/turtle.dic",
+			"-input_endian", "little", /* raw data demands it */
+			"-samprate", "16000", NULL));
+    TEST_ASSERT(ps = ps_init(config));
+    TEST_EQUAL(0, strcmp(ps->acmod->mgau->vt->name, "mlp"));
+    TEST_EQUAL(0, ps_start_utt(ps));
+    TEST_ASSERT(ps_process_raw(ps, buf, nsamps, FALSE, TRUE) > 0);
+    TEST_EQUAL(0, ps_end_utt(ps));
+    TEST_ASSERT(ps_get_n_frames(ps) > 0);
+    ps_free(ps);
+    cmd_ln_free_r(config);
+
+    ckd_free(buf);
+    for (i = 0; i < 2; ++i) {
+        ckd_free(weight[i]);
+        ckd_free(wscale[i]);
+        ckd_free(bias[i]);
+    }
+    remove(MLPFILE);
+    remove(PACKFILE);
+    return 0;
+}
@@ -0,0 +1,260 @@
+/* -*- c-basic-offset: 4 -*- */
+#include "config.h"
+
+#include <soundswallower/pocketsphinx.h>
+#include <stdio.h>
+#include <string.h>
+
+#include <soundswallower/pocketsphinx_internal.h>
+#include <soundswallower/ptm_mgau.h>
+#include <soundswallower/modelpack.h>
+
+#include "test_macros.h"
+
+#define PACKFILE "test_modelpack.ssm"
+#define GAUDENFILE "test_modelpack.gauden"
+#define MLLRFILE "test_modelpack.mllr"
+
+/* Identity transform for the three streams of en-us */
+static void
+write_identity_mllr(void)
+{
+    FILE *fh;
+    int f, i, j;
+
+    TEST_ASSERT(fh = fopen(MLLRFILE, "w"));
+    fprintf(fh, "1\n3\n");
+    for (f = 0; f < 3; ++f) {
+        fprintf(fh, "13\n");
+        for (i = 0; i < 13; ++i) {
+            for (j = 0; j < 13; ++j)
+                fprintf(fh, "%d ", i == j);
+            fprintf(fh, "\n");
+        }
+        for (i = 0; i < 13; ++i)
+            fprintf(fh, "0 ");
+        fprintf(fh, "\n");
+        for (i = 0; i < 13; ++i)
+            fprintf(fh, "1 ");
+        fprintf(fh, "\n");
+    }
+    fclose(fh);
+}
+
+static const char *
+decode(ps_decoder_t *ps, int32 *score)
+{
+    FILE *rawfh;
+    int16 buf[2048];
+    size_t nread;
+
+    TEST_ASSERT(rawfh = fopen(TESTDATADIR "/goforward.raw", "rb"));
+    TEST_EQUAL(0, ps_start_utt(ps));
+    while (!feof(rawfh)) {
+	nread = fread(buf, sizeof(*buf), sizeof(buf)/sizeof(*buf), rawfh);
+        ps_process_raw(ps, buf, nread, FALSE, FALSE);
+    }
+    fclose(rawfh);
+    TEST_EQUAL(0, ps_end_utt(ps));
+    return ps_get_hyp(ps, score);
+}
+
+static void
+check_bad_featlen(void)
+{
+    logmath_t *lmath;
+    s3file_t *s3f;
+    gauden_t *g;
+    FILE *fh;
+    char *buf;
+    long len;
+    int32 zero = 0;
+
+    TEST_ASSERT(fh = fopen(GAUDENFILE, "rb"));
+    fseek(fh, 0, SEEK_END);
+    len = ftell(fh);
+    fseek(fh, 0, SEEK_SET);
+    buf = ckd_malloc(len);
+    TEST_EQUAL((size_t)len, fread(buf, 1, len, fh));
+    fclose(fh);
+    /* Lengths of the streams follow the 40-byte header. */
+    memcpy(buf + 40, &zero, sizeof(zero));
+    TEST_ASSERT(fh = fopen(GAUDENFILE ".bad", "wb"));
+    TEST_EQUAL((size_t)len, fwrite(buf, 1, len, fh));
+    fclose(fh);
+    ckd_free(buf);
+
+    /* Same -logbase and -varfloor as they were written with. */
+    lmath = logmath_init(1.0001f, 0, FALSE);
+    TEST_ASSERT(s3f = s3file_map_file(GAUDENFILE));
+    g = gauden_init_precomp(s3f, 0.0001f, lmath);
+    TEST_ASSERT(g);
+    gauden_free(g);
+    s3file_free(s3f);
+    TEST_ASSERT(s3f = s3file_map_file(GAUDENFILE ".bad"));
+    TEST_EQUAL(NULL, gauden_init_precomp(s3f, 0.0001f, lmath));
+    s3file_free(s3f);
+    logmath_free(lmath);
+    remove(GAUDENFILE ".bad");
+}
+
+int
+main(int argc, char *argv[])
+{
+    ps_decoder_t *ps, *ps2;
+    ps_model_t *model;
+    ps_mllr_t *mllr;
+    logmath_t *lmath;
+    cmd_ln_t *config;
+    ptm_mgau_t *s;
+    s3file_t *pack;
+    const char *hyp;
+    int32 score, score2;
+
+    (void)argc; (void)argv;
+    /* Write a pack from the model directory. */
+    TEST_ASSERT(config =
+            cmd_ln_init(NULL, ps_args(), TRUE,
+			"-hmm", MODELDIR "/en-us", NULL));
+    TEST_ASSERT(model = ps_model_init(config));
+    TEST_EQUAL(0, ps_model_write(model, PACKFILE));
+    /* And just the Gaussians. */
+    lmath = logmath_init(cmd_ln_float32_r(config, "-logbase"), 0, FALSE);
+    TEST_EQUAL(0, modelpack_write_gauden(ps_model_get_config(model),
+                                         lmath, GAUDENFILE));
+    logmath_free(lmath);
+    ps_model_free(model);
+    cmd_ln_free_r(config);
+    TEST_ASSERT(modelpack_is_pack(PACKFILE));
+    TEST_ASSERT(!modelpack_is_pack(MODELDIR "/en-us"));
+    TEST_ASSERT(!modelpack_is_pack(MODELDIR "/en-us/means"));
+    TEST_ASSERT(pack = modelpack_open(PACKFILE));
+    s3file_free(pack);
+
+    /* Decode with the directory. */
+    TEST_ASSERT(config =
+            cmd_ln_init(NULL, ps_args(), TRUE,
+			"-hmm", MODELDIR "/en-us",
+			"-fsg", TESTDATADIR "/goforward.fsg",
+			"-dict", TESTDATADIR "/turtle.dic",
+			"-input_endian", "little", /* raw data demands it */
+			"-samprate", "16000", NULL));
+    TEST_ASSERT(ps = ps_init(config));
+    hyp = decode(ps, &score);
+    printf("%s (%d)\n", hyp, score);
+    TEST_EQUAL(0, strcmp("go forward ten meters", hyp));
+    cmd_ln_free_r(config);
+
+    /* And with the pack, which should be exactly the same. */
+    TEST_ASSERT(config =
+            cmd_ln_init(NULL, ps_args(), TRUE,
+			"-hmm", PACKFILE,
+			"-fsg", TESTDATADIR "/goforward.fsg",
+			"-dict", TESTDATADIR "/turtle.dic",
+			"-input_endian", "little", /* raw data demands it */
+			"-samprate", "16000", NULL));
+    TEST_ASSERT(ps2 = ps_init(config));
+    hyp = decode(ps2, &score2);
+    printf("%s (%d)\n", hyp, score2);
+    TEST_EQUAL(0, strcmp("go forward ten meters", hyp));
+    TEST_EQUAL(score, score2);
+    /* Feature parameters came from the pack. */
+    TEST_EQUAL(130, cmd_ln_float32_r(ps2->config, "-lowerf"));
+    TEST_EQUAL(0, strcmp("1s_c_d_dd", cmd_ln_str_r(ps2->config, "-feat")));
+    /* Noise dictionary came from the pack, dictionary didn't. */
+    TEST_ASSERT(dict_wordid(ps2->dict, "<sil>") != BAD_S3WID);
+    TEST_ASSERT(dict_wordid(ps2->dict, "ten") != BAD_S3WID);
+    TEST_EQUAL(dict_size(ps->dict), dict_size(ps2->dict));
+    /* Gaussians are used in place. */
+    s = (ptm_mgau_t *)ps2->acmod->mgau;
+    TEST_ASSERT(s->g->filemap);
+    TEST_ASSERT((const char *)s->g->mean[0][0][0] >= (const char *)s->g->filemap->buf);
+    TEST_ASSERT((const char *)s->g->mean[0][0][0] < s->g->filemap->end);
+    /* And can't be adapted. */
+    TEST_EQUAL(-1, gauden_mllr_transform(s->g, NULL, ps2->config));
+    /* Nor can a pack be packed again. */
+    TEST_EQUAL(-1, ps_model_write(ps_get_model(ps2), PACKFILE ".2"));
+    ps_free(ps2);
+    cmd_ln_free_r(config);
+
+    /* Precomputed Gaussians can also go with a model directory. */
+    TEST_ASSERT(config =
+            cmd_ln_init(NULL, ps_args(), TRUE,
+			"-hmm", MODELDIR "/en-us",
+			"-gauden", GAUDENFILE,
+			"-fsg", TESTDATADIR "/goforward.fsg",
+			"-dict", TESTDATADIR "/turtle.dic",
+			"-input_endian", "little", /* raw data demands it */
+			"-samprate", "16000", NULL));
+    TEST_ASSERT(ps2 = ps_init(config));
+    s = (ptm_mgau_t *)ps2->acmod->mgau;
+    TEST_ASSERT(s->g->filemap);
+    hyp = decode(ps2, &score2);
+    TEST_EQUAL(0, strcmp("go forward ten meters", hyp));
+    /* Reinitialize to reset CMN. */
+    TEST_EQUAL(0, ps_reinit(ps, NULL));
+    hyp = decode(ps, &score);
+    TEST_EQUAL(score, score2);
+    /* In which case they can be adapted, from the means and variances. */
+    write_identity_mllr();
+    TEST_ASSERT(mllr = ps_mllr_read(MLLRFILE));
+    TEST_EQUAL(mllr, ps_update_mllr(ps2, mllr));
+    ps_mllr_free(mllr);
+    s = (ptm_mgau_t *)ps2->acmod->mgau;
+    TEST_EQUAL(NULL, s->g->filemap);
+    TEST_EQUAL(0, ps_reinit(ps2, NULL));
+    hyp = decode(ps2, &score2);
+    TEST_EQUAL(0, strcmp("go forward ten meters", hyp));
+    TEST_EQUAL(score, score2);
+    ps_free(ps2);
+    cmd_ln_free_r(config);
+
+    /* If they don't match the configuration, the means and variances
+     * are used instead. */
+    TEST_ASSERT(config =
+            cmd_ln_init(NULL, ps_args(), TRUE,
+			"-hmm", MODELDIR "/en-us",
+			"-gauden", GAUDENFILE,
+			"-varfloor", "0.001",
+			"-fsg", TESTDATADIR "/goforward.fsg",
+			"-dict", TESTDATADIR "/turtle.dic", NULL));
+    TEST_ASSERT(ps2 = ps_init(config));
+    s = (ptm_mgau_t *)ps2->acmod->mgau;
+    TEST_EQUAL(NULL, s->g->filemap);
+    ps_free(ps2);
+    cmd_ln_free_r(config);
+
+    /* Nor if they came from some other means and variances (here we
+     * pretend the variances are new means, with the same shape). */
+    TEST_ASSERT(config =
+            cmd_ln_init(NULL, ps_args(), TRUE,
+                        "-hmm", MODELDIR "/en-us",
+                        "-gauden", GAUDENFILE,
+                        "-mean", MODELDIR "/en-us/variances",
+                        "-fsg", TESTDATADIR "/goforward.fsg",
+                        "-dict", TESTDATADIR "/turtle.dic", NULL));
+    TEST_ASSERT(ps2 = ps_init(config));
+    s = (ptm_mgau_t *)ps2->acmod->mgau;
+    TEST_EQUAL(NULL, s->g->filemap);
+    ps_free(ps2);
+    ps_free(ps);
+    cmd_ln_free_r(config);
+
+    /* Invalid dimensions are rejected. */
+    check_bad_featlen();
+
+    /* Gaussians are only valid for the log base they were made with. */
+    TEST_ASSERT(config =
+            cmd_ln_init(NULL, ps_args(), TRUE,
+			"-hmm", PACKFILE,
+			"-logbase", "1.0003",
+			"-fsg", TESTDATADIR "/goforward.fsg",
+			"-dict", TESTDATADIR "/turtle.dic", NULL));
+    TEST_EQUAL(NULL, ps_init(config));
+    cmd_ln_free_r(config);
+
+    remove(PACKFILE);
+    remove(GAUDENFILE);
+    remove(MLLRFILE);
+    return 0;
+}
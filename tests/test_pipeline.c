@@ -0,0 +1,84 @@
+/* -*- c-basic-offset: 4 -*- */
+#include "config.h"
+
+#include <stdio.h>
+#include <string.h>
+
+#include <soundswallower/pocketsphinx.h>
+#include <soundswallower/pocketsphinx_internal.h>
+
+#include "test_macros.h"
+
+static const char *
+decode(cmd_ln_t *config, int32 *score, int *n_frames, int expect_pipe)
+{
+    static char hyp[256];
+    ps_decoder_t *ps;
+    FILE *rawfh;
+    int16 buf[2048];
+    size_t nread;
+    const char *h;
+
+    TEST_ASSERT(ps = ps_init(config));
+#ifdef HAVE_PTHREAD
+    TEST_EQUAL(expect_pipe, ps->acmod->pipe != NULL);
+#else
+    (void)expect_pipe;
+#endif
+    TEST_ASSERT(rawfh = fopen(TESTDATADIR "/goforward.raw", "rb"));
+    TEST_EQUAL(0, ps_start_utt(ps));
+    while (!feof(rawfh)) {
+        nread = fread(buf, sizeof(*buf), sizeof(buf)/sizeof(*buf), rawfh);
+        TEST_ASSERT(ps_process_raw(ps, buf, nread, FALSE, FALSE) >= 0);
+    }
+    fclose(rawfh);
+    TEST_EQUAL(0, ps_end_utt(ps));
+    *n_frames = ps_get_n_frames(ps);
+    TEST_ASSERT(h = ps_get_hyp(ps, score));
+    strncpy(hyp, h, sizeof(hyp) - 1);
+    ps_free(ps);
+    return hyp;
+}
+
+static void
+compare(const char *compallsen, const char *gmmblock)
+{
+    cmd_ln_t *config;
+    const char *hyp;
+    int32 score, score2;
+    int n_frames, n_frames2, pipe;
+
+    TEST_ASSERT(config =
+            cmd_ln_init(NULL, ps_args(), TRUE,
+                        "-hmm", MODELDIR "/en-us",
+                        "-fsg", TESTDATADIR "/goforward.fsg",
+                        "-dict", TESTDATADIR "/turtle.dic",
+                        "-compallsen", compallsen,
+                        "-gmmblock", gmmblock,
+                        "-input_endian", "little", /* raw data demands it */
+                        "-samprate", "16000", NULL));
+    hyp = decode(config, &score, &n_frames, FALSE);
+    printf("%s (%d)\n", hyp, score);
+    TEST_EQUAL(0, strcmp("go forward ten meters", hyp));
+
+    /* Scores don't change when computed ahead of the search, and
+     * without -compallsen it just doesn't happen. */
+    cmd_ln_set_boolean_r(config, "-pipeline", TRUE);
+    pipe = cmd_ln_boolean_r(config, "-compallsen");
+    hyp = decode(config, &score2, &n_frames2, pipe);
+    printf("pipeline %d gmmblock %s: %s (%d)\n", pipe, gmmblock, hyp, score2);
+    TEST_EQUAL(0, strcmp("go forward ten meters", hyp));
+    TEST_EQUAL(score, score2);
+    TEST_EQUAL(n_frames, n_frames2);
+    cmd_ln_free_r(config);
+}
+
+int
+main(int argc, char *argv[])
+{
+    (void)argc; (void)argv;
+    compare("yes", "1");
+    compare("yes", "8");
+    compare("no", "1");
+    return 0;
+}
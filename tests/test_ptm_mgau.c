@@ -8,9 +8,14 @@
 #include <soundswallower/pocketsphinx_internal.h>
 #include <soundswallower/ptm_mgau.h>
 #include <soundswallower/ms_mgau.h>
+#include <soundswallower/simd.h>
 
 #include "test_macros.h"
 
+#define MIXWFILE "test_ptm_mgau.mixw"
+#define SENDUMP4FILE "test_ptm_mgau.sendump4"
+#define SENDUMP8FILE "test_ptm_mgau.sendump8"
+
 static const mfcc_t cmninit[13] = {
 	FLOAT2MFCC(41.00),
 	FLOAT2MFCC(-5.29),
@@ -83,6 +88,567 @@ run_acmod_test(acmod_t *acmod)
 	ckd_free(buf);
 }
 
+static int16 **
+score_utt(acmod_t *acmod, int16 const *buf, size_t nsamps, int *out_nfr)
+{
+	int16 **scores;
+	int n_sen, nfr;
+
+	n_sen = bin_mdef_n_sen(acmod->mdef);
+	cmn_live_set(acmod->fcb->cmn_struct, cmninit);
+	TEST_EQUAL(0, acmod_start_utt(acmod));
+	acmod_process_raw(acmod, &buf, &nsamps, TRUE);
+	TEST_EQUAL(0, acmod_end_utt(acmod));
+	scores = ckd_calloc_2d(acmod->n_feat_frame, n_sen, sizeof(**scores));
+	nfr = 0;
+	while (acmod->n_feat_frame > 0) {
+		int frame_idx = -1;
+		int16 const *senscr = acmod_score(acmod, &frame_idx);
+		TEST_EQUAL(nfr, frame_idx);
+		memcpy(scores[nfr++], senscr, n_sen * sizeof(*senscr));
+		acmod_advance(acmod);
+	}
+	*out_nfr = nfr;
+	return scores;
+}
+
+void
+run_simd_test(cmd_ln_t *config, logmath_t *lmath, fe_t *fe, feat_t *fcb)
+{
+	static const int levels[] = {
+		SIMD_SSE2, SIMD_AVX2, SIMD_AVX512, SIMD_NEON
+	};
+	FILE *rawfh;
+	int16 *buf, **ref;
+	size_t nsamps;
+	acmod_t *acmod;
+	int i, nfr, n_sen;
+
+	TEST_ASSERT(rawfh = fopen(TESTDATADIR "/goforward.raw", "rb"));
+	fseek(rawfh, 0, SEEK_END);
+	nsamps = ftell(rawfh) / sizeof(*buf);
+	fseek(rawfh, 0, SEEK_SET);
+	buf = ckd_calloc(nsamps, sizeof(*buf));
+	TEST_EQUAL(nsamps, fread(buf, sizeof(*buf), nsamps, rawfh));
+	fclose(rawfh);
+
+	/* Reference scores from the scalar code. */
+	TEST_ASSERT((acmod = acmod_init(config, lmath, fe, fcb)));
+	TEST_EQUAL(SIMD_NONE, ptm_mgau_set_simd(acmod->mgau, SIMD_NONE));
+	n_sen = bin_mdef_n_sen(acmod->mdef);
+	ref = score_utt(acmod, buf, nsamps, &nfr);
+	acmod_free(acmod);
+
+	for (i = 0; i < (int)(sizeof(levels) / sizeof(levels[0])); ++i) {
+		int16 **scores;
+		int j, simd_nfr;
+
+		if (levels[i] > (int)simd_detect())
+			continue;
+		TEST_ASSERT((acmod = acmod_init(config, lmath, fe, fcb)));
+		if (ptm_mgau_set_simd(acmod->mgau, levels[i]) != levels[i]) {
+			acmod_free(acmod);
+			continue;
+		}
+		printf("Comparing %s to scalar codebook evaluation\n",
+		       simd_level_name(levels[i]));
+		scores = score_utt(acmod, buf, nsamps, &simd_nfr);
+		TEST_EQUAL(nfr, simd_nfr);
+		for (j = 0; j < nfr; ++j)
+			TEST_EQUAL(0, memcmp(ref[j], scores[j],
+					     n_sen * sizeof(**scores)));
+		ckd_free_2d(scores);
+		acmod_free(acmod);
+	}
+	ckd_free_2d(ref);
+	ckd_free(buf);
+}
+
+/* Score a synthetic frame (twice, to use both eval_cb() and
+ * eval_topn()) in which the best density of codebook 0 comes out at
+ * exactly -1025, but would come out just above it if its multiply
+ * and subtract were fused, which changes its score once shifted by
+ * SENSCR_SHIFT. */
+static int16 *
+score_boundary(cmd_ln_t *config, logmath_t *lmath, fe_t *fe, feat_t *fcb,
+	       int level, int *out_n_sen)
+{
+	acmod_t *acmod;
+	ptm_mgau_t *s;
+	mfcc_t **mean, **var, **old_mean, **old_var;
+	mfcc_t *det, *old_det, **feat;
+	uint8 *senone_active;
+	int16 *scores;
+	int i, n_sen, frame;
+
+	TEST_ASSERT((acmod = acmod_init(config, lmath, fe, fcb)));
+	s = (ptm_mgau_t *)acmod->mgau;
+	mean = ckd_calloc_2d(s->g->n_density, s->g->featlen[0], sizeof(**mean));
+	var = ckd_calloc_2d(s->g->n_density, s->g->featlen[0], sizeof(**var));
+	det = ckd_calloc(s->g->n_density, sizeof(*det));
+	/* -574 - 33.312 * 33.312 * 0.40642, in the last density, so
+	 * that eval_cb() finds it. */
+	for (i = 0; i < s->g->n_density - 1; ++i)
+		det[i] = (mfcc_t)(-3000 - i);
+	var[i][0] = 0x1.a02c9p-2f;
+	det[i] = -0x1.1fp+9f;
+	old_mean = s->g->mean[0][0];
+	old_var = s->g->var[0][0];
+	old_det = s->g->det[0][0];
+	s->g->mean[0][0] = mean;
+	s->g->var[0][0] = var;
+	s->g->det[0][0] = det;
+	TEST_EQUAL(level, ptm_mgau_set_simd(acmod->mgau, level));
+
+	n_sen = bin_mdef_n_sen(acmod->mdef);
+	scores = ckd_calloc(2 * n_sen, sizeof(*scores));
+	senone_active = ckd_calloc(n_sen, sizeof(*senone_active));
+	for (i = 1; i < n_sen; ++i)
+		senone_active[i] = 1;
+	feat = ckd_calloc(s->g->n_feat, sizeof(*feat));
+	for (i = 0; i < s->g->n_feat; ++i)
+		feat[i] = ckd_calloc(s->g->featlen[i], sizeof(**feat));
+	feat[0][0] = 0x1.0a7efap+5f;
+	for (frame = 0; frame < 2; ++frame) {
+		acmod->mgau->frame_idx = frame;
+		ps_mgau_frame_eval(acmod->mgau, scores + frame * n_sen,
+				   senone_active, n_sen, feat, frame, TRUE);
+	}
+
+	s->g->mean[0][0] = old_mean;
+	s->g->var[0][0] = old_var;
+	s->g->det[0][0] = old_det;
+	for (i = 0; i < s->g->n_feat; ++i)
+		ckd_free(feat[i]);
+	ckd_free(feat);
+	acmod_free(acmod);
+	ckd_free_2d(mean);
+	ckd_free_2d(var);
+	ckd_free(det);
+	ckd_free(senone_active);
+	*out_n_sen = n_sen;
+	return scores;
+}
+
+void
+run_boundary_test(cmd_ln_t *config, logmath_t *lmath, fe_t *fe, feat_t *fcb)
+{
+	static const int levels[] = {
+		SIMD_SSE2, SIMD_AVX2, SIMD_AVX512, SIMD_NEON
+	};
+	int16 *ref;
+	int i, n_sen;
+
+	ref = score_boundary(config, lmath, fe, fcb, SIMD_NONE, &n_sen);
+	for (i = 0; i < (int)(sizeof(levels) / sizeof(levels[0])); ++i) {
+		int16 *scores;
+
+		if (levels[i] > (int)simd_detect())
+			continue;
+		printf("Comparing %s to scalar codebook evaluation at a rounding boundary\n",
+		       simd_level_name(levels[i]));
+		scores = score_boundary(config, lmath, fe, fcb, levels[i], &n_sen);
+		TEST_EQUAL(0, memcmp(ref, scores, 2 * n_sen * sizeof(*scores)));
+		ckd_free(scores);
+	}
+	ckd_free(ref);
+}
+
+void
+run_senmajor_test(cmd_ln_t *config, logmath_t *lmath, fe_t *fe, feat_t *fcb)
+{
+	FILE *rawfh;
+	int16 *buf, **ref, **scores;
+	size_t nsamps;
+	acmod_t *acmod;
+	int i, nfr, sen_nfr, n_sen;
+
+	TEST_ASSERT(rawfh = fopen(TESTDATADIR "/goforward.raw", "rb"));
+	fseek(rawfh, 0, SEEK_END);
+	nsamps = ftell(rawfh) / sizeof(*buf);
+	fseek(rawfh, 0, SEEK_SET);
+	buf = ckd_calloc(nsamps, sizeof(*buf));
+	TEST_EQUAL(nsamps, fread(buf, sizeof(*buf), nsamps, rawfh));
+	fclose(rawfh);
+
+	TEST_ASSERT((acmod = acmod_init(config, lmath, fe, fcb)));
+	n_sen = bin_mdef_n_sen(acmod->mdef);
+	TEST_ASSERT(((ptm_mgau_t *)acmod->mgau)->sen_mixw == NULL);
+	ref = score_utt(acmod, buf, nsamps, &nfr);
+	TEST_EQUAL(0, ptm_mgau_set_senmajor(acmod->mgau, TRUE));
+	TEST_ASSERT(((ptm_mgau_t *)acmod->mgau)->sen_mixw != NULL);
+	printf("Comparing senone-major to feature-major mixture weights\n");
+	scores = score_utt(acmod, buf, nsamps, &sen_nfr);
+	TEST_EQUAL(nfr, sen_nfr);
+	for (i = 0; i < nfr; ++i)
+		TEST_EQUAL(0, memcmp(ref[i], scores[i],
+				     n_sen * sizeof(**scores)));
+	TEST_EQUAL(0, ptm_mgau_set_senmajor(acmod->mgau, FALSE));
+	TEST_ASSERT(((ptm_mgau_t *)acmod->mgau)->sen_mixw == NULL);
+	ckd_free_2d(scores);
+	ckd_free_2d(ref);
+	acmod_free(acmod);
+	ckd_free(buf);
+}
+
+static void
+write_string(FILE *fh, const char *str)
+{
+	int32 len = strlen(str) + 1;
+	fwrite(&len, sizeof(len), 1, fh);
+	fwrite(str, 1, len, fh);
+}
+
+/* There is no PTM model with 4-bit mixture weights in the tree, so we
+ * make random ones for en-us, along with the same weights unpacked to
+ * 8 bits.  Even senones are in the low nibble of each byte, and odd
+ * ones in the high nibble. */
+static void
+write_sendump_4bit(int n_sen, int n_feat, int n_density)
+{
+	FILE *fh4, *fh8;
+	char str[64];
+	uint8 cb[16], *row4, *row8;
+	uint32 seed = 42;
+	int32 zero = 0;
+	int i, j, rowlen;
+
+	TEST_ASSERT(fh4 = fopen(SENDUMP4FILE, "wb"));
+	TEST_ASSERT(fh8 = fopen(SENDUMP8FILE, "wb"));
+	write_string(fh4, "test_ptm_mgau");
+	write_string(fh8, "test_ptm_mgau");
+	write_string(fh4, "4-bit mixture weights");
+	write_string(fh8, "8-bit mixture weights");
+	sprintf(str, "feature_count %d", n_feat);
+	write_string(fh4, str);
+	write_string(fh8, str);
+	sprintf(str, "mixture_count %d", n_density);
+	write_string(fh4, str);
+	write_string(fh8, str);
+	sprintf(str, "model_count %d", n_sen);
+	write_string(fh4, str);
+	write_string(fh8, str);
+	write_string(fh4, "cluster_count 16");
+	write_string(fh4, "cluster_bits 4");
+	fwrite(&zero, sizeof(zero), 1, fh4);
+	fwrite(&zero, sizeof(zero), 1, fh8);
+	fwrite(&n_density, sizeof(int32), 1, fh8);
+	fwrite(&n_sen, sizeof(int32), 1, fh8);
+	for (i = 0; i < 16; ++i)
+		cb[i] = i * 9;
+	fwrite(cb, 1, 16, fh4);
+	rowlen = (n_sen + 1) / 2;
+	row4 = ckd_calloc(rowlen, 1);
+	row8 = ckd_calloc(n_sen, 1);
+	for (i = 0; i < n_feat * n_density; ++i) {
+		for (j = 0; j < rowlen; ++j) {
+			seed = seed * 1103515245 + 12345;
+			row4[j] = seed >> 16;
+		}
+		for (j = 0; j < n_sen; ++j)
+			row8[j] = cb[(j & 1) ? row4[j / 2] >> 4 : row4[j / 2] & 0x0f];
+		fwrite(row4, 1, rowlen, fh4);
+		fwrite(row8, 1, n_sen, fh8);
+	}
+	ckd_free(row4);
+	ckd_free(row8);
+	fclose(fh4);
+	fclose(fh8);
+}
+
+static int16 *
+score_frames_active(acmod_t *acmod, int16 const *buf, size_t nsamps,
+		    int *out_nfr)
+{
+	uint8 *senone_active;
+	int16 *scores;
+	int n_sen, nfr, frame;
+
+	n_sen = bin_mdef_n_sen(acmod->mdef);
+	cmn_live_set(acmod->fcb->cmn_struct, cmninit);
+	TEST_EQUAL(0, acmod_start_utt(acmod));
+	acmod_process_raw(acmod, &buf, &nsamps, TRUE);
+	TEST_EQUAL(0, acmod_end_utt(acmod));
+	nfr = acmod->n_feat_frame;
+	scores = ckd_calloc(nfr * n_sen, sizeof(*scores));
+	senone_active = ckd_calloc(n_sen, sizeof(*senone_active));
+	for (frame = 0; frame < nfr; ++frame) {
+		mfcc_t **feat = acmod->feat_buf[(acmod->feat_outidx + frame)
+						% acmod->n_feat_alloc];
+		int i, n_active;
+		/* Every third senone, give or take. */
+		for (n_active = i = 0; i < n_sen; i += 3 + frame % 2)
+			senone_active[n_active++] = (i == 0) ? 0 : 3 + frame % 2;
+		acmod->mgau->frame_idx = frame;
+		ps_mgau_frame_eval(acmod->mgau, scores + frame * n_sen,
+				   senone_active, n_active, feat, frame, FALSE);
+	}
+	ckd_free(senone_active);
+	*out_nfr = nfr;
+	return scores;
+}
+
+void
+run_thread_test(cmd_ln_t *config, logmath_t *lmath, fe_t *fe, feat_t *fcb)
+{
+	FILE *rawfh;
+	int16 *buf, **ref, **scores, *ref_active, *scores_active;
+	size_t nsamps;
+	acmod_t *acmod;
+	int i, nfr, thr_nfr, n_sen;
+
+	TEST_ASSERT(rawfh = fopen(TESTDATADIR "/goforward.raw", "rb"));
+	fseek(rawfh, 0, SEEK_END);
+	nsamps = ftell(rawfh) / sizeof(*buf);
+	fseek(rawfh, 0, SEEK_SET);
+	buf = ckd_calloc(nsamps, sizeof(*buf));
+	TEST_EQUAL(nsamps, fread(buf, sizeof(*buf), nsamps, rawfh));
+	fclose(rawfh);
+
+	TEST_ASSERT((acmod = acmod_init(config, lmath, fe, fcb)));
+	n_sen = bin_mdef_n_sen(acmod->mdef);
+	ref = score_utt(acmod, buf, nsamps, &nfr);
+	ref_active = score_frames_active(acmod, buf, nsamps, &nfr);
+	acmod_free(acmod);
+
+	cmd_ln_set_int32_r(config, "-nthreads", 3);
+	TEST_ASSERT((acmod = acmod_init(config, lmath, fe, fcb)));
+	printf("Comparing 3 threads to 1 thread\n");
+	scores = score_utt(acmod, buf, nsamps, &thr_nfr);
+	TEST_EQUAL(nfr, thr_nfr);
+	for (i = 0; i < nfr; ++i)
+		TEST_EQUAL(0, memcmp(ref[i], scores[i],
+				     n_sen * sizeof(**scores)));
+	scores_active = score_frames_active(acmod, buf, nsamps, &thr_nfr);
+	TEST_EQUAL(nfr, thr_nfr);
+	TEST_EQUAL(0, memcmp(ref_active, scores_active,
+			     nfr * n_sen * sizeof(*scores_active)));
+	acmod_free(acmod);
+	cmd_ln_set_int32_r(config, "-nthreads", 1);
+
+	ckd_free(scores_active);
+	ckd_free(ref_active);
+	ckd_free_2d(scores);
+	ckd_free_2d(ref);
+	ckd_free(buf);
+}
+
+void
+run_4bit_test(cmd_ln_t *config, logmath_t *lmath, fe_t *fe, feat_t *fcb)
+{
+	FILE *rawfh;
+	int16 *buf, **ref, **scores, *ref_active, *scores_active;
+	size_t nsamps;
+	acmod_t *acmod;
+	ptm_mgau_t *s;
+	int i, nfr, nfr4, n_sen;
+
+	TEST_ASSERT(rawfh = fopen(TESTDATADIR "/goforward.raw", "rb"));
+	fseek(rawfh, 0, SEEK_END);
+	nsamps = ftell(rawfh) / sizeof(*buf);
+	fseek(rawfh, 0, SEEK_SET);
+	buf = ckd_calloc(nsamps, sizeof(*buf));
+	TEST_EQUAL(nsamps, fread(buf, sizeof(*buf), nsamps, rawfh));
+	fclose(rawfh);
+
+	TEST_ASSERT((acmod = acmod_init(config, lmath, fe, fcb)));
+	s = (ptm_mgau_t *)acmod->mgau;
+	write_sendump_4bit(s->n_sen, s->g->n_feat, s->g->n_density);
+	acmod_free(acmod);
+
+	cmd_ln_set_str_extra_r(config, "_sendump", SENDUMP8FILE);
+	TEST_ASSERT((acmod = acmod_init(config, lmath, fe, fcb)));
+	TEST_ASSERT(((ptm_mgau_t *)acmod->mgau)->mixw_cb == NULL);
+	n_sen = bin_mdef_n_sen(acmod->mdef);
+	ref = score_utt(acmod, buf, nsamps, &nfr);
+	ref_active = score_frames_active(acmod, buf, nsamps, &nfr);
+	acmod_free(acmod);
+
+	cmd_ln_set_str_extra_r(config, "_sendump", SENDUMP4FILE);
+	TEST_ASSERT((acmod = acmod_init(config, lmath, fe, fcb)));
+	TEST_ASSERT(((ptm_mgau_t *)acmod->mgau)->mixw_cb != NULL);
+	printf("Comparing 4-bit to 8-bit mixture weights\n");
+	scores = score_utt(acmod, buf, nsamps, &nfr4);
+	TEST_EQUAL(nfr, nfr4);
+	for (i = 0; i < nfr; ++i)
+		TEST_EQUAL(0, memcmp(ref[i], scores[i],
+				     n_sen * sizeof(**scores)));
+	ckd_free_2d(scores);
+	scores_active = score_frames_active(acmod, buf, nsamps, &nfr4);
+	TEST_EQUAL(nfr, nfr4);
+	TEST_EQUAL(0, memcmp(ref_active, scores_active,
+			     nfr * n_sen * sizeof(*scores_active)));
+	ckd_free(scores_active);
+	printf("Comparing senone-major 4-bit to 8-bit mixture weights\n");
+	TEST_EQUAL(0, ptm_mgau_set_senmajor(acmod->mgau, TRUE));
+	scores = score_utt(acmod, buf, nsamps, &nfr4);
+	TEST_EQUAL(nfr, nfr4);
+	for (i = 0; i < nfr; ++i)
+		TEST_EQUAL(0, memcmp(ref[i], scores[i],
+				     n_sen * sizeof(**scores)));
+	acmod_free(acmod);
+
+	cmd_ln_set_str_extra_r(config, "_sendump", MODELDIR "/en-us/sendump");
+	remove(SENDUMP4FILE);
+	remove(SENDUMP8FILE);
+	ckd_free_2d(scores);
+	ckd_free_2d(ref);
+	ckd_free(ref_active);
+	ckd_free(buf);
+}
+
+/* There is no model with floating-point mixture weights in the tree,
+ * so we make random ones for en-us to test ms_mgau. */
+static void
+write_mixw(int n_sen, int n_feat, int n_cw)
+{
+	FILE *fh;
+	uint32 magic = 0x11223344, seed = 42;
+	int32 hdr[4];
+	float32 *pdf;
+	int i, j;
+
+	hdr[0] = n_sen;
+	hdr[1] = n_feat;
+	hdr[2] = n_cw;
+	hdr[3] = n_sen * n_feat * n_cw;
+	pdf = ckd_calloc(n_cw, sizeof(*pdf));
+	TEST_ASSERT(fh = fopen(MIXWFILE, "wb"));
+	fprintf(fh, "s3\nversion 1.0\nendhdr\n");
+	fwrite(&magic, sizeof(magic), 1, fh);
+	fwrite(hdr, sizeof(*hdr), 4, fh);
+	for (i = 0; i < n_sen * n_feat; ++i) {
+		for (j = 0; j < n_cw; ++j) {
+			seed = seed * 1103515245 + 12345;
+			pdf[j] = (float32)((seed >> 8) & 0xffff) + 1.0f;
+		}
+		fwrite(pdf, sizeof(*pdf), n_cw, fh);
+	}
+	fclose(fh);
+	ckd_free(pdf);
+}
+
+static acmod_t *
+ms_acmod_init(cmd_ln_t *config, logmath_t *lmath, fe_t *fe, feat_t *fcb)
+{
+	acmod_t *acmod;
+
+	/* The PTM scorer would happily read these mixture weights, so
+	 * replace it. */
+	TEST_ASSERT((acmod = acmod_init(config, lmath, fe, fcb)));
+	ps_mgau_free(acmod->mgau);
+	TEST_ASSERT((acmod->mgau = ms_mgau_init(acmod)));
+	TEST_EQUAL(0, strcmp(acmod->mgau->vt->name, "ms"));
+	return acmod;
+}
+
+void
+run_ms_thread_test(cmd_ln_t *config, logmath_t *lmath, fe_t *fe, feat_t *fcb)
+{
+	FILE *rawfh;
+	int16 *buf, **ref, **scores, *ref_active, *scores_active;
+	size_t nsamps;
+	acmod_t *acmod;
+	ptm_mgau_t *s;
+	int i, nfr, thr_nfr, n_sen;
+
+	TEST_ASSERT(rawfh = fopen(TESTDATADIR "/goforward.raw", "rb"));
+	fseek(rawfh, 0, SEEK_END);
+	nsamps = ftell(rawfh) / sizeof(*buf);
+	fseek(rawfh, 0, SEEK_SET);
+	buf = ckd_calloc(nsamps, sizeof(*buf));
+	TEST_EQUAL(nsamps, fread(buf, sizeof(*buf), nsamps, rawfh));
+	fclose(rawfh);
+
+	TEST_ASSERT((acmod = acmod_init(config, lmath, fe, fcb)));
+	s = (ptm_mgau_t *)acmod->mgau;
+	write_mixw(s->n_sen, s->g->n_feat, s->g->n_density);
+	acmod_free(acmod);
+	cmd_ln_set_str_extra_r(config, "_sendump", NULL);
+	cmd_ln_set_str_extra_r(config, "_mixw", MIXWFILE);
+
+	acmod = ms_acmod_init(config, lmath, fe, fcb);
+	n_sen = bin_mdef_n_sen(acmod->mdef);
+	ref = score_utt(acmod, buf, nsamps, &nfr);
+	ref_active = score_frames_active(acmod, buf, nsamps, &nfr);
+	acmod_free(acmod);
+
+	/* Both the codebooks and the senones are split among the
+	 * threads, which must not change the scores. */
+	cmd_ln_set_int32_r(config, "-nthreads", 3);
+	acmod = ms_acmod_init(config, lmath, fe, fcb);
+	printf("Comparing 3 threads to 1 thread (ms)\n");
+	scores = score_utt(acmod, buf, nsamps, &thr_nfr);
+	TEST_EQUAL(nfr, thr_nfr);
+	for (i = 0; i < nfr; ++i)
+		TEST_EQUAL(0, memcmp(ref[i], scores[i],
+				     n_sen * sizeof(**scores)));
+	scores_active = score_frames_active(acmod, buf, nsamps, &thr_nfr);
+	TEST_EQUAL(nfr, thr_nfr);
+	TEST_EQUAL(0, memcmp(ref_active, scores_active,
+			     nfr * n_sen * sizeof(*scores_active)));
+	acmod_free(acmod);
+	cmd_ln_set_int32_r(config, "-nthreads", 1);
+
+	cmd_ln_set_str_extra_r(config, "_mixw", NULL);
+	cmd_ln_set_str_extra_r(config, "_sendump", MODELDIR "/en-us/sendump");
+	remove(MIXWFILE);
+	ckd_free(scores_active);
+	ckd_free(ref_active);
+	ckd_free_2d(scores);
+	ckd_free_2d(ref);
+	ckd_free(buf);
+}
+
+void
+run_block_test(cmd_ln_t *config, logmath_t *lmath, fe_t *fe, feat_t *fcb)
+{
+	static const int blocks[] = { 2, 16, 1000 };
+	FILE *rawfh;
+	int16 *buf, **ref;
+	size_t nsamps;
+	acmod_t *acmod;
+	int i, nfr, n_sen;
+
+	TEST_ASSERT(rawfh = fopen(TESTDATADIR "/goforward.raw", "rb"));
+	fseek(rawfh, 0, SEEK_END);
+	nsamps = ftell(rawfh) / sizeof(*buf);
+	fseek(rawfh, 0, SEEK_SET);
+	buf = ckd_calloc(nsamps, sizeof(*buf));
+	TEST_EQUAL(nsamps, fread(buf, sizeof(*buf), nsamps, rawfh));
+	fclose(rawfh);
+
+	TEST_ASSERT((acmod = acmod_init(config, lmath, fe, fcb)));
+	n_sen = bin_mdef_n_sen(acmod->mdef);
+	ref = score_utt(acmod, buf, nsamps, &nfr);
+	acmod_free(acmod);
+
+	/* With -compallsen all codebooks are active anyway, so blocked
+	 * evaluation should give the same scores. */
+	for (i = 0; i < (int)(sizeof(blocks) / sizeof(blocks[0])); ++i) {
+		int16 **scores;
+		int j, block_nfr;
+
+		cmd_ln_set_int32_r(config, "-gmmblock", blocks[i]);
+		cmd_ln_set_int32_r(config, "-nthreads", 1 + i % 2);
+		TEST_ASSERT((acmod = acmod_init(config, lmath, fe, fcb)));
+		TEST_EQUAL(blocks[i], acmod->block_size);
+		printf("Comparing blocks of %d frames (%d threads) to single frames\n",
+		       blocks[i], 1 + i % 2);
+		scores = score_utt(acmod, buf, nsamps, &block_nfr);
+		TEST_EQUAL(nfr, block_nfr);
+		for (j = 0; j < nfr; ++j)
+			TEST_EQUAL(0, memcmp(ref[j], scores[j],
+					     n_sen * sizeof(**scores)));
+		ckd_free_2d(scores);
+		acmod_free(acmod);
+	}
+	cmd_ln_set_int32_r(config, "-gmmblock", 1);
+	cmd_ln_set_int32_r(config, "-nthreads", 1);
+	ckd_free_2d(ref);
+	ckd_free(buf);
+}
+
 int
 main(int argc, char *argv[])
 {
@@ -110,6 +676,7 @@ main(int argc, char *argv[])
 	cmd_ln_set_str_extra_r(config, "_sendump", MODELDIR "/en-us/sendump");
 	cmd_ln_set_str_extra_r(config, "_mixw", NULL);
 	cmd_ln_set_str_extra_r(config, "_lda", NULL);
+	cmd_ln_set_str_extra_r(config, "_mlp", NULL);
 	cmd_ln_set_str_extra_r(config, "_senmgau", NULL);	
 	
 	TEST_ASSERT(config);
@@ -133,6 +700,13 @@ main(int argc, char *argv[])
 	}
 	E_INFOCONT("-%d\n", i-1);
 	run_acmod_test(acmod);
+	run_simd_test(config, lmath, fe, fcb);
+	run_boundary_test(config, lmath, fe, fcb);
+	run_senmajor_test(config, lmath, fe, fcb);
+	run_4bit_test(config, lmath, fe, fcb);
+	run_thread_test(config, lmath, fe, fcb);
+	run_ms_thread_test(config, lmath, fe, fcb);
+	run_block_test(config, lmath, fe, fcb);
 
 #if 0
 	/* Replace it with ms_mgau. */
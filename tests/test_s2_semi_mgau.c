@@ -0,0 +1,303 @@
+/* -*- c-basic-offset: 4 -*- */
+#include "config.h"
+
+#include <stdio.h>
+#include <string.h>
+
+#include <soundswallower/pocketsphinx.h>
+#include <soundswallower/pocketsphinx_internal.h>
+#include <soundswallower/s2_semi_mgau.h>
+#include <soundswallower/simd.h>
+#include <soundswallower/bitvec.h>
+
+#include "test_macros.h"
+
+/* There is no semi-continuous model with 4-bit mixture weights in
+ * the tree, so we make one out of the first codebook of en-us. */
+#define MEANFILE "test_s2_semi_mgau.means"
+#define VARFILE "test_s2_semi_mgau.variances"
+#define SENDUMPFILE "test_s2_semi_mgau.sendump"
+
+static const mfcc_t cmninit[13] = {
+    FLOAT2MFCC(41.00),
+    FLOAT2MFCC(-5.29),
+    FLOAT2MFCC(-0.12),
+    FLOAT2MFCC(5.09),
+    FLOAT2MFCC(2.48),
+    FLOAT2MFCC(-4.07),
+    FLOAT2MFCC(-1.37),
+    FLOAT2MFCC(-1.78),
+    FLOAT2MFCC(-5.08),
+    FLOAT2MFCC(-2.05),
+    FLOAT2MFCC(-6.45),
+    FLOAT2MFCC(-1.42),
+    FLOAT2MFCC(1.17)
+};
+
+static void
+write_first_codebook(const char *infile, const char *outfile)
+{
+    s3file_t *s;
+    FILE *fh;
+    int32 n_mgau, n_feat, n_density, veclen[3], n, blk;
+    uint32 magic = 0x11223344;
+    float32 *buf;
+
+    TEST_ASSERT(s = s3file_map_file(infile));
+    TEST_EQUAL(0, s3file_parse_header(s, NULL));
+    TEST_EQUAL(1, s3file_get(&n_mgau, sizeof(int32), 1, s));
+    TEST_EQUAL(1, s3file_get(&n_feat, sizeof(int32), 1, s));
+    TEST_EQUAL(1, s3file_get(&n_density, sizeof(int32), 1, s));
+    TEST_EQUAL(3, n_feat);
+    TEST_EQUAL(3, s3file_get(veclen, sizeof(int32), 3, s));
+    TEST_EQUAL(1, s3file_get(&n, sizeof(int32), 1, s));
+    blk = n_density * (veclen[0] + veclen[1] + veclen[2]);
+    buf = ckd_calloc(blk, sizeof(*buf));
+    TEST_EQUAL((size_t)blk, s3file_get(buf, sizeof(*buf), blk, s));
+    s3file_free(s);
+
+    TEST_ASSERT(fh = fopen(outfile, "wb"));
+    fprintf(fh, "s3\nversion 1.0\nendhdr\n");
+    fwrite(&magic, sizeof(magic), 1, fh);
+    n_mgau = 1;
+    fwrite(&n_mgau, sizeof(int32), 1, fh);
+    fwrite(&n_feat, sizeof(int32), 1, fh);
+    fwrite(&n_density, sizeof(int32), 1, fh);
+    fwrite(veclen, sizeof(int32), 3, fh);
+    fwrite(&blk, sizeof(int32), 1, fh);
+    fwrite(buf, sizeof(*buf), blk, fh);
+    fclose(fh);
+    ckd_free(buf);
+}
+
+static void
+write_string(FILE *fh, const char *str)
+{
+    int32 len = strlen(str) + 1;
+    fwrite(&len, sizeof(len), 1, fh);
+    fwrite(str, 1, len, fh);
+}
+
+static void
+write_sendump(int n_sen)
+{
+    FILE *fh;
+    char str[64];
+    uint8 cb[16], *row;
+    uint32 seed = 42;
+    int32 zero = 0;
+    int i, j, rowlen;
+
+    TEST_ASSERT(fh = fopen(SENDUMPFILE, "wb"));
+    write_string(fh, "test_s2_semi_mgau");
+    write_string(fh, "4-bit mixture weights");
+    write_string(fh, "feature_count 3");
+    write_string(fh, "mixture_count 128");
+    sprintf(str, "model_count %d", n_sen);
+    write_string(fh, str);
+    write_string(fh, "cluster_count 16");
+    write_string(fh, "cluster_bits 4");
+    fwrite(&zero, sizeof(zero), 1, fh);
+    /* Keep weights plus densities within the add table. */
+    for (i = 0; i < 16; ++i)
+        cb[i] = i * 9;
+    fwrite(cb, 1, 16, fh);
+    rowlen = (n_sen + 1) / 2;
+    row = ckd_calloc(rowlen, 1);
+    for (i = 0; i < 3 * 128; ++i) {
+        for (j = 0; j < rowlen; ++j) {
+            seed = seed * 1103515245 + 12345;
+            row[j] = seed >> 16;
+        }
+        fwrite(row, 1, rowlen, fh);
+    }
+    ckd_free(row);
+    fclose(fh);
+}
+
+/* Activate a different, more or less sparse, set of senones in each
+ * frame, including the ones at the end which are done one by one. */
+static void
+activate_senones(acmod_t *acmod, int frame)
+{
+    int n_sen = bin_mdef_n_sen(acmod->mdef);
+    int i, step = 1 + (frame % 4) * 7;
+
+    acmod_clear_active(acmod);
+    for (i = frame % 3; i < n_sen; i += step)
+        bitvec_set(acmod->senone_active_vec, i);
+    for (i = n_sen - 5; i < n_sen; ++i)
+        bitvec_set(acmod->senone_active_vec, i);
+}
+
+static int16 **
+score_utt(acmod_t *acmod, int16 const *buf, size_t nsamps, int *out_nfr)
+{
+    int16 **scores;
+    int n_sen, nfr;
+
+    n_sen = bin_mdef_n_sen(acmod->mdef);
+    cmn_live_set(acmod->fcb->cmn_struct, cmninit);
+    TEST_EQUAL(0, acmod_start_utt(acmod));
+    acmod_process_raw(acmod, &buf, &nsamps, TRUE);
+    TEST_EQUAL(0, acmod_end_utt(acmod));
+    scores = ckd_calloc_2d(acmod->n_feat_frame, n_sen, sizeof(**scores));
+    nfr = 0;
+    while (acmod->n_feat_frame > 0) {
+        int frame_idx = -1;
+        int16 const *senscr;
+        if (!acmod->compallsen)
+            activate_senones(acmod, nfr);
+        senscr = acmod_score(acmod, &frame_idx);
+        TEST_EQUAL(nfr, frame_idx);
+        memcpy(scores[nfr++], senscr, n_sen * sizeof(*senscr));
+        acmod_advance(acmod);
+    }
+    *out_nfr = nfr;
+    return scores;
+}
+
+static void
+run_simd_test(cmd_ln_t *config, logmath_t *lmath, fe_t *fe, feat_t *fcb,
+              int16 const *buf, size_t nsamps)
+{
+    static const int levels[] = {
+        SIMD_AVX2, SIMD_NEON
+    };
+    int16 **ref;
+    acmod_t *acmod;
+    int i, nfr, n_sen;
+
+    TEST_ASSERT((acmod = acmod_init(config, lmath, fe, fcb)));
+    TEST_EQUAL(0, strcmp(acmod->mgau->vt->name, "s2_semi"));
+    TEST_ASSERT(((s2_semi_mgau_t *)acmod->mgau)->mixw_cb != NULL);
+    TEST_EQUAL(SIMD_NONE, s2_semi_mgau_set_simd(acmod->mgau, SIMD_NONE));
+    n_sen = bin_mdef_n_sen(acmod->mdef);
+    ref = score_utt(acmod, buf, nsamps, &nfr);
+    acmod_free(acmod);
+
+    for (i = 0; i < (int)(sizeof(levels) / sizeof(levels[0])); ++i) {
+        int16 **scores;
+        int j, simd_nfr;
+
+        if (levels[i] > (int)simd_detect())
+            continue;
+        TEST_ASSERT((acmod = acmod_init(config, lmath, fe, fcb)));
+        if (s2_semi_mgau_set_simd(acmod->mgau, levels[i]) != levels[i]) {
+            acmod_free(acmod);
+            continue;
+        }
+        printf("Comparing %s to scalar 4-bit weights (topn %d, compallsen %d)\n",
+               simd_level_name(levels[i]),
+               (int)cmd_ln_int_r(config, "-topn"),
+               (int)cmd_ln_boolean_r(config, "-compallsen"));
+        scores = score_utt(acmod, buf, nsamps, &simd_nfr);
+        TEST_EQUAL(nfr, simd_nfr);
+        for (j = 0; j < nfr; ++j)
+            TEST_EQUAL(0, memcmp(ref[j], scores[j],
+                                 n_sen * sizeof(**scores)));
+        ckd_free_2d(scores);
+        acmod_free(acmod);
+    }
+    ckd_free_2d(ref);
+}
+
+static void
+run_thread_test(cmd_ln_t *config, logmath_t *lmath, fe_t *fe, feat_t *fcb,
+                int16 const *buf, size_t nsamps)
+{
+    int16 **ref, **scores;
+    acmod_t *acmod;
+    int j, nfr, thr_nfr, n_sen;
+
+    TEST_ASSERT((acmod = acmod_init(config, lmath, fe, fcb)));
+    n_sen = bin_mdef_n_sen(acmod->mdef);
+    ref = score_utt(acmod, buf, nsamps, &nfr);
+    acmod_free(acmod);
+
+    /* Each thread does one feature stream, which must not change
+     * the scores. */
+    cmd_ln_set_int_r(config, "-nthreads", 3);
+    TEST_ASSERT((acmod = acmod_init(config, lmath, fe, fcb)));
+    TEST_EQUAL(3, workpool_n_workers(((s2_semi_mgau_t *)acmod->mgau)->pool));
+    printf("Comparing 3 threads to 1 thread (topn %d, compallsen %d)\n",
+           (int)cmd_ln_int_r(config, "-topn"),
+           (int)cmd_ln_boolean_r(config, "-compallsen"));
+    scores = score_utt(acmod, buf, nsamps, &thr_nfr);
+    TEST_EQUAL(nfr, thr_nfr);
+    for (j = 0; j < nfr; ++j)
+        TEST_EQUAL(0, memcmp(ref[j], scores[j], n_sen * sizeof(**scores)));
+    acmod_free(acmod);
+    cmd_ln_set_int_r(config, "-nthreads", 1);
+
+    ckd_free_2d(scores);
+    ckd_free_2d(ref);
+}
+
+int
+main(int argc, char *argv[])
+{
+    static const int topns[] = { 1, 4, 6 };
+    logmath_t *lmath;
+    cmd_ln_t *config;
+    bin_mdef_t *mdef;
+    fe_t *fe;
+    feat_t *fcb;
+    FILE *rawfh;
+    int16 *buf;
+    size_t nsamps;
+    int i;
+
+    (void)argc; (void)argv;
+    TEST_ASSERT(mdef = bin_mdef_read(NULL, MODELDIR "/en-us/mdef.bin"));
+    write_first_codebook(MODELDIR "/en-us/means", MEANFILE);
+    write_first_codebook(MODELDIR "/en-us/variances", VARFILE);
+    write_sendump(bin_mdef_n_sen(mdef));
+    bin_mdef_free(mdef);
+
+    TEST_ASSERT(rawfh = fopen(TESTDATADIR "/goforward.raw", "rb"));
+    fseek(rawfh, 0, SEEK_END);
+    nsamps = ftell(rawfh) / sizeof(*buf);
+    fseek(rawfh, 0, SEEK_SET);
+    buf = ckd_calloc(nsamps, sizeof(*buf));
+    TEST_EQUAL(nsamps, fread(buf, sizeof(*buf), nsamps, rawfh));
+    fclose(rawfh);
+
+    lmath = logmath_init(1.0001, 0, 0);
+    config = cmd_ln_init(NULL, ps_args(), TRUE,
+                         "-input_endian", "little", /* raw data demands it */
+                         NULL);
+    TEST_ASSERT(config);
+    cmd_ln_parse_file_r(config, ps_args(), MODELDIR "/en-us/feat.params", FALSE);
+    cmd_ln_set_str_extra_r(config, "_mdef", MODELDIR "/en-us/mdef.bin");
+    cmd_ln_set_str_extra_r(config, "_mean", MEANFILE);
+    cmd_ln_set_str_extra_r(config, "_var", VARFILE);
+    cmd_ln_set_str_extra_r(config, "_tmat", MODELDIR "/en-us/transition_matrices");
+    cmd_ln_set_str_extra_r(config, "_sendump", SENDUMPFILE);
+    cmd_ln_set_str_extra_r(config, "_mixw", NULL);
+    cmd_ln_set_str_extra_r(config, "_lda", NULL);
+    cmd_ln_set_str_extra_r(config, "_mlp", NULL);
+    cmd_ln_set_str_extra_r(config, "_senmgau", NULL);
+    fe = fe_init(config);
+    fcb = feat_init(config);
+
+    for (i = 0; i < (int)(sizeof(topns) / sizeof(topns[0])); ++i) {
+        cmd_ln_set_int_r(config, "-topn", topns[i]);
+        cmd_ln_set_boolean_r(config, "-compallsen", TRUE);
+        run_simd_test(config, lmath, fe, fcb, buf, nsamps);
+        run_thread_test(config, lmath, fe, fcb, buf, nsamps);
+        cmd_ln_set_boolean_r(config, "-compallsen", FALSE);
+        run_simd_test(config, lmath, fe, fcb, buf, nsamps);
+        run_thread_test(config, lmath, fe, fcb, buf, nsamps);
+    }
+
+    ckd_free(buf);
+    fe_free(fe);
+    feat_free(fcb);
+    logmath_free(lmath);
+    cmd_ln_free_r(config);
+    remove(MEANFILE);
+    remove(VARFILE);
+    remove(SENDUMPFILE);
+    return 0;
+}
@@ -0,0 +1,154 @@
+/* -*- c-basic-offset: 4 -*- */
+#include "config.h"
+
+#include <stdio.h>
+#include <string.h>
+
+#include <soundswallower/pocketsphinx.h>
+#include <soundswallower/pocketsphinx_internal.h>
+
+#include "test_macros.h"
+
+/* Score all of goforward.raw with the decoder's own acoustic model. */
+static int16 *
+score_utt(ps_decoder_t *ps, int *out_nfr)
+{
+    acmod_t *acmod = ps->acmod;
+    FILE *rawfh;
+    int16 *buf, *scores;
+    int16 const *bptr;
+    size_t nsamps;
+    int n_sen, nfr;
+
+    TEST_ASSERT(rawfh = fopen(TESTDATADIR "/goforward.raw", "rb"));
+    fseek(rawfh, 0, SEEK_END);
+    nsamps = ftell(rawfh) / sizeof(*buf);
+    fseek(rawfh, 0, SEEK_SET);
+    buf = ckd_calloc(nsamps, sizeof(*buf));
+    TEST_EQUAL(nsamps, fread(buf, sizeof(*buf), nsamps, rawfh));
+    fclose(rawfh);
+
+    n_sen = bin_mdef_n_sen(acmod->mdef);
+    TEST_EQUAL(0, acmod_start_utt(acmod));
+    bptr = buf;
+    acmod_process_raw(acmod, &bptr, &nsamps, TRUE);
+    TEST_EQUAL(0, acmod_end_utt(acmod));
+    ckd_free(buf);
+    scores = ckd_calloc((size_t)acmod->n_feat_frame * n_sen, sizeof(*scores));
+    nfr = 0;
+    while (acmod->n_feat_frame > 0) {
+        int16 const *senscr;
+        TEST_ASSERT(senscr = acmod_score(acmod, NULL));
+        memcpy(scores + (size_t)nfr * n_sen, senscr, n_sen * sizeof(*senscr));
+        acmod_advance(acmod);
+        ++nfr;
+    }
+    *out_nfr = nfr;
+    return scores;
+}
+
+static const char *
+decode_raw(ps_decoder_t *ps, int16 const *scores, int32 *score)
+{
+    FILE *rawfh;
+    int16 *buf;
+    size_t nsamps;
+
+    TEST_ASSERT(rawfh = fopen(TESTDATADIR "/goforward.raw", "rb"));
+    fseek(rawfh, 0, SEEK_END);
+    nsamps = ftell(rawfh) / sizeof(*buf);
+    fseek(rawfh, 0, SEEK_SET);
+    buf = ckd_calloc(nsamps, sizeof(*buf));
+    TEST_EQUAL(nsamps, fread(buf, sizeof(*buf), nsamps, rawfh));
+    fclose(rawfh);
+    TEST_EQUAL(0, ps_start_utt(ps));
+    TEST_ASSERT(ps_process_raw(ps, buf, nsamps, FALSE, TRUE) > 0);
+    /* Can't switch to scores now. */
+    TEST_ASSERT(ps_process_senscr(ps, scores, bin_mdef_n_sen(ps->acmod->mdef),
+                                  1, FALSE) < 0);
+    TEST_EQUAL(0, ps_end_utt(ps));
+    ckd_free(buf);
+    return ps_get_hyp(ps, score);
+}
+
+static const char *
+decode_senscr(ps_decoder_t *ps, int16 const *scores, int nfr,
+              int blksize, int no_search, int32 *score, int *out_n_frames)
+{
+    int n_sen = bin_mdef_n_sen(ps->acmod->mdef);
+    int i;
+
+    TEST_EQUAL(0, ps_start_utt(ps));
+    for (i = 0; i < nfr; i += blksize) {
+        int n = nfr - i < blksize ? nfr - i : blksize;
+        TEST_ASSERT(ps_process_senscr(ps, scores + (size_t)i * n_sen,
+                                      n_sen, n, no_search) >= 0);
+    }
+    TEST_EQUAL(0, ps_end_utt(ps));
+    *out_n_frames = ps_get_n_frames(ps);
+    return ps_get_hyp(ps, score);
+}
+
+int
+main(int argc, char *argv[])
+{
+    static const int blksizes[] = { 1, 7, 64, 1000 };
+    ps_decoder_t *ps;
+    cmd_ln_t *config;
+    int16 *scores;
+    int16 buf[256];
+    const char *hyp;
+    int32 score, score2;
+    int i, nfr, n_sen, n_frames, n_frames2;
+
+    (void)argc; (void)argv;
+    TEST_ASSERT(config =
+            cmd_ln_init(NULL, ps_args(), TRUE,
+			"-hmm", MODELDIR "/en-us",
+			"-fsg", TESTDATADIR "/goforward.fsg",
+			"-dict", TESTDATADIR "/turtle.dic",
+			"-compallsen", "yes",
+			"-input_endian", "little", /* raw data demands it */
+			"-samprate", "16000", NULL));
+    TEST_ASSERT(ps = ps_init(config));
+    n_sen = bin_mdef_n_sen(ps->acmod->mdef);
+
+    scores = score_utt(ps, &nfr);
+    hyp = decode_raw(ps, scores, &score);
+    printf("%s (%d)\n", hyp, score);
+    TEST_EQUAL(0, strcmp("go forward ten meters", hyp));
+    n_frames = ps_get_n_frames(ps);
+
+    /* Same result from the scores, however they are fed in. */
+    for (i = 0; i < (int)(sizeof(blksizes) / sizeof(blksizes[0])); ++i) {
+        hyp = decode_senscr(ps, scores, nfr, blksizes[i], FALSE, &score2,
+                            &n_frames2);
+        printf("%d: %s (%d)\n", blksizes[i], hyp, score2);
+        TEST_EQUAL(0, strcmp("go forward ten meters", hyp));
+        TEST_EQUAL(score, score2);
+        TEST_EQUAL(n_frames, n_frames2);
+        hyp = decode_senscr(ps, scores, nfr, blksizes[i], TRUE, &score2,
+                            &n_frames2);
+        TEST_EQUAL(0, strcmp("go forward ten meters", hyp));
+        TEST_EQUAL(score, score2);
+        TEST_EQUAL(n_frames, n_frames2);
+    }
+
+    /* Wrong number of senones, and mixing scores with audio. */
+    TEST_EQUAL(0, ps_start_utt(ps));
+    TEST_ASSERT(ps_process_senscr(ps, scores, n_sen - 1, 1, FALSE) < 0);
+    TEST_ASSERT(ps_process_senscr(ps, scores, n_sen, 1, FALSE) >= 0);
+    memset(buf, 0, sizeof(buf));
+    TEST_ASSERT(ps_process_raw(ps, buf, 256, FALSE, FALSE) < 0);
+    TEST_EQUAL(0, ps_end_utt(ps));
+
+    /* And audio works again afterwards. */
+    hyp = decode_raw(ps, scores, &score2);
+    TEST_EQUAL(0, strcmp("go forward ten meters", hyp));
+    TEST_EQUAL(score, score2);
+
+    ckd_free(scores);
+    ps_free(ps);
+    cmd_ln_free_r(config);
+    return 0;
+}
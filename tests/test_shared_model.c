@@ -0,0 +1,149 @@
+/* -*- c-basic-offset: 4 -*- */
+#include "config.h"
+
+#include <soundswallower/pocketsphinx.h>
+#include <stdio.h>
+#include <string.h>
+
+#include <soundswallower/pocketsphinx_internal.h>
+#include <soundswallower/ptm_mgau.h>
+
+#include "test_macros.h"
+
+/* Decode goforward.raw with several decoders at once, a block at a
+ * time for each in turn, so that any scoring state which is
+ * accidentally shared between them will mess things up. */
+static void
+decode_together(ps_decoder_t **ps, int n_ps, int32 *scores)
+{
+    FILE *rawfh;
+    int16 buf[2048];
+    size_t nread;
+    int i;
+
+    TEST_ASSERT(rawfh = fopen(TESTDATADIR "/goforward.raw", "rb"));
+    for (i = 0; i < n_ps; ++i)
+        TEST_EQUAL(0, ps_start_utt(ps[i]));
+    while (!feof(rawfh)) {
+	nread = fread(buf, sizeof(*buf), sizeof(buf)/sizeof(*buf), rawfh);
+        for (i = 0; i < n_ps; ++i)
+            ps_process_raw(ps[i], buf, nread, FALSE, FALSE);
+    }
+    fclose(rawfh);
+    for (i = 0; i < n_ps; ++i) {
+        const char *hyp;
+        TEST_EQUAL(0, ps_end_utt(ps[i]));
+        hyp = ps_get_hyp(ps[i], &scores[i]);
+        printf("%d: %s (%d)\n", i, hyp, scores[i]);
+        TEST_EQUAL(0, strcmp("go forward ten meters", hyp));
+    }
+}
+
+int
+main(int argc, char *argv[])
+{
+    ps_decoder_t *ps[4];
+    ps_model_t *model;
+    cmd_ln_t *config, *config2;
+    ptm_mgau_t *s0, *s1;
+    char *phones, *phones2;
+    int32 scores[4], first_score;
+    int i;
+
+    (void)argc; (void)argv;
+    TEST_ASSERT(config =
+            cmd_ln_init(NULL, ps_args(), TRUE,
+			"-hmm", MODELDIR "/en-us",
+			"-fsg", TESTDATADIR "/goforward.fsg",
+			"-dict", TESTDATADIR "/turtle.dic",
+			"-input_endian", "little", /* raw data demands it */
+			"-bestpath", "no",
+			"-samprate", "16000", NULL));
+    /* A decoder with its own model, for reference. */
+    TEST_ASSERT(ps[0] = ps_init(config));
+    /* Two sharing a model loaded on its own (which they retain). */
+    TEST_ASSERT(model = ps_model_init(config));
+    TEST_ASSERT(ps[1] = ps_init_shared(model, config));
+    TEST_ASSERT(ps[2] = ps_init_shared(model, config));
+    TEST_EQUAL(model, ps_get_model(ps[1]));
+    TEST_EQUAL(1, ps_model_free(model) > 0);
+    /* And one sharing the model of the reference decoder. */
+    TEST_ASSERT(ps[3] = ps_init_shared(ps_get_model(ps[0]), config));
+    /* Which does not share the state of its acmod. */
+    model = ps_get_model(ps[0]);
+    TEST_ASSERT(model->acmod != ps[0]->acmod);
+    TEST_ASSERT(model->acmod->fe != ps[0]->fe);
+    TEST_ASSERT(model->acmod->fcb != ps[0]->fcb);
+    TEST_EQUAL(model->acmod, ps[0]->acmod->shared);
+
+    /* Parameters are the same, scoring state isn't. */
+    TEST_EQUAL(ps[1]->acmod->mdef, ps[2]->acmod->mdef);
+    TEST_EQUAL(ps[1]->acmod->tmat, ps[2]->acmod->tmat);
+    TEST_EQUAL(ps[1]->dict, ps[2]->dict);
+    TEST_EQUAL(ps[0]->acmod->mdef, ps[3]->acmod->mdef);
+    s0 = (ptm_mgau_t *)ps[1]->acmod->mgau;
+    s1 = (ptm_mgau_t *)ps[2]->acmod->mgau;
+    TEST_EQUAL(s0->g, s1->g);
+    TEST_EQUAL(s0->mixw, s1->mixw);
+    TEST_ASSERT(s0->hist != s1->hist);
+    TEST_ASSERT(ps[1]->acmod->senone_scores != ps[2]->acmod->senone_scores);
+
+    /* Nor can they be adapted. */
+    TEST_EQUAL(NULL, ps_update_mllr(ps[1], NULL));
+    TEST_EQUAL(NULL, ps_update_mllr(ps[0], NULL));
+
+    decode_together(ps, 4, scores);
+    for (i = 1; i < 4; ++i)
+        TEST_EQUAL(scores[0], scores[i]);
+    first_score = scores[0];
+
+    /* Adding a word only affects one decoder. */
+    TEST_ASSERT(ps_add_word(ps[2], "_forward", "F AO R W ER D", TRUE) != -1);
+    TEST_ASSERT(ps[1]->dict != ps[2]->dict);
+    phones = ps_lookup_word(ps[2], "_forward");
+    TEST_EQUAL(0, strcmp(phones, "F AO R W ER D"));
+    ckd_free(phones);
+    TEST_EQUAL(NULL, ps_lookup_word(ps[1], "_forward"));
+    /* And the rest of the dictionary is still there. */
+    phones = ps_lookup_word(ps[1], "forward");
+    phones2 = ps_lookup_word(ps[2], "forward");
+    TEST_EQUAL(0, strcmp(phones, phones2));
+    ckd_free(phones);
+    ckd_free(phones2);
+
+    /* Reinitializing keeps the model. */
+    TEST_EQUAL(0, ps_reinit(ps[2], NULL));
+    TEST_EQUAL(ps[1]->acmod->mdef, ps[2]->acmod->mdef);
+    TEST_EQUAL(ps[1]->dict, ps[2]->dict);
+
+    /* Which also resets CMN, so it should do what it did the first
+     * time, while the others have adapted to the first utterance. */
+    decode_together(ps, 4, scores);
+    TEST_EQUAL(first_score, scores[2]);
+    TEST_EQUAL(scores[0], scores[1]);
+    TEST_EQUAL(scores[0], scores[3]);
+
+    /* Reinitializing one that was not created with a model loads its
+     * own again, even if others share the one it had. */
+    TEST_ASSERT(config2 =
+            cmd_ln_init(NULL, ps_args(), TRUE,
+                        "-hmm", MODELDIR "/en-us",
+                        "-fsg", TESTDATADIR "/goforward.fsg",
+                        "-input_endian", "little",
+                        "-bestpath", "no",
+                        "-samprate", "16000", NULL));
+    TEST_EQUAL(0, ps_reinit(ps[0], config2));
+    TEST_EQUAL(NULL, ps[0]->model);
+    TEST_ASSERT(ps[0]->acmod->mdef != ps[3]->acmod->mdef);
+    TEST_ASSERT(dict_size(ps[0]->dict) > dict_size(ps[3]->dict));
+    /* And the others can still use it. */
+    decode_together(ps, 4, scores);
+    cmd_ln_free_r(config2);
+
+    /* Free the reference decoder first, its model has to stay. */
+    for (i = 0; i < 4; ++i)
+        TEST_EQUAL(0, ps_free(ps[i]));
+    cmd_ln_free_r(config);
+
+    return 0;
+}
@@ -0,0 +1,154 @@
+/* -*- c-basic-offset: 4 -*- */
+#include "config.h"
+
+#include <stdio.h>
+#include <string.h>
+
+#include <soundswallower/pocketsphinx.h>
+#include <soundswallower/pocketsphinx_internal.h>
+#include <soundswallower/vad.h>
+
+#include "test_macros.h"
+
+/* Lead in with this much silence (from the start of the file), so
+ * that there is something to drop. */
+#define N_LEADIN 16000
+
+static int16 *
+read_audio(size_t *out_nsamps)
+{
+    FILE *rawfh;
+    int16 *buf;
+    size_t nsamps, i;
+
+    TEST_ASSERT(rawfh = fopen(TESTDATADIR "/goforward.raw", "rb"));
+    fseek(rawfh, 0, SEEK_END);
+    nsamps = ftell(rawfh) / sizeof(*buf);
+    fseek(rawfh, 0, SEEK_SET);
+    buf = ckd_calloc(nsamps + N_LEADIN, sizeof(*buf));
+    TEST_EQUAL(nsamps, fread(buf + N_LEADIN, sizeof(*buf), nsamps, rawfh));
+    fclose(rawfh);
+    /* The first 0.1s of the file is silence. */
+    for (i = 0; i < N_LEADIN; ++i)
+        buf[i] = buf[N_LEADIN + i % 1600];
+    *out_nsamps = nsamps + N_LEADIN;
+    return buf;
+}
+
+static const char *
+decode(ps_decoder_t *ps, int16 const *buf, size_t nsamps,
+       int *out_sf, int *out_ef)
+{
+    ps_seg_t *seg;
+    const char *hyp;
+    size_t i;
+
+    TEST_EQUAL(0, ps_start_utt(ps));
+    for (i = 0; i < nsamps; i += 2048) {
+        size_t n = nsamps - i < 2048 ? nsamps - i : 2048;
+        TEST_ASSERT(ps_process_raw(ps, buf + i, n, FALSE, FALSE) >= 0);
+    }
+    TEST_EQUAL(0, ps_end_utt(ps));
+    hyp = ps_get_hyp(ps, NULL);
+    /* Find where "go" and "meters" are. */
+    *out_sf = *out_ef = -1;
+    for (seg = ps_seg_iter(ps); seg; seg = ps_seg_next(seg)) {
+        if (0 == strcmp(ps_seg_word(seg), "go"))
+            ps_seg_frames(seg, out_sf, NULL);
+        if (0 == strcmp(ps_seg_word(seg), "meters"))
+            ps_seg_frames(seg, NULL, out_ef);
+    }
+    return hyp;
+}
+
+static void
+test_skip_map(void)
+{
+    cmd_ln_t *config;
+    vad_t *vad;
+
+    TEST_ASSERT(config = cmd_ln_init(NULL, ps_args(), TRUE,
+                                     "-vad_prespeech", "100",
+                                     NULL));
+    /* Leading context is limited to what fits. */
+    TEST_ASSERT(vad = vad_init(config, 50));
+    TEST_EQUAL(40, vad->prespeech);
+    vad_start(vad);
+    vad->n_held = 100;
+    TEST_EQUAL(0, vad_n_skipped(vad));
+    vad_skip(vad, 0, 30);
+    vad_skip(vad, 0, 10);
+    vad_skip(vad, 50, 20);
+    TEST_EQUAL(2, vad->n_skip);
+    TEST_EQUAL(60, vad_n_skipped(vad));
+    TEST_EQUAL(40, vad_input_frame(vad, 0));
+    TEST_EQUAL(89, vad_input_frame(vad, 49));
+    TEST_EQUAL(110, vad_input_frame(vad, 50));
+    TEST_EQUAL(160, vad_input_frame(vad, 100));
+    vad_start(vad);
+    TEST_EQUAL(100, vad_input_frame(vad, 100));
+    vad_free(vad);
+    cmd_ln_free_r(config);
+}
+
+int
+main(int argc, char *argv[])
+{
+    ps_decoder_t *ps;
+    cmd_ln_t *config;
+    int16 *buf;
+    size_t nsamps;
+    const char *hyp;
+    int sf, ef, vad_sf, vad_ef, nfr, nspeech;
+
+    (void)argc; (void)argv;
+    test_skip_map();
+    buf = read_audio(&nsamps);
+
+    TEST_ASSERT(config =
+            cmd_ln_init(NULL, ps_args(), TRUE,
+			"-hmm", MODELDIR "/en-us",
+			"-fsg", TESTDATADIR "/goforward.fsg",
+			"-dict", TESTDATADIR "/turtle.dic",
+			"-input_endian", "little", /* raw data demands it */
+			"-samprate", "16000", NULL));
+    TEST_ASSERT(ps = ps_init(config));
+    hyp = decode(ps, buf, nsamps, &sf, &ef);
+    printf("%s (%d to %d)\n", hyp, sf, ef);
+    TEST_EQUAL(0, strcmp("go forward ten meters", hyp));
+    nfr = ps_get_n_frames(ps);
+    ps_free(ps);
+
+    /* Leading and trailing silence is dropped, but the words are in
+     * (more or less) the same place. */
+    cmd_ln_set_boolean_r(config, "-vad", TRUE);
+    TEST_ASSERT(ps = ps_init(config));
+    hyp = decode(ps, buf, nsamps, &vad_sf, &vad_ef);
+    nspeech = ps->acmod->output_frame;
+    printf("%s (%d to %d), %d of %d frames searched\n",
+           hyp, vad_sf, vad_ef, nspeech, ps_get_n_frames(ps));
+    TEST_EQUAL(0, strcmp("go forward ten meters", hyp));
+    TEST_ASSERT(nspeech < nfr - 100);
+    TEST_EQUAL(nfr, ps_get_n_frames(ps));
+    TEST_ASSERT(vad_sf >= sf - 5 && vad_sf <= sf + 5);
+    TEST_ASSERT(vad_ef >= ef - 5 && vad_ef <= ef + 5);
+
+    /* And the noise floor carries over to the next utterance. */
+    hyp = decode(ps, buf, nsamps, &vad_sf, &vad_ef);
+    TEST_EQUAL(0, strcmp("go forward ten meters", hyp));
+    TEST_ASSERT(vad_sf >= sf - 5 && vad_sf <= sf + 5);
+
+    /* Silence alone doesn't get searched at all. */
+    TEST_EQUAL(0, ps_start_utt(ps));
+    TEST_ASSERT(ps_process_raw(ps, buf, N_LEADIN, FALSE, FALSE) >= 0);
+    TEST_EQUAL(0, ps_end_utt(ps));
+    printf("%d of %d frames searched\n",
+           ps->acmod->output_frame, ps_get_n_frames(ps));
+    TEST_ASSERT(ps->acmod->output_frame < 40);
+    TEST_ASSERT(ps_get_n_frames(ps) >= N_LEADIN / 160 - 2);
+
+    ckd_free(buf);
+    ps_free(ps);
+    cmd_ln_free_r(config);
+    return 0;
+}